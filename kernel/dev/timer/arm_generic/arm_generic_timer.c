@@ -244,6 +244,16 @@ uint64_t current_ticks(void)
     return read_ct();
 }
 
+bool platform_usermode_time_scale(struct fp_32_64* ns_per_tick)
+{
+    // zx_ticks_get() reads the virtual counter, which only matches the
+    // physical one when the virtual offset is zero.
+    if (reg_procs != &cntv_procs)
+        return false;
+    *ns_per_tick = ns_per_cntpct;
+    return true;
+}
+
 uint64_t ticks_per_second(void)
 {
     return u64_mul_u32_fp32_64(1000 * 1000 * 1000, cntpct_per_ns);
@@ -20,15 +20,25 @@ __BEGIN_CDECLS
 
 #define MUTEX_MAGIC (0x6D757478) // 'mutx'
 
+/* Track contention statistics per acquisition site, see the "mutexstats" command.
+ * Off by default; build with ENABLE_MUTEX_STATS=true to turn it on.
+ */
+#ifndef MUTEX_CONTENTION_STATS
+#define MUTEX_CONTENTION_STATS 0
+#endif
+
 /* Body of the mutex.
  * The val field holds either 0 or a pointer to the thread_t holding the mutex.
  * If one or more threads are blocking and queued up, MUTEX_FLAG_QUEUED is ORed in as well.
  * NOTE: MUTEX_FLAG_QUEUED is only manipulated under the THREAD_LOCK.
+ * While MUTEX_FLAG_QUEUED is set the mutex is on its holder's owned_mutexes list
+ * through owner_node, so the holder can inherit the waiters' priority.
  */
 typedef struct TA_CAP("mutex") mutex {
     uint32_t magic;
     uintptr_t val;
     wait_queue_t wait;
+    struct list_node owner_node;
 } mutex_t;
 
 #define MUTEX_FLAG_QUEUED ((uintptr_t)1)
@@ -49,6 +59,7 @@ static inline thread_t* mutex_holder(const mutex_t* m) {
         .magic = MUTEX_MAGIC,                       \
         .val = 0,                                   \
         .wait = WAIT_QUEUE_INITIAL_VALUE((m).wait), \
+        .owner_node = LIST_INITIAL_CLEARED_VALUE,   \
     }
 
 /* Rules for Mutexes:
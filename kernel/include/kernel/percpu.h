@@ -18,7 +18,7 @@ __BEGIN_CDECLS
 
 struct percpu {
     /* per cpu timer queue */
-    struct list_node timer_queue;
+    timer_queue_t timer_queue;
 
     /* per cpu preemption timer */
     timer_t preempt_timer;
@@ -31,6 +31,14 @@ struct percpu {
     /* 0 means no pending IPI */
     zx_time_t ipi_timestamp;
 
+    /* cpus to send a reschedule IPI to once this cpu drops the thread_lock */
+    cpu_mask_t deferred_resched_ipis;
+
+    /* the thread running on this cpu, updated under the thread_lock at each
+     * context switch. Other cpus may compare against it without the lock, but
+     * must not dereference it. */
+    thread_t* volatile curr_thread;
+
     /* thread/cpu level statistics */
     struct cpu_stats stats;
 
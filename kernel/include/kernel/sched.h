@@ -29,3 +29,13 @@ bool sched_unblock(thread_t* t) __WARN_UNUSED_RESULT;
 bool sched_unblock_list(struct list_node* list) __WARN_UNUSED_RESULT;
 
 void sched_transition_off_cpu(cpu_num_t old_cpu);
+
+/* queue reschedule IPIs for |mask|, to be sent once the thread_lock is dropped */
+void sched_queue_resched_ipis(cpu_mask_t mask);
+
+/* priority inheritance support for mutexes */
+int sched_get_effective_priority(const thread_t* t);
+
+/* set the priority |t| inherits from threads blocked on mutexes it holds, moving it
+ * between run queues if needed. return true if the current cpu should reschedule */
+bool sched_inherit_priority(thread_t* t, int priority) __WARN_UNUSED_RESULT;
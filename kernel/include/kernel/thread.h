@@ -93,6 +93,10 @@ typedef struct thread {
     int base_priority;
     int priority_boost;
 
+    /* priority inherited from the highest priority thread blocked on a mutex
+     * this thread holds, LOWEST_PRIORITY if none */
+    int inherited_priority;
+
     /* current cpu the thread is either running on or in the ready queue, undefined otherwise */
     cpu_num_t curr_cpu;
     cpu_num_t last_cpu;      /* last cpu the thread ran on, INVALID_CPU if it's never run */
@@ -117,12 +121,22 @@ typedef struct thread {
     /* if blocked, a pointer to the wait queue */
     struct wait_queue* blocking_wait_queue;
 
+    /* if blocked in mutex_acquire, the mutex being waited for */
+    struct mutex* blocking_mutex;
+
+    /* mutexes held by this thread that other threads are blocked on */
+    struct list_node owned_mutexes;
+
     /* return code if woken up abnormally from suspend, sleep, or block */
     zx_status_t blocked_status;
 
     /* are we allowed to be interrupted on the current thing we're blocked/sleeping on */
     bool interruptable;
 
+    /* set while the thread wakes a peer it is about to wait on, see
+     * thread_set_handoff_wakeup() */
+    bool handoff_wakeup;
+
     /* non-NULL if stopped in an exception */
     const struct arch_exception_context* exception_context;
 
@@ -282,13 +296,37 @@ static inline bool thread_is_real_time_or_idle(thread_t* t) {
 thread_t* get_current_thread(void);
 void set_current_thread(thread_t*);
 
-/* scheduler lock */
+/* While set, the next thread woken by the current thread (outside of interrupt
+ * context) is queued on the current cpu ahead of other threads of its priority
+ * and gets the rest of the current thread's time slice, instead of being sent
+ * to an idle cpu. Meant for synchronous IPC, where the waker is about to block
+ * on the woken thread: the two then trade this cpu instead of bouncing between
+ * cpus. The first such wakeup clears it.
+ */
+static inline void thread_set_handoff_wakeup(bool handoff) {
+    get_current_thread()->handoff_wakeup = handoff;
+}
+
+/* scheduler lock
+ *
+ * Covers thread state, every cpu's run queues and every wait queue. Reschedule
+ * IPIs are not sent while it is held; see thread_lock_release().
+ */
 extern spin_lock_t thread_lock;
 
+/* Release the thread_lock. Reschedule IPIs that the scheduler queued while the
+ * lock was held are sent only after it has been dropped, so that other cpus
+ * are not kept spinning on the lock while the interrupt controller is written.
+ * All paths that release the thread_lock must go through one of these rather
+ * than calling spin_unlock directly.
+ */
+void thread_lock_release(void) TA_REL(thread_lock);
+void thread_lock_release_irqrestore(spin_lock_saved_state_t state) TA_REL(thread_lock);
+
 #define THREAD_LOCK(state)         \
     spin_lock_saved_state_t state; \
     spin_lock_irqsave(&thread_lock, state)
-#define THREAD_UNLOCK(state) spin_unlock_irqrestore(&thread_lock, state)
+#define THREAD_UNLOCK(state) thread_lock_release_irqrestore(state)
 
 static inline bool thread_lock_held(void) {
     return spin_lock_held(&thread_lock);
@@ -327,7 +365,7 @@ public:
     }
 
     ~AutoThreadLock() {
-        spin_unlock_irqrestore(&thread_lock, state_);
+        thread_lock_release_irqrestore(state_);
     }
 
     DISALLOW_COPY_ASSIGN_AND_MOVE(AutoThreadLock);
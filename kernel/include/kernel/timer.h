@@ -28,9 +28,26 @@ enum slack_mode {
     TIMER_SLACK_EARLY,  // slack interval is (deadline - slack, dealine]
 };
 
+/* Per-cpu timer queues are AVL trees ordered by scheduled_time, timers with the
+ * same scheduled_time being kept in the order they were queued. */
+struct timer_queue;
+
+struct timer_queue_node {
+    struct timer* parent;
+    struct timer* left;
+    struct timer* right;
+    struct timer_queue* queue; // NULL if not queued
+    int height;
+};
+
+typedef struct timer_queue {
+    struct timer* root;
+    struct timer* head; // earliest timer, NULL if the queue is empty
+} timer_queue_t;
+
 typedef struct timer {
     int magic;
-    struct list_node node;
+    struct timer_queue_node node;
 
     zx_time_t scheduled_time;
     int64_t slack; // Stores the applied slack adjustment from
@@ -42,16 +59,16 @@ typedef struct timer {
     volatile bool cancel;    // true if cancel is pending
 } timer_t;
 
-#define TIMER_INITIAL_VALUE(t)              \
-    {                                       \
-        .magic = TIMER_MAGIC,               \
-        .node = LIST_INITIAL_CLEARED_VALUE, \
-        .scheduled_time = 0,                \
-        .slack = 0,                         \
-        .callback = NULL,                   \
-        .arg = NULL,                        \
-        .active_cpu = -1,                   \
-        .cancel = false,                    \
+#define TIMER_INITIAL_VALUE(t)               \
+    {                                        \
+        .magic = TIMER_MAGIC,                \
+        .node = {NULL, NULL, NULL, NULL, 0}, \
+        .scheduled_time = 0,                 \
+        .slack = 0,                          \
+        .callback = NULL,                    \
+        .arg = NULL,                         \
+        .active_cpu = -1,                    \
+        .cancel = false,                     \
     }
 
 /* Rules for Timers:
@@ -45,6 +45,12 @@ uint64_t ticks_per_second(void);
 /* high-precision timer current_ticks */
 uint64_t current_ticks(void);
 
+/* If current_time() is the counter that user mode reads with zx_ticks_get()
+ * times a constant, stores that constant in |ns_per_tick| and returns true,
+ * so that the vDSO can compute the time without entering the kernel. */
+struct fp_32_64;
+bool platform_usermode_time_scale(struct fp_32_64* ns_per_tick);
+
 /* super early platform initialization, before almost everything */
 void platform_early_init(void);
 
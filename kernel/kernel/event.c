@@ -168,7 +168,7 @@ static int event_signal_internal(event_t* e, bool reschedule, zx_status_t wait_r
 
     // conditionally THREAD_UNLOCK
     if (!thread_lock_held)
-        spin_unlock_irqrestore(&thread_lock, state);
+        thread_lock_release_irqrestore(state);
 
     return wake_count;
 }
@@ -67,8 +67,11 @@ void mp_reschedule(mp_ipi_target_t target, cpu_mask_t mask, uint flags) {
         mask &= mp.active_cpus;
         mask &= ~cpu_num_to_mask(local_cpu);
 
-        /* this is generally a bad state, though this may be too aggressive */
-        DEBUG_ASSERT(mask != 0);
+        /* the scheduler defers its IPIs until the thread_lock is dropped, by
+         * which point the target may have gone offline, so an empty mask is
+         * not an error */
+        if (mask == 0)
+            return;
 
         /* mask out cpus that are currently running realtime code */
         if ((flags & MP_RESCHEDULE_FLAG_REALTIME) == 0) {
@@ -244,7 +247,7 @@ static void mp_unplug_trampoline(void) {
      * should be quick), then this CPU may execute the task. */
     mp_set_curr_cpu_online(false);
 
-    spin_unlock(&thread_lock);
+    thread_lock_release();
 
     /* do *not* enable interrupts, we want this CPU to never receive another
      * interrupt */
@@ -16,18 +16,78 @@
 
 #include <kernel/mutex.h>
 
+#include <arch/ops.h>
 #include <assert.h>
 #include <debug.h>
 #include <err.h>
 #include <inttypes.h>
+#include <kernel/mp.h>
+#include <kernel/percpu.h>
 #include <kernel/sched.h>
 #include <kernel/thread.h>
 #include <lib/ktrace.h>
+#include <platform.h>
+#include <string.h>
 #include <trace.h>
 #include <zircon/types.h>
 
 #define LOCAL_TRACE 0
 
+/* how long to spin waiting for a running holder to release before blocking */
+#define MUTEX_SPIN_MAX_DURATION ZX_USEC(10)
+
+#if MUTEX_CONTENTION_STATS
+/* Contention statistics, keyed by the address mutex_acquire was called from.
+ * Only acquisitions that found the mutex held are recorded, so the uncontended
+ * acquire and release paths are left alone. Slots are claimed on first use and
+ * never freed; once the table is full new sites are not tracked.
+ */
+#define MUTEX_STATS_SITES 256
+
+struct mutex_site_stats {
+    uint64_t site;
+    uint64_t spin_acquires;
+    uint64_t blocks;
+    uint64_t max_wait_cycles;
+};
+
+static struct mutex_site_stats mutex_stats[MUTEX_STATS_SITES];
+
+static struct mutex_site_stats* mutex_stats_lookup(uintptr_t site) {
+    uint idx = (uint)((site >> 2) * 2654435761u) % MUTEX_STATS_SITES;
+    for (uint i = 0; i < MUTEX_STATS_SITES; i++) {
+        struct mutex_site_stats* st = &mutex_stats[(idx + i) % MUTEX_STATS_SITES];
+        uint64_t cur = atomic_load_u64_relaxed(&st->site);
+        if (cur == 0) {
+            if (atomic_cmpxchg_u64(&st->site, &cur, site))
+                return st;
+        }
+        if (cur == site)
+            return st;
+    }
+    return NULL;
+}
+
+static uint64_t mutex_stats_begin(void) {
+    return arch_cycle_count();
+}
+
+/* record an acquisition at |site| that found the mutex held at |start| */
+static void mutex_stats_contended(uintptr_t site, bool blocked, uint64_t start) {
+    uint64_t wait = arch_cycle_count() - start;
+    struct mutex_site_stats* st = mutex_stats_lookup(site);
+    if (!st)
+        return;
+    atomic_add_u64(blocked ? &st->blocks : &st->spin_acquires, 1);
+    uint64_t max = atomic_load_u64_relaxed(&st->max_wait_cycles);
+    while (wait > max && !atomic_cmpxchg_u64(&st->max_wait_cycles, &max, wait))
+        ;
+}
+#else
+static inline uint64_t mutex_stats_begin(void) { return 0; }
+static inline void mutex_stats_contended(uintptr_t site, bool blocked, uint64_t start) {}
+#endif
+
 /**
  * @brief  Initialize a mutex_t
  */
@@ -54,11 +114,108 @@ void mutex_destroy(mutex_t* m) {
               holder, holder->name);
     }
 #endif
+    DEBUG_ASSERT(!list_in_list(&m->owner_node));
     m->magic = 0;
     m->val = 0;
     wait_queue_destroy(&m->wait);
 }
 
+/* highest effective priority of the threads blocked on |m| */
+static int mutex_waiter_priority(mutex_t* m) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    int priority = LOWEST_PRIORITY;
+    thread_t* t;
+    list_for_every_entry (&m->wait.list, t, thread_t, queue_node) {
+        int ep = sched_get_effective_priority(t);
+        if (ep > priority)
+            priority = ep;
+    }
+    return priority;
+}
+
+/* recompute the priority |t| inherits from the mutexes it holds */
+static bool mutex_update_inherited_priority(thread_t* t) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    int priority = LOWEST_PRIORITY;
+    mutex_t* m;
+    list_for_every_entry (&t->owned_mutexes, m, mutex_t, owner_node) {
+        int p = mutex_waiter_priority(m);
+        if (p > priority)
+            priority = p;
+    }
+    return sched_inherit_priority(t, priority);
+}
+
+/* The current thread is about to block on |m|. Lend its priority to the holder,
+ * and on through whatever the holder is itself blocked on. Every mutex on the
+ * chain has waiters, so its holder cannot release it without the thread_lock
+ * and the chain is stable while we walk it.
+ */
+static void mutex_propagate_priority(mutex_t* m, thread_t* ct) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    int priority = sched_get_effective_priority(ct);
+    thread_t* holder = mutex_holder(m);
+    while (holder && holder != ct) {
+        if (sched_get_effective_priority(holder) >= priority)
+            break;
+
+        // we are about to block, so a local reschedule is going to happen anyway
+        __UNUSED bool local_resched = sched_inherit_priority(holder, priority);
+
+        m = holder->blocking_mutex;
+        if (!m)
+            break;
+        holder = mutex_holder(m);
+    }
+}
+
+/* Whether |t| is the thread running on some online cpu. Only the per-cpu
+ * record of each cpu's current thread is read; |t| is never dereferenced, as
+ * a mutex holder may have released the mutex and exited by the time we look.
+ * A freed thread_t reused for a new, running thread would read as running,
+ * which only costs a spin bounded by the caller's deadline.
+ */
+static bool mutex_holder_on_cpu(const thread_t* t) {
+    cpu_mask_t online = mp_get_online_mask();
+    for (cpu_num_t i = 0; i < SMP_MAX_CPUS; i++) {
+        if ((online & cpu_num_to_mask(i)) && percpu[i].curr_thread == t)
+            return true;
+    }
+    return false;
+}
+
+/* Spin while the holder is running on another cpu, on the assumption that it
+ * will release the mutex shortly and that doing so is cheaper than blocking.
+ * Give up once someone has queued up behind the holder, so as not to jump the
+ * queue, or when the holder stops running.
+ */
+static bool mutex_spin(mutex_t* m, thread_t* ct) {
+    if (mp_get_online_mask() == cpu_num_to_mask(arch_curr_cpu_num()))
+        return false;
+
+    zx_time_t deadline = current_time() + MUTEX_SPIN_MAX_DURATION;
+    for (;;) {
+        uintptr_t val = mutex_val(m);
+        if (val == 0) {
+            if (atomic_cmpxchg_u64(&m->val, &val, (uintptr_t)ct))
+                return true;
+            continue;
+        }
+        if (val & MUTEX_FLAG_QUEUED)
+            return false;
+
+        if (!mutex_holder_on_cpu((thread_t*)val))
+            return false;
+        if (current_time() >= deadline)
+            return false;
+
+        arch_spinloop_pause();
+    }
+}
+
 /**
  * @brief  Acquire the mutex
  */
@@ -67,9 +224,9 @@ void mutex_acquire(mutex_t* m) TA_NO_THREAD_SAFETY_ANALYSIS {
     DEBUG_ASSERT(!arch_in_int_handler());
 
     thread_t* ct = get_current_thread();
+    __UNUSED uintptr_t site = (uintptr_t)__GET_CALLER();
     uintptr_t oldval;
 
-retry:
     // fast path: assume its unheld, try to grab it
     oldval = 0;
     if (likely(atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct))) {
@@ -83,6 +240,19 @@ retry:
               ct, ct->name, m);
 #endif
 
+    __UNUSED uint64_t contended_at = mutex_stats_begin();
+
+    // the holder may be about to release it, try spinning for a bit first
+    if (mutex_spin(m, ct)) {
+        mutex_stats_contended(site, false, contended_at);
+        return;
+    }
+
+retry:
+    oldval = 0;
+    if (atomic_cmpxchg_u64(&m->val, &oldval, (uintptr_t)ct))
+        return;
+
     // we contended with someone else, will probably need to block
     THREAD_LOCK(state);
 
@@ -100,6 +270,15 @@ retry:
         goto retry;
     }
 
+    // the holder can no longer release without the thread_lock, so it is safe to
+    // hang the mutex off of it and lend it our priority
+    if (!(oldval & MUTEX_FLAG_QUEUED)) {
+        DEBUG_ASSERT(!list_in_list(&m->owner_node));
+        list_add_tail(&mutex_holder(m)->owned_mutexes, &m->owner_node);
+    }
+    ct->blocking_mutex = m;
+    mutex_propagate_priority(m, ct);
+
     // we have signalled that we're blocking, so drop into the wait queue
     zx_status_t ret = wait_queue_block(&m->wait, ZX_TIME_INFINITE);
     if (unlikely(ret < ZX_OK)) {
@@ -111,8 +290,11 @@ retry:
 
     // someone must have woken us up, we should own the mutex now
     DEBUG_ASSERT(ct == mutex_holder(m));
+    DEBUG_ASSERT(ct->blocking_mutex == NULL);
 
     THREAD_UNLOCK(state);
+
+    mutex_stats_contended(site, true, contended_at);
 }
 
 // shared implementation of release
@@ -148,9 +330,11 @@ static inline void mutex_release_internal(mutex_t* m, bool reschedule, bool thre
     // release a thread in the wait queue
     thread_t* t = wait_queue_dequeue_one(&m->wait, ZX_OK);
     DEBUG_ASSERT_MSG(t, "mutex_release: wait queue didn't have anything, but m->val = %#" PRIxPTR "\n", mutex_val(m));
+    t->blocking_mutex = NULL;
 
     // we woke up a thread, mark the mutex owned by that thread
-    uintptr_t newval = (uintptr_t)t | (wait_queue_is_empty(&m->wait) ? 0 : MUTEX_FLAG_QUEUED);
+    bool queued = !wait_queue_is_empty(&m->wait);
+    uintptr_t newval = (uintptr_t)t | (queued ? MUTEX_FLAG_QUEUED : 0);
 
     oldval = (uintptr_t)ct | MUTEX_FLAG_QUEUED;
     if (!atomic_cmpxchg_u64(&m->val, &oldval, newval)) {
@@ -159,15 +343,24 @@ static inline void mutex_release_internal(mutex_t* m, bool reschedule, bool thre
 
     ktrace(TAG_KWAIT_WAKE, (uintptr_t)&m->wait >> 32, (uintptr_t)&m->wait, 1, 0);
 
+    // hand the remaining waiters' priority over to the new owner, and drop whatever
+    // we were inheriting through this mutex
+    list_delete(&m->owner_node);
+    bool local_resched = mutex_update_inherited_priority(ct);
+    if (queued) {
+        list_add_tail(&t->owned_mutexes, &m->owner_node);
+        __UNUSED bool blocked_resched = mutex_update_inherited_priority(t);
+    }
+
     // wake up the new thread, putting it in a run queue on a cpu. reschedule if the local
     // cpu run queue was modified
-    bool local_resched = sched_unblock(t);
+    local_resched |= sched_unblock(t);
     if (reschedule && local_resched)
         sched_reschedule();
 
     // conditionally THREAD_UNLOCK
     if (!thread_lock_held)
-        spin_unlock_irqrestore(&thread_lock, state);
+        thread_lock_release_irqrestore(state);
 }
 
 void mutex_release(mutex_t* m) TA_NO_THREAD_SAFETY_ANALYSIS {
@@ -188,3 +381,35 @@ void mutex_release_thread_locked(mutex_t* m, bool reschedule) TA_NO_THREAD_SAFET
     // the thread_lock
     mutex_release_internal(m, reschedule, true);
 }
+
+#if WITH_LIB_CONSOLE
+#include <lib/console.h>
+
+static int cmd_mutexstats(int argc, const cmd_args* argv, uint32_t flags) {
+#if MUTEX_CONTENTION_STATS
+    bool reset = (argc > 1 && !strcmp(argv[1].str, "reset"));
+
+    printf("%18s %12s %12s %16s\n", "site", "spin acq", "blocks", "max wait cycles");
+    for (uint i = 0; i < MUTEX_STATS_SITES; i++) {
+        struct mutex_site_stats* st = &mutex_stats[i];
+        if (st->site == 0)
+            continue;
+        printf("%#18" PRIx64 " %12" PRIu64 " %12" PRIu64 " %16" PRIu64 "\n",
+               st->site, st->spin_acquires, st->blocks, st->max_wait_cycles);
+        if (reset) {
+            st->spin_acquires = 0;
+            st->blocks = 0;
+            st->max_wait_cycles = 0;
+        }
+    }
+#else
+    printf("mutex contention statistics are not enabled in this build\n");
+#endif
+    return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("mutexstats", "mutex contention statistics by acquisition site", &cmd_mutexstats)
+STATIC_COMMAND_END(mutex);
+
+#endif // WITH_LIB_CONSOLE
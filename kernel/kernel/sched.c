@@ -54,9 +54,43 @@
 
 static bool local_migrate_if_needed(thread_t* curr_thread);
 
+/* Queue reschedule IPIs for |mask| on the current cpu. They are sent by
+ * thread_lock_release() once the thread_lock has been dropped. If we context
+ * switch first, the thread switched to releases the lock on this same cpu and
+ * sends them. The lock is held with interrupts disabled, so the current cpu
+ * cannot change in between.
+ */
+void sched_queue_resched_ipis(cpu_mask_t mask) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    get_local_percpu()->deferred_resched_ipis |= mask;
+}
+
+void thread_lock_release(void) {
+    DEBUG_ASSERT(arch_ints_disabled());
+
+    struct percpu* c = get_local_percpu();
+    cpu_mask_t mask = c->deferred_resched_ipis;
+    c->deferred_resched_ipis = 0;
+
+    spin_unlock(&thread_lock);
+
+    /* the threads being woken are already in their run queues, so the target
+     * cpus will find them as soon as they take the lock in response */
+    if (mask)
+        mp_reschedule(MP_IPI_TARGET_MASK, mask, 0);
+}
+
+void thread_lock_release_irqrestore(spin_lock_saved_state_t state) {
+    thread_lock_release();
+    arch_interrupt_restore(state, SPIN_LOCK_FLAG_INTERRUPTS);
+}
+
 /* compute the effective priority of a thread */
 static int effec_priority(const thread_t* t) {
     int ep = t->base_priority + t->priority_boost;
+    if (unlikely(t->inherited_priority > ep))
+        ep = t->inherited_priority;
     DEBUG_ASSERT(ep >= LOWEST_PRIORITY && ep <= HIGHEST_PRIORITY);
     return ep;
 }
@@ -262,10 +296,48 @@ void sched_block(void) {
     sched_resched_internal();
 }
 
+/* if the current thread asked to hand off its cpu to the thread it wakes, queue |t| at the head
+ * of the local run queue with the rest of the current thread's time slice. returns false if the
+ * normal placement should be used.
+ */
+static bool handoff_insert(thread_t* t) {
+    thread_t* current_thread = get_current_thread();
+    if (likely(!current_thread->handoff_wakeup) || arch_in_int_handler())
+        return false;
+
+    cpu_num_t curr_cpu = arch_curr_cpu_num();
+    if (!(t->cpu_affinity & cpu_num_to_mask(curr_cpu)))
+        return false;
+
+    /* only the first wakeup gets the cpu */
+    current_thread->handoff_wakeup = false;
+
+    LOCAL_KTRACE2("sched_handoff", (uint32_t)current_thread->user_tid, (uint32_t)t->user_tid);
+
+    /* donate what is left of the current thread's time slice; real time threads don't have one */
+    if (!thread_is_real_time_or_idle(current_thread)) {
+        zx_duration_t used = current_time() - current_thread->last_started_running;
+        if (current_thread->remaining_time_slice > used) {
+            zx_duration_t left = current_thread->remaining_time_slice - used;
+            if (left > t->remaining_time_slice)
+                t->remaining_time_slice = left;
+        }
+    }
+
+    t->curr_cpu = curr_cpu;
+    insert_in_run_queue_head(curr_cpu, t);
+    return true;
+}
+
 /* find a cpu to run the thread on, put it in the run queue for that cpu, and accumulate a list
  * of cpus we'll need to reschedule, including the local cpu.
  */
 static void find_cpu_and_insert(thread_t* t, bool* local_resched, cpu_mask_t* accum_cpu_mask) {
+    if (handoff_insert(t)) {
+        *local_resched = true;
+        return;
+    }
+
     /* find a core to run it on */
     cpu_mask_t cpu = find_cpu_mask(t);
     cpu_num_t cpu_num;
@@ -304,8 +376,7 @@ bool sched_unblock(thread_t* t) {
     cpu_mask_t mask = 0;
     find_cpu_and_insert(t, &local_resched, &mask);
 
-    if (mask)
-        mp_reschedule(MP_IPI_TARGET_MASK, mask, 0);
+    sched_queue_resched_ipis(mask);
     return local_resched;
 }
 
@@ -331,8 +402,7 @@ bool sched_unblock_list(struct list_node* list) {
         find_cpu_and_insert(t, &local_resched, &accum_cpu_mask);
     }
 
-    if (accum_cpu_mask)
-        mp_reschedule(MP_IPI_TARGET_MASK, accum_cpu_mask, 0);
+    sched_queue_resched_ipis(accum_cpu_mask);
 
     return local_resched;
 }
@@ -449,7 +519,7 @@ static void migrate_current_thread(thread_t* current_thread) {
     current_thread->state = THREAD_READY;
     find_cpu_and_insert(current_thread, &local_resched, &accum_cpu_mask);
     if (accum_cpu_mask)
-        mp_reschedule(MP_IPI_TARGET_MASK, accum_cpu_mask, 0);
+        sched_queue_resched_ipis(accum_cpu_mask);
     sched_resched_internal();
 }
 
@@ -469,7 +539,7 @@ void sched_transition_off_cpu(cpu_num_t old_cpu) {
     }
 
     if (accum_cpu_mask) {
-        mp_reschedule(MP_IPI_TARGET_MASK, accum_cpu_mask, 0);
+        sched_queue_resched_ipis(accum_cpu_mask);
     }
 }
 
@@ -541,14 +611,60 @@ void sched_migrate(thread_t* t) {
     }
 
     // send some ipis based on the previous code
-    if (accum_cpu_mask) {
-        mp_reschedule(MP_IPI_TARGET_MASK, accum_cpu_mask, 0);
-    }
+    sched_queue_resched_ipis(accum_cpu_mask);
     if (local_resched) {
         sched_reschedule();
     }
 }
 
+int sched_get_effective_priority(const thread_t* t) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    return effec_priority(t);
+}
+
+bool sched_inherit_priority(thread_t* t, int priority) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+    DEBUG_ASSERT(priority >= LOWEST_PRIORITY && priority <= HIGHEST_PRIORITY);
+
+    if (t->inherited_priority == priority)
+        return false;
+
+    int old_ep = effec_priority(t);
+
+    /* a ready thread is queued by its effective priority, so pull it out first */
+    bool queued = (t->state == THREAD_READY) && list_in_list(&t->queue_node);
+    if (queued) {
+        struct percpu* c = &percpu[t->curr_cpu];
+        list_delete(&t->queue_node);
+        if (list_is_empty(&c->run_queue[old_ep])) {
+            c->run_queue_bitmap &= ~(1u << old_ep);
+        }
+    }
+
+    t->inherited_priority = priority;
+    int new_ep = effec_priority(t);
+
+    if (queued) {
+        insert_in_run_queue_tail(t->curr_cpu, t);
+    }
+
+    if (new_ep == old_ep)
+        return false;
+
+    /* let the cpu the thread is on reconsider if it should be running: a ready
+     * thread that got more important, or a running one that got less */
+    bool local_resched = false;
+    if ((queued && new_ep > old_ep) || (t->state == THREAD_RUNNING && new_ep < old_ep)) {
+        if (t->curr_cpu == arch_curr_cpu_num()) {
+            local_resched = true;
+        } else {
+            sched_queue_resched_ipis(cpu_num_to_mask(t->curr_cpu));
+        }
+    }
+    return local_resched;
+}
+
 /* preemption timer that is set whenever a thread is scheduled */
 static enum handler_return sched_timer_tick(timer_t* t, zx_time_t now, void* arg) {
     /* if the preemption timer went off on the idle or a real time thread, ignore it */
@@ -642,6 +758,7 @@ void sched_resched_internal(void) {
         oldthread->curr_cpu = INVALID_CPU;
     newthread->last_cpu = cpu;
     newthread->curr_cpu = cpu;
+    percpu[cpu].curr_thread = newthread;
 
     /* if we selected the idle thread the cpu's run queue must be empty, so mark the
      * cpu as idle */
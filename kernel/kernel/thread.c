@@ -73,6 +73,7 @@ static void init_thread_struct(thread_t* t, const char* name) {
     t->magic = THREAD_MAGIC;
     strlcpy(t->name, name, sizeof(t->name));
     wait_queue_init(&t->retcode_wait_queue);
+    list_initialize(&t->owned_mutexes);
 }
 
 static void initial_thread_func(void) TA_REQ(thread_lock) __NO_RETURN;
@@ -80,7 +81,7 @@ static void initial_thread_func(void) {
     int ret;
 
     /* release the thread lock that was implicitly held across the reschedule */
-    spin_unlock(&thread_lock);
+    thread_lock_release();
     arch_enable_ints();
 
     thread_t* ct = get_current_thread();
@@ -141,11 +142,13 @@ thread_t* thread_create_etc(
     t->arg = arg;
     t->base_priority = priority;
     t->priority_boost = 0;
+    t->inherited_priority = LOWEST_PRIORITY;
     t->state = THREAD_INITIAL;
     t->signals = 0;
     t->blocking_wait_queue = NULL;
     t->blocked_status = ZX_OK;
     t->interruptable = false;
+    t->handoff_wakeup = false;
     t->curr_cpu = INVALID_CPU;
     t->last_cpu = INVALID_CPU;
     t->cpu_affinity = CPU_MASK_ALL;
@@ -348,7 +351,7 @@ zx_status_t thread_suspend(thread_t* t) {
         /* The following call is not essential.  It just makes the
              * thread suspension happen sooner rather than at the next
              * timer interrupt or syscall. */
-        mp_reschedule(MP_IPI_TARGET_MASK, cpu_num_to_mask(t->curr_cpu), 0);
+        sched_queue_resched_ipis(cpu_num_to_mask(t->curr_cpu));
         break;
     case THREAD_SUSPENDED:
         /* thread is suspended already */
@@ -599,7 +602,7 @@ void thread_kill(thread_t* t) {
         /* The following call is not essential.  It just makes the
              * thread termination happen sooner rather than at the next
              * timer interrupt or syscall. */
-        mp_reschedule(MP_IPI_TARGET_MASK, cpu_num_to_mask(t->curr_cpu), 0);
+        sched_queue_resched_ipis(cpu_num_to_mask(t->curr_cpu));
         break;
     case THREAD_SUSPENDED:
         /* thread is suspended, resume it so it can get the kill signal */
@@ -836,7 +839,7 @@ static enum handler_return thread_sleep_handler(timer_t* timer, zx_time_t now,
         return INT_NO_RESCHEDULE;
 
     if (t->state != THREAD_SLEEPING) {
-        spin_unlock(&thread_lock);
+        thread_lock_release();
         return INT_NO_RESCHEDULE;
     }
 
@@ -845,7 +848,7 @@ static enum handler_return thread_sleep_handler(timer_t* timer, zx_time_t now,
     /* unblock the thread */
     bool local_resched = sched_unblock(t);
 
-    spin_unlock(&thread_lock);
+    thread_lock_release();
 
     /* force a reschedule on the current cpu if the local run queue was modified in sched_unblock */
     return local_resched ? INT_RESCHEDULE : INT_NO_RESCHEDULE;
@@ -969,6 +972,7 @@ void thread_construct_first(thread_t* t, const char* name) {
     init_thread_struct(t, name);
     t->base_priority = HIGHEST_PRIORITY;
     t->priority_boost = 0;
+    t->inherited_priority = LOWEST_PRIORITY;
     t->state = THREAD_RUNNING;
     t->flags = THREAD_FLAG_DETACHED;
     t->signals = 0;
@@ -981,6 +985,7 @@ void thread_construct_first(thread_t* t, const char* name) {
     THREAD_LOCK(state);
     list_add_head(&thread_list, &t->thread_list_node);
     set_current_thread(t);
+    percpu[cpu].curr_thread = t;
     THREAD_UNLOCK(state);
 }
 
@@ -43,118 +43,279 @@ void timer_init(timer_t* timer) {
     *timer = (timer_t)TIMER_INITIAL_VALUE(*timer);
 }
 
+/* timer queue manipulation
+ *
+ * Each cpu's pending timers are kept in an AVL tree keyed on scheduled_time,
+ * with the earliest timer cached as the queue head. Timers with equal
+ * scheduled_times are kept in insertion order by always descending to the
+ * right on a tie, so they fire in the order they were queued.
+ */
+static inline bool timer_is_queued(const timer_t* t) {
+    return t->node.queue != NULL;
+}
+
+static inline int timer_node_height(const timer_t* t) {
+    return t ? t->node.height : 0;
+}
+
+static void timer_node_update_height(timer_t* t) {
+    int l = timer_node_height(t->node.left);
+    int r = timer_node_height(t->node.right);
+    t->node.height = 1 + ((l > r) ? l : r);
+}
+
+/* point |parent|'s link to |old| (or the root, if no parent) at |child| */
+static void timer_queue_replace_child(timer_queue_t* q, timer_t* parent,
+                                      timer_t* old, timer_t* child) {
+    if (!parent) {
+        q->root = child;
+    } else if (parent->node.left == old) {
+        parent->node.left = child;
+    } else {
+        parent->node.right = child;
+    }
+    if (child)
+        child->node.parent = parent;
+}
+
+static timer_t* timer_queue_rotate_left(timer_queue_t* q, timer_t* x) {
+    timer_t* y = x->node.right;
+    x->node.right = y->node.left;
+    if (y->node.left)
+        y->node.left->node.parent = x;
+    timer_queue_replace_child(q, x->node.parent, x, y);
+    y->node.left = x;
+    x->node.parent = y;
+    timer_node_update_height(x);
+    timer_node_update_height(y);
+    return y;
+}
+
+static timer_t* timer_queue_rotate_right(timer_queue_t* q, timer_t* x) {
+    timer_t* y = x->node.left;
+    x->node.left = y->node.right;
+    if (y->node.right)
+        y->node.right->node.parent = x;
+    timer_queue_replace_child(q, x->node.parent, x, y);
+    y->node.right = x;
+    x->node.parent = y;
+    timer_node_update_height(x);
+    timer_node_update_height(y);
+    return y;
+}
+
+/* restore the AVL balance on the path from |t| up to the root */
+static void timer_queue_rebalance(timer_queue_t* q, timer_t* t) {
+    while (t) {
+        timer_node_update_height(t);
+        int balance = timer_node_height(t->node.left) - timer_node_height(t->node.right);
+        if (balance > 1) {
+            timer_t* l = t->node.left;
+            if (timer_node_height(l->node.left) < timer_node_height(l->node.right))
+                timer_queue_rotate_left(q, l);
+            t = timer_queue_rotate_right(q, t);
+        } else if (balance < -1) {
+            timer_t* r = t->node.right;
+            if (timer_node_height(r->node.right) < timer_node_height(r->node.left))
+                timer_queue_rotate_right(q, r);
+            t = timer_queue_rotate_left(q, t);
+        }
+        t = t->node.parent;
+    }
+}
+
+static timer_t* timer_queue_next(const timer_t* t) {
+    if (t->node.right) {
+        t = t->node.right;
+        while (t->node.left)
+            t = t->node.left;
+        return (timer_t*)t;
+    }
+    while (t->node.parent && t->node.parent->node.right == t)
+        t = t->node.parent;
+    return t->node.parent;
+}
+
+static timer_t* timer_queue_prev(const timer_t* t) {
+    if (t->node.left) {
+        t = t->node.left;
+        while (t->node.right)
+            t = t->node.right;
+        return (timer_t*)t;
+    }
+    while (t->node.parent && t->node.parent->node.left == t)
+        t = t->node.parent;
+    return t->node.parent;
+}
+
+static timer_t* timer_queue_last(const timer_queue_t* q) {
+    timer_t* t = q->root;
+    while (t && t->node.right)
+        t = t->node.right;
+    return t;
+}
+
+/* the first timer scheduled at or after |time|, NULL if none */
+static timer_t* timer_queue_lower_bound(const timer_queue_t* q, zx_time_t time) {
+    timer_t* result = NULL;
+    timer_t* t = q->root;
+    while (t) {
+        if (t->scheduled_time >= time) {
+            result = t;
+            t = t->node.left;
+        } else {
+            t = t->node.right;
+        }
+    }
+    return result;
+}
+
+static void timer_queue_insert(timer_queue_t* q, timer_t* timer) {
+    DEBUG_ASSERT(!timer_is_queued(timer));
+
+    timer_t* parent = NULL;
+    timer_t** link = &q->root;
+    bool leftmost = true;
+    while (*link) {
+        parent = *link;
+        if (timer->scheduled_time < parent->scheduled_time) {
+            link = &parent->node.left;
+        } else {
+            link = &parent->node.right;
+            leftmost = false;
+        }
+    }
+
+    timer->node.parent = parent;
+    timer->node.left = NULL;
+    timer->node.right = NULL;
+    timer->node.queue = q;
+    timer->node.height = 1;
+    *link = timer;
+
+    if (leftmost)
+        q->head = timer;
+
+    timer_queue_rebalance(q, parent);
+}
+
+static void timer_queue_remove(timer_t* timer) {
+    timer_queue_t* q = timer->node.queue;
+    DEBUG_ASSERT(q);
+
+    if (q->head == timer)
+        q->head = timer_queue_next(timer);
+
+    timer_t* rebalance_from;
+    timer_t* left = timer->node.left;
+    timer_t* right = timer->node.right;
+    if (left && right) {
+        /* replace the timer with its successor, the leftmost node of its right subtree */
+        timer_t* succ = right;
+        while (succ->node.left)
+            succ = succ->node.left;
+
+        if (succ != right) {
+            rebalance_from = succ->node.parent;
+            timer_queue_replace_child(q, rebalance_from, succ, succ->node.right);
+            succ->node.right = right;
+            right->node.parent = succ;
+        } else {
+            rebalance_from = succ;
+        }
+        succ->node.left = left;
+        left->node.parent = succ;
+        succ->node.height = timer->node.height;
+        timer_queue_replace_child(q, timer->node.parent, timer, succ);
+    } else {
+        rebalance_from = timer->node.parent;
+        timer_queue_replace_child(q, rebalance_from, timer, left ? left : right);
+    }
+
+    timer->node.parent = NULL;
+    timer->node.left = NULL;
+    timer->node.right = NULL;
+    timer->node.queue = NULL;
+    timer->node.height = 0;
+
+    timer_queue_rebalance(q, rebalance_from);
+}
+
 static void insert_timer_in_queue(uint cpu, timer_t* timer,
                                   uint64_t early_slack, uint64_t late_slack) {
 
     DEBUG_ASSERT(arch_ints_disabled());
     LTRACEF("timer %p, cpu %u, scheduled %" PRIu64 "\n", timer, cpu, timer->scheduled_time);
 
+    timer_queue_t* q = &percpu[cpu].timer_queue;
     zx_time_t earliest_deadline = timer->scheduled_time - early_slack;
     zx_time_t latest_deadline = timer->scheduled_time + late_slack;
 
     // For inserting the timer we consider several cases. In general we
-    // want to coalesce with the current timer unless we can prove that
+    // want to coalesce with an existing timer unless we can prove that
     // either that:
-    //  1- there is no slack overlap with current timer OR
-    //  2- the next timer is a better fit.
+    //  1- there is no slack overlap with an existing timer OR
+    //  2- the other neighboring timer is a better fit.
     //
-    // In diagrams that follow
-    // - Let |e| be the current (existing) timer deadline
+    // Only the two timers adjacent to the new one can be candidates, so
+    // find them in the tree:
+    //
+    // - Let |p| be the last timer scheduled before the new timer, if any
+    // - Let |n| be the first timer scheduled at or after it, if any
     // - Let |t| be the deadline of the timer we are inserting
-    // - Let |n| be the next timer deadline if any
-    // - Let |x| be the end of the list (not a timer)
     // - Let |(| and |)| the earliest_deadline and latest_deadline.
     //
-    timer_t* entry;
+    timer_t* next = timer_queue_lower_bound(q, timer->scheduled_time);
+    timer_t* prev = next ? timer_queue_prev(next) : timer_queue_last(q);
 
-    list_for_every_entry (&percpu[cpu].timer_queue, entry, timer_t, node) {
-        if (entry->scheduled_time > latest_deadline) {
-            // New timer latest is earlier than the current timer.
-            // Just add upfront as is, without slack.
-            //
-            //   ---------t---)--e-------------------------------> time
-            //
-            timer->slack = 0ull;
-            list_add_before(&entry->node, &timer->node);
-            return;
+    if (prev && prev->scheduled_time >= earliest_deadline) {
+        // There is overlap with the previous timer, but could the next timer
+        // (if any) be a better fit? It is if it lands exactly on the new
+        // timer, or overlaps as well and is closer.
+        //
+        //  -------------(--p---t-----?-------------------> time
+        //
+        bool next_is_better = false;
+        if (next) {
+            if (next->scheduled_time == timer->scheduled_time) {
+                next_is_better = true;
+            } else if (next->scheduled_time < latest_deadline) {
+                zx_duration_t delta_prev = timer->scheduled_time - prev->scheduled_time;
+                zx_duration_t delta_next = next->scheduled_time - timer->scheduled_time;
+                next_is_better = (delta_next < delta_prev);
+            }
         }
 
-        if (entry->scheduled_time >= timer->scheduled_time) {
-            //  New timer slack overlaps and is to the left (or equal). We
-            //  coalesce with current by scheduling late.
+        if (!next_is_better) {
+            // Coalesce by scheduling early.
             //
-            //  --------(----t---e-)----------------------------> time
+            //  --------------(-p---t---n-)-----------------------> time
             //
-            timer->slack = entry->scheduled_time - timer->scheduled_time;
-            timer->scheduled_time = entry->scheduled_time;
-            list_add_after(&entry->node, &timer->node);
+            timer->slack = prev->scheduled_time - timer->scheduled_time;
+            timer->scheduled_time = prev->scheduled_time;
+            timer_queue_insert(q, timer);
             return;
         }
+    }
 
-        if (entry->scheduled_time < earliest_deadline) {
-            // new timer earliest is later than the current timer. This case
-            // is handled in a future iteration.
-            //
-            //   ----------------e--(---t-----------------------> time
-            //
-            continue;
-        }
-
-        // New timer is to the right of current timer and there is overlap
-        // with the current timer, but could the next timer (if any) be
-        // a better fit?
-        //
-        //  -------------(--e---t-----?-------------------> time
-        //
-
-        const timer_t* next =
-            list_next_type(&percpu[cpu].timer_queue, &entry->node, timer_t, node);
-
-        if (next != NULL) {
-            if (next->scheduled_time <= timer->scheduled_time) {
-                // The new timer is to the right of the next timer. There is no
-                // chance the current timer is a better fit.
-                //
-                //  -------------(--e---n---t----------------------> time
-                //
-                continue;
-            }
-
-            if (next->scheduled_time < latest_deadline) {
-                // There is slack overlap with the next timer, and also with the
-                // current timer. Which coalescing is a better match?
-                //
-                //  --------------(-e---t---n-)-----------------------> time
-                //
-                zx_duration_t delta_entry = timer->scheduled_time - entry->scheduled_time;
-                zx_duration_t delta_next = next->scheduled_time - timer->scheduled_time;
-                if (delta_next < delta_entry) {
-                    // New timer is closer to the next timer, handle it in the
-                    // next iteration.
-                    continue;
-                }
-            }
-        }
-
-        // Handles the remaining cases, note that there is overlap with
-        // the current timer.
+    if (next && next->scheduled_time <= latest_deadline) {
+        //  New timer slack overlaps and is to the left (or equal) of the next
+        //  timer. We coalesce with it by scheduling late.
         //
-        //  1- this is the last timer (next == NULL) or
-        //  2- there is no overlap with the next timer, or
-        //  3- there is overlap with both current and next but
-        //     current is closer.
+        //  --------(----t---n-)----------------------------> time
         //
-        //  So we coalesce by scheduling early.
-        //
-        timer->slack = entry->scheduled_time - timer->scheduled_time;
-        timer->scheduled_time = entry->scheduled_time;
-        list_add_after(&entry->node, &timer->node);
+        timer->slack = next->scheduled_time - timer->scheduled_time;
+        timer->scheduled_time = next->scheduled_time;
+        timer_queue_insert(q, timer);
         return;
     }
 
-    // Walked off the end of the list and there was no overlap.
+    // No overlap with either neighbor, add it as is, without slack.
+    //
+    //   ---p---(---t---)--n-----------------------------> time
+    //
     timer->slack = 0ull;
-    list_add_tail(&percpu[cpu].timer_queue, &timer->node);
+    timer_queue_insert(q, timer);
 }
 
 void timer_set(timer_t* timer, zx_time_t deadline,
@@ -166,8 +327,8 @@ void timer_set(timer_t* timer, zx_time_t deadline,
     DEBUG_ASSERT(timer->magic == TIMER_MAGIC);
     DEBUG_ASSERT(mode <= TIMER_SLACK_EARLY);
 
-    if (list_in_list(&timer->node)) {
-        panic("timer %p already in list\n", timer);
+    if (timer_is_queued(timer)) {
+        panic("timer %p already in queue\n", timer);
     }
 
     zx_duration_t late_slack;
@@ -220,7 +381,7 @@ void timer_set(timer_t* timer, zx_time_t deadline,
 
     insert_timer_in_queue(cpu, timer, early_slack, late_slack);
 
-    if (list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node) == timer) {
+    if (percpu[cpu].timer_queue.head == timer) {
         /* we just modified the head of the timer queue */
         LTRACEF("setting new timer for %" PRIu64 " nsecs\n", deadline);
         platform_set_oneshot_timer(deadline);
@@ -252,8 +413,8 @@ void timer_reset_oneshot_local(timer_t* timer, zx_time_t deadline, timer_callbac
     }
 
     /* remove it from the queue if it was present */
-    if (list_in_list(&timer->node))
-        list_delete(&timer->node);
+    if (timer_is_queued(timer))
+        timer_queue_remove(timer);
 
     /* set up the structure */
     timer->scheduled_time = deadline;
@@ -267,7 +428,7 @@ void timer_reset_oneshot_local(timer_t* timer, zx_time_t deadline, timer_callbac
 
     insert_timer_in_queue(cpu, timer, 0u, 0u);
 
-    if (list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node) == timer) {
+    if (percpu[cpu].timer_queue.head == timer) {
         /* we just modified the head of the timer queue */
         LTRACEF("setting new timer for %" PRIu64 " nsecs\n", deadline);
         platform_set_oneshot_timer(deadline);
@@ -305,14 +466,14 @@ bool timer_cancel(timer_t* timer) {
     bool callback_not_running;
 
     /* if the timer is in a queue, remove it and adjust hardware timers if needed */
-    if (list_in_list(&timer->node)) {
+    if (timer_is_queued(timer)) {
         callback_not_running = true;
 
         /* save a copy of the old head of the queue */
-        timer_t* oldhead = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+        timer_t* oldhead = percpu[cpu].timer_queue.head;
 
         /* remove our timer from the queue */
-        list_delete(&timer->node);
+        timer_queue_remove(timer);
 
         /* TODO(cpu): if  after removing |timer| there is one other single timer with
            the same scheduled_time and slack non-zero then it is possible to return
@@ -321,7 +482,7 @@ bool timer_cancel(timer_t* timer) {
         /* see if we've just modified the head of this cpu's timer queue */
         /* if we modified another cpu's queue, we'll just let it fire and sort itself out */
         if (unlikely(oldhead == timer)) {
-            timer_t* newhead = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+            timer_t* newhead = percpu[cpu].timer_queue.head;
             if (newhead) {
                 LTRACEF("setting new timer to %" PRIu64 "\n", newhead->scheduled_time);
                 platform_set_oneshot_timer(newhead->scheduled_time);
@@ -365,7 +526,7 @@ enum handler_return timer_tick(zx_time_t now) {
 
     for (;;) {
         /* see if there's an event to process */
-        timer = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+        timer = percpu[cpu].timer_queue.head;
         if (likely(timer == 0))
             break;
         LTRACEF("next item on timer queue %p at %" PRIu64 " now %" PRIu64 " (%p, arg %p)\n",
@@ -378,7 +539,7 @@ enum handler_return timer_tick(zx_time_t now) {
         DEBUG_ASSERT_MSG(timer && timer->magic == TIMER_MAGIC,
                          "ASSERT: timer failed magic check: timer %p, magic 0x%x\n",
                          timer, (uint)timer->magic);
-        list_delete(&timer->node);
+        timer_queue_remove(timer);
 
         /* mark the timer busy */
         timer->active_cpu = cpu;
@@ -408,7 +569,7 @@ enum handler_return timer_tick(zx_time_t now) {
     }
 
     /* reset the timer to the next event */
-    timer = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer = percpu[cpu].timer_queue.head;
     if (timer) {
         /* has to be the case or it would have fired already */
         DEBUG_ASSERT(timer->scheduled_time > now);
@@ -446,19 +607,19 @@ void timer_transition_off_cpu(uint old_cpu) {
     spin_lock_irqsave(&timer_lock, state);
     uint cpu = arch_curr_cpu_num();
 
-    timer_t* old_head = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer_t* old_head = percpu[cpu].timer_queue.head;
 
-    timer_t *entry = NULL, *tmp_entry = NULL;
+    timer_t* entry;
     /* Move all timers from old_cpu to this cpu */
-    list_for_every_entry_safe (&percpu[old_cpu].timer_queue, entry, tmp_entry, timer_t, node) {
-        list_delete(&entry->node);
+    while ((entry = percpu[old_cpu].timer_queue.head) != NULL) {
+        timer_queue_remove(entry);
         // We lost the original asymmetric slack information so when we combine them
         // with the other timer queue they are not coalesced again.
         // TODO(cpu): figure how important this case is.
         insert_timer_in_queue(cpu, entry, 0u, 0u);
     }
 
-    timer_t* new_head = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer_t* new_head = percpu[cpu].timer_queue.head;
     if (new_head != NULL && new_head != old_head) {
         /* we just modified the head of the timer queue */
         LTRACEF("setting new timer for %" PRIu64 " nsecs\n", new_head->scheduled_time);
@@ -474,7 +635,7 @@ void timer_thaw_percpu(void) {
 
     uint cpu = arch_curr_cpu_num();
 
-    timer_t* t = list_peek_head_type(&percpu[cpu].timer_queue, timer_t, node);
+    timer_t* t = percpu[cpu].timer_queue.head;
     if (t) {
         LTRACEF("rescheduling timer for %" PRIu64 " nsecs\n", t->scheduled_time);
         platform_set_oneshot_timer(t->scheduled_time);
@@ -486,7 +647,8 @@ void timer_thaw_percpu(void) {
 void timer_queue_init(void) {
     timer_lock = SPIN_LOCK_INITIAL_VALUE;
     for (uint i = 0; i < SMP_MAX_CPUS; i++) {
-        list_initialize(&percpu[i].timer_queue);
+        percpu[i].timer_queue.root = NULL;
+        percpu[i].timer_queue.head = NULL;
     }
 }
 
@@ -504,7 +666,7 @@ static void dump_timer_queues(char* buf, size_t len) {
 
             timer_t* t;
             zx_time_t last = now;
-            list_for_every_entry (&percpu[i].timer_queue, t, timer_t, node) {
+            for (t = percpu[i].timer_queue.head; t; t = timer_queue_next(t)) {
                 zx_duration_t delta_now = (t->scheduled_time > now) ? (t->scheduled_time - now) : 0;
                 zx_duration_t delta_last = (t->scheduled_time > last) ? (t->scheduled_time - last) : 0;
                 ptr += snprintf(buf + ptr, len - ptr,
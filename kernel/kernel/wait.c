@@ -39,7 +39,7 @@ static enum handler_return wait_queue_timeout_handler(timer_t* timer, zx_time_t
         ret = local_resched ? INT_RESCHEDULE : INT_NO_RESCHEDULE;
     }
 
-    spin_unlock(&thread_lock);
+    thread_lock_release();
 
     return ret;
 }
@@ -0,0 +1,47 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+// This file is used both in the kernel and in the vDSO implementation.
+// So it must be compatible with both the kernel and userland header
+// environments.  It must use only the basic types so that struct
+// layouts match exactly in both contexts.
+
+#define VDSO_CLOCK_SIZE (4 * 4 + 8)
+#define VDSO_CLOCK_ALIGN 8
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+// This struct lets zx_time_get() read clocks without entering the kernel.
+// Unlike vdso_constants, it is not entirely constant: the kernel keeps a
+// mapping of it and stores |utc_offset| whenever the UTC clock is adjusted.
+struct vdso_clock {
+
+    // Nonzero if ZX_CLOCK_MONOTONIC is the zx_ticks_get() counter times
+    // |ns_per_tick|.  Otherwise zx_time_get() must enter the kernel.
+    uint32_t use_ticks;
+
+    // Nanoseconds per tick, as a 32.64 fixed point number laid out like
+    // the kernel's struct fp_32_64.
+    uint32_t ns_per_tick_l0;
+    uint32_t ns_per_tick_l32;
+    uint32_t ns_per_tick_l64;
+
+    // ZX_CLOCK_UTC minus ZX_CLOCK_MONOTONIC, as set by zx_clock_adjust().
+    // This is the only member which changes after boot; it must be
+    // accessed atomically.
+    int64_t utc_offset;
+};
+
+static_assert(VDSO_CLOCK_SIZE == sizeof(vdso_clock),
+              "Need to adjust VDSO_CLOCK_SIZE");
+static_assert(VDSO_CLOCK_ALIGN == alignof(vdso_clock),
+              "Need to adjust VDSO_CLOCK_ALIGN");
+
+#endif // __ASSEMBLER__
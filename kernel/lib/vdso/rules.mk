@@ -15,6 +15,7 @@ MODULE_SRCS := \
 
 MODULE_DEPS := \
     kernel/lib/fbl \
+    kernel/lib/fixed_point \
 
 vdso-filename := $(BUILDDIR)/system/ulib/zircon/libzircon.so
 
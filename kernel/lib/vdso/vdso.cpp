@@ -5,11 +5,13 @@
 // https://opensource.org/licenses/MIT
 
 #include <lib/vdso.h>
+#include <lib/vdso-clock.h>
 #include <lib/vdso-constants.h>
 
 #include <fbl/alloc_checker.h>
 #include <fbl/type_support.h>
 #include <kernel/cmdline.h>
+#include <lib/fixed_point.h>
 #include <object/handle.h>
 #include <platform.h>
 #include <vm/pmm.h>
@@ -199,6 +201,10 @@ void blacklist_##category##_syscalls(VDsoDynSymWindow& dynsym_window, \
 #undef SYSCALL_IN_CATEGORY_END
 #undef SYSCALL_CATEGORY_END
 
+// The full vDSO's clock data stays mapped into the kernel for good, so that
+// zx_clock_adjust() can update it.
+KernelVmoWindow<vdso_clock>* clock_window;
+
 } // anonymous namespace
 
 const VDso* VDso::instance_ = NULL;
@@ -234,9 +240,31 @@ const VDso* VDso::Create() {
         pmm_count_total_bytes(),
     };
 
+    bool soft_ticks = per_second == 0 || cmdline_get_bool("vdso.soft_ticks", false);
+
+    static_assert(sizeof(vdso_clock) == VDSO_DATA_CLOCK_SIZE,
+                  "gen-rodso-code.sh is suspect");
+    clock_window = new (&ac) KernelVmoWindow<vdso_clock>(
+        "vDSO clock", vdso->vmo()->vmo(), VDSO_DATA_CLOCK);
+    ASSERT(ac.check());
+
+    // zx_time_get can compute the monotonic clock itself only if it reads the
+    // same counter as the kernel's current_time().
+    fp_32_64 ns_per_tick = {};
+    bool use_ticks = !soft_ticks &&
+        platform_usermode_time_scale(&ns_per_tick) &&
+        !cmdline_get_bool("vdso.syscall_time", false);
+    *clock_window->data() = (vdso_clock) {
+        use_ticks,
+        ns_per_tick.l0,
+        ns_per_tick.l32,
+        ns_per_tick.l64,
+        0,
+    };
+
     // If ticks_per_second has not been calibrated, it will return 0. In this
     // case, use soft_ticks instead.
-    if (per_second == 0 || cmdline_get_bool("vdso.soft_ticks", false)) {
+    if (soft_ticks) {
         // Make zx_ticks_per_second return nanoseconds per second.
         constants_window.data()->ticks_per_second = ZX_SEC(1);
 
@@ -254,6 +282,11 @@ const VDso* VDso::Create() {
     return instance_;
 }
 
+void VDso::SetUtcOffset(int64_t offset) {
+    if (clock_window)
+        __atomic_store_n(&clock_window->data()->utc_offset, offset, __ATOMIC_RELAXED);
+}
+
 uintptr_t VDso::base_address(const fbl::RefPtr<VmMapping>& code_mapping) {
     return code_mapping ? code_mapping->base() - VDSO_CODE_START : 0;
 }
@@ -292,6 +325,9 @@ void VDso::CreateVariant(Variant variant) {
     VDsoDynSymWindow dynsym_window(new_vmo);
     VDsoCodeWindow code_window(new_vmo);
 
+    // Only the full vDSO's clock data is kept up to date.
+    REDIRECT_SYSCALL(dynsym_window, zx_time_get, syscall_time_get);
+
     const char* name = nullptr;
     switch (variant) {
     case Variant::TEST1:
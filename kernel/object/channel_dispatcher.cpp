@@ -216,8 +216,12 @@ zx_status_t ChannelDispatcher::Call(fbl::unique_ptr<MessagePacket> msg,
         waiters_.push_back(waiter);
     }
 
-    // (1) Write outbound message to opposing endpoint.
+    // (1) Write outbound message to opposing endpoint. We are about to
+    // block until the reply arrives, so let the thread woken up to serve
+    // the request run next on this cpu.
+    thread_set_handoff_wakeup(true);
     other->WriteSelf(fbl::move(msg));
+    thread_set_handoff_wakeup(false);
 
     // Reuse the code from the half-call used for retrying a Call after thread
     // suspend.
@@ -274,8 +278,13 @@ int ChannelDispatcher::WriteSelf(fbl::unique_ptr<MessagePacket> msg) {
             // Remove waiter from list.
             if (waiter.get_txid() == txid) {
                 waiters_.erase(waiter);
+                // The caller is blocked on exactly this reply, so hand it
+                // this cpu rather than waking it up elsewhere.
+                thread_set_handoff_wakeup(true);
+                int woken = waiter.Deliver(fbl::move(msg));
+                thread_set_handoff_wakeup(false);
                 // we return how many threads have been woken up, or zero.
-                return waiter.Deliver(fbl::move(msg));
+                return woken;
             }
         }
     }
@@ -194,7 +194,7 @@ void Dispatcher::AddObserverHelper(StateObserver* observer,
     {
         AutoLock lock(mutex);
 
-        flags = observer->OnInitialize(signals_, cinfo);
+        flags = observer->OnInitialize(signals_.load(fbl::memory_order_relaxed), cinfo);
         if (!(flags & StateObserver::kNeedRemoval))
             observers_.push_front(observer);
     }
@@ -261,19 +261,33 @@ template <typename Mutex>
 void Dispatcher::UpdateStateHelper(zx_signals_t clear_mask,
                                    zx_signals_t set_mask,
                                    Mutex* mutex) TA_NO_THREAD_SAFETY_ANALYSIS {
+    // |signals_| only changes under the lock, so an update which would not
+    // change the current snapshot would not have changed the signals at the
+    // time the snapshot was taken either. Such updates, like re-asserting
+    // READABLE on every write to a non-empty channel, skip the lock and the
+    // walk of the observers entirely.
+    auto snapshot = signals_.load(fbl::memory_order_acquire);
+    if (((snapshot & ~clear_mask) | set_mask) == snapshot)
+        return;
+
     StateObserver::Flags flags;
     Dispatcher::ObserverList obs_to_remove;
 
     {
         AutoLock lock(mutex);
-        auto previous_signals = signals_;
-        signals_ &= ~clear_mask;
-        signals_ |= set_mask;
+        auto previous_signals = signals_.load(fbl::memory_order_relaxed);
+        auto signals = (previous_signals & ~clear_mask) | set_mask;
+
+        if (previous_signals == signals)
+            return;
+
+        // Pairs with the acquire load in PollSignals().
+        signals_.store(signals, fbl::memory_order_release);
 
-        if (previous_signals == signals_)
+        if (observers_.is_empty())
             return;
 
-        flags = UpdateInternalLocked(&obs_to_remove, signals_);
+        flags = UpdateInternalLocked(&obs_to_remove, signals);
     }
 
     while (!obs_to_remove.is_empty()) {
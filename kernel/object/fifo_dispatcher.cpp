@@ -6,8 +6,11 @@
 
 #include <object/fifo_dispatcher.h>
 
+#include <stddef.h>
 #include <string.h>
 
+#include <arch/ops.h>
+#include <vm/vm_object_paged.h>
 #include <zircon/rights.h>
 #include <fbl/alloc_checker.h>
 #include <fbl/auto_lock.h>
@@ -20,6 +23,9 @@ zx_status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t o
                                    fbl::RefPtr<Dispatcher>* dispatcher0,
                                    fbl::RefPtr<Dispatcher>* dispatcher1,
                                    zx_rights_t* rights) {
+    if (options & ~ZX_FIFO_SHARED_RING)
+        return ZX_ERR_INVALID_ARGS;
+
     // count and elemsize must be nonzero
     // count must be a power of two
     // total size must be <= kMaxSizeBytes
@@ -30,19 +36,32 @@ zx_status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t o
     }
 
     fbl::AllocChecker ac;
-    auto data0 = fbl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
-    if (!ac.check())
-        return ZX_ERR_NO_MEMORY;
-
-    auto fifo0 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize, fbl::move(data0)));
-    if (!ac.check())
-        return ZX_ERR_NO_MEMORY;
+    fbl::unique_ptr<uint8_t[]> data0;
+    fbl::unique_ptr<uint8_t[]> data1;
+    fbl::RefPtr<VmObject> ring_vmo;
+    if (options & ZX_FIFO_SHARED_RING) {
+        // One page for the indices of both rings, followed by the rings.
+        uint64_t size = PAGE_SIZE + 2 * ROUNDUP(count * elemsize, PAGE_SIZE);
+        zx_status_t status = VmObjectPaged::Create(PMM_ALLOC_FLAG_ANY, size, &ring_vmo);
+        if (status != ZX_OK)
+            return status;
+        ring_vmo->set_name("fifo-ring", sizeof("fifo-ring"));
+    } else {
+        data0.reset(new (&ac) uint8_t[count * elemsize]);
+        if (!ac.check())
+            return ZX_ERR_NO_MEMORY;
+        data1.reset(new (&ac) uint8_t[count * elemsize]);
+        if (!ac.check())
+            return ZX_ERR_NO_MEMORY;
+    }
 
-    auto data1 = fbl::unique_ptr<uint8_t[]>(new (&ac) uint8_t[count * elemsize]);
+    auto fifo0 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize,
+                                                        fbl::move(data0), ring_vmo, 0u));
     if (!ac.check())
         return ZX_ERR_NO_MEMORY;
 
-    auto fifo1 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize, fbl::move(data1)));
+    auto fifo1 = fbl::AdoptRef(new (&ac) FifoDispatcher(options, count, elemsize,
+                                                        fbl::move(data1), ring_vmo, 1u));
     if (!ac.check())
         return ZX_ERR_NO_MEMORY;
 
@@ -56,10 +75,12 @@ zx_status_t FifoDispatcher::Create(uint32_t count, uint32_t elemsize, uint32_t o
 }
 
 FifoDispatcher::FifoDispatcher(uint32_t /*options*/, uint32_t count, uint32_t elem_size,
-                               fbl::unique_ptr<uint8_t[]> data)
+                               fbl::unique_ptr<uint8_t[]> data,
+                               fbl::RefPtr<VmObject> ring_vmo, uint32_t ring_index)
     : Dispatcher(ZX_FIFO_WRITABLE),
       elem_count_(count), elem_size_(elem_size), mask_(count - 1),
-      peer_koid_(0u), head_(0u), tail_(0u), data_(fbl::move(data)) {
+      peer_koid_(0u), head_(0u), tail_(0u), data_(fbl::move(data)),
+      ring_vmo_(fbl::move(ring_vmo)), ring_index_(ring_index) {
 }
 
 FifoDispatcher::~FifoDispatcher() {
@@ -143,6 +164,9 @@ zx_status_t FifoDispatcher::WriteSelf(user_in_ptr<const uint8_t> ptr, size_t byt
 
     AutoLock lock(&lock_);
 
+    if (ring_vmo_)
+        return WriteSelfRingLocked(ptr, count, actual);
+
     uint32_t old_head = head_;
 
     // total number of available empty slots in the fifo
@@ -201,6 +225,9 @@ zx_status_t FifoDispatcher::ReadToUser(user_out_ptr<uint8_t> ptr, size_t bytelen
 
     AutoLock lock(&lock_);
 
+    if (ring_vmo_)
+        return ReadRingLocked(ptr, count, actual);
+
     uint32_t old_tail = tail_;
 
     // total number of available entries to read from the fifo
@@ -249,3 +276,203 @@ zx_status_t FifoDispatcher::ReadToUser(user_out_ptr<uint8_t> ptr, size_t bytelen
     *actual = (tail_ - old_tail);
     return ZX_OK;
 }
+
+uint64_t FifoDispatcher::RingHeaderOffset(uint32_t index) const {
+    return index * sizeof(zx_fifo_ring_header_t);
+}
+
+uint64_t FifoDispatcher::RingDataOffset(uint32_t index) const {
+    return PAGE_SIZE + index * ROUNDUP(elem_count_ * elem_size_, PAGE_SIZE);
+}
+
+zx_status_t FifoDispatcher::GetRing(fbl::RefPtr<VmObject>* vmo, zx_fifo_ring_info_t* info) {
+    canary_.Assert();
+
+    if (!ring_vmo_)
+        return ZX_ERR_NOT_SUPPORTED;
+
+    uint32_t peer_index = ring_index_ ^ 1u;
+    info->elem_count = elem_count_;
+    info->elem_size = elem_size_;
+    info->rx_header_offset = RingHeaderOffset(ring_index_);
+    info->rx_data_offset = RingDataOffset(ring_index_);
+    info->tx_header_offset = RingHeaderOffset(peer_index);
+    info->tx_data_offset = RingDataOffset(peer_index);
+    info->vmo_size = ring_vmo_->size();
+    *vmo = ring_vmo_;
+    return ZX_OK;
+}
+
+zx_status_t FifoDispatcher::ReadRingIndicesLocked(uint32_t* head, uint32_t* tail) {
+    zx_fifo_ring_header_t header;
+    size_t actual;
+    zx_status_t status = ring_vmo_->Read(&header, RingHeaderOffset(ring_index_),
+                                         sizeof(header), &actual);
+    if (status != ZX_OK || actual != sizeof(header))
+        return ZX_ERR_BAD_STATE;
+
+    // The indices are in memory userspace can write; don't trust them.
+    if (header.head - header.tail > elem_count_)
+        return ZX_ERR_BAD_STATE;
+
+    *head = header.head;
+    *tail = header.tail;
+    return ZX_OK;
+}
+
+zx_status_t FifoDispatcher::WriteRingIndexLocked(size_t field_offset, uint32_t value) {
+    // Whoever reads the index must find the entries before it in place.
+    smp_mb();
+
+    size_t actual;
+    zx_status_t status = ring_vmo_->Write(&value, RingHeaderOffset(ring_index_) + field_offset,
+                                          sizeof(value), &actual);
+    if (status != ZX_OK || actual != sizeof(value))
+        return ZX_ERR_BAD_STATE;
+    return ZX_OK;
+}
+
+zx_status_t FifoDispatcher::RefreshRingLocked() {
+    uint32_t head, tail;
+    zx_status_t status = ReadRingIndicesLocked(&head, &tail);
+    if (status != ZX_OK)
+        return status;
+
+    uint32_t used = head - tail;
+    if (used == 0)
+        UpdateState(ZX_FIFO_READABLE, 0u);
+    else
+        UpdateState(0u, ZX_FIFO_READABLE);
+
+    if (other_) {
+        if (used == elem_count_)
+            other_->UpdateState(ZX_FIFO_WRITABLE, 0u);
+        else
+            other_->UpdateState(0u, ZX_FIFO_WRITABLE);
+    }
+    return ZX_OK;
+}
+
+zx_status_t FifoDispatcher::RefreshRingSelf() {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+    return RefreshRingLocked();
+}
+
+zx_status_t FifoDispatcher::NotifyRing() {
+    canary_.Assert();
+
+    if (!ring_vmo_)
+        return ZX_ERR_NOT_SUPPORTED;
+
+    fbl::RefPtr<FifoDispatcher> other;
+    {
+        AutoLock lock(&lock_);
+        zx_status_t status = RefreshRingLocked();
+        if (status != ZX_OK)
+            return status;
+        if (!other_)
+            return ZX_ERR_PEER_CLOSED;
+        other = other_;
+    }
+
+    return other->RefreshRingSelf();
+}
+
+zx_status_t FifoDispatcher::WriteSelfRingLocked(user_in_ptr<const uint8_t> ptr, size_t count,
+                                                uint32_t* actual) {
+    uint32_t old_head, tail;
+    zx_status_t status = ReadRingIndicesLocked(&old_head, &tail);
+    if (status != ZX_OK)
+        return status;
+
+    // total number of available empty slots in the fifo
+    size_t avail = elem_count_ - (old_head - tail);
+    if (avail == 0)
+        return ZX_ERR_SHOULD_WAIT;
+
+    if (count > avail)
+        count = avail;
+
+    uint32_t head = old_head;
+    uint64_t data_offset = RingDataOffset(ring_index_);
+    while (count > 0) {
+        uint32_t offset = (head & mask_);
+
+        // number of slots from target to end, inclusive
+        uint32_t n = elem_count_ - offset;
+
+        // number of slots we can actually copy
+        size_t to_copy = (count > n) ? n : count;
+
+        size_t written;
+        status = ring_vmo_->WriteUser(ptr.reinterpret<const void>(),
+                                      data_offset + offset * elem_size_,
+                                      to_copy * elem_size_, &written);
+        if (status != ZX_OK)
+            return ZX_ERR_INVALID_ARGS;
+
+        // nothing is visible to the reader until head is written below
+        head += static_cast<uint32_t>(to_copy);
+        count -= to_copy;
+        ptr = ptr.byte_offset(to_copy * elem_size_);
+    }
+
+    status = WriteRingIndexLocked(offsetof(zx_fifo_ring_header_t, head), head);
+    if (status != ZX_OK)
+        return status;
+
+    *actual = head - old_head;
+    return RefreshRingLocked();
+}
+
+zx_status_t FifoDispatcher::ReadRingLocked(user_out_ptr<uint8_t> ptr, size_t count,
+                                           uint32_t* actual) {
+    uint32_t head, old_tail;
+    zx_status_t status = ReadRingIndicesLocked(&head, &old_tail);
+    if (status != ZX_OK)
+        return status;
+
+    // total number of available entries to read from the fifo
+    size_t avail = head - old_tail;
+    if (avail == 0) {
+        // userspace may have drained the ring without telling us
+        UpdateState(ZX_FIFO_READABLE, 0u);
+        return ZX_ERR_SHOULD_WAIT;
+    }
+
+    if (count > avail)
+        count = avail;
+
+    uint32_t tail = old_tail;
+    uint64_t data_offset = RingDataOffset(ring_index_);
+    while (count > 0) {
+        uint32_t offset = (tail & mask_);
+
+        // number of slots from target to end, inclusive
+        uint32_t n = elem_count_ - offset;
+
+        // number of slots we can actually copy
+        size_t to_copy = (count > n) ? n : count;
+
+        size_t read;
+        status = ring_vmo_->ReadUser(ptr.reinterpret<void>(),
+                                     data_offset + offset * elem_size_,
+                                     to_copy * elem_size_, &read);
+        if (status != ZX_OK)
+            return ZX_ERR_INVALID_ARGS;
+
+        // the slots are not handed back to the writer until tail is written below
+        tail += static_cast<uint32_t>(to_copy);
+        count -= to_copy;
+        ptr = ptr.byte_offset(to_copy * elem_size_);
+    }
+
+    status = WriteRingIndexLocked(offsetof(zx_fifo_ring_header_t, tail), tail);
+    if (status != ZX_OK)
+        return status;
+
+    *actual = tail - old_tail;
+    return RefreshRingLocked();
+}
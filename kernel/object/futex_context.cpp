@@ -26,7 +26,11 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (auto& bucket : buckets_) {
+        __UNUSED AutoLock lock(&bucket.lock);
+        DEBUG_ASSERT(bucket.futex_table.is_empty());
+        DEBUG_ASSERT(bucket.waiters.load() == 0);
+    }
 }
 
 zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int current_value, zx_time_t deadline) {
@@ -36,6 +40,7 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     if (futex_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
+    Bucket* bucket = GetBucket(futex_key);
     FutexNode* node;
 
     // FutexWait() checks that the address value_ptr still contains
@@ -44,16 +49,27 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    lock_.Acquire();
+    bucket->lock.Acquire();
+
+    // Count ourselves as a waiter before looking at the value. This pairs
+    // with the barrier in FutexWake(): either it sees us here, or we see the
+    // value it stored before checking.
+    bucket->waiters.fetch_add(1);
+    // The count must be visible before the futex value is read, or both
+    // sides can miss each other: on arm64 the user load could otherwise be
+    // satisfied ahead of the counter store.
+    smp_mb();
 
     int value;
     zx_status_t result = value_ptr.copy_from_user(&value);
     if (result != ZX_OK) {
-        lock_.Release();
+        bucket->waiters.fetch_sub(1);
+        bucket->lock.Release();
         return result;
     }
     if (value != current_value) {
-        lock_.Release();
+        bucket->waiters.fetch_sub(1);
+        bucket->lock.Release();
         return ZX_ERR_BAD_STATE;
     }
 
@@ -62,10 +78,11 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     node->set_hash_key(futex_key);
     node->SetAsSingletonList();
 
-    QueueNodesLocked(node);
+    // Our waiter count was already added above.
+    QueueNodesLocked(bucket, node, 0);
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
-    result = node->BlockThread(&lock_, deadline);
+    // Block current thread.  This releases the bucket lock and does not reacquire it.
+    result = node->BlockThread(&bucket->lock, deadline);
     if (result == ZX_OK) {
         DEBUG_ASSERT(!node->IsInQueue());
         // All the work necessary for removing us from the hash table was done by FutexWake()
@@ -77,9 +94,13 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     // (ZX_ERR_INTERNAL_INTR_RETRY).
     //
     // We need to ensure that the thread's node is removed from the wait
-    // queue, because FutexWake() probably didn't do that.
-    AutoLock lock(&lock_);
-    if (UnqueueNodeLocked(node)) {
+    // queue, because FutexWake() probably didn't do that.  We may have been
+    // requeued onto a futex in another bucket in the meantime, so find the
+    // bucket from the node rather than from value_ptr.
+    bucket = LockNodeBucket(node);
+    if (bucket) {
+        UnqueueNodeLocked(bucket, node);
+        bucket->lock.Release();
         return result;
     }
     // The current thread was not found on the wait queue.  This means
@@ -114,9 +135,18 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
     if (futex_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    Bucket* bucket = GetBucket(futex_key);
+
+    // Fast path: nobody is waiting on any futex in this bucket. The caller
+    // changed the futex value before calling us; the barrier orders that
+    // store before our load of the waiter count.
+    smp_mb();
+    if (bucket->waiters.load(fbl::memory_order_relaxed) == 0)
+        return ZX_OK;
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    AutoLock lock(&bucket->lock);
+
+    FutexNode* node = bucket->futex_table.erase(futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
@@ -124,12 +154,14 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
     DEBUG_ASSERT(node->GetKey() == futex_key);
 
     bool any_woken = false;
+    uint32_t removed = 0;
     FutexNode* remaining_waiters =
-        FutexNode::WakeThreads(node, count, futex_key, &any_woken);
+        FutexNode::WakeThreads(node, count, futex_key, &removed, &any_woken);
+    bucket->waiters.fetch_sub(removed);
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        bucket->futex_table.insert(remaining_waiters);
     }
 
     if (any_woken) {
@@ -141,37 +173,74 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
 }
 
 zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t wake_count, int current_value,
-                                       user_in_ptr<const int> requeue_ptr, uint32_t requeue_count) {
+                                       user_in_ptr<const int> requeue_ptr, uint32_t requeue_count)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
     LTRACE_ENTRY;
 
     if ((requeue_ptr.get() == nullptr) && requeue_count)
         return ZX_ERR_INVALID_ARGS;
 
-    AutoLock lock(&lock_);
+    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
+    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
+    Bucket* wake_bucket = GetBucket(wake_key);
+    Bucket* requeue_bucket = GetBucket(requeue_key);
+
+    // Fast path: nobody is waiting in the bucket for wake_ptr, so there is
+    // nothing to wake or requeue. We still owe the caller the value check.
+    smp_mb();
+    bool skip_lock = (wake_bucket->waiters.load(fbl::memory_order_relaxed) == 0);
+
+    // Take both bucket locks, in address order so that concurrent requeues
+    // in opposite directions cannot deadlock.
+    Bucket* first = (wake_bucket < requeue_bucket) ? wake_bucket : requeue_bucket;
+    Bucket* second = (wake_bucket < requeue_bucket) ? requeue_bucket : wake_bucket;
+    if (!skip_lock) {
+        first->lock.Acquire();
+        if (second != first)
+            second->lock.Acquire();
+    }
+    auto unlock = [&]() TA_NO_THREAD_SAFETY_ANALYSIS {
+        if (!skip_lock) {
+            if (second != first)
+                second->lock.Release();
+            first->lock.Release();
+        }
+    };
 
     int value;
     zx_status_t result = wake_ptr.copy_from_user(&value);
-    if (result != ZX_OK) return result;
-    if (value != current_value) return ZX_ERR_BAD_STATE;
+    if (result != ZX_OK) {
+        unlock();
+        return result;
+    }
+    if (value != current_value) {
+        unlock();
+        return ZX_ERR_BAD_STATE;
+    }
 
-    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
-    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
-    if (wake_key == requeue_key) return ZX_ERR_INVALID_ARGS;
-    if (wake_key % sizeof(int) || requeue_key % sizeof(int))
+    if (wake_key == requeue_key || wake_key % sizeof(int) || requeue_key % sizeof(int)) {
+        unlock();
         return ZX_ERR_INVALID_ARGS;
+    }
+
+    if (skip_lock)
+        return ZX_OK;
 
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
+    // nodes below, because operations on futex_table look at the GetKey
     // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    FutexNode* node = wake_bucket->futex_table.erase(wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
+        unlock();
         return ZX_OK;
     }
 
     bool any_woken = false;
     if (wake_count > 0) {
-        node = FutexNode::WakeThreads(node, wake_count, wake_key, &any_woken);
+        uint32_t removed = 0;
+        node = FutexNode::WakeThreads(node, wake_count, wake_key, &removed, &any_woken);
+        wake_bucket->waiters.fetch_sub(removed);
     }
 
     // node is now the head of wake_ptr futex after possibly removing some threads to wake
@@ -179,50 +248,70 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t
         if (requeue_count > 0) {
             // head and tail of list of nodes to requeue
             FutexNode* requeue_head = node;
+            uint32_t removed = 0;
             node = FutexNode::RemoveFromHead(node, requeue_count,
-                                             wake_key, requeue_key);
+                                             wake_key, requeue_key, &removed);
+            wake_bucket->waiters.fetch_sub(removed);
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            QueueNodesLocked(requeue_bucket, requeue_head, removed);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
+        wake_bucket->futex_table.insert(node);
     }
 
+    unlock();
+
     if (any_woken) {
-        lock.release();
         thread_reschedule();
     }
 
     return ZX_OK;
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.IsHeld());
+FutexContext::Bucket* FutexContext::LockNodeBucket(FutexNode* node) {
+    // The node's key, and so its bucket, can only change under the locks of
+    // both the old and new buckets (see FutexRequeue()), so once we hold the
+    // lock for the bucket the key currently maps to, it is stable.
+    for (;;) {
+        uintptr_t futex_key = node->GetKeyRacy();
+        Bucket* bucket = GetBucket(futex_key);
+        bucket->lock.Acquire();
+        if (GetBucket(node->GetKey()) == bucket) {
+            if (node->IsInQueue())
+                return bucket;
+            bucket->lock.Release();
+            return nullptr;
+        }
+        bucket->lock.Release();
+    }
+}
 
-    FutexNode::HashTable::iterator iter;
+void FutexContext::QueueNodesLocked(Bucket* bucket, FutexNode* head, uint32_t count) {
+    DEBUG_ASSERT(bucket->lock.IsHeld());
+
+    bucket->waiters.fetch_add(count);
+
+    Bucket::Table::iterator iter;
 
     // Attempt to insert this FutexNode into the hash table.  If the insert
     // succeeds, then the current thread is first to block on this futex and we
     // are finished.  If the insert fails, then there is already a thread
     // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+    if (!bucket->futex_table.insert_or_find(head, &iter))
         iter->AppendList(head);
 }
 
-// This attempts to unqueue a thread (which may or may not be waiting on a
-// futex), given its FutexNode.  This returns whether the FutexNode was
-// found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.IsHeld());
-
-    if (!node->IsInQueue())
-        return false;
+// This unqueues a thread, given its FutexNode, from the futex wait queue in
+// |bucket| that it is known to be on.
+void FutexContext::UnqueueNodeLocked(Bucket* bucket, FutexNode* node) {
+    DEBUG_ASSERT(bucket->lock.IsHeld());
+    DEBUG_ASSERT(node->IsInQueue());
 
     // Note: When UnqueueNode() is called from FutexWait(), it might be
     // tempting to reuse the futex key that was passed to FutexWait().
@@ -230,10 +319,10 @@ bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
     // FutexRequeue(), so we need to re-get the hash table key here.
     uintptr_t futex_key = node->GetKey();
 
-    FutexNode* old_head = futex_table_.erase(futex_key);
+    FutexNode* old_head = bucket->futex_table.erase(futex_key);
     DEBUG_ASSERT(old_head);
     FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
     if (new_head)
-        futex_table_.insert(new_head);
-    return true;
+        bucket->futex_table.insert(new_head);
+    bucket->waiters.fetch_sub(1);
 }
@@ -70,7 +70,8 @@ FutexNode* FutexNode::RemoveNodeFromList(FutexNode* list_head,
 
 // This removes up to |count| threads from the list specified by |node|,
 // and it wakes those threads.  It returns the new list head (i.e. the list
-// of remaining nodes), which may be null (empty).
+// of remaining nodes), which may be null (empty).  The number of nodes
+// removed is returned in |out_removed|.
 //
 // This will always remove at least one node, because it requires that
 // |count| is non-zero and |list_head| is a non-empty list.
@@ -78,15 +79,19 @@ FutexNode* FutexNode::RemoveNodeFromList(FutexNode* list_head,
 // RemoveFromHead() is similar, except that it produces a list of removed
 // threads without waking them.
 FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
-                                  uintptr_t old_hash_key, bool* out_any_woken) {
+                                  uintptr_t old_hash_key, uint32_t* out_removed,
+                                  bool* out_any_woken) {
     ASSERT(node);
     ASSERT(count != 0);
 
     FutexNode* const list_end = node->queue_prev_;
     for (uint32_t i = 0; i < count; i++) {
         DEBUG_ASSERT(node->GetKey() == old_hash_key);
-        // Clear this field to avoid any possible confusion.
-        node->set_hash_key(0);
+        // The key is left in place: if this thread's wait is timing out
+        // concurrently, FutexWait() uses it to find the lock that
+        // serializes it against us.
+
+        *out_removed = i + 1;
 
         const bool is_last_node = (node == list_end);
         FutexNode* next = node->queue_next_;
@@ -112,7 +117,7 @@ FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
 // This removes up to |count| nodes from |list_head|.  It returns the new
 // list head (i.e. the list of remaining nodes), which may be null (empty).
 // On return, |list_head| is the list of nodes that were removed --
-// |list_head| remains a valid list.
+// |list_head| remains a valid list -- and |out_removed| is its length.
 //
 // This will always remove at least one node, because it requires that
 // |count| is non-zero and |list_head| is a non-empty list.
@@ -121,7 +126,8 @@ FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
 // removes from the list.
 FutexNode* FutexNode::RemoveFromHead(FutexNode* list_head, uint32_t count,
                                      uintptr_t old_hash_key,
-                                     uintptr_t new_hash_key) {
+                                     uintptr_t new_hash_key,
+                                     uint32_t* out_removed) {
     ASSERT(list_head);
     ASSERT(count != 0);
 
@@ -131,6 +137,7 @@ FutexNode* FutexNode::RemoveFromHead(FutexNode* list_head, uint32_t count,
         // For requeuing, update the key so that FutexWait() can remove the
         // thread from its current queue if the wait operation times out.
         node->set_hash_key(new_hash_key);
+        *out_removed = i + 1;
 
         node = node->queue_next_;
         if (node == list_head) {
@@ -175,10 +182,10 @@ bool FutexNode::WakeThread() {
     // cases to consider:
     //  1) The thread's wait times out, or the thread is killed or
     //     suspended.  In those cases, FutexWait() will reacquire the
-    //     FutexContext lock.  We are currently holding that lock, so
-    //     FutexWait() will not race with us.
+    //     lock of the FutexContext bucket for the futex.  We are currently
+    //     holding that lock, so FutexWait() will not race with us.
     //  2) The thread is woken by our wait_queue_wake_one() call.  In
-    //     this case, FutexWait() will *not* reacquire the FutexContext
+    //     this case, FutexWait() will *not* reacquire the bucket
     //     lock.  To handle this correctly, we must not access |this|
     //     after wait_queue_wake_one().
 
@@ -186,9 +193,9 @@ bool FutexNode::WakeThread() {
     MarkAsNotInQueue();
 
     // Place the waiting thread in the runnable state, but do not
-    // reschedule yet.  Our caller is currently holding the main
-    // futex_lock, and any threads which get woken by this action are going
-    // to immediately attempt to obtain the main futex_lock.  If we
+    // reschedule yet.  Our caller is currently holding the futex's
+    // bucket lock, and any threads which get woken by this action may
+    // immediately attempt to obtain that lock.  If we
     // indicate that the thread was woken during this process, our caller
     // will release the lock and then arrange for a reschedule operation
     // (which leads to a smoother transition).
@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <stdint.h>
 
+#include <fbl/atomic.h>
 #include <fbl/canary.h>
 #include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_single_list.h>
@@ -59,6 +60,7 @@ DECLARE_DISPTAG(GuestDispatcher, ZX_OBJ_TYPE_GUEST)
 DECLARE_DISPTAG(VcpuDispatcher, ZX_OBJ_TYPE_VCPU)
 DECLARE_DISPTAG(TimerDispatcher, ZX_OBJ_TYPE_TIMER)
 DECLARE_DISPTAG(IommuDispatcher, ZX_OBJ_TYPE_IOMMU)
+DECLARE_DISPTAG(WaitSetDispatcher, ZX_OBJ_TYPE_WAIT_SET)
 
 #undef DECLARE_DISPTAG
 
@@ -108,6 +110,14 @@ public:
     // Like Cancel() but issued via via zx_port_cancel().
     bool CancelByKey(Handle* handle, const void* port, uint64_t key);
 
+    // Returns a snapshot of the asserted signals without taking |lock_|. The
+    // snapshot may be stale by the time it is looked at, so it is only good
+    // for answering waits on signals which it shows are already asserted.
+    zx_signals_t PollSignals() const {
+        ZX_DEBUG_ASSERT(has_state_tracker());
+        return signals_.load(fbl::memory_order_acquire);
+    }
+
     // Accessors for CookieJars
     // These live with the state tracker so they can make use of the state tracker's
     // lock (since not all objects have their own locks, but all Dispatchers that are
@@ -122,6 +132,10 @@ public:
 
     virtual bool has_state_tracker() const { return false; }
 
+    // Whether add_observer() hands observers a CountInfo, which a snapshot
+    // from PollSignals() cannot provide.
+    virtual bool has_count_info() const { return false; }
+
     virtual zx_status_t add_observer(StateObserver* observer);
 
     virtual zx_status_t user_signal(uint32_t clear_mask, uint32_t set_mask, bool peer);
@@ -157,7 +171,7 @@ protected:
 
     zx_signals_t GetSignalsState() const {
         ZX_DEBUG_ASSERT(has_state_tracker());
-        return signals_;
+        return signals_.load(fbl::memory_order_relaxed);
     }
 
     // Dispatcher subtypes should use this lock to protect their internal state.
@@ -190,7 +204,10 @@ private:
     // accesses (all of which go via GetSignalsState) will be
     // statically under this lock_, rather than maybe under this lock
     // or the more specific object lock.
-    zx_signals_t signals_;
+    //
+    // Writes happen under |lock_|, but reads via PollSignals() do not,
+    // hence the atomic.
+    fbl::atomic<zx_signals_t> signals_;
 
     // Active observers are elements in |observers_|.
     ObserverList observers_ TA_GUARDED(lock_);
@@ -9,7 +9,9 @@
 #include <stdint.h>
 
 #include <object/dispatcher.h>
+#include <vm/vm_object.h>
 
+#include <zircon/syscalls/fifo.h>
 #include <zircon/types.h>
 #include <fbl/canary.h>
 #include <fbl/mutex.h>
@@ -34,15 +36,46 @@ public:
     zx_status_t WriteFromUser(user_in_ptr<const uint8_t> src, size_t len, uint32_t* actual);
     zx_status_t ReadToUser(user_out_ptr<uint8_t> dst, size_t len, uint32_t* actual);
 
+    // Only for fifos created with ZX_FIFO_SHARED_RING: returns the VMO which
+    // holds the entries of both directions, and where this endpoint's rings
+    // are in it.
+    zx_status_t GetRing(fbl::RefPtr<VmObject>* vmo, zx_fifo_ring_info_t* info);
+
+    // Only for fifos created with ZX_FIFO_SHARED_RING: brings the signals of
+    // both endpoints up to date after entries were moved through the mapped
+    // ring instead of with ReadToUser() and WriteFromUser().
+    zx_status_t NotifyRing();
+
 private:
     FifoDispatcher(uint32_t options, uint32_t elem_count, uint32_t elem_size,
-                   fbl::unique_ptr<uint8_t[]> data);
+                   fbl::unique_ptr<uint8_t[]> data, fbl::RefPtr<VmObject> ring_vmo,
+                   uint32_t ring_index);
     void Init(fbl::RefPtr<FifoDispatcher> other);
     zx_status_t WriteSelf(user_in_ptr<const uint8_t> ptr, size_t len, uint32_t* actual);
     zx_status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask);
 
+    // Shared ring versions of WriteSelf() and ReadToUser().
+    zx_status_t WriteSelfRingLocked(user_in_ptr<const uint8_t> ptr, size_t count,
+                                    uint32_t* actual) TA_REQ(lock_);
+    zx_status_t ReadRingLocked(user_out_ptr<uint8_t> ptr, size_t count,
+                               uint32_t* actual) TA_REQ(lock_);
+
+    // Reads the indices of the ring this endpoint reads from. Fails with
+    // ZX_ERR_BAD_STATE if userspace left them inconsistent.
+    zx_status_t ReadRingIndicesLocked(uint32_t* head, uint32_t* tail) TA_REQ(lock_);
+    zx_status_t WriteRingIndexLocked(size_t field_offset, uint32_t value) TA_REQ(lock_);
+
+    // Recomputes READABLE for this endpoint and WRITABLE for the peer from
+    // the indices of the ring this endpoint reads from.
+    zx_status_t RefreshRingLocked() TA_REQ(lock_);
+    zx_status_t RefreshRingSelf();
+
     void OnPeerZeroHandles();
 
+    // Offsets of the ring of endpoint |index| (0 or 1) in the shared VMO.
+    uint64_t RingHeaderOffset(uint32_t index) const;
+    uint64_t RingDataOffset(uint32_t index) const;
+
     fbl::Canary<fbl::magic("FIFO")> canary_;
     const uint32_t elem_count_;
     const uint32_t elem_size_;
@@ -55,5 +88,12 @@ private:
     uint32_t tail_ TA_GUARDED(lock_);
     fbl::unique_ptr<uint8_t[]> data_ TA_GUARDED(lock_);
 
+    // Set instead of |data_| for ZX_FIFO_SHARED_RING fifos, in which case
+    // |head_| and |tail_| are unused: the indices live in the VMO, where
+    // userspace can change them at any time. Both endpoints share the VMO;
+    // |ring_index_| selects the ring this endpoint reads from.
+    const fbl::RefPtr<VmObject> ring_vmo_;
+    const uint32_t ring_index_;
+
     static constexpr uint32_t kMaxSizeBytes = PAGE_SIZE;
 };
@@ -8,6 +8,7 @@
 
 #include <lib/user_copy/user_ptr.h>
 #include <zircon/types.h>
+#include <fbl/atomic.h>
 #include <fbl/mutex.h>
 #include <object/futex_node.h>
 
@@ -23,6 +24,9 @@
 // When the thread at the head of the futex's blocked thread list is resumed,
 // The FutexNode for the new head of the blocked thread list is set as the hash table value
 // for the futex.
+// The futexes are spread across a fixed number of buckets by address, each with
+// its own lock and hash table, so that threads using unrelated futexes do not
+// serialize on a single lock.
 class FutexContext {
 public:
     FutexContext();
@@ -51,14 +55,37 @@ private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    static constexpr size_t kNumBuckets = 16;
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    struct Bucket {
+        using Table = fbl::HashTable<uintptr_t, FutexNode*, fbl::SinglyLinkedList<FutexNode*>,
+                                     size_t, 7>;
 
-    // protects futex_table_
-    fbl::Mutex lock_;
+        // protects futex_table
+        fbl::Mutex lock;
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+        // Number of threads queued on, or in the process of queueing on, a
+        // futex in this bucket. FutexWait() raises it before checking the
+        // futex value, so a waker that finds it zero after changing the value
+        // knows there is nobody to wake and can skip |lock|.
+        fbl::atomic<uint32_t> waiters{0};
+
+        // Key is futex address, value is the FutexNode for the head of futex's blocked
+        // thread list.
+        Table futex_table TA_GUARDED(lock);
+    };
+
+    Bucket* GetBucket(uintptr_t futex_key) {
+        return &buckets_[FutexNode::GetHash(futex_key) % kNumBuckets];
+    }
+
+    // Lock the bucket |node| is queued in, returning it, or return nullptr
+    // if the node is not queued.
+    Bucket* LockNodeBucket(FutexNode* node) TA_NO_THREAD_SAFETY_ANALYSIS;
+
+    void QueueNodesLocked(Bucket* bucket, FutexNode* head, uint32_t count) TA_REQ(bucket->lock);
+
+    void UnqueueNodeLocked(Bucket* bucket, FutexNode* node) TA_REQ(bucket->lock);
+
+    Bucket buckets_[kNumBuckets];
 };
@@ -34,20 +34,26 @@ public:
     static FutexNode* RemoveNodeFromList(FutexNode* list_head, FutexNode* node);
 
     static FutexNode* WakeThreads(FutexNode* node, uint32_t count,
-                                  uintptr_t old_hash_key, bool* out_any_woken);
+                                  uintptr_t old_hash_key, uint32_t* out_removed,
+                                  bool* out_any_woken);
 
     static FutexNode* RemoveFromHead(FutexNode* list_head,
                                      uint32_t count,
                                      uintptr_t old_hash_key,
-                                     uintptr_t new_hash_key);
+                                     uintptr_t new_hash_key,
+                                     uint32_t* out_removed);
 
     // This must be called with |mutex| held and returns without |mutex| held.
     zx_status_t BlockThread(fbl::Mutex* mutex, zx_time_t deadline) TA_REL(mutex);
 
     void set_hash_key(uintptr_t key) {
-        hash_key_ = key;
+        __atomic_store_n(&hash_key_, key, __ATOMIC_RELAXED);
     }
 
+    // Reads the key without holding the lock that protects it. Only good for
+    // deciding which lock to take; it must be checked again once that is held.
+    uintptr_t GetKeyRacy() const { return __atomic_load_n(&hash_key_, __ATOMIC_RELAXED); }
+
     // Trait implementation for fbl::HashTable
     uintptr_t GetKey() const { return hash_key_; }
     static size_t GetHash(uintptr_t key) { return (key >> 3); }
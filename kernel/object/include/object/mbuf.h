@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 
+#include <arch/defines.h>
 #include <lib/user_copy/user_ptr.h>
 #include <zircon/types.h>
 #include <fbl/intrusive_single_list.h>
@@ -24,16 +25,26 @@ public:
     bool is_empty() const;
     size_t size() const { return size_; }
 
+    // The number of bytes the chain accepts before it reports itself full.
+    // It may be raised up to kSizeMaxLimit, for sockets carrying bulk data.
+    size_t max_size() const { return size_max_; }
+    zx_status_t set_max_size(size_t size_max);
+
 private:
-    // An MBuf is a small fixed-size chainable memory buffer.
+    // An MBuf is a chainable memory buffer. Its payload follows the header
+    // directly. Small MBufs come from the heap; writes larger than a small
+    // MBuf's payload are stored in MBufs which fill a whole page.
     struct MBuf : public fbl::SinglyLinkedListable<MBuf*> {
         // 8 for the linked list and 4 for the explicit uint32_t fields.
         static constexpr size_t kHeaderSize = 8 + (4 * 4);
         // 16 is for the malloc header.
         static constexpr size_t kMallocSize = 2048 - 16;
         static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
+        static constexpr size_t kPagePayloadSize = PAGE_SIZE - kHeaderSize;
 
         size_t rem() const;
+        bool is_page() const { return cap_ == kPagePayloadSize; }
+        char* data() { return reinterpret_cast<char*>(this) + kHeaderSize; }
 
         uint32_t off_ = 0u;
         uint32_t len_ = 0u;
@@ -43,19 +54,28 @@ private:
         //
         // Always 0 in ZX_SOCKET_STREAM mode.
         uint32_t pkt_len_ = 0u;
-        uint32_t unused_;
-        char data_[kPayloadSize] = {0};
-        // TODO: maybe union data_ with char* blocks for large messages
+        // Size of the payload area, kPayloadSize or kPagePayloadSize.
+        uint32_t cap_;
     };
-    static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
+    static_assert(sizeof(MBuf) == MBuf::kHeaderSize, "");
 
     static constexpr size_t kSizeMax = 128 * MBuf::kPayloadSize;
+    static constexpr size_t kSizeMaxLimit = 16 * 1024 * 1024;
+
+    // Page MBufs are returned to the pmm beyond this many free ones, so a
+    // large socket does not keep its peak footprint after it drains.
+    static constexpr size_t kPageFreelistMax = 16;
 
-    MBuf* AllocMBuf();
+    // Returns a page MBuf if |len| bytes would not fit in a small one.
+    MBuf* AllocMBuf(size_t len);
     void FreeMBuf(MBuf* buf);
+    static void DeleteMBuf(MBuf* buf);
 
     fbl::SinglyLinkedList<MBuf*> freelist_;
+    fbl::SinglyLinkedList<MBuf*> page_freelist_;
+    size_t page_freelist_count_ = 0u;
     fbl::SinglyLinkedList<MBuf*> tail_;
     MBuf* head_ = nullptr;;
     size_t size_ = 0u;
+    size_t size_max_ = kSizeMax;
 };
@@ -49,6 +49,11 @@ public:
 
     zx_status_t ReadControl(user_out_ptr<void> dst, size_t len, size_t* nread);
 
+    // The number of bytes this endpoint buffers for reading before the
+    // peer stops being writable.
+    size_t GetReadBufferMax();
+    zx_status_t SetReadBufferMax(size_t size);
+
     // On success, share takes ownership of h
     zx_status_t Share(Handle* h);
 
@@ -19,8 +19,10 @@ class VmAspace;
 
 class VmObjectDispatcher final : public Dispatcher {
 public:
+    // A dispatcher created with |resizable| false fails SetSize(), for VMOs
+    // whose size the kernel relies on.
     static zx_status_t Create(fbl::RefPtr<VmObject> vmo, fbl::RefPtr<Dispatcher>* dispatcher,
-                              zx_rights_t* rights);
+                              zx_rights_t* rights, bool resizable = true);
 
     ~VmObjectDispatcher() final;
     zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_VMO; }
@@ -46,10 +48,11 @@ public:
     const fbl::RefPtr<VmObject>& vmo() const { return vmo_; }
 
 private:
-    explicit VmObjectDispatcher(fbl::RefPtr<VmObject> vmo);
+    VmObjectDispatcher(fbl::RefPtr<VmObject> vmo, bool resizable);
 
     fbl::Canary<fbl::magic("VMOD")> canary_;
     fbl::RefPtr<VmObject> vmo_;
+    const bool resizable_;
 
     // VMOs do not currently maintain any VMO-specific signal state,
     // but do allow user signals to be set. In addition, the CookieJar
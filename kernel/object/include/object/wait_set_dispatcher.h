@@ -0,0 +1,120 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <kernel/event.h>
+#include <lib/user_copy/user_ptr.h>
+#include <object/dispatcher.h>
+#include <object/state_observer.h>
+
+#include <zircon/types.h>
+#include <fbl/canary.h>
+#include <fbl/intrusive_double_list.h>
+#include <fbl/intrusive_wavl_tree.h>
+#include <fbl/mutex.h>
+#include <fbl/ref_ptr.h>
+
+#include <sys/types.h>
+
+class Handle;
+
+// A wait set is a persistent set of (handle, signals) entries, each named by
+// a caller-chosen cookie. Unlike zx_object_wait_many(), entries stay
+// registered with the watched objects between waits: each entry is a
+// StateObserver which moves itself onto the set's ready list when its
+// signals become active, so a wait only looks at ready entries.
+//
+// Level-triggered entries stay on the ready list, and keep being reported,
+// for as long as any of their signals are asserted. Edge-triggered entries
+// are reported once per batch of state changes which assert one of their
+// signals.
+//
+// An entry is removed with zx_waitset_remove(), which goes through the
+// watched object's observer cancellation like zx_port_cancel(). When the
+// watched handle is closed, the entry is reported once more with status
+// ZX_ERR_CANCELED and then removed.
+class WaitSetDispatcher final : public Dispatcher {
+public:
+    static zx_status_t Create(uint32_t options, fbl::RefPtr<Dispatcher>* dispatcher,
+                              zx_rights_t* rights);
+
+    ~WaitSetDispatcher() final;
+    zx_obj_type_t get_type() const final { return ZX_OBJ_TYPE_WAIT_SET; }
+
+    void on_zero_handles() final;
+
+    // Called under the handle table lock.
+    zx_status_t AddEntry(Handle* handle, uint64_t cookie, zx_signals_t signals, uint32_t options);
+
+    // Called under the handle table lock.
+    zx_status_t RemoveEntry(Handle* handle, uint64_t cookie);
+
+    // The most results a single Wait() reports.
+    static constexpr uint32_t kMaxWaitResults = 1024u;
+
+    // Waits until at least one entry is ready, then reports up to |count|
+    // (at most kMaxWaitResults) ready entries to |results|.
+    zx_status_t Wait(zx_time_t deadline, user_out_ptr<zx_waitset_result_t> results,
+                     uint32_t count, uint32_t* actual);
+
+private:
+    class Entry final : public StateObserver,
+                        public fbl::WAVLTreeContainable<Entry*>,
+                        public fbl::DoublyLinkedListable<Entry*> {
+    public:
+        Entry(fbl::RefPtr<WaitSetDispatcher> wait_set, const Handle* handle, uint64_t cookie,
+              zx_signals_t signals, bool edge_triggered);
+        ~Entry() = default;
+
+        uint64_t GetKey() const { return cookie_; }
+
+    private:
+        friend class WaitSetDispatcher;
+
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        // StateObserver overrides.
+        Flags OnInitialize(zx_signals_t initial_state, const StateObserver::CountInfo* cinfo) final;
+        Flags OnStateChange(zx_signals_t new_state) final;
+        Flags OnCancel(const Handle* handle) final;
+        Flags OnCancelByKey(const Handle* handle, const void* wait_set, uint64_t key) final;
+        void OnRemoved() final;
+
+        fbl::RefPtr<WaitSetDispatcher> const wait_set_;
+        const Handle* const handle_;
+        const uint64_t cookie_;
+        const zx_signals_t trigger_;
+        const bool edge_triggered_;
+
+        // Set by OnCancel() before OnRemoved() is called.
+        bool handle_closed_ = false;
+
+        // The following are protected by the wait set's lock.
+        zx_signals_t observed_ = 0u;
+        bool ready_ = false;
+        bool closed_ = false;
+    };
+
+    WaitSetDispatcher();
+
+    // Called with the watched object's lock held.
+    StateObserver::Flags UpdateEntry(Entry* entry, zx_signals_t new_state);
+
+    // Returns true if the caller should delete |entry|.
+    bool OnEntryRemoved(Entry* entry);
+
+    // Returns the number of threads woken.
+    int MakeReadyLocked(Entry* entry) TA_REQ(lock_);
+    void UnreadyLocked(Entry* entry) TA_REQ(lock_);
+
+    fbl::Canary<fbl::magic("WSET")> canary_;
+    Event event_;
+    bool zero_handles_ TA_GUARDED(lock_);
+    fbl::WAVLTree<uint64_t, Entry*> entries_ TA_GUARDED(lock_);
+    fbl::DoublyLinkedList<Entry*> ready_ TA_GUARDED(lock_);
+};
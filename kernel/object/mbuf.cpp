@@ -10,33 +10,47 @@
 
 #include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
+#include <fbl/new.h>
+#include <vm/pmm.h>
 
 #define LOCAL_TRACE 0
 
 constexpr size_t MBufChain::MBuf::kHeaderSize;
 constexpr size_t MBufChain::MBuf::kMallocSize;
 constexpr size_t MBufChain::MBuf::kPayloadSize;
+constexpr size_t MBufChain::MBuf::kPagePayloadSize;
 constexpr size_t MBufChain::kSizeMax;
+constexpr size_t MBufChain::kSizeMaxLimit;
+constexpr size_t MBufChain::kPageFreelistMax;
 
 size_t MBufChain::MBuf::rem() const {
-    return kPayloadSize - (off_ + len_);
+    return cap_ - (off_ + len_);
 }
 
 MBufChain::~MBufChain() {
     while (!tail_.is_empty())
-        delete tail_.pop_front();
+        DeleteMBuf(tail_.pop_front());
     while (!freelist_.is_empty())
-        delete freelist_.pop_front();
+        DeleteMBuf(freelist_.pop_front());
+    while (!page_freelist_.is_empty())
+        DeleteMBuf(page_freelist_.pop_front());
 }
 
 bool MBufChain::is_full() const {
-    return size_ >= kSizeMax;
+    return size_ >= size_max_;
 }
 
 bool MBufChain::is_empty() const {
     return size_ == 0;
 }
 
+zx_status_t MBufChain::set_max_size(size_t size_max) {
+    if (size_max == 0 || size_max > kSizeMaxLimit)
+        return ZX_ERR_OUT_OF_RANGE;
+    size_max_ = size_max;
+    return ZX_OK;
+}
+
 size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
     if (datagram && len > tail_.front().pkt_len_)
         len = tail_.front().pkt_len_;
@@ -44,7 +58,7 @@ size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
     size_t pos = 0;
     while (pos < len && !tail_.is_empty()) {
         MBuf& cur = tail_.front();
-        char* src = cur.data_ + cur.off_;
+        char* src = cur.data() + cur.off_;
         size_t copy_len = MIN(cur.len_, len - pos);
         if (dst.byte_offset(pos).copy_array_to_user(src, copy_len) != ZX_OK)
             return pos;
@@ -74,12 +88,16 @@ size_t MBufChain::Read(user_out_ptr<void> dst, size_t len, bool datagram) {
 
 zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src,
                                      size_t len, size_t* written) {
-    if (len + size_ > kSizeMax)
+    if (len + size_ > size_max_)
         return ZX_ERR_SHOULD_WAIT;
 
+    // All the mbufs of a packet are the same kind.
+    const size_t payload_size =
+        (len > MBuf::kPayloadSize) ? MBuf::kPagePayloadSize : MBuf::kPayloadSize;
+
     fbl::SinglyLinkedList<MBuf*> bufs;
-    for (size_t need = 1 + ((len - 1) / MBuf::kPayloadSize); need != 0; need--) {
-        auto buf = AllocMBuf();
+    for (size_t need = 1 + ((len - 1) / payload_size); need != 0; need--) {
+        auto buf = AllocMBuf(len);
         if (buf == nullptr) {
             while (!bufs.is_empty())
                 FreeMBuf(bufs.pop_front());
@@ -90,8 +108,8 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src,
 
     size_t pos = 0;
     for (auto& buf : bufs) {
-        size_t copy_len = fbl::min(MBuf::kPayloadSize, len - pos);
-        if (src.byte_offset(pos).copy_array_from_user(buf.data_, copy_len) != ZX_OK) {
+        size_t copy_len = fbl::min(payload_size, len - pos);
+        if (src.byte_offset(pos).copy_array_from_user(buf.data(), copy_len) != ZX_OK) {
             while (!bufs.is_empty())
                 FreeMBuf(bufs.pop_front());
             return ZX_ERR_INVALID_ARGS; // Bad user buffer.
@@ -121,7 +139,7 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src,
 zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src,
                                    size_t len, size_t* written) {
     if (head_ == nullptr) {
-        head_ = AllocMBuf();
+        head_ = AllocMBuf(len);
         if (head_ == nullptr)
             return ZX_ERR_SHOULD_WAIT;
         tail_.push_front(head_);
@@ -130,16 +148,16 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src,
     size_t pos = 0;
     while (pos < len) {
         if (head_->rem() == 0) {
-            auto next = AllocMBuf();
+            auto next = AllocMBuf(len - pos);
             if (next == nullptr)
                 break;
             tail_.insert_after(tail_.make_iterator(*head_), next);
             head_ = next;
         }
-        void* dst = head_->data_ + head_->off_ + head_->len_;
+        void* dst = head_->data() + head_->off_ + head_->len_;
         size_t copy_len = fbl::min(head_->rem(), len - pos);
-        if (size_ + copy_len > kSizeMax) {
-            copy_len = kSizeMax - size_;
+        if (size_ + copy_len > size_max_) {
+            copy_len = size_max_ - size_;
             if (copy_len == 0)
                 break;
         }
@@ -157,17 +175,52 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src,
     return ZX_OK;
 }
 
-MBufChain::MBuf* MBufChain::AllocMBuf() {
-    if (freelist_.is_empty()) {
+MBufChain::MBuf* MBufChain::AllocMBuf(size_t len) {
+    MBuf* buf;
+    if (len > MBuf::kPayloadSize) {
+        if (!page_freelist_.is_empty()) {
+            page_freelist_count_--;
+            return page_freelist_.pop_front();
+        }
+        void* page = pmm_alloc_kpage(nullptr, nullptr);
+        if (page == nullptr)
+            return nullptr;
+        buf = new (page) MBuf();
+        buf->cap_ = static_cast<uint32_t>(MBuf::kPagePayloadSize);
+    } else {
+        if (!freelist_.is_empty())
+            return freelist_.pop_front();
         fbl::AllocChecker ac;
-        MBuf* buf = new (&ac) MBuf();
-        return (!ac.check()) ? nullptr : buf;
+        char* mem = new (&ac) char[MBuf::kMallocSize];
+        if (!ac.check())
+            return nullptr;
+        buf = new (mem) MBuf();
+        buf->cap_ = static_cast<uint32_t>(MBuf::kPayloadSize);
     }
-    return freelist_.pop_front();
+    return buf;
 }
 
 void MBufChain::FreeMBuf(MBuf* buf) {
     buf->off_ = 0u;
     buf->len_ = 0u;
-    freelist_.push_front(buf);
+    buf->pkt_len_ = 0u;
+    if (!buf->is_page()) {
+        freelist_.push_front(buf);
+    } else if (page_freelist_count_ < kPageFreelistMax) {
+        page_freelist_count_++;
+        page_freelist_.push_front(buf);
+    } else {
+        DeleteMBuf(buf);
+    }
+}
+
+// static
+void MBufChain::DeleteMBuf(MBuf* buf) {
+    bool is_page = buf->is_page();
+    buf->~MBuf();
+    if (is_page) {
+        pmm_free_kpages(buf, 1);
+    } else {
+        delete[] reinterpret_cast<char*>(buf);
+    }
 }
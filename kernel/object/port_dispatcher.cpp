@@ -40,6 +40,9 @@ public:
     virtual PortPacket* Alloc();
     virtual void Free(PortPacket* port_packet);
 
+    // Allocates a packet which CancelQueued() can match against |handle|.
+    PortPacket* Alloc(const void* handle);
+
     size_t DiagnosticCount() const {
         return arena_.DiagnosticCount();
     }
@@ -58,7 +61,11 @@ zx_status_t ArenaPortAllocator::Init() {
 }
 
 PortPacket* ArenaPortAllocator::Alloc() {
-    PortPacket* packet = arena_.New(nullptr, this);
+    return Alloc(nullptr);
+}
+
+PortPacket* ArenaPortAllocator::Alloc(const void* handle) {
+    PortPacket* packet = arena_.New(handle, this);
     if (packet == nullptr) {
         printf("WARNING: Could not allocate new port packet\n");
         return nullptr;
@@ -73,11 +80,6 @@ void ArenaPortAllocator::Free(PortPacket* port_packet) {
 PortPacket::PortPacket(const void* handle, PortAllocator* allocator)
     : packet{}, handle(handle), observer(nullptr), allocator(allocator) {
     // Note that packet is initialized to zeros.
-    if (handle) {
-        // Currently |handle| is only valid if the packets are not ephemeral
-        // which means that PortObserver always uses the kernel heap.
-        DEBUG_ASSERT(allocator == nullptr);
-    }
 }
 
 // static
@@ -318,6 +320,29 @@ zx_status_t PortDispatcher::MakeObserver(uint32_t options, Handle* handle, uint6
             return ZX_ERR_INVALID_ARGS;
     }
 
+    // A one-shot wait for signals which are already asserted is satisfied
+    // right away, with an ephemeral packet instead of an observer which
+    // would be added and removed again under the object's lock. If the
+    // arena is exhausted, the observer below queues its own packet. Objects
+    // which report counts, such as the number of queued messages, take the
+    // slow path so that the packet carries the real count.
+    if (type == ZX_PKT_TYPE_SIGNAL_ONE && !dispatcher->has_count_info()) {
+        zx_signals_t observed = dispatcher->PollSignals();
+        if (observed & signals) {
+            auto port_packet = port_allocator.Alloc(handle);
+            if (port_packet) {
+                auto& packet = port_packet->packet;
+                packet.status = ZX_OK;
+                packet.key = key;
+                packet.type = type;
+                packet.signal.trigger = signals;
+                if (Queue(port_packet, observed, 1u) != ZX_OK)
+                    port_packet->Free();
+                return ZX_OK;
+            }
+        }
+    }
+
     fbl::AllocChecker ac;
     auto observer = new (&ac) PortObserver(type, handle, fbl::RefPtr<PortDispatcher>(this), key,
                                            signals);
@@ -363,7 +388,11 @@ bool PortDispatcher::CancelQueued(const void* handle, uint64_t key) {
 
         if ((it->handle == handle) && (it->key() == key)) {
             auto to_remove = it++;
-            delete packets_.erase(to_remove)->observer;
+            auto port_packet = packets_.erase(to_remove);
+            if (port_packet->is_ephemeral())
+                port_packet->Free();
+            else
+                delete port_packet->observer;
             packet_removed = true;
         } else {
             ++it;
@@ -393,6 +393,34 @@ zx_status_t SocketDispatcher::ReadControl(user_out_ptr<void> dst, size_t len,
     return ZX_OK;
 }
 
+size_t SocketDispatcher::GetReadBufferMax() {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+    return data_.max_size();
+}
+
+zx_status_t SocketDispatcher::SetReadBufferMax(size_t size) {
+    canary_.Assert();
+
+    AutoLock lock(&lock_);
+
+    bool was_full = is_full();
+
+    zx_status_t status = data_.set_max_size(size);
+    if (status != ZX_OK)
+        return status;
+
+    if (other_ && was_full != is_full()) {
+        if (was_full) {
+            other_->UpdateState(0u, ZX_SOCKET_WRITABLE);
+        } else {
+            other_->UpdateState(ZX_SOCKET_WRITABLE, 0u);
+        }
+    }
+    return ZX_OK;
+}
+
 zx_status_t SocketDispatcher::CheckShareable(SocketDispatcher* to_send) {
     // We disallow sharing of sockets that support sharing themselves
     // and disallow sharing either end of the socket we're going to
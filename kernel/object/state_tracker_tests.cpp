@@ -181,6 +181,71 @@ bool on_cancel_by_key(void* context) {
 
 } // namespace removal
 
+// Tests for the signal snapshot
+namespace signals {
+
+class CountingObserver : public StateObserver {
+public:
+    CountingObserver() = default;
+
+    // The number of times OnStateChange() has been called.
+    int changes() const { return changes_; }
+
+private:
+    Flags OnInitialize(zx_signals_t initial_state,
+                       const StateObserver::CountInfo* cinfo) override {
+        return 0;
+    }
+    Flags OnStateChange(zx_signals_t new_state) override {
+        changes_++;
+        return 0;
+    }
+    Flags OnCancel(const Handle* handle) override { return 0; }
+
+    int changes_ = 0;
+};
+
+bool poll_signals(void* context) {
+    BEGIN_TEST;
+
+    TestDispatcher st;
+    EXPECT_EQ(0u, st.PollSignals(), "");
+
+    st.CallUpdateState();
+    EXPECT_EQ(1u, st.PollSignals(), "");
+
+    st.CallAllOnHooks();
+    EXPECT_EQ(7u, st.PollSignals(), "");
+
+    END_TEST;
+}
+
+bool redundant_update(void* context) {
+    BEGIN_TEST;
+
+    CountingObserver obs;
+
+    TestDispatcher st;
+    st.AddObserver(&obs, nullptr);
+
+    st.CallUpdateState();
+    EXPECT_EQ(1, obs.changes(), "");
+
+    // The signal is already asserted, so observers hear nothing.
+    st.CallUpdateState();
+    EXPECT_EQ(1, obs.changes(), "");
+
+    // Asserting more signals is a change.
+    st.CallAllOnHooks();
+    EXPECT_EQ(2, obs.changes(), "");
+
+    st.RemoveObserver(&obs);
+
+    END_TEST;
+}
+
+} // namespace signals
+
 #define ST_UNITTEST(fname) UNITTEST(#fname, fname)
 
 UNITTEST_START_TESTCASE(state_tracker_tests)
@@ -189,6 +254,8 @@ ST_UNITTEST(removal::on_initialize)
 ST_UNITTEST(removal::on_state_change_via_update_state)
 ST_UNITTEST(removal::on_cancel)
 ST_UNITTEST(removal::on_cancel_by_key)
+ST_UNITTEST(signals::poll_signals)
+ST_UNITTEST(signals::redundant_update)
 
 UNITTEST_END_TESTCASE(
     state_tracker_tests, "statetracker", "StateTracker test", nullptr, nullptr);
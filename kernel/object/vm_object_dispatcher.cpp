@@ -22,9 +22,10 @@
 
 zx_status_t VmObjectDispatcher::Create(fbl::RefPtr<VmObject> vmo,
                                        fbl::RefPtr<Dispatcher>* dispatcher,
-                                       zx_rights_t* rights) {
+                                       zx_rights_t* rights,
+                                       bool resizable) {
     fbl::AllocChecker ac;
-    auto disp = new (&ac) VmObjectDispatcher(fbl::move(vmo));
+    auto disp = new (&ac) VmObjectDispatcher(fbl::move(vmo), resizable);
     if (!ac.check())
         return ZX_ERR_NO_MEMORY;
 
@@ -34,8 +35,8 @@ zx_status_t VmObjectDispatcher::Create(fbl::RefPtr<VmObject> vmo,
     return ZX_OK;
 }
 
-VmObjectDispatcher::VmObjectDispatcher(fbl::RefPtr<VmObject> vmo)
-    : vmo_(vmo) {}
+VmObjectDispatcher::VmObjectDispatcher(fbl::RefPtr<VmObject> vmo, bool resizable)
+    : vmo_(vmo), resizable_(resizable) {}
 
 VmObjectDispatcher::~VmObjectDispatcher() {
     // Intentionally leave vmo_->user_id() set to our koid even though we're
@@ -74,6 +75,9 @@ zx_status_t VmObjectDispatcher::Write(user_in_ptr<const void> user_data,
 zx_status_t VmObjectDispatcher::SetSize(uint64_t size) {
     canary_.Assert();
 
+    if (!resizable_)
+        return ZX_ERR_UNAVAILABLE;
+
     return vmo_->Resize(size);
 }
 
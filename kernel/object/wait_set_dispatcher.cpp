@@ -0,0 +1,312 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <object/wait_set_dispatcher.h>
+
+#include <assert.h>
+#include <err.h>
+#include <trace.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/auto_lock.h>
+#include <fbl/unique_ptr.h>
+#include <object/handle.h>
+#include <zircon/rights.h>
+#include <zircon/types.h>
+
+using fbl::AutoLock;
+
+#define LOCAL_TRACE 0
+
+WaitSetDispatcher::Entry::Entry(fbl::RefPtr<WaitSetDispatcher> wait_set, const Handle* handle,
+                                uint64_t cookie, zx_signals_t signals, bool edge_triggered)
+    : wait_set_(fbl::move(wait_set)),
+      handle_(handle),
+      cookie_(cookie),
+      trigger_(signals),
+      edge_triggered_(edge_triggered) {
+    DEBUG_ASSERT(handle != nullptr);
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnInitialize(zx_signals_t initial_state,
+                                                            const StateObserver::CountInfo* cinfo) {
+    return wait_set_->UpdateEntry(this, initial_state);
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnStateChange(zx_signals_t new_state) {
+    return wait_set_->UpdateEntry(this, new_state);
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnCancel(const Handle* handle) {
+    if (handle_ != handle)
+        return 0;
+    handle_closed_ = true;
+    return kHandled | kNeedRemoval;
+}
+
+StateObserver::Flags WaitSetDispatcher::Entry::OnCancelByKey(const Handle* handle,
+                                                             const void* wait_set, uint64_t key) {
+    if ((handle_ != handle) || (cookie_ != key) || (wait_set_.get() != wait_set))
+        return 0;
+    return kHandled | kNeedRemoval;
+}
+
+void WaitSetDispatcher::Entry::OnRemoved() {
+    // Deleting the entry may drop the last reference to the wait set, so it
+    // must happen after the wait set's lock is released.
+    if (wait_set_->OnEntryRemoved(this))
+        delete this;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+
+zx_status_t WaitSetDispatcher::Create(uint32_t options, fbl::RefPtr<Dispatcher>* dispatcher,
+                                      zx_rights_t* rights) {
+    DEBUG_ASSERT(options == 0);
+    fbl::AllocChecker ac;
+    auto disp = new (&ac) WaitSetDispatcher();
+    if (!ac.check())
+        return ZX_ERR_NO_MEMORY;
+
+    *rights = ZX_DEFAULT_WAIT_SET_RIGHTS;
+    *dispatcher = fbl::AdoptRef<Dispatcher>(disp);
+    return ZX_OK;
+}
+
+WaitSetDispatcher::WaitSetDispatcher()
+    : zero_handles_(false) {
+}
+
+WaitSetDispatcher::~WaitSetDispatcher() {
+    // Every entry holds a reference to us.
+    DEBUG_ASSERT(entries_.is_empty());
+    DEBUG_ASSERT(ready_.is_empty());
+}
+
+void WaitSetDispatcher::on_zero_handles() {
+    canary_.Assert();
+
+    fbl::DoublyLinkedList<Entry*> to_delete;
+    {
+        AutoLock lock(&lock_);
+        zero_handles_ = true;
+
+        // Entries whose handles were closed are only waiting to be reported.
+        // Entries which are still attached detach themselves on their next
+        // state change, or when their handle goes away.
+        for (auto it = ready_.begin(); it != ready_.end();) {
+            Entry* entry = &*it++;
+            if (entry->closed_) {
+                UnreadyLocked(entry);
+                entries_.erase(*entry);
+                to_delete.push_back(entry);
+            }
+        }
+        event_.Unsignal();
+    }
+
+    while (!to_delete.is_empty())
+        delete to_delete.pop_front();
+}
+
+zx_status_t WaitSetDispatcher::AddEntry(Handle* handle, uint64_t cookie, zx_signals_t signals,
+                                        uint32_t options) {
+    canary_.Assert();
+
+    // Called under the handle table lock.
+
+    auto dispatcher = handle->dispatcher();
+    if (!dispatcher->has_state_tracker())
+        return ZX_ERR_NOT_SUPPORTED;
+
+    bool edge_triggered;
+    switch (options) {
+        case ZX_WAITSET_LEVEL_TRIGGERED:
+            edge_triggered = false;
+            break;
+        case ZX_WAITSET_EDGE_TRIGGERED:
+            edge_triggered = true;
+            break;
+        default:
+            return ZX_ERR_INVALID_ARGS;
+    }
+
+    fbl::AllocChecker ac;
+    auto entry = new (&ac) Entry(fbl::RefPtr<WaitSetDispatcher>(this), handle, cookie, signals,
+                                 edge_triggered);
+    if (!ac.check())
+        return ZX_ERR_NO_MEMORY;
+
+    {
+        AutoLock lock(&lock_);
+        if (entries_.find(cookie).IsValid()) {
+            lock.release();
+            delete entry;
+            return ZX_ERR_ALREADY_EXISTS;
+        }
+        entries_.insert(entry);
+    }
+
+    dispatcher->add_observer(entry);
+    return ZX_OK;
+}
+
+zx_status_t WaitSetDispatcher::RemoveEntry(Handle* handle, uint64_t cookie) {
+    canary_.Assert();
+
+    // Called under the handle table lock.
+
+    auto dispatcher = handle->dispatcher();
+    if (!dispatcher->has_state_tracker())
+        return ZX_ERR_NOT_SUPPORTED;
+
+    // The entry's OnRemoved() takes it out of |entries_|.
+    return dispatcher->CancelByKey(handle, this, cookie) ? ZX_OK : ZX_ERR_NOT_FOUND;
+}
+
+zx_status_t WaitSetDispatcher::Wait(zx_time_t deadline,
+                                    user_out_ptr<zx_waitset_result_t> results,
+                                    uint32_t count, uint32_t* actual) {
+    canary_.Assert();
+
+    // Results are gathered into a kernel buffer under the lock and copied
+    // out once it is dropped, so that a fault on the user buffer is never
+    // taken while every signal delivery to the set waits on the lock.
+    count = fbl::min(count, kMaxWaitResults);
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<zx_waitset_result_t[]> buffer(new (&ac) zx_waitset_result_t[count]);
+    if (!ac.check())
+        return ZX_ERR_NO_MEMORY;
+
+    fbl::DoublyLinkedList<Entry*> to_delete;
+    uint32_t reported = 0u;
+    zx_status_t status = ZX_OK;
+
+    for (;;) {
+        {
+            AutoLock lock(&lock_);
+
+            // Level-triggered entries which are still asserted go back on
+            // the ready list behind the ones we have not looked at yet.
+            fbl::DoublyLinkedList<Entry*> still_ready;
+
+            while (reported < count && !ready_.is_empty()) {
+                Entry* entry = &ready_.front();
+
+                buffer[reported++] = {
+                    entry->cookie_,
+                    entry->closed_ ? ZX_ERR_CANCELED : ZX_OK,
+                    entry->observed_,
+                };
+
+                ready_.pop_front();
+                entry->ready_ = false;
+                if (entry->closed_) {
+                    entries_.erase(*entry);
+                    to_delete.push_back(entry);
+                } else if (entry->edge_triggered_) {
+                    entry->observed_ = 0u;
+                } else {
+                    entry->ready_ = true;
+                    still_ready.push_back(entry);
+                }
+            }
+
+            ready_.splice(ready_.end(), still_ready);
+            if (ready_.is_empty())
+                event_.Unsignal();
+        }
+
+        if (reported > 0u)
+            break;
+
+        status = event_.Wait(deadline);
+        if (status != ZX_OK)
+            break;
+    }
+
+    while (!to_delete.is_empty())
+        delete to_delete.pop_front();
+
+    if (reported == 0u)
+        return status;
+
+    // The entries are already consumed; like any syscall handed a bad
+    // buffer, a fault here loses the results.
+    status = results.copy_array_to_user(buffer.get(), reported);
+    if (status != ZX_OK)
+        return status;
+
+    *actual = reported;
+    return ZX_OK;
+}
+
+StateObserver::Flags WaitSetDispatcher::UpdateEntry(Entry* entry, zx_signals_t new_state) {
+    canary_.Assert();
+
+    // Always called with the object state lock being held.
+    AutoLock lock(&lock_);
+
+    if (zero_handles_)
+        return StateObserver::kNeedRemoval;
+
+    if ((entry->trigger_ & new_state) == 0u) {
+        if (!entry->edge_triggered_) {
+            entry->observed_ = new_state;
+            UnreadyLocked(entry);
+        }
+        return 0;
+    }
+
+    if (entry->edge_triggered_) {
+        // Accumulate until the entry is reported.
+        entry->observed_ |= new_state;
+    } else {
+        entry->observed_ = new_state;
+    }
+
+    return MakeReadyLocked(entry) > 0 ? StateObserver::kWokeThreads : 0;
+}
+
+bool WaitSetDispatcher::OnEntryRemoved(Entry* entry) {
+    canary_.Assert();
+
+    int woken = 0;
+    {
+        AutoLock lock(&lock_);
+
+        if (!entry->handle_closed_ || zero_handles_) {
+            UnreadyLocked(entry);
+            entries_.erase(*entry);
+            return true;
+        }
+
+        // Report the closed handle once; Wait() then deletes the entry.
+        entry->closed_ = true;
+        entry->observed_ = ZX_SIGNAL_HANDLE_CLOSED;
+        woken = MakeReadyLocked(entry);
+    }
+
+    if (woken > 0)
+        thread_reschedule();
+    return false;
+}
+
+int WaitSetDispatcher::MakeReadyLocked(Entry* entry) {
+    if (entry->ready_)
+        return 0;
+    entry->ready_ = true;
+    ready_.push_back(entry);
+    return event_.Signal();
+}
+
+void WaitSetDispatcher::UnreadyLocked(Entry* entry) {
+    if (!entry->ready_)
+        return;
+    entry->ready_ = false;
+    ready_.erase(*entry);
+}
@@ -173,6 +173,14 @@ uint64_t current_ticks(void) {
     return rdtsc();
 }
 
+bool platform_usermode_time_scale(struct fp_32_64* ns_per_tick) {
+    // The HPET and the PIT cannot be read from user mode.
+    if (wall_clock != CLOCK_TSC)
+        return false;
+    *ns_per_tick = ns_per_tsc;
+    return true;
+}
+
 zx_time_t ticks_to_nanos(uint64_t ticks) {
     return u64_mul_u64_fp32_64(ticks, ns_per_tsc);
 }
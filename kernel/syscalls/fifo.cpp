@@ -15,6 +15,7 @@
 #include <object/fifo_dispatcher.h>
 #include <object/handle.h>
 #include <object/process_dispatcher.h>
+#include <object/vm_object_dispatcher.h>
 
 #include <zircon/syscalls/policy.h>
 #include <fbl/ref_ptr.h>
@@ -84,3 +85,48 @@ zx_status_t sys_fifo_read(zx_handle_t handle, user_out_ptr<void> entries, size_t
 
     return ZX_OK;
 }
+
+zx_status_t sys_fifo_get_ring(zx_handle_t handle, user_out_ptr<zx_fifo_ring_info_t> info_out,
+                              user_out_handle* out) {
+    auto up = ProcessDispatcher::GetCurrent();
+
+    // The ring can be used to both read and write entries.
+    fbl::RefPtr<FifoDispatcher> fifo;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_READ | ZX_RIGHT_WRITE,
+                                                     &fifo);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::RefPtr<VmObject> vmo;
+    zx_fifo_ring_info_t info;
+    status = fifo->GetRing(&vmo, &info);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::RefPtr<Dispatcher> dispatcher;
+    zx_rights_t rights;
+    // Both endpoints share the ring, so neither may resize it or change its
+    // properties out from under the other.
+    status = VmObjectDispatcher::Create(fbl::move(vmo), &dispatcher, &rights,
+                                        /* resizable */ false);
+    if (status != ZX_OK)
+        return status;
+
+    status = info_out.copy_to_user(info);
+    if (status != ZX_OK)
+        return status;
+
+    return out->make(fbl::move(dispatcher),
+                     rights & ~(ZX_RIGHT_EXECUTE | ZX_RIGHT_SET_PROPERTY));
+}
+
+zx_status_t sys_fifo_ring_notify(zx_handle_t handle) {
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<FifoDispatcher> fifo;
+    zx_status_t status = up->GetDispatcherWithRights(handle, ZX_RIGHT_WRITE, &fifo);
+    if (status != ZX_OK)
+        return status;
+
+    return fifo->NotifyRing();
+}
@@ -21,6 +21,7 @@
 #include <object/process_dispatcher.h>
 #include <object/resource_dispatcher.h>
 #include <object/resources.h>
+#include <object/socket_dispatcher.h>
 #include <object/thread_dispatcher.h>
 #include <object/vm_address_region_dispatcher.h>
 
@@ -619,6 +620,15 @@ zx_status_t sys_object_get_property(zx_handle_t handle_value, uint32_t property,
                 return status;
             return ZX_OK;
         }
+        case ZX_PROP_SOCKET_RX_BUF_MAX: {
+            if (size < sizeof(size_t))
+                return ZX_ERR_BUFFER_TOO_SMALL;
+            auto socket = DownCastDispatcher<SocketDispatcher>(&dispatcher);
+            if (!socket)
+                return ZX_ERR_WRONG_TYPE;
+            size_t value = socket->GetReadBufferMax();
+            return _value.reinterpret<size_t>().copy_to_user(value);
+        }
         default:
             return ZX_ERR_INVALID_ARGS;
     }
@@ -699,6 +709,18 @@ zx_status_t sys_object_set_property(zx_handle_t handle_value, uint32_t property,
             return job->set_importance(
                 static_cast<zx_job_importance_t>(value));
         }
+        case ZX_PROP_SOCKET_RX_BUF_MAX: {
+            if (size < sizeof(size_t))
+                return ZX_ERR_BUFFER_TOO_SMALL;
+            auto socket = DownCastDispatcher<SocketDispatcher>(&dispatcher);
+            if (!socket)
+                return ZX_ERR_WRONG_TYPE;
+            size_t value = 0;
+            zx_status_t status = _value.reinterpret<const size_t>().copy_from_user(&value);
+            if (status != ZX_OK)
+                return status;
+            return socket->SetReadBufferMax(value);
+        }
     }
 
     return ZX_ERR_INVALID_ARGS;
@@ -59,6 +59,19 @@ zx_status_t sys_object_wait_one(zx_handle_t handle_value,
         if (!handle->HasRights(ZX_RIGHT_WAIT))
             return ZX_ERR_ACCESS_DENIED;
 
+        // If the signals are already asserted there is nothing to wait
+        // for, and no need to register and unregister an observer.
+        auto dispatcher = handle->dispatcher();
+        if (dispatcher->has_state_tracker()) {
+            zx_signals_t signals_state = dispatcher->PollSignals();
+            if (signals_state & signals) {
+                lock.release();
+                if (observed)
+                    return observed.copy_to_user(signals_state);
+                return ZX_OK;
+            }
+        }
+
         result = wait_state_observer.Begin(&event, handle, signals);
         if (result != ZX_OK)
             return result;
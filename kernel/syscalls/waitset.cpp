@@ -0,0 +1,111 @@
+// Copyright 2017 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <err.h>
+#include <inttypes.h>
+#include <trace.h>
+
+#include <object/handle.h>
+#include <object/process_dispatcher.h>
+#include <object/wait_set_dispatcher.h>
+
+#include <fbl/auto_lock.h>
+#include <fbl/ref_ptr.h>
+
+#include <zircon/syscalls/policy.h>
+#include <zircon/types.h>
+
+#include "priv.h"
+
+#define LOCAL_TRACE 0
+
+zx_status_t sys_waitset_create(uint32_t options, user_out_handle* out) {
+    LTRACEF("options %u\n", options);
+
+    // No options are supported.
+    if (options != 0u)
+        return ZX_ERR_INVALID_ARGS;
+
+    // A wait set is a specialized port.
+    auto up = ProcessDispatcher::GetCurrent();
+    zx_status_t result = up->QueryPolicy(ZX_POL_NEW_PORT);
+    if (result != ZX_OK)
+        return result;
+
+    fbl::RefPtr<Dispatcher> dispatcher;
+    zx_rights_t rights;
+
+    result = WaitSetDispatcher::Create(options, &dispatcher, &rights);
+    if (result != ZX_OK)
+        return result;
+
+    return out->make(fbl::move(dispatcher), rights);
+}
+
+zx_status_t sys_waitset_add(zx_handle_t waitset_handle, zx_handle_t handle_value,
+                            uint64_t cookie, zx_signals_t signals, uint32_t options) {
+    LTRACEF("handle %x\n", handle_value);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<WaitSetDispatcher> wait_set;
+    auto status = up->GetDispatcherWithRights(waitset_handle, ZX_RIGHT_WRITE, &wait_set);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::AutoLock lock(up->handle_table_lock());
+    Handle* handle = up->GetHandleLocked(handle_value);
+    if (!handle)
+        return ZX_ERR_BAD_HANDLE;
+    if (!handle->HasRights(ZX_RIGHT_WAIT))
+        return ZX_ERR_ACCESS_DENIED;
+
+    return wait_set->AddEntry(handle, cookie, signals, options);
+}
+
+zx_status_t sys_waitset_remove(zx_handle_t waitset_handle, zx_handle_t handle_value,
+                               uint64_t cookie) {
+    LTRACEF("handle %x\n", handle_value);
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<WaitSetDispatcher> wait_set;
+    auto status = up->GetDispatcherWithRights(waitset_handle, ZX_RIGHT_WRITE, &wait_set);
+    if (status != ZX_OK)
+        return status;
+
+    fbl::AutoLock lock(up->handle_table_lock());
+    Handle* handle = up->GetHandleLocked(handle_value);
+    if (!handle)
+        return ZX_ERR_BAD_HANDLE;
+    if (!handle->HasRights(ZX_RIGHT_WAIT))
+        return ZX_ERR_ACCESS_DENIED;
+
+    return wait_set->RemoveEntry(handle, cookie);
+}
+
+zx_status_t sys_waitset_wait(zx_handle_t waitset_handle, zx_time_t deadline,
+                             user_out_ptr<zx_waitset_result_t> results, uint32_t count,
+                             user_out_ptr<uint32_t> actual_out) {
+    LTRACEF("handle %x\n", waitset_handle);
+
+    if (count == 0u)
+        return ZX_ERR_INVALID_ARGS;
+
+    auto up = ProcessDispatcher::GetCurrent();
+
+    fbl::RefPtr<WaitSetDispatcher> wait_set;
+    zx_status_t status = up->GetDispatcherWithRights(waitset_handle, ZX_RIGHT_READ, &wait_set);
+    if (status != ZX_OK)
+        return status;
+
+    uint32_t actual;
+    status = wait_set->Wait(deadline, results, count, &actual);
+    if (status != ZX_OK)
+        return status;
+
+    return actual_out.copy_to_user(actual);
+}
@@ -18,6 +18,7 @@
 #include <kernel/thread.h>
 #include <lib/crypto/global_prng.h>
 #include <lib/user_copy/user_ptr.h>
+#include <lib/vdso.h>
 #include <object/event_dispatcher.h>
 #include <object/event_pair_dispatcher.h>
 #include <object/handle.h>
@@ -57,7 +58,9 @@ zx_status_t sys_nanosleep(zx_time_t deadline) {
 // This must be accessed atomically from any given thread.
 static fbl::atomic<int64_t> utc_offset;
 
-uint64_t sys_time_get(uint32_t clock_id) {
+// zx_time_get() is implemented in the vDSO, which only enters the kernel
+// for the clocks it cannot read itself.
+zx_time_t sys_time_get_fallback(uint32_t clock_id) {
     switch (clock_id) {
     case ZX_CLOCK_MONOTONIC:
         return current_time();
@@ -83,6 +86,7 @@ zx_status_t sys_clock_adjust(zx_handle_t hrsrc, uint32_t clock_id, int64_t offse
         return ZX_ERR_ACCESS_DENIED;
     case ZX_CLOCK_UTC:
         utc_offset.store(offset);
+        VDso::SetUtcOffset(offset);
         return ZX_OK;
     default:
         return ZX_ERR_INVALID_ARGS;
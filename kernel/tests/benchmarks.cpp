@@ -10,10 +10,14 @@
 #include <arch/ops.h>
 #include <err.h>
 #include <inttypes.h>
+#include <kernel/event.h>
 #include <kernel/mp.h>
 #include <kernel/mutex.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread.h>
+#include <kernel/timer.h>
+#include <object/event_dispatcher.h>
+#include <object/state_observer.h>
 #include <platform.h>
 #include <rand.h>
 #include <stdio.h>
@@ -235,6 +239,214 @@ __NO_INLINE static void bench_mutex() {
     printf("%" PRIu64 " cycles to acquire/release uncontended mutex %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
 }
 
+static enum handler_return bench_timer_cb(timer_t* t, zx_time_t now, void* arg) {
+    return INT_NO_RESCHEDULE;
+}
+
+// Arm a large number of timers with scattered deadlines and slack on one cpu,
+// then cancel them all, to measure the cost of the timer queue operations.
+__NO_INLINE static void bench_timer_set_cancel() {
+    static const uint count = 100000;
+
+    timer_t* timers = (timer_t*)malloc(sizeof(timer_t) * count);
+    if (!timers) {
+        printf("failed to allocate timers\n");
+        return;
+    }
+
+    // far enough out that none of them fire while we are measuring
+    zx_time_t base = current_time() + ZX_SEC(3600);
+    zx_time_t* deadlines = (zx_time_t*)malloc(sizeof(zx_time_t) * count);
+    if (!deadlines) {
+        printf("failed to allocate deadlines\n");
+        free(timers);
+        return;
+    }
+    for (uint i = 0; i < count; i++) {
+        timer_init(&timers[i]);
+        deadlines[i] = base + (rand() % ZX_SEC(10));
+    }
+
+    spin_lock_saved_state_t state;
+    arch_interrupt_save(&state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+
+    uint64_t c = arch_cycle_count();
+    for (uint i = 0; i < count; i++) {
+        timer_set(&timers[i], deadlines[i], TIMER_SLACK_CENTER, ZX_USEC(50), bench_timer_cb, NULL);
+    }
+    uint64_t set_cycles = arch_cycle_count() - c;
+
+    c = arch_cycle_count();
+    for (uint i = 0; i < count; i++) {
+        timer_cancel(&timers[i]);
+    }
+    uint64_t cancel_cycles = arch_cycle_count() - c;
+
+    arch_interrupt_restore(state, ARCH_DEFAULT_SPIN_LOCK_FLAG_INTERRUPTS);
+
+    printf("%" PRIu64 " cycles to set %u timers (%" PRIu64 " cycles per)\n",
+           set_cycles, count, set_cycles / count);
+    printf("%" PRIu64 " cycles to cancel %u timers (%" PRIu64 " cycles per)\n",
+           cancel_cycles, count, cancel_cycles / count);
+
+    free(deadlines);
+    free(timers);
+}
+
+// A pair of threads pinned to two different cpus bouncing a wakeup back and
+// forth through a pair of events. Every round trip is two cross-cpu wakeups, so
+// running several pairs at once measures how well the block/wake paths scale.
+struct pingpong_pair {
+    event_t ping;
+    event_t pong;
+    thread_t* threads[2];
+};
+
+static const uint PINGPONG_ITER = 100000;
+
+static int pingpong_initiator(void* arg) {
+    auto pair = static_cast<pingpong_pair*>(arg);
+    for (uint i = 0; i < PINGPONG_ITER; i++) {
+        event_signal(&pair->ping, true);
+        event_wait(&pair->pong);
+    }
+    return 0;
+}
+
+static int pingpong_responder(void* arg) {
+    auto pair = static_cast<pingpong_pair*>(arg);
+    for (uint i = 0; i < PINGPONG_ITER; i++) {
+        event_wait(&pair->ping);
+        event_signal(&pair->pong, true);
+    }
+    return 0;
+}
+
+__NO_INLINE static void bench_event_pingpong() {
+    cpu_mask_t online = mp_get_online_mask();
+    cpu_num_t cpus[SMP_MAX_CPUS];
+    uint num_cpus = 0;
+    while (online) {
+        cpu_num_t cpu = lowest_cpu_set(online);
+        cpus[num_cpus++] = cpu;
+        online &= ~cpu_num_to_mask(cpu);
+    }
+
+    if (num_cpus < 2) {
+        printf("event ping-pong benchmark needs at least 2 cpus\n");
+        return;
+    }
+
+    pingpong_pair pairs[SMP_MAX_CPUS / 2];
+    for (uint num_pairs = 1; num_pairs <= num_cpus / 2; num_pairs++) {
+        for (uint i = 0; i < num_pairs; i++) {
+            pingpong_pair* pair = &pairs[i];
+            event_init(&pair->ping, false, EVENT_FLAG_AUTOUNSIGNAL);
+            event_init(&pair->pong, false, EVENT_FLAG_AUTOUNSIGNAL);
+            pair->threads[0] = thread_create("pingpong initiator", &pingpong_initiator, pair,
+                                             DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+            pair->threads[1] = thread_create("pingpong responder", &pingpong_responder, pair,
+                                             DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+            thread_set_cpu_affinity(pair->threads[0], cpu_num_to_mask(cpus[2 * i]));
+            thread_set_cpu_affinity(pair->threads[1], cpu_num_to_mask(cpus[2 * i + 1]));
+        }
+
+        zx_time_t t = current_time();
+        for (uint i = 0; i < num_pairs; i++) {
+            thread_resume(pairs[i].threads[1]);
+            thread_resume(pairs[i].threads[0]);
+        }
+        for (uint i = 0; i < num_pairs; i++) {
+            thread_join(pairs[i].threads[0], NULL, ZX_TIME_INFINITE);
+            thread_join(pairs[i].threads[1], NULL, ZX_TIME_INFINITE);
+        }
+        t = current_time() - t;
+
+        for (uint i = 0; i < num_pairs; i++) {
+            event_destroy(&pairs[i].ping);
+            event_destroy(&pairs[i].pong);
+        }
+
+        printf("%u event ping-pong pair(s): %u round trips each in %" PRIu64 " ns (%" PRIu64 " ns per round trip)\n",
+               num_pairs, PINGPONG_ITER, t, t / PINGPONG_ITER);
+    }
+}
+
+// Stands in for a waiter whose signals never come, so the cost of notifying
+// observers can be measured without anyone being woken.
+class BenchObserver final : public StateObserver {
+public:
+    Flags OnInitialize(zx_signals_t initial_state, const CountInfo* cinfo) final { return 0; }
+    Flags OnStateChange(zx_signals_t new_state) final { return 0; }
+    Flags OnCancel(const Handle* handle) final { return 0; }
+};
+
+__NO_INLINE static void bench_event_signal() {
+    fbl::RefPtr<Dispatcher> event;
+    zx_rights_t rights;
+    if (EventDispatcher::Create(0u, &event, &rights) != ZX_OK) {
+        printf("failed to create event\n");
+        return;
+    }
+
+    static const uint count = 1024 * 1024;
+
+    // test 1: assert and deassert a signal nobody is observing
+    uint64_t c = arch_cycle_count();
+    for (size_t i = 0; i < count; i++) {
+        event->user_signal(0u, ZX_USER_SIGNAL_0, false);
+        event->user_signal(ZX_USER_SIGNAL_0, 0u, false);
+    }
+    c = arch_cycle_count() - c;
+
+    printf("%" PRIu64 " cycles to signal/unsignal an unobserved event %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
+
+    // test 2: re-assert a signal which is already asserted
+    event->user_signal(0u, ZX_USER_SIGNAL_0, false);
+    c = arch_cycle_count();
+    for (size_t i = 0; i < count; i++) {
+        event->user_signal(0u, ZX_USER_SIGNAL_0, false);
+    }
+    c = arch_cycle_count() - c;
+    event->user_signal(ZX_USER_SIGNAL_0, 0u, false);
+
+    printf("%" PRIu64 " cycles to re-signal a signaled event %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
+
+    // test 3: assert and deassert a signal with an observer attached
+    BenchObserver observer;
+    event->AddObserver(&observer, nullptr);
+    c = arch_cycle_count();
+    for (size_t i = 0; i < count; i++) {
+        event->user_signal(0u, ZX_USER_SIGNAL_0, false);
+        event->user_signal(ZX_USER_SIGNAL_0, 0u, false);
+    }
+    c = arch_cycle_count() - c;
+    event->RemoveObserver(&observer);
+
+    printf("%" PRIu64 " cycles to signal/unsignal an observed event %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
+
+    // test 4: wait on a signaled event, once by polling its signals and once
+    // the way a wait which has to block starts and ends, with an observer
+    event->user_signal(0u, ZX_USER_SIGNAL_0, false);
+    c = arch_cycle_count();
+    for (size_t i = 0; i < count; i++) {
+        if (!(event->PollSignals() & ZX_USER_SIGNAL_0))
+            printf("event unexpectedly not signaled\n");
+    }
+    c = arch_cycle_count() - c;
+
+    printf("%" PRIu64 " cycles to poll a signaled event %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
+
+    c = arch_cycle_count();
+    for (size_t i = 0; i < count; i++) {
+        event->AddObserver(&observer, nullptr);
+        event->RemoveObserver(&observer);
+    }
+    c = arch_cycle_count() - c;
+
+    printf("%" PRIu64 " cycles to add/remove an observer on a signaled event %u times (%" PRIu64 " cycles per)\n", c, count, c / count);
+}
+
 void benchmarks() {
     bench_set_overhead();
     bench_memcpy();
@@ -251,4 +463,7 @@ void benchmarks() {
 
     bench_spinlock();
     bench_mutex();
+    bench_timer_set_cancel();
+    bench_event_pingpong();
+    bench_event_signal();
 }
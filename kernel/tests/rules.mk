@@ -29,6 +29,7 @@ MODULE_DEPS += \
     kernel/lib/crypto \
     kernel/lib/header_tests \
     kernel/lib/fbl \
+    kernel/object \
     third_party/lib/safeint \
     kernel/lib/unittest \
 
@@ -100,6 +100,70 @@ static int mutex_test(void) {
     return 0;
 }
 
+struct mutex_pi_state {
+    mutex_t m;
+    event_t held;
+    event_t release;
+};
+
+static int mutex_pi_holder(void* arg) {
+    auto state = static_cast<mutex_pi_state*>(arg);
+
+    mutex_acquire(&state->m);
+    event_signal(&state->held, true);
+    event_wait(&state->release);
+    mutex_release(&state->m);
+    return 0;
+}
+
+static int mutex_pi_waiter(void* arg) {
+    auto state = static_cast<mutex_pi_state*>(arg);
+
+    mutex_acquire(&state->m);
+    mutex_release(&state->m);
+    return 0;
+}
+
+static void mutex_pi_test() {
+    printf("starting mutex priority inheritance test\n");
+
+    mutex_pi_state state;
+    mutex_init(&state.m);
+    event_init(&state.held, false, 0);
+    event_init(&state.release, false, 0);
+
+    thread_t* holder = thread_create("mutex pi holder", &mutex_pi_holder, &state,
+                                     LOW_PRIORITY, DEFAULT_STACK_SIZE);
+    thread_resume(holder);
+    event_wait(&state.held);
+
+    thread_t* waiter = thread_create("mutex pi waiter", &mutex_pi_waiter, &state,
+                                     HIGH_PRIORITY, DEFAULT_STACK_SIZE);
+    thread_resume(waiter);
+
+    // wait for the waiter to block on the mutex, at which point the holder
+    // should be running at (at least) its priority
+    bool blocked = false;
+    while (!blocked) {
+        thread_sleep_relative(ZX_MSEC(1));
+
+        AutoThreadLock lock;
+        blocked = (waiter->blocking_mutex == &state.m);
+        if (blocked)
+            ASSERT(holder->inherited_priority >= HIGH_PRIORITY);
+    }
+
+    event_signal(&state.release, true);
+    thread_join(waiter, NULL, ZX_TIME_INFINITE);
+    thread_join(holder, NULL, ZX_TIME_INFINITE);
+
+    event_destroy(&state.held);
+    event_destroy(&state.release);
+    mutex_destroy(&state.m);
+
+    printf("done with mutex priority inheritance test\n");
+}
+
 static event_t e;
 
 static int event_signaler(void* arg) {
@@ -697,6 +761,7 @@ int thread_tests(void) {
     kill_tests();
 
     mutex_test();
+    mutex_pi_test();
     event_test();
 
     spinlock_test();
@@ -125,6 +125,31 @@ GENERATED += $(USER_MANIFEST)
 # to generate dependencies
 USER_MANIFEST_DEPS := $(foreach x,$(USER_MANIFEST_LINES),$(lastword $(subst =,$(SPACE),$(strip $(x)))))
 
+# Driver manifests let devmgr find the drivers in /boot/driver and
+# /boot/driver/test without opening each of them at boot.  They are
+# generated from the user manifest and added to the bootfs next to
+# the drivers they describe.
+DRIVER_MANIFEST := $(BUILDDIR)/driver-manifest.bin
+TEST_DRIVER_MANIFEST := $(BUILDDIR)/driver-test-manifest.bin
+
+$(DRIVER_MANIFEST): DRIVER_DIR := driver
+$(TEST_DRIVER_MANIFEST): DRIVER_DIR := driver/test
+$(DRIVER_MANIFEST) $(TEST_DRIVER_MANIFEST): $(MKDRIVERMANIFEST) $(USER_MANIFEST) $(USER_MANIFEST_DEPS)
+	$(call BUILDECHO,generating $@)
+	@$(MKDIR)
+	$(NOECHO)$(MKDRIVERMANIFEST) -o $@ -d $(DRIVER_DIR) $(USER_MANIFEST)
+
+USER_BOOTFS_MANIFEST := $(BUILDDIR)/bootfs-drivers.manifest
+$(USER_BOOTFS_MANIFEST): $(USER_MANIFEST) $(DRIVER_MANIFEST) $(TEST_DRIVER_MANIFEST)
+	$(call BUILDECHO,generating $@)
+	@$(MKDIR)
+	$(NOECHO)cp $(USER_MANIFEST) $@.tmp
+	$(NOECHO)echo driver/.driver-manifest=$(DRIVER_MANIFEST) >> $@.tmp
+	$(NOECHO)echo driver/test/.driver-manifest=$(TEST_DRIVER_MANIFEST) >> $@.tmp
+	$(NOECHO)$(call TESTANDREPLACEFILE,$@.tmp,$@)
+
+GENERATED += $(DRIVER_MANIFEST) $(TEST_DRIVER_MANIFEST) $(USER_BOOTFS_MANIFEST)
+
 PLATFORM_OPTS :=
 ifneq ($(PLATFORM_VID),)
     PLATFORM_OPTS += --vid $(PLATFORM_VID)
@@ -168,10 +193,10 @@ $(KERNEL_BOOTDATA): $(MKBOOTFS) $(ADDITIONAL_BOOTDATA_ITEMS)
 kernel-only: kernel kernel-bootdata
 kernel-bootdata: $(KERNEL_BOOTDATA)
 
-$(USER_BOOTDATA): $(MKBOOTFS) $(USER_MANIFEST) $(USER_MANIFEST_DEPS) $(ADDITIONAL_BOOTDATA_ITEMS)
+$(USER_BOOTDATA): $(MKBOOTFS) $(USER_BOOTFS_MANIFEST) $(USER_MANIFEST_DEPS) $(ADDITIONAL_BOOTDATA_ITEMS)
 	$(call BUILDECHO,generating $@)
 	@$(MKDIR)
-	$(NOECHO)$(MKBOOTFS) --target=boot -c -o $(USER_BOOTDATA) $(USER_MANIFEST) $(ADDITIONAL_BOOTDATA_ITEMS)
+	$(NOECHO)$(MKBOOTFS) --target=boot -c -o $(USER_BOOTDATA) $(USER_BOOTFS_MANIFEST) $(ADDITIONAL_BOOTDATA_ITEMS)
 
 GENERATED += $(USER_BOOTDATA)
 
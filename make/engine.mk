@@ -41,6 +41,7 @@ LKNAME ?= zircon
 CLANG_TARGET_FUCHSIA ?= false
 USE_LINKER_GC ?= true
 HOST_USE_ASAN ?= false
+ENABLE_MUTEX_STATS ?= false
 
 ifeq ($(call TOBOOL,$(ENABLE_ULIB_ONLY)),true)
 ENABLE_BUILD_SYSROOT := false
@@ -379,6 +380,11 @@ MDI_INCLUDES := system/public/zircon/mdi/zircon.mdi
 KERNEL_DEFINES += WITH_PANIC_BACKTRACE=1 WITH_FRAME_POINTERS=1
 KERNEL_COMPILEFLAGS += $(KEEP_FRAME_POINTER_COMPILEFLAGS)
 
+# per-site mutex contention statistics, see the "mutexstats" console command
+ifeq ($(call TOBOOL,$(ENABLE_MUTEX_STATS)),true)
+KERNEL_DEFINES += MUTEX_CONTENTION_STATS=1
+endif
+
 # userspace boot file system generated by the build system
 USER_BOOTDATA := $(BUILDDIR)/bootdata.bin
 USER_FS := $(BUILDDIR)/user.fs
@@ -399,6 +405,7 @@ BUILDID ?=
 TOOLS := $(BUILDDIR)/tools
 MDIGEN := $(TOOLS)/mdigen
 MKBOOTFS := $(TOOLS)/mkbootfs
+MKDRIVERMANIFEST := $(TOOLS)/mkdrivermanifest
 SYSGEN := $(TOOLS)/sysgen
 
 # set V=1 in the environment if you want to see the full command line of every command
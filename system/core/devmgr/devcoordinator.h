@@ -144,6 +144,18 @@ struct dc_driver {
     uint32_t flags;
     struct list_node node;
     const char* libname;
+
+    // The BIND_PROTOCOL value a device must have for this driver to bind
+    // to it, or 0 if the bind program does not require a single protocol.
+    uint32_t bind_protocol;
+
+    // Entry in the coordinator's index of drivers by |bind_protocol|,
+    // and the driver's position in the list of all drivers.
+    struct list_node index_node;
+    uint32_t index_position;
+
+    // ktrace probe for this driver's bind events, 0 until first needed.
+    uint32_t trace_probe;
 };
 
 #define DRIVER_NAME_LEN_MAX 64
@@ -164,6 +176,23 @@ bool dc_is_bindable(driver_t* drv, uint32_t protocol_id,
                     zx_device_prop_t* props, size_t prop_count,
                     bool autobind);
 
+// Returns the BIND_PROTOCOL value the bind program requires, or 0 if it
+// does not require a single protocol.
+uint32_t dc_bind_program_protocol(const zx_bind_inst_t* binding, uint32_t binding_size);
+
+// Returns the BIND_PROTOCOL value a bind program sees for a device.
+uint32_t dc_device_bind_protocol(uint32_t protocol_id,
+                                 const zx_device_prop_t* props, size_t prop_count);
+
+// Counts of bind program evaluations, for dmctl's "bindstats".
+typedef struct {
+    uint64_t evaluations;
+    uint64_t matches;
+    zx_time_t duration;
+} dc_bind_stats_t;
+
+extern dc_bind_stats_t dc_bind_stats;
+
 #define DC_MAX_DATA 4096
 
 // The first two fields of devcoordinator messages align
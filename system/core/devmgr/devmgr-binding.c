@@ -8,8 +8,12 @@
 
 #include <stdio.h>
 
+#include <zircon/syscalls.h>
+
 #include "devcoordinator.h"
 
+dc_bind_stats_t dc_bind_stats;
+
 typedef struct {
     const zx_device_prop_t* props;
     const zx_device_prop_t* end;
@@ -152,5 +156,64 @@ bool dc_is_bindable(driver_t* drv, uint32_t protocol_id,
     ctx.binding_size = drv->binding_size;
     ctx.name = drv->name;
     ctx.autobind = autobind ? 1 : 0;
-    return is_bindable(&ctx);
+
+    zx_time_t start = zx_time_get(ZX_CLOCK_MONOTONIC);
+    bool bindable = is_bindable(&ctx);
+    dc_bind_stats.duration += zx_time_get(ZX_CLOCK_MONOTONIC) - start;
+    dc_bind_stats.evaluations++;
+    if (bindable) {
+        dc_bind_stats.matches++;
+    }
+    return bindable;
+}
+
+uint32_t dc_bind_program_protocol(const zx_bind_inst_t* binding, uint32_t binding_size) {
+    const zx_bind_inst_t* end = binding + (binding_size / sizeof(zx_bind_inst_t));
+    const zx_bind_inst_t* ip;
+
+    // Programs which start with BI_ABORT_IF(NE, BIND_PROTOCOL, ...), with
+    // nothing before it which could match or jump past it.
+    for (ip = binding; ip < end; ip++) {
+        uint32_t inst = ip->op;
+        switch (BINDINST_OP(inst)) {
+        case OP_ABORT:
+            if ((BINDINST_CC(inst) == COND_NE) && (BINDINST_PB(inst) == BIND_PROTOCOL)) {
+                return ip->arg;
+            }
+            continue;
+        case OP_SET:
+        case OP_CLEAR:
+        case OP_LABEL:
+            continue;
+        }
+        break;
+    }
+
+    // Programs whose every match is BI_MATCH_IF(EQ, BIND_PROTOCOL, ...)
+    // for the same protocol.
+    uint32_t protocol = 0;
+    for (ip = binding; ip < end; ip++) {
+        uint32_t inst = ip->op;
+        if (BINDINST_OP(inst) != OP_MATCH) {
+            continue;
+        }
+        if ((BINDINST_CC(inst) != COND_EQ) || (BINDINST_PB(inst) != BIND_PROTOCOL)) {
+            return 0;
+        }
+        if ((protocol != 0) && (protocol != ip->arg)) {
+            return 0;
+        }
+        protocol = ip->arg;
+    }
+    return protocol;
+}
+
+uint32_t dc_device_bind_protocol(uint32_t protocol_id,
+                                 const zx_device_prop_t* props, size_t prop_count) {
+    bpctx_t ctx = {
+        .props = props,
+        .end = props + prop_count,
+        .protocol_id = protocol_id,
+    };
+    return dev_get_prop(&ctx, BIND_PROTOCOL);
 }
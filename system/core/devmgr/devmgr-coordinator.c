@@ -4,13 +4,16 @@
 
 #include <ctype.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <threads.h>
 
 #include <ddk/driver.h>
 #include <driver-info/driver-info.h>
 #include <launchpad/launchpad.h>
+#include <launchpad/vmo.h>
 #include <zircon/assert.h>
 #include <zircon/ktrace.h>
 #include <zircon/processargs.h>
@@ -34,6 +37,7 @@ bool dc_asan_drivers = false;
 static void dc_dump_state(void);
 static void dc_dump_devprops(void);
 static void dc_dump_drivers(void);
+static void dc_dump_bind_stats(void);
 
 typedef struct {
     zx_status_t status;
@@ -131,6 +135,7 @@ static zx_status_t handle_dmctl_write(size_t len, const char* cmd) {
                      "ktraceon    - start kernel tracing\n"
                      "devprops    - dump published devices and their binding properties\n"
                      "drivers     - list discovered drivers and their properties\n"
+                     "bindstats   - show how many bind programs have been run\n"
                      );
             return ZX_OK;
         }
@@ -168,6 +173,10 @@ static zx_status_t handle_dmctl_write(size_t len, const char* cmd) {
             return ZX_OK;
         }
     }
+    if ((len == 9) && (!memcmp(cmd, "bindstats", 9))) {
+        dc_dump_bind_stats();
+        return ZX_OK;
+    }
     if ((len == 9) && (!memcmp(cmd, "ktraceoff", 9))) {
         zx_ktrace_control(get_root_resource(), KTRACE_ACTION_STOP, 0, NULL);
         zx_ktrace_control(get_root_resource(), KTRACE_ACTION_REWIND, 0, NULL);
@@ -213,12 +222,101 @@ static list_node_t list_drivers_new = LIST_INITIAL_VALUE(list_drivers_new);
 // Drivers to try last
 static list_node_t list_drivers_fallback = LIST_INITIAL_VALUE(list_drivers_fallback);
 
+// Drivers in All Drivers by the protocol their bind program requires, so
+// that a device is only matched against drivers which could bind to it.
+// Drivers which do not require a single protocol are in |driver_index_any|.
+// Both keep the order of All Drivers, which is the order drivers are tried
+// in, and are rebuilt when All Drivers changes.
+#define DRIVER_INDEX_BUCKETS 64
+static list_node_t driver_index[DRIVER_INDEX_BUCKETS];
+static list_node_t driver_index_any = LIST_INITIAL_VALUE(driver_index_any);
+static bool driver_index_stale = true;
+
 // All Devices (excluding static immortal devices)
 static list_node_t list_devices = LIST_INITIAL_VALUE(list_devices);
 
 // All DevHosts
 static list_node_t list_devhosts = LIST_INITIAL_VALUE(list_devhosts);
 
+static void dc_add_driver(driver_t* drv, bool at_head) {
+    if (at_head) {
+        list_add_head(&list_drivers, &drv->node);
+    } else {
+        list_add_tail(&list_drivers, &drv->node);
+    }
+    driver_index_stale = true;
+}
+
+static list_node_t* driver_index_bucket(uint32_t protocol) {
+    return &driver_index[(protocol * 2654435761u) >> 26];
+}
+
+static void dc_rebuild_driver_index(void) {
+    for (size_t n = 0; n < countof(driver_index); n++) {
+        list_initialize(&driver_index[n]);
+    }
+    list_initialize(&driver_index_any);
+
+    uint32_t position = 0;
+    driver_t* drv;
+    list_for_every_entry(&list_drivers, drv, driver_t, node) {
+        drv->index_position = position++;
+        if (drv->bind_protocol) {
+            list_add_tail(driver_index_bucket(drv->bind_protocol), &drv->index_node);
+        } else {
+            list_add_tail(&driver_index_any, &drv->index_node);
+        }
+    }
+    driver_index_stale = false;
+}
+
+// Walks, in the order of All Drivers, the drivers which might bind
+// to a device whose BIND_PROTOCOL is |protocol|.
+typedef struct {
+    uint32_t protocol;
+    list_node_t* bucket;
+    driver_t* next_in_bucket;
+    driver_t* next_any;
+} driver_candidates_t;
+
+static void dc_driver_candidates_init(driver_candidates_t* it, uint32_t protocol) {
+    if (driver_index_stale) {
+        dc_rebuild_driver_index();
+    }
+    it->protocol = protocol;
+    it->bucket = driver_index_bucket(protocol);
+    it->next_in_bucket = list_peek_head_type(it->bucket, driver_t, index_node);
+    it->next_any = list_peek_head_type(&driver_index_any, driver_t, index_node);
+}
+
+static driver_t* dc_driver_candidates_next(driver_candidates_t* it) {
+    for (;;) {
+        driver_t* drv;
+        if ((it->next_in_bucket != NULL) &&
+            ((it->next_any == NULL) ||
+             (it->next_in_bucket->index_position < it->next_any->index_position))) {
+            drv = it->next_in_bucket;
+            it->next_in_bucket = list_next_type(it->bucket, &drv->index_node,
+                                                driver_t, index_node);
+            if (drv->bind_protocol != it->protocol) {
+                // another protocol in the same bucket
+                continue;
+            }
+        } else if (it->next_any != NULL) {
+            drv = it->next_any;
+            it->next_any = list_next_type(&driver_index_any, &drv->index_node,
+                                          driver_t, index_node);
+        } else {
+            return NULL;
+        }
+        return drv;
+    }
+}
+
+static uint32_t dc_get_bind_protocol(device_t* dev) {
+    return dc_device_bind_protocol(dev->protocol_id, dev->props, dev->prop_count);
+}
+
 static driver_t* libname_to_driver(const char* libname) {
     driver_t* drv;
     list_for_every_entry(&list_drivers, drv, driver_t, node) {
@@ -380,6 +478,21 @@ static void dc_dump_drivers(void) {
     }
 }
 
+static void dc_dump_bind_stats(void) {
+    size_t drivers = list_length(&list_drivers);
+    size_t indexed = 0;
+    driver_t* drv;
+    list_for_every_entry(&list_drivers, drv, driver_t, node) {
+        if (drv->bind_protocol) {
+            indexed++;
+        }
+    }
+    dmprintf("Drivers     : %zu (%zu indexed by protocol)\n", drivers, indexed);
+    dmprintf("Evaluations : %" PRIu64 " (%" PRIu64 " matched)\n",
+             dc_bind_stats.evaluations, dc_bind_stats.matches);
+    dmprintf("Time        : %" PRIu64 " us\n", dc_bind_stats.duration / 1000);
+}
+
 static void dc_handle_new_device(device_t* dev);
 static void dc_handle_new_driver(void);
 
@@ -534,21 +647,93 @@ static void dc_watch(zx_handle_t h) {
     }
 }
 
-static zx_status_t dc_launch_devhost(devhost_t* host,
-                                     const char* name, zx_handle_t hrpc) {
-    const char* devhost_bin = get_devhost_bin();
+// Bind and devhost launch events are emitted as ktrace probes, so that
+// they line up with the kernel's view of the devhosts doing the work.
+// Each driver and each devhost gets a probe named after it. arg0 is the
+// event. arg1 is the status for *_DONE events, and for BIND_START the koid
+// of the devhost, which is 0 if that devhost is still being launched.
+#define DC_TRACE_BIND_START 1
+#define DC_TRACE_BIND_DONE 2
+#define DC_TRACE_LAUNCH_START 3
+#define DC_TRACE_LAUNCH_DONE 4
+
+static uint32_t dc_trace_probe(const char* name) {
+    // the kernel always reads a whole ZX_MAX_NAME_LEN buffer
+    char buf[ZX_MAX_NAME_LEN] = {};
+    strncpy(buf, name, sizeof(buf) - 1);
+    zx_status_t r = zx_ktrace_control(get_root_resource(), KTRACE_ACTION_NEW_PROBE, 0, buf);
+    return (r > 0) ? (uint32_t) r : 0;
+}
+
+static void dc_trace(uint32_t probe, uint32_t event, uint32_t arg) {
+    if (probe != 0) {
+        zx_ktrace_write(get_root_resource(), probe, event, arg);
+    }
+}
+
+static void dc_trace_driver(driver_t* drv, uint32_t event, uint32_t arg) {
+    if (drv->trace_probe == 0) {
+        drv->trace_probe = dc_trace_probe(drv->name);
+    }
+    dc_trace(drv->trace_probe, event, arg);
+}
+
+// Devhost processes are created by a few launcher threads, so that loading
+// one devhost does not hold up the coordinator, or the devhosts of other
+// buses. A new devhost is usable as soon as it is queued: messages to it
+// wait in its rpc channel until the process starts reading them.
+//
+// Everything a launch needs from the coordinator is gathered when it is
+// queued. The result comes back to the coordinator through dc_port.
+#define DEVHOST_LAUNCHERS_MAX 4
+
+typedef struct {
+    list_node_t node;
+
+    // holds a reference until the launch completes
+    devhost_t* host;
+    char name[32];
+    uint32_t trace_probe;
+
+    zx_handle_t hrpc;
+    zx_handle_t vmo;
+    zx_handle_t resource;
+    zx_handle_t fs_root;
+    zx_handle_t svc_root;
+    zx_handle_t job_root;
+    const char* devhost_bin;
+
+    // results
+    zx_handle_t proc;
+    zx_status_t status;
+} devhost_launch_t;
+
+static mtx_t launch_lock = MTX_INIT;
+static cnd_t launch_cond;
+static list_node_t list_launches = LIST_INITIAL_VALUE(list_launches);
+
+// Launches which are done, for the coordinator to finish. At most one
+// packet is queued for them at a time.
+static list_node_t list_launched = LIST_INITIAL_VALUE(list_launched);
+static bool launched_queued;
 
+static void dc_release_devhost(devhost_t* dh);
+static zx_status_t dc_devhost_launched(port_handler_t* ph, zx_signals_t signals, uint32_t evt);
+
+static port_handler_t launched_handler = {
+    .func = dc_devhost_launched,
+};
+
+static zx_status_t dc_launch_devhost(devhost_launch_t* dl) {
     launchpad_t* lp;
-    launchpad_create_with_jobs(devhost_job, 0, name, &lp);
-    launchpad_load_from_file(lp, devhost_bin);
-    launchpad_set_args(lp, 1, &devhost_bin);
+    launchpad_create_with_jobs(devhost_job, 0, dl->name, &lp);
+    launchpad_load_from_vmo(lp, dl->vmo);
+    launchpad_set_args(lp, 1, &dl->devhost_bin);
 
-    launchpad_add_handle(lp, hrpc, PA_HND(PA_USER0, 0));
+    launchpad_add_handle(lp, dl->hrpc, PA_HND(PA_USER0, 0));
 
-    zx_handle_t h;
     //TODO: limit root resource to root devhost only
-    zx_handle_duplicate(get_root_resource(), ZX_RIGHT_SAME_RIGHTS, &h);
-    launchpad_add_handle(lp, h, PA_HND(PA_RESOURCE, 0));
+    launchpad_add_handle(lp, dl->resource, PA_HND(PA_RESOURCE, 0));
 
     // Inherit devmgr's environment (including kernel cmdline)
     launchpad_clone(lp, LP_CLONE_ENVIRON);
@@ -557,35 +742,146 @@ static zx_status_t dc_launch_devhost(devhost_t* host,
     size_t name_count = 0;
 
     //TODO: eventually devhosts should not have vfs access
-    launchpad_add_handle(lp, fs_root_clone(),
+    launchpad_add_handle(lp, dl->fs_root,
                          PA_HND(PA_NS_DIR, name_count++));
 
     //TODO: constrain to /svc/device
-    if ((h = svc_root_clone()) != ZX_HANDLE_INVALID) {
-        launchpad_add_handle(lp, h, PA_HND(PA_NS_DIR, name_count++));
+    if (dl->svc_root != ZX_HANDLE_INVALID) {
+        launchpad_add_handle(lp, dl->svc_root, PA_HND(PA_NS_DIR, name_count++));
     }
 
     launchpad_set_nametable(lp, name_count, nametable);
 
     //TODO: limit root job access to root devhost only
-    launchpad_add_handle(lp, get_sysinfo_job_root(),
+    launchpad_add_handle(lp, dl->job_root,
                          PA_HND(PA_USER0, ID_HJOBROOT));
 
     const char* errmsg;
-    zx_status_t status = launchpad_go(lp, &host->proc, &errmsg);
+    zx_status_t status = launchpad_go(lp, &dl->proc, &errmsg);
     if (status < 0) {
         log(ERROR, "devcoord: launch devhost '%s': failed: %d: %s\n",
-            name, status, errmsg);
+            dl->name, status, errmsg);
         return status;
     }
-    zx_info_handle_basic_t info;
-    if (zx_object_get_info(host->proc, ZX_INFO_HANDLE_BASIC, &info,
-                           sizeof(info), NULL, NULL) == ZX_OK) {
-        host->koid = info.koid;
+    return ZX_OK;
+}
+
+static int dc_devhost_launcher(void* arg) {
+    for (;;) {
+        mtx_lock(&launch_lock);
+        devhost_launch_t* dl;
+        while ((dl = list_remove_head_type(&list_launches, devhost_launch_t, node)) == NULL) {
+            cnd_wait(&launch_cond, &launch_lock);
+        }
+        mtx_unlock(&launch_lock);
+
+        dc_trace(dl->trace_probe, DC_TRACE_LAUNCH_START, 0);
+        dl->status = dc_launch_devhost(dl);
+        dc_trace(dl->trace_probe, DC_TRACE_LAUNCH_DONE, dl->status);
+
+        mtx_lock(&launch_lock);
+        list_add_tail(&list_launched, &dl->node);
+        bool notify = !launched_queued;
+        launched_queued = true;
+        mtx_unlock(&launch_lock);
+
+        if (notify) {
+            // The port only refuses packets while it is out of room, so
+            // wait for the coordinator to catch up. Should it fail for
+            // good, the launch stays listed for the next one to pick up.
+            zx_status_t r;
+            while ((r = port_queue(&dc_port, &launched_handler, 0)) != ZX_OK) {
+                if ((r != ZX_ERR_SHOULD_WAIT) && (r != ZX_ERR_NO_MEMORY)) {
+                    log(ERROR, "devcoord: cannot queue devhost launch: %d\n", r);
+                    mtx_lock(&launch_lock);
+                    launched_queued = false;
+                    mtx_unlock(&launch_lock);
+                    break;
+                }
+                zx_nanosleep(zx_deadline_after(ZX_MSEC(10)));
+            }
+        }
     }
-    log(INFO, "devcoord: launch devhost '%s': pid=%zu\n",
-        name, host->koid);
+    return 0;
+}
+
+static void dc_finish_launch(devhost_launch_t* dl) {
+    devhost_t* dh = dl->host;
+    if (dl->status == ZX_OK) {
+        dh->proc = dl->proc;
+        zx_info_handle_basic_t info;
+        if (zx_object_get_info(dh->proc, ZX_INFO_HANDLE_BASIC, &info,
+                               sizeof(info), NULL, NULL) == ZX_OK) {
+            dh->koid = info.koid;
+        }
+        log(INFO, "devcoord: launch devhost '%s': pid=%zu\n",
+            dl->name, dh->koid);
+    }
+    // On failure the devhost's end of the rpc channel is gone, so the
+    // devices queued for it see their channels closed and are removed.
+}
 
+// Runs on the coordinator once launchers are done with some launches.
+static zx_status_t dc_devhost_launched(port_handler_t* ph, zx_signals_t signals, uint32_t evt) {
+    list_node_t done = LIST_INITIAL_VALUE(done);
+    mtx_lock(&launch_lock);
+    list_move(&list_launched, &done);
+    launched_queued = false;
+    mtx_unlock(&launch_lock);
+
+    devhost_launch_t* dl;
+    while ((dl = list_remove_head_type(&done, devhost_launch_t, node)) != NULL) {
+        devhost_t* dh = dl->host;
+        dc_finish_launch(dl);
+        free(dl);
+        dc_release_devhost(dh);
+    }
+    return ZX_OK;
+}
+
+static zx_handle_t devhost_vmo;
+static const char* devhost_vmo_bin;
+
+static zx_status_t dc_get_devhost_vmo(const char** bin, zx_handle_t* out) {
+    const char* devhost_bin = get_devhost_bin();
+    if (devhost_vmo_bin != devhost_bin) {
+        zx_handle_t vmo;
+        zx_status_t r;
+        if ((r = launchpad_vmo_from_file(devhost_bin, &vmo)) < 0) {
+            log(ERROR, "devcoord: cannot load '%s': %d\n", devhost_bin, r);
+            return r;
+        }
+        zx_handle_close(devhost_vmo);
+        devhost_vmo = vmo;
+        devhost_vmo_bin = devhost_bin;
+    }
+    *bin = devhost_bin;
+    return zx_handle_duplicate(devhost_vmo, ZX_RIGHT_SAME_RIGHTS, out);
+}
+
+static bool launchers_running;
+
+static zx_status_t dc_start_devhost_launchers(void) {
+    if (cnd_init(&launch_cond) != thrd_success) {
+        return ZX_ERR_NO_RESOURCES;
+    }
+    uint32_t count = zx_system_get_num_cpus();
+    if (count > DEVHOST_LAUNCHERS_MAX) {
+        count = DEVHOST_LAUNCHERS_MAX;
+    }
+    for (uint32_t n = 0; n < count; n++) {
+        thrd_t t;
+        if (thrd_create_with_name(&t, dc_devhost_launcher, NULL,
+                                  "devhost-launcher") != thrd_success) {
+            // one is enough to make progress
+            if (n == 0) {
+                return ZX_ERR_NO_RESOURCES;
+            }
+            break;
+        }
+        thrd_detach(t);
+    }
+    launchers_running = true;
     return ZX_OK;
 }
 
@@ -595,19 +891,32 @@ static zx_status_t dc_new_devhost(const char* name, devhost_t* parent,
     if (dh == NULL) {
         return ZX_ERR_NO_MEMORY;
     }
+    devhost_launch_t* dl = calloc(1, sizeof(devhost_launch_t));
+    if (dl == NULL) {
+        free(dh);
+        return ZX_ERR_NO_MEMORY;
+    }
 
-    zx_handle_t hrpc;
     zx_status_t r;
-    if ((r = zx_channel_create(0, &hrpc, &dh->hrpc)) < 0) {
+    if ((r = zx_channel_create(0, &dl->hrpc, &dh->hrpc)) < 0) {
+        free(dl);
         free(dh);
         return r;
     }
-
-    if ((r = dc_launch_devhost(dh, name, hrpc)) < 0) {
+    if ((r = dc_get_devhost_vmo(&dl->devhost_bin, &dl->vmo)) < 0) {
+        zx_handle_close(dl->hrpc);
         zx_handle_close(dh->hrpc);
+        free(dl);
         free(dh);
         return r;
     }
+    zx_handle_duplicate(get_root_resource(), ZX_RIGHT_SAME_RIGHTS, &dl->resource);
+    dl->fs_root = fs_root_clone();
+    dl->svc_root = svc_root_clone();
+    dl->job_root = get_sysinfo_job_root();
+    strncpy(dl->name, name, sizeof(dl->name) - 1);
+    dl->trace_probe = dc_trace_probe(name);
+    dl->host = dh;
 
     list_initialize(&dh->devices);
     list_initialize(&dh->children);
@@ -619,6 +928,20 @@ static zx_status_t dc_new_devhost(const char* name, devhost_t* parent,
     }
     list_add_tail(&list_devhosts, &dh->anode);
 
+    if (launchers_running) {
+        // dropped by dc_devhost_launched()
+        dh->refcount++;
+
+        mtx_lock(&launch_lock);
+        list_add_tail(&list_launches, &dl->node);
+        cnd_signal(&launch_cond);
+        mtx_unlock(&launch_lock);
+    } else {
+        dl->status = dc_launch_devhost(dl);
+        dc_finish_launch(dl);
+        free(dl);
+    }
+
     log(DEVLC, "devcoord: new host %p\n", dh);
 
     *out = dh;
@@ -942,8 +1265,10 @@ static zx_status_t dc_bind_device(device_t* dev, const char* drvlibname) {
     bool autobind = (drvlibname[0] == 0);
 
     //TODO: disallow if we're in the middle of enumeration, etc
+    driver_candidates_t candidates;
+    dc_driver_candidates_init(&candidates, dc_get_bind_protocol(dev));
     driver_t* drv;
-    list_for_every_entry(&list_drivers, drv, driver_t, node) {
+    while ((drv = dc_driver_candidates_next(&candidates)) != NULL) {
         if (autobind || !strcmp(drv->libname, drvlibname)) {
             if (dc_is_bindable(drv, dev->protocol_id,
                                dev->props, dev->prop_count, autobind)) {
@@ -1127,6 +1452,7 @@ static zx_status_t dc_handle_device_read(device_t* dev) {
         }
         switch (pending->op) {
         case PENDING_BIND:
+            dc_trace_driver(pending->ctx, DC_TRACE_BIND_DONE, msg.status);
             if (msg.status != ZX_OK) {
                 log(ERROR, "devcoord: rpc: bind-driver '%s' status %d\n",
                     dev->name, msg.status);
@@ -1313,7 +1639,8 @@ static zx_status_t dc_create_proxy(device_t* parent) {
 }
 
 // send message to devhost, requesting the binding of a driver to a device
-static zx_status_t dh_bind_driver(device_t* dev, const char* libname) {
+static zx_status_t dh_bind_driver(device_t* dev, driver_t* drv) {
+    const char* libname = drv->libname;
     dc_msg_t msg;
     uint32_t mlen;
 
@@ -1342,9 +1669,11 @@ static zx_status_t dh_bind_driver(device_t* dev, const char* libname) {
         return r;
     }
 
+    dc_trace_driver(drv, DC_TRACE_BIND_START, dev->host ? dev->host->koid : 0);
+
     dev->flags |= DEV_CTX_BOUND;
     pending->op = PENDING_BIND;
-    pending->ctx = NULL;
+    pending->ctx = drv;
     list_add_tail(&dev->pending, &pending->node);
     return ZX_OK;
 }
@@ -1436,7 +1765,7 @@ static zx_status_t dc_attempt_bind(driver_t* drv, device_t* dev) {
             log(ERROR, "devcoord: can't bind to device without devhost\n");
             return ZX_ERR_BAD_STATE;
         }
-        return dh_bind_driver(dev, drv->libname);
+        return dh_bind_driver(dev, drv);
     }
 
     zx_status_t r;
@@ -1444,7 +1773,7 @@ static zx_status_t dc_attempt_bind(driver_t* drv, device_t* dev) {
         return r;
     }
 
-    r = dh_bind_driver(dev->proxy, drv->libname);
+    r = dh_bind_driver(dev->proxy, drv);
     //TODO(swetland): arrange to mark us unbound when the proxy (or its devhost) goes away
     if ((r == ZX_OK) && !(dev->flags & DEV_CTX_MULTI_BIND)) {
         dev->flags |= DEV_CTX_BOUND;
@@ -1453,9 +1782,11 @@ static zx_status_t dc_attempt_bind(driver_t* drv, device_t* dev) {
 }
 
 static void dc_handle_new_device(device_t* dev) {
-    driver_t* drv;
+    driver_candidates_t candidates;
+    dc_driver_candidates_init(&candidates, dc_get_bind_protocol(dev));
 
-    list_for_every_entry(&list_drivers, drv, driver_t, node) {
+    driver_t* drv;
+    while ((drv = dc_driver_candidates_next(&candidates)) != NULL) {
         if (dc_is_bindable(drv, dev->protocol_id,
                            dev->props, dev->prop_count, true)) {
             log(SPEW, "devcoord: drv='%s' bindable to dev='%s'\n",
@@ -1690,6 +2021,8 @@ static work_t new_driver_work;
 // to the list of new drivers and work is queued to process it.  If
 // before it's added to the list of all drivers or fallback list.
 void dc_driver_added(driver_t* drv, const char* version) {
+    drv->bind_protocol = dc_bind_program_protocol(drv->binding, drv->binding_size);
+
     //TODO: real priority scheme
     if (dc_running) {
         if (version[0] == '*') {
@@ -1710,9 +2043,9 @@ void dc_driver_added(driver_t* drv, const char* version) {
     } else if (version[0] == '!') {
         // debugging / development hack
         // prioritize drivers with version "!..." over others
-        list_add_head(&list_drivers, &drv->node);
+        dc_add_driver(drv, true);
     } else {
-        list_add_tail(&list_drivers, &drv->node);
+        dc_add_driver(drv, false);
     }
 }
 
@@ -1735,6 +2068,11 @@ device_t* coordinator_init(zx_handle_t root_job) {
 
     port_init(&dc_port);
 
+    if ((status = dc_start_devhost_launchers()) < 0) {
+        log(ERROR, "devcoord: cannot start devhost launchers, launching in line: %d\n",
+            status);
+    }
+
     return &root_device;
 }
 
@@ -1756,6 +2094,9 @@ void dc_bind_driver(driver_t* drv) {
                 // if device is already bound or being destroyed, skip it
                 continue;
             }
+            if (drv->bind_protocol && (drv->bind_protocol != dc_get_bind_protocol(dev))) {
+                continue;
+            }
             if (dc_is_bindable(drv, dev->protocol_id,
                                dev->props, dev->prop_count, true)) {
                 log(INFO, "devcoord: drv='%s' bindable to dev='%s'\n",
@@ -1770,7 +2111,7 @@ void dc_bind_driver(driver_t* drv) {
 void dc_handle_new_driver(void) {
     driver_t* drv;
     while ((drv = list_remove_head_type(&list_drivers_new, driver_t, node)) != NULL) {
-        list_add_tail(&list_drivers, &drv->node);
+        dc_add_driver(drv, false);
         dc_bind_driver(drv);
     }
 }
@@ -1852,7 +2193,7 @@ void coordinator(void) {
     } else {
         driver_t* drv;
         while ((drv = list_remove_tail_type(&list_drivers_fallback, driver_t, node)) != NULL) {
-            list_add_tail(&list_drivers, &drv->node);
+            dc_add_driver(drv, false);
         }
     }
 
@@ -1861,6 +2202,8 @@ void coordinator(void) {
     list_for_every_entry(&list_drivers, drv, driver_t, node) {
         dc_bind_driver(drv);
     }
+    log(INFO, "devcoord: %" PRIu64 " bind programs run in %" PRIu64 " us at startup\n",
+        dc_bind_stats.evaluations, dc_bind_stats.duration / 1000);
 
     dc_running = true;
 
@@ -4,17 +4,24 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "devmgr.h"
 #include "devcoordinator.h"
+#include "log.h"
 
 #include <driver-info/driver-info.h>
 
+#include <fdio/io.h>
+
 #include <zircon/driver/binding.h>
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
 
 static bool is_driver_disabled(const char* name) {
     // driver.<driver_name>.disable
@@ -74,11 +81,62 @@ static void found_driver(zircon_driver_note_payload_t* note,
     dc_driver_added(drv, note->version);
 }
 
-void find_loadable_drivers(const char* path) {
-    DIR* dir = opendir(path);
-    if (dir == NULL) {
+static void found_manifest_driver(zircon_driver_note_payload_t* note,
+                                  const zx_bind_inst_t* bi,
+                                  const char* name, void* cookie) {
+    const char* path = cookie;
+    char libname[256 + 32];
+    int r = snprintf(libname, sizeof(libname), "%s/%s", path, name);
+    if ((r < 0) || (r >= (int)sizeof(libname))) {
         return;
     }
+    found_driver(note, bi, libname);
+}
+
+// Adds the drivers described by the driver manifest in |path|, which is
+// generated at build time, instead of opening every driver in |path|.
+static zx_status_t load_driver_manifest(const char* path) {
+    char fn[256 + 32];
+    int r = snprintf(fn, sizeof(fn), "%s/" DI_MANIFEST_NAME, path);
+    if ((r < 0) || (r >= (int)sizeof(fn))) {
+        return ZX_ERR_BAD_PATH;
+    }
+
+    int fd;
+    if ((fd = open(fn, O_RDONLY)) < 0) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    struct stat s;
+    zx_handle_t vmo;
+    zx_status_t status;
+    if (fstat(fd, &s) < 0) {
+        status = ZX_ERR_IO;
+    } else {
+        status = fdio_get_vmo(fd, &vmo);
+    }
+    close(fd);
+    if (status != ZX_OK) {
+        return status;
+    }
+    if (s.st_size == 0) {
+        zx_handle_close(vmo);
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    uintptr_t addr;
+    status = zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, s.st_size,
+                         ZX_VM_FLAG_PERM_READ, &addr);
+    zx_handle_close(vmo);
+    if (status != ZX_OK) {
+        return status;
+    }
+    status = di_read_driver_manifest((const void*)addr, s.st_size,
+                                     (void*)path, found_manifest_driver);
+    zx_vmar_unmap(zx_vmar_root_self(), addr, s.st_size);
+    return status;
+}
+
+static void scan_drivers(const char* path, DIR* dir) {
     struct dirent* de;
     while ((de = readdir(dir)) != NULL) {
         if (de->d_name[0] == '.') {
@@ -108,7 +166,31 @@ void find_loadable_drivers(const char* path) {
             }
         }
     }
+}
+
+void find_loadable_drivers(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return;
+    }
+
+    zx_time_t start = zx_time_get(ZX_CLOCK_MONOTONIC);
+    const char* how = "manifest";
+    zx_status_t status = ZX_ERR_NOT_FOUND;
+    if (getenv_bool("devmgr.driver-manifest", true)) {
+        status = load_driver_manifest(path);
+        if ((status != ZX_OK) && (status != ZX_ERR_NOT_FOUND)) {
+            log(ERROR, "devcoord: bad driver manifest in '%s': %d\n", path, status);
+        }
+    }
+    if (status != ZX_OK) {
+        how = "scan";
+        scan_drivers(path, dir);
+    }
     closedir(dir);
+
+    log(INFO, "devcoord: found drivers in '%s' in %" PRIu64 " us (%s)\n", path,
+        (zx_time_get(ZX_CLOCK_MONOTONIC) - start) / 1000, how);
 }
 
 void load_driver(const char* path) {
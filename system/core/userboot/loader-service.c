@@ -115,6 +115,8 @@ static bool handle_loader_rpc(struct loader_state* state,
         break;
 
     case LOADER_SVC_OP_CLONE:
+    case LOADER_SVC_OP_LOAD_OBJECTS:
+    case LOADER_SVC_OP_LOAD_PRELINKED:
         msgbuf.msg.arg = ZX_ERR_NOT_SUPPORTED;
         goto error_reply;
 
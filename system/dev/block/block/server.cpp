@@ -17,6 +17,7 @@
 #include <zircon/compiler.h>
 #include <zircon/device/block.h>
 #include <zircon/syscalls.h>
+#include <zircon/syscalls/fifo.h>
 #include <zx/fifo.h>
 
 #include "server.h"
@@ -266,7 +267,7 @@ zx_status_t BlockServer::Create(zx_device_t* dev, zx::fifo* fifo_out, BlockServe
     }
 
     zx_status_t status;
-    if ((status = zx::fifo::create(BLOCK_FIFO_MAX_DEPTH, BLOCK_FIFO_ESIZE, 0,
+    if ((status = zx::fifo::create(BLOCK_FIFO_MAX_DEPTH, BLOCK_FIFO_ESIZE, ZX_FIFO_SHARED_RING,
                                    fifo_out, &bs->fifo_)) != ZX_OK) {
         delete bs;
         return status;
@@ -16,6 +16,7 @@
 
 #ifdef __cplusplus
 
+#include <bitmap/rle-bitmap.h>
 #include <ddktl/device.h>
 #include <ddktl/protocol/block.h>
 #include <fs/mapped-vmo.h>
@@ -50,6 +51,21 @@ public:
         }
         return pslices_[vslice - vslice_start_];
     }
+    // Replace the pslice backing an already-mapped vslice
+    void set(size_t vslice, uint32_t pslice) {
+        ZX_DEBUG_ASSERT(vslice - vslice_start_ < pslices_.size());
+        ZX_DEBUG_ASSERT(pslice != PSLICE_UNALLOCATED);
+        pslices_[vslice - vslice_start_] = pslice;
+    }
+    // Returns true if the extent is backed by a single run of pslices
+    bool IsPhysicallyContiguous() const {
+        for (size_t i = 1; i < pslices_.size(); i++) {
+            if (pslices_[i - 1] + 1 != pslices_[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
 
     // Breaks the extent from:
     //   [start(), end())
@@ -138,6 +154,12 @@ public:
     zx_status_t FreeSlicesLocked(VPartition* vp, size_t vslice_start,
                                  size_t count) TA_REQ(lock_);
 
+    // Migrate the slices of 'vp' so that each extent of contiguous vslices is
+    // backed by a contiguous run of pslices, where free space allows.
+    // Data is copied while the partition remains bound; I/O to the partition
+    // is stalled only while one of its extents is being moved.
+    zx_status_t Defragment(VPartition* vp) TA_EXCL(lock_);
+
     size_t DiskSize() const { return info_.block_count * info_.block_size; }
     size_t SliceSize() const { return slice_size_; }
     size_t VSliceMax() const { return VSLICE_MAX; }
@@ -156,7 +178,32 @@ private:
     DISALLOW_COPY_ASSIGN_AND_MOVE(VPartitionManager);
 
     zx_status_t FindFreeVPartEntryLocked(size_t* out) const TA_REQ(lock_);
-    zx_status_t FindFreeSliceLocked(size_t* out, size_t hint) const TA_REQ(lock_);
+    // Find a free pslice for a new allocation.
+    //
+    // |hint| is the pslice which would keep the allocation physically
+    // contiguous with the preceding vslice (zero if there is none), and
+    // |count| is the number of slices the caller intends to allocate as a run.
+    zx_status_t FindFreeSliceLocked(size_t* out, size_t hint, size_t count) const TA_REQ(lock_);
+
+    // Find the smallest run of free pslices which is at least |count| slices
+    // long. If no run is long enough, the longest run is returned instead.
+    zx_status_t FindFreeRunLocked(size_t count, size_t* out_start,
+                                  size_t* out_length) const TA_REQ(lock_);
+
+    // Rebuild the free slice index from the slice allocation table.
+    zx_status_t BuildFreeIndexLocked() TA_REQ(lock_);
+
+    // Whether the allocation table marks every pslice in [start, start + count)
+    // free.
+    bool IsFreeRunLocked(size_t start, size_t count) const TA_REQ(lock_);
+
+    // Mark a pslice as allocated to (vpart, vslice) / as free, keeping the
+    // allocation table and the free slice index consistent.
+    void AllocateSliceEntryLocked(size_t pslice, size_t vpart, size_t vslice) TA_REQ(lock_);
+    void FreeSliceEntryLocked(size_t pslice) TA_REQ(lock_);
+
+    // Copy the contents of one pslice to another, using |vmo| as a bounce buffer.
+    zx_status_t CopySliceLocked(size_t src, size_t dst, const MappedVmo* vmo) TA_REQ(lock_);
 
     fvm_t* GetFvmLocked() const TA_REQ(lock_) {
         return reinterpret_cast<fvm_t*>(metadata_->GetData());
@@ -187,6 +234,12 @@ private:
     fbl::Mutex lock_;
     fbl::unique_ptr<MappedVmo> metadata_ TA_GUARDED(lock_);
     bool first_metadata_is_primary_ TA_GUARDED(lock_);
+    // Index of free pslices, stored as runs. If an allocation failure leaves
+    // the index inconsistent with the allocation table, it is marked invalid,
+    // rebuilt on the next allocation, and the slice table is scanned directly
+    // in the meantime.
+    bitmap::RleBitmap free_slices_ TA_GUARDED(lock_);
+    bool free_slices_valid_ TA_GUARDED(lock_);
     size_t metadata_size_;
     size_t slice_size_;
 };
@@ -206,6 +259,7 @@ public:
     auto ExtentBegin() TA_REQ(lock_) {
         return slice_map_.begin();
     }
+
     uint32_t SliceGetLocked(size_t vslice) const TA_REQ(lock_);
 
     // Check slices starting from |vslice_start|.
@@ -218,6 +272,13 @@ public:
     }
     zx_status_t SliceSetLocked(size_t vslice, uint32_t pslice) TA_REQ(lock_);
 
+    // Remap an allocated vslice onto a different pslice.
+    void SliceMoveLocked(size_t vslice, uint32_t pslice) TA_REQ(lock_) {
+        auto extent = --slice_map_.upper_bound(vslice);
+        ZX_DEBUG_ASSERT(extent.IsValid());
+        extent->set(vslice, pslice);
+    }
+
     bool SliceCanFree(size_t vslice) const TA_REQ(lock_) {
         auto extent = --slice_map_.upper_bound(vslice);
         return extent.IsValid() && extent->get(vslice) != PSLICE_UNALLOCATED;
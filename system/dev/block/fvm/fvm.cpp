@@ -57,8 +57,8 @@ bool SliceExtent::Merge(const SliceExtent& other) {
 }
 
 VPartitionManager::VPartitionManager(zx_device_t* parent, const block_info_t& info)
-    : ManagerDeviceType(parent), info_(info), metadata_(nullptr), metadata_size_(0),
-      slice_size_(0) {}
+    : ManagerDeviceType(parent), info_(info), metadata_(nullptr), free_slices_valid_(false),
+      metadata_size_(0), slice_size_(0) {}
 
 VPartitionManager::~VPartitionManager() = default;
 
@@ -211,6 +211,11 @@ zx_status_t VPartitionManager::Load() {
         metadata_ = fbl::move(mvmo_backup);
     }
 
+    if ((status = BuildFreeIndexLocked()) != ZX_OK) {
+        // Not fatal; allocations fall back to scanning the slice table.
+        fprintf(stderr, "fvm: Failed to build free slice index: %d\n", status);
+    }
+
     // Begin initializing the underlying partitions
     DdkMakeVisible();
     auto_detach.cancel();
@@ -306,8 +311,97 @@ zx_status_t VPartitionManager::FindFreeVPartEntryLocked(size_t* out) const {
     return ZX_ERR_NO_SPACE;
 }
 
-zx_status_t VPartitionManager::FindFreeSliceLocked(size_t* out, size_t hint) const {
+zx_status_t VPartitionManager::BuildFreeIndexLocked() {
+    free_slices_.ClearAll();
+    free_slices_valid_ = false;
     const size_t maxSlices = UsableSlicesCount(DiskSize(), SliceSize());
+    size_t run_start = 0;
+    for (size_t i = 1; i <= maxSlices + 1; i++) {
+        bool free = (i <= maxSlices) && (GetSliceEntryLocked(i)->vpart == FVM_SLICE_FREE);
+        if (free && run_start == 0) {
+            run_start = i;
+        } else if (!free && run_start != 0) {
+            zx_status_t status;
+            if ((status = free_slices_.Set(run_start, i)) != ZX_OK) {
+                free_slices_.ClearAll();
+                return status;
+            }
+            run_start = 0;
+        }
+    }
+    free_slices_valid_ = true;
+    return ZX_OK;
+}
+
+bool VPartitionManager::IsFreeRunLocked(size_t start, size_t count) const {
+    const size_t maxSlices = UsableSlicesCount(DiskSize(), SliceSize());
+    if (start == 0 || start + count > maxSlices + 1) {
+        return false;
+    }
+    for (size_t i = start; i < start + count; i++) {
+        if (GetSliceEntryLocked(i)->vpart != FVM_SLICE_FREE) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void VPartitionManager::AllocateSliceEntryLocked(size_t pslice, size_t vpart, size_t vslice) {
+    slice_entry_t* alloc_entry = GetSliceEntryLocked(pslice);
+    ZX_DEBUG_ASSERT(alloc_entry->vpart == FVM_SLICE_FREE);
+    ZX_DEBUG_ASSERT(vpart <= VPART_MAX);
+    ZX_DEBUG_ASSERT(vslice <= VSLICE_MAX);
+    alloc_entry->vpart = vpart & VPART_MAX;
+    alloc_entry->vslice = vslice & VSLICE_MAX;
+    if (free_slices_valid_ && free_slices_.Clear(pslice, pslice + 1) != ZX_OK) {
+        free_slices_valid_ = false;
+    }
+}
+
+void VPartitionManager::FreeSliceEntryLocked(size_t pslice) {
+    GetSliceEntryLocked(pslice)->vpart = FVM_SLICE_FREE;
+    if (free_slices_valid_ && free_slices_.Set(pslice, pslice + 1) != ZX_OK) {
+        free_slices_valid_ = false;
+    }
+}
+
+zx_status_t VPartitionManager::FindFreeRunLocked(size_t count, size_t* out_start,
+                                                 size_t* out_length) const {
+    ZX_DEBUG_ASSERT(free_slices_valid_);
+    const bitmap::RleBitmapElement* best = nullptr;
+    for (const auto& run : free_slices_) {
+        if (best == nullptr) {
+            best = &run;
+        } else if (best->bitlen < count) {
+            // Nothing fits yet; prefer the longest run seen so far.
+            if (run.bitlen > best->bitlen) {
+                best = &run;
+            }
+        } else if (run.bitlen >= count && run.bitlen < best->bitlen) {
+            // Prefer the tightest fit, leaving larger runs for growth.
+            best = &run;
+        }
+    }
+    if (best == nullptr) {
+        return ZX_ERR_NO_SPACE;
+    }
+    *out_start = best->bitoff;
+    *out_length = best->bitlen;
+    return ZX_OK;
+}
+
+zx_status_t VPartitionManager::FindFreeSliceLocked(size_t* out, size_t hint,
+                                                   size_t count) const {
+    const size_t maxSlices = UsableSlicesCount(DiskSize(), SliceSize());
+    if (free_slices_valid_) {
+        if (hint != 0 && hint <= maxSlices && free_slices_.Get(hint, hint + 1)) {
+            *out = hint;
+            return ZX_OK;
+        }
+        size_t length;
+        return FindFreeRunLocked(count, out, &length);
+    }
+
     hint = fbl::max(hint, 1lu);
     for (size_t i = hint; i <= maxSlices; i++) {
         if (GetSliceEntryLocked(i)->vpart == 0) {
@@ -336,14 +430,28 @@ zx_status_t VPartitionManager::AllocateSlicesLocked(VPartition* vp, size_t vslic
         return ZX_ERR_INVALID_ARGS;
     }
 
+    if (!free_slices_valid_) {
+        // Opportunistically repair the free slice index; on failure, we fall
+        // back to scanning the allocation table.
+        BuildFreeIndexLocked();
+    }
+
     zx_status_t status = ZX_OK;
-    size_t hint = 0;
 
     {
         fbl::AutoLock lock(&vp->lock_);
         if (vp->IsKilledLocked()) {
             return ZX_ERR_BAD_STATE;
         }
+
+        // Keep the new slices physically contiguous with the slice backing
+        // the preceding vslice, if there is one.
+        size_t hint = 0;
+        if (vslice_start > 0) {
+            uint32_t prev = vp->SliceGetLocked(vslice_start - 1);
+            hint = (prev == PSLICE_UNALLOCATED) ? 0 : prev + 1;
+        }
+
         for (size_t i = 0; i < count; i++) {
             size_t pslice;
             auto vslice = vslice_start + i;
@@ -351,22 +459,17 @@ zx_status_t VPartitionManager::AllocateSlicesLocked(VPartition* vp, size_t vslic
                 status = ZX_ERR_INVALID_ARGS;
             }
             if ((status != ZX_OK) ||
-                ((status = FindFreeSliceLocked(&pslice, hint)) != ZX_OK) ||
+                ((status = FindFreeSliceLocked(&pslice, hint, count - i)) != ZX_OK) ||
                 ((status = vp->SliceSetLocked(vslice, static_cast<uint32_t>(pslice)) != ZX_OK))) {
                 for (int j = static_cast<int>(i - 1); j >= 0; j--) {
                     vslice = vslice_start + j;
-                    GetSliceEntryLocked(vp->SliceGetLocked(vslice))->vpart = PSLICE_UNALLOCATED;
+                    FreeSliceEntryLocked(vp->SliceGetLocked(vslice));
                     vp->SliceFreeLocked(vslice);
                 }
 
                 return status;
             }
-            slice_entry_t* alloc_entry = GetSliceEntryLocked(pslice);
-            auto vpart = vp->GetEntryIndex();
-            ZX_DEBUG_ASSERT(vpart <= VPART_MAX);
-            ZX_DEBUG_ASSERT(vslice <= VSLICE_MAX);
-            alloc_entry->vpart = vpart & VPART_MAX;
-            alloc_entry->vslice = vslice & VSLICE_MAX;
+            AllocateSliceEntryLocked(pslice, vp->GetEntryIndex(), vslice);
             hint = pslice + 1;
         }
     }
@@ -377,7 +480,7 @@ zx_status_t VPartitionManager::AllocateSlicesLocked(VPartition* vp, size_t vslic
         fbl::AutoLock lock(&vp->lock_);
         for (int j = static_cast<int>(count - 1); j >= 0; j--) {
             auto vslice = vslice_start + j;
-            GetSliceEntryLocked(vp->SliceGetLocked(vslice))->vpart = PSLICE_UNALLOCATED;
+            FreeSliceEntryLocked(vp->SliceGetLocked(vslice));
             vp->SliceFreeLocked(vslice);
         }
     }
@@ -449,7 +552,7 @@ zx_status_t VPartitionManager::FreeSlicesLocked(VPartition* vp, size_t vslice_st
             // Special case: Freeing entire VPartition
             for (auto extent = vp->ExtentBegin(); extent.IsValid(); extent = vp->ExtentBegin()) {
                 for (size_t i = extent->start(); i < extent->end(); i++) {
-                    GetSliceEntryLocked(vp->SliceGetLocked(i))->vpart = PSLICE_UNALLOCATED;
+                    FreeSliceEntryLocked(vp->SliceGetLocked(i));
                 }
                 vp->ExtentDestroyLocked(extent->start());
             }
@@ -475,7 +578,7 @@ zx_status_t VPartitionManager::FreeSlicesLocked(VPartition* vp, size_t vslice_st
                     } else {
                         ZX_ASSERT(vp->SliceFreeLocked(vslice));
                     }
-                    GetSliceEntryLocked(pslice)->vpart = 0;
+                    FreeSliceEntryLocked(pslice);
                     freed_something = true;
                 }
             }
@@ -488,6 +591,129 @@ zx_status_t VPartitionManager::FreeSlicesLocked(VPartition* vp, size_t vslice_st
     return WriteFvmLocked();
 }
 
+zx_status_t VPartitionManager::CopySliceLocked(size_t src, size_t dst, const MappedVmo* vmo) {
+    const size_t disk_size = DiskSize();
+    const size_t slice_size = SliceSize();
+    const size_t chunk = vmo->GetSize();
+    for (size_t off = 0; off < slice_size; off += chunk) {
+        const size_t length = fbl::min(chunk, slice_size - off);
+        iotxn_t* txn = nullptr;
+        zx_status_t status = iotxn_alloc_vmo(&txn, IOTXN_ALLOC_POOL, vmo->GetVmo(), 0, length);
+        if (status != ZX_OK) {
+            return status;
+        }
+        txn->opcode = IOTXN_OP_READ;
+        txn->offset = SliceStart(disk_size, slice_size, src) + off;
+        txn->length = length;
+        iotxn_synchronous_op(parent(), txn);
+        if (txn->status == ZX_OK) {
+            txn->opcode = IOTXN_OP_WRITE;
+            txn->offset = SliceStart(disk_size, slice_size, dst) + off;
+            txn->length = length;
+            iotxn_synchronous_op(parent(), txn);
+        }
+        status = txn->status;
+        iotxn_release(txn);
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
+}
+
+zx_status_t VPartitionManager::Defragment(VPartition* vp) {
+    constexpr size_t kMaxCopyChunk = 1 << 20;
+
+    fbl::unique_ptr<MappedVmo> buffer;
+    zx_status_t status = MappedVmo::Create(fbl::min(kMaxCopyChunk, SliceSize()),
+                                           "fvm-migrate", &buffer);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    fbl::AutoLock lock(&lock_);
+
+    size_t vslice = 0;
+    while (true) {
+        // Only one extent is migrated at a time, so the partition lock is
+        // dropped (and I/O may proceed) between extents.
+        fbl::AutoLock vlock(&vp->lock_);
+        if (vp->IsKilledLocked()) {
+            return ZX_ERR_BAD_STATE;
+        }
+
+        auto extent = vp->ExtentBegin();
+        while (extent.IsValid() && (extent->end() <= vslice || extent->IsPhysicallyContiguous())) {
+            ++extent;
+        }
+        if (!extent.IsValid()) {
+            return ZX_OK;
+        }
+        const size_t start = extent->start();
+        const size_t length = extent->size();
+        vslice = extent->end();
+
+        // Earlier moves in this pass changed the free slices; make sure the
+        // index reflects them before picking a destination, and check the
+        // chosen run against the allocation table itself.
+        if (!free_slices_valid_ && (status = BuildFreeIndexLocked()) != ZX_OK) {
+            return status;
+        }
+        size_t dst;
+        size_t run_length;
+        if (FindFreeRunLocked(length, &dst, &run_length) != ZX_OK || run_length < length) {
+            // Not enough contiguous free space; leave this extent alone.
+            continue;
+        }
+        if (!IsFreeRunLocked(dst, length)) {
+            if ((status = BuildFreeIndexLocked()) != ZX_OK) {
+                return status;
+            }
+            if (FindFreeRunLocked(length, &dst, &run_length) != ZX_OK || run_length < length ||
+                !IsFreeRunLocked(dst, length)) {
+                continue;
+            }
+        }
+
+        // Flush in-flight iotxns, so nothing can still target the old slices
+        // once they are released.
+        status = device_ioctl(parent(), IOCTL_DEVICE_SYNC, nullptr, 0, nullptr, 0, nullptr);
+        if (status != ZX_OK) {
+            return status;
+        }
+
+        fbl::AllocChecker ac;
+        fbl::Vector<uint32_t> old_pslices;
+        old_pslices.reserve(length, &ac);
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+        for (size_t i = 0; i < length; i++) {
+            old_pslices.push_back(vp->SliceGetLocked(start + i));
+            if ((status = CopySliceLocked(old_pslices[i], dst + i, buffer.get())) != ZX_OK) {
+                return status;
+            }
+        }
+
+        // The data exists in both locations; switching the allocation table
+        // over happens atomically with the metadata write.
+        for (size_t i = 0; i < length; i++) {
+            FreeSliceEntryLocked(old_pslices[i]);
+            AllocateSliceEntryLocked(dst + i, vp->GetEntryIndex(), start + i);
+            vp->SliceMoveLocked(start + i, static_cast<uint32_t>(dst + i));
+        }
+        if ((status = WriteFvmLocked()) != ZX_OK) {
+            // The on-disk metadata still refers to the old slices.
+            for (size_t i = 0; i < length; i++) {
+                FreeSliceEntryLocked(dst + i);
+                AllocateSliceEntryLocked(old_pslices[i], vp->GetEntryIndex(), start + i);
+                vp->SliceMoveLocked(start + i, old_pslices[i]);
+            }
+            return status;
+        }
+    }
+}
+
 // Device protocol (FVM)
 
 zx_status_t VPartitionManager::DdkIoctl(uint32_t op, const void* cmd,
@@ -838,6 +1064,9 @@ zx_status_t VPartition::DdkIoctl(uint32_t op, const void* cmd, size_t cmdlen,
     case IOCTL_BLOCK_FVM_DESTROY: {
         return mgr_->FreeSlices(this, 0, mgr_->VSliceMax());
     }
+    case IOCTL_BLOCK_FVM_DEFRAG: {
+        return mgr_->Defragment(this);
+    }
     default:
         return ZX_ERR_NOT_SUPPORTED;
     }
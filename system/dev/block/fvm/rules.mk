@@ -13,6 +13,7 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/fvm.cpp \
 
 MODULE_STATIC_LIBS := \
+    system/ulib/bitmap \
     system/ulib/ddk \
     system/ulib/ddktl \
     system/ulib/fs \
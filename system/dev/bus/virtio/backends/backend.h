@@ -27,7 +27,8 @@ public:
     virtual zx_status_t Bind() = 0;
     virtual void Unbind(){};
 
-    // Returns true if the specified feature bit is set
+    // Returns true if the specified feature bit is set. Features are given as
+    // bit numbers (e.g. VIRTIO_F_VERSION_1), not masks.
     virtual bool ReadFeature(uint32_t bit) = 0;
     // Does a Driver -> Device acknowledgement of a feature bit
     virtual void SetFeature(uint32_t bit) = 0;
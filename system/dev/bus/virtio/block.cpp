@@ -6,6 +6,7 @@
 
 #include <ddk/debug.h>
 #include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
 #include <fbl/auto_lock.h>
 #include <inttypes.h>
 #include <pretty/hexdump.h>
@@ -14,6 +15,7 @@
 #include <string.h>
 #include <sys/param.h>
 #include <zircon/compiler.h>
+#include <zircon/syscalls.h>
 
 #include "trace.h"
 #include "utils.h"
@@ -60,7 +62,10 @@ void BlockDevice::GetInfo(block_info_t* info) {
     memset(info, 0, sizeof(*info));
     info->block_size = GetBlockSize();
     info->block_count = GetSize() / GetBlockSize();
-    info->max_transfer_size = (uint32_t)(PAGE_SIZE * (ring_size - 2));
+    // Each transfer needs a descriptor for the request header and one for the
+    // response, in addition to one per page of data.
+    size_t max_descs = indirect_desc_ ? indirect_desc_count : ring_size;
+    info->max_transfer_size = (uint32_t)(PAGE_SIZE * (max_descs - 2));
 }
 
 zx_status_t BlockDevice::virtio_block_ioctl(void* ctx, uint32_t op, const void* in_buf, size_t in_len,
@@ -119,31 +124,38 @@ zx_status_t BlockDevice::Init() {
     // ack and set the driver status bit
     DriverStatusAck();
 
-    // XXX check features bits and ack/nak them
-
-    // allocate the main vring
-    auto err = vring_.Init(0, ring_size);
-    if (err < 0) {
-        zxlogf(ERROR, "failed to allocate vring\n");
-        return err;
+    // negotiate the ring features we know how to use
+    if (DeviceFeatureSupported(VIRTIO_F_RING_INDIRECT_DESC)) {
+        DriverFeatureAck(VIRTIO_F_RING_INDIRECT_DESC);
+        indirect_desc_ = true;
     }
-
-    // allocate a queue of block requests
-    size_t size = sizeof(virtio_blk_req_t) * blk_req_count + sizeof(uint8_t) * blk_req_count;
-
-    zx_status_t r = map_contiguous_memory(size, (uintptr_t*)&blk_req_, &blk_req_pa_);
-    if (r < 0) {
-        zxlogf(ERROR, "cannot alloc blk_req buffers %d\n", r);
-        return r;
+    if (DeviceFeatureSupported(VIRTIO_F_RING_EVENT_IDX)) {
+        DriverFeatureAck(VIRTIO_F_RING_EVENT_IDX);
+        event_idx_ = true;
+    }
+    const uint32_t mq_feature = __builtin_ctz(VIRTIO_BLK_F_MQ);
+    if (DeviceFeatureSupported(mq_feature)) {
+        DriverFeatureAck(mq_feature);
+        // One queue per CPU, bounded by what the device offers.
+        uint32_t cpus = zx_system_get_num_cpus();
+        num_queues_ = static_cast<uint16_t>(fbl::min<uint32_t>(
+            fbl::min<uint32_t>(config_.num_queues, cpus), max_queues));
+        num_queues_ = fbl::max<uint16_t>(num_queues_, 1);
+    }
+    if (DeviceStatusFeaturesOk() != ZX_OK) {
+        zxlogf(ERROR, "%s: feature negotiation failed\n", tag());
+        return ZX_ERR_NOT_SUPPORTED;
     }
 
-    LTRACEF("allocated blk request at %p, physical address %#" PRIxPTR "\n", blk_req_, blk_req_pa_);
-
-    // responses are 32 words at the end of the allocated block
-    blk_res_pa_ = blk_req_pa_ + sizeof(virtio_blk_req_t) * blk_req_count;
-    blk_res_ = (uint8_t*)((uintptr_t)blk_req_ + sizeof(virtio_blk_req_t) * blk_req_count);
+    zxlogf(TRACE, "%s: %u queue(s), indirect %d, event idx %d\n", tag(), num_queues_,
+           indirect_desc_, event_idx_);
 
-    LTRACEF("allocated blk responses at %p, physical address %#" PRIxPTR "\n", blk_res_, blk_res_pa_);
+    for (uint16_t i = 0; i < num_queues_; i++) {
+        zx_status_t r = InitQueue(&queues_[i], i);
+        if (r != ZX_OK) {
+            return r;
+        }
+    }
 
     // start the interrupt thread
     StartIrqThread();
@@ -173,13 +185,80 @@ zx_status_t BlockDevice::Init() {
     return ZX_OK;
 }
 
+zx_status_t BlockDevice::InitQueue(RequestQueue* queue, uint16_t index) {
+    fbl::AllocChecker ac;
+    queue->vring.reset(new (&ac) Ring(this));
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    // allocate the vring
+    auto err = queue->vring->Init(index, ring_size);
+    if (err < 0) {
+        zxlogf(ERROR, "failed to allocate vring %u\n", index);
+        return err;
+    }
+    queue->vring->SetEventIdx(event_idx_);
+
+    // allocate a queue of block requests
+    size_t size = sizeof(virtio_blk_req_t) * blk_req_count + sizeof(uint8_t) * blk_req_count;
+
+    zx_status_t r = map_contiguous_memory(size, (uintptr_t*)&queue->blk_req, &queue->blk_req_pa);
+    if (r < 0) {
+        zxlogf(ERROR, "cannot alloc blk_req buffers %d\n", r);
+        return r;
+    }
+
+    LTRACEF("allocated blk request at %p, physical address %#" PRIxPTR "\n",
+            queue->blk_req, queue->blk_req_pa);
+
+    // responses are 32 words at the end of the allocated block
+    queue->blk_res_pa = queue->blk_req_pa + sizeof(virtio_blk_req_t) * blk_req_count;
+    queue->blk_res = (uint8_t*)((uintptr_t)queue->blk_req +
+                                sizeof(virtio_blk_req_t) * blk_req_count);
+
+    LTRACEF("allocated blk responses at %p, physical address %#" PRIxPTR "\n",
+            queue->blk_res, queue->blk_res_pa);
+
+    if (indirect_desc_) {
+        size = sizeof(vring_desc) * indirect_desc_count * blk_req_count;
+        r = map_contiguous_memory(size, (uintptr_t*)&queue->indirect, &queue->indirect_pa);
+        if (r < 0) {
+            zxlogf(ERROR, "cannot alloc indirect descriptor tables %d\n", r);
+            return r;
+        }
+    }
+
+    return ZX_OK;
+}
+
+BlockDevice::RequestQueue* BlockDevice::SelectQueue() {
+    uintptr_t self = reinterpret_cast<uintptr_t>(thrd_current());
+    // Thread structures are at least cache line aligned; skip the low bits.
+    return &queues_[(self >> 6) % num_queues_];
+}
+
 void BlockDevice::IrqRingUpdate() {
     LTRACE_ENTRY;
 
+    // All queues share the device's interrupt.
+    for (uint16_t i = 0; i < num_queues_; i++) {
+        IrqQueueUpdate(&queues_[i]);
+    }
+}
+
+void BlockDevice::IrqQueueUpdate(RequestQueue* queue) {
+    // Completed iotxns are collected here and completed once the queue lock
+    // has been dropped, since completion callbacks may queue new iotxns.
+    list_node completed = LIST_INITIAL_VALUE(completed);
+
+    fbl::AutoLock lock(&queue->lock);
+    Ring* vring = queue->vring.get();
+
     // parse our descriptor chain, add back to the free queue
-    auto free_chain = [this](vring_used_elem* used_elem) {
+    auto free_chain = [queue, vring, &completed](vring_used_elem* used_elem) {
         uint32_t i = (uint16_t)used_elem->id;
-        struct vring_desc* desc = vring_.DescFromIndex((uint16_t)i);
+        struct vring_desc* desc = vring->DescFromIndex((uint16_t)i);
         auto head_desc = desc; // save the first element
         for (;;) {
             int next;
@@ -191,29 +270,35 @@ void BlockDevice::IrqRingUpdate() {
                 next = -1;
             }
 
-            vring_.FreeDesc((uint16_t)i);
+            vring->FreeDesc((uint16_t)i);
 
             if (next < 0)
                 break;
             i = next;
-            desc = vring_.DescFromIndex((uint16_t)i);
+            desc = vring->DescFromIndex((uint16_t)i);
         }
 
         // search our pending txn list to see if this completes it
         iotxn_t* txn;
-        list_for_every_entry (&iotxn_list, txn, iotxn_t, node) {
+        list_for_every_entry (&queue->iotxn_list, txn, iotxn_t, node) {
             if (txn->context == head_desc) {
                 LTRACEF("completes txn %p\n", txn);
-                free_blk_req((unsigned int)txn->extra[1]);
+                queue->free_blk_req((unsigned int)txn->extra[1]);
                 list_delete(&txn->node);
-                iotxn_complete(txn, ZX_OK, txn->length);
+                list_add_tail(&completed, &txn->node);
                 break;
             }
         }
     };
 
     // tell the ring to find free chains and hand it back to our lambda
-    vring_.IrqRingUpdate(free_chain);
+    vring->IrqRingUpdate(free_chain);
+    lock.release();
+
+    iotxn_t* txn;
+    while ((txn = list_remove_head_type(&completed, iotxn_t, node)) != nullptr) {
+        iotxn_complete(txn, ZX_OK, txn->length);
+    }
 }
 
 void BlockDevice::IrqConfigChange() {
@@ -259,8 +344,6 @@ static void ScatterGatherHelper(const iotxn_t* txn, callback callback_new_run) {
 void BlockDevice::QueueReadWriteTxn(iotxn_t* txn) {
     LTRACEF("txn %p, pflags %#x\n", txn, txn->pflags);
 
-    fbl::AutoLock lock(&lock_);
-
     bool write = (txn->opcode == IOTXN_OP_WRITE);
 
     // offset must be aligned to block size
@@ -288,15 +371,18 @@ void BlockDevice::QueueReadWriteTxn(iotxn_t* txn) {
         return;
     }
 
+    RequestQueue* queue = SelectQueue();
+    fbl::AutoLock lock(&queue->lock);
+
     // allocate and start filling out a block request
-    auto index = alloc_blk_req();
+    auto index = queue->alloc_blk_req();
     if (index >= blk_req_count) {
         TRACEF("too many block requests queued (%zu)!\n", index);
         iotxn_complete(txn, ZX_ERR_NO_RESOURCES, 0);
         return;
     }
 
-    auto req = &blk_req_[index];
+    auto req = &queue->blk_req[index];
     req->type = write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
     req->ioprio = 0;
     req->sector = txn->offset / 512;
@@ -331,30 +417,69 @@ void BlockDevice::QueueReadWriteTxn(iotxn_t* txn) {
     LTRACEF("run count %lu\n", run_count);
     assert(run_count > 0);
 
+    Ring* vring = queue->vring.get();
+
     /* put together a transfer */
     uint16_t i;
-    auto desc = vring_.AllocDescChain((uint16_t)(2u + run_count), &i);
-    if (!desc) {
-        TRACEF("failed to allocate descriptor chain of length %zu\n", 2u + run_count);
-        // TODO: handle this scenario by requeing the transfer in smaller runs
-        iotxn_complete(txn, ZX_ERR_NO_RESOURCES, 0);
-        return;
+    vring_desc* desc;
+    vring_desc* head;
+    vring_desc* table = nullptr;
+    if (indirect_desc_) {
+        // The whole transfer is described by this request's indirect table,
+        // consuming only a single descriptor in the ring.
+        if (2u + run_count > indirect_desc_count) {
+            TRACEF("transfer of %zu runs too large for indirect table\n", run_count);
+            queue->free_blk_req(index);
+            iotxn_complete(txn, ZX_ERR_OUT_OF_RANGE, 0);
+            return;
+        }
+        head = vring->AllocDescChain(1, &i);
+        if (!head) {
+            TRACEF("failed to allocate indirect descriptor\n");
+            queue->free_blk_req(index);
+            iotxn_complete(txn, ZX_ERR_NO_RESOURCES, 0);
+            return;
+        }
+        table = &queue->indirect[index * indirect_desc_count];
+        size_t table_len = 2u + run_count;
+        for (size_t j = 0; j < table_len; j++) {
+            table[j].next = (uint16_t)(j + 1);
+        }
+        head->addr = queue->indirect_pa + index * indirect_desc_count * sizeof(vring_desc);
+        head->len = (uint32_t)(table_len * sizeof(vring_desc));
+        head->flags = VRING_DESC_F_INDIRECT;
+        desc = table;
+    } else {
+        head = vring->AllocDescChain((uint16_t)(2u + run_count), &i);
+        if (!head) {
+            TRACEF("failed to allocate descriptor chain of length %zu\n", 2u + run_count);
+            // TODO: handle this scenario by requeing the transfer in smaller runs
+            queue->free_blk_req(index);
+            iotxn_complete(txn, ZX_ERR_NO_RESOURCES, 0);
+            return;
+        }
+        desc = head;
     }
 
-    LTRACEF("after alloc chain desc %p, i %u\n", desc, i);
+    LTRACEF("after alloc chain desc %p, i %u\n", head, i);
 
     /* point the iotxn at this head descriptor */
-    txn->context = desc;
+    txn->context = head;
+
+    // Direct chains are walked through the ring, indirect ones through the table.
+    auto next_desc = [vring, table](vring_desc* d) {
+        return table ? &table[d->next] : vring->DescFromIndex(d->next);
+    };
 
     /* set up the descriptor pointing to the head */
-    desc->addr = blk_req_pa_ + index * sizeof(virtio_blk_req_t);
+    desc->addr = queue->blk_req_pa + index * sizeof(virtio_blk_req_t);
     desc->len = sizeof(virtio_blk_req_t);
     desc->flags = VRING_DESC_F_NEXT;
     LTRACE_DO(virtio_dump_desc(desc));
     {
-        auto new_run_callback = [this, write, &desc](uint64_t start, uint64_t len) {
+        auto new_run_callback = [write, &desc, &next_desc](uint64_t start, uint64_t len) {
             /* set up the descriptor pointing to the buffer */
-            desc = vring_.DescFromIndex(desc->next);
+            desc = next_desc(desc);
 
             desc->addr = start;
             desc->len = (uint32_t)len;
@@ -370,20 +495,20 @@ void BlockDevice::QueueReadWriteTxn(iotxn_t* txn) {
     LTRACE_DO(virtio_dump_desc(desc));
 
     /* set up the descriptor pointing to the response */
-    desc = vring_.DescFromIndex(desc->next);
-    desc->addr = blk_res_pa_ + index;
+    desc = next_desc(desc);
+    desc->addr = queue->blk_res_pa + index;
     desc->len = 1;
     desc->flags = VRING_DESC_F_WRITE;
     LTRACE_DO(virtio_dump_desc(desc));
 
     // save the iotxn in a list
-    list_add_tail(&iotxn_list, &txn->node);
+    list_add_tail(&queue->iotxn_list, &txn->node);
 
     /* submit the transfer */
-    vring_.SubmitChain(i);
+    vring->SubmitChain(i);
 
     /* kick it off */
-    vring_.Kick();
+    vring->Kick();
 }
 
 } // namespace virtio
@@ -10,6 +10,7 @@
 #include <zircon/compiler.h>
 
 #include "backends/backend.h"
+#include <fbl/unique_ptr.h>
 #include <virtio/block.h>
 #include <zircon/device/block.h>
 
@@ -43,40 +44,74 @@ private:
 
     void QueueReadWriteTxn(iotxn_t* txn);
 
-    // the main virtio ring
-    Ring vring_ = {this};
-
     static const uint16_t ring_size = 128; // 128 matches legacy pci
 
-    // saved block device configuration out of the pci config BAR
-    virtio_blk_config_t config_ = {};
-
     // a queue of block request/responses
     static const size_t blk_req_count = 32;
 
-    zx_paddr_t blk_req_pa_ = 0;
-    virtio_blk_req_t* blk_req_ = nullptr;
+    // Number of descriptors in each request's indirect descriptor table; one
+    // page worth of descriptors.
+    static const size_t indirect_desc_count = PAGE_SIZE / sizeof(vring_desc);
+
+    // Upper bound on the number of virtqueues used with VIRTIO_BLK_F_MQ.
+    static const uint16_t max_queues = 8;
+
+    // A virtqueue along with the request buffers and pending iotxns which
+    // belong to it. Each queue is protected by its own lock, so submissions
+    // from different threads do not contend unless they map to the same queue.
+    struct RequestQueue {
+        fbl::Mutex lock;
+
+        fbl::unique_ptr<Ring> vring;
+
+        zx_paddr_t blk_req_pa = 0;
+        virtio_blk_req_t* blk_req = nullptr;
 
-    zx_paddr_t blk_res_pa_ = 0;
-    uint8_t* blk_res_ = nullptr;
+        zx_paddr_t blk_res_pa = 0;
+        uint8_t* blk_res = nullptr;
 
-    uint32_t blk_req_bitmap_ = 0;
-    static_assert(blk_req_count <= sizeof(blk_req_bitmap_) * CHAR_BIT, "");
+        // blk_req_count indirect tables of indirect_desc_count descriptors,
+        // one per request slot. Only allocated if indirect descriptors were
+        // negotiated.
+        zx_paddr_t indirect_pa = 0;
+        vring_desc* indirect = nullptr;
 
-    size_t alloc_blk_req() {
-        size_t i = 0;
-        if (blk_req_bitmap_ != 0)
-            i = sizeof(blk_req_bitmap_) * CHAR_BIT - __builtin_clz(blk_req_bitmap_);
-        blk_req_bitmap_ |= (1 << i);
-        return i;
-    }
+        uint32_t blk_req_bitmap = 0;
+
+        size_t alloc_blk_req() {
+            size_t i = 0;
+            if (blk_req_bitmap != 0)
+                i = sizeof(blk_req_bitmap) * CHAR_BIT - __builtin_clz(blk_req_bitmap);
+            blk_req_bitmap |= (1 << i);
+            return i;
+        }
+
+        void free_blk_req(size_t i) {
+            blk_req_bitmap &= ~(1 << i);
+        }
+
+        // pending iotxns
+        list_node iotxn_list = LIST_INITIAL_VALUE(iotxn_list);
+    };
+    static_assert(blk_req_count <= sizeof(RequestQueue::blk_req_bitmap) * CHAR_BIT, "");
+
+    zx_status_t InitQueue(RequestQueue* queue, uint16_t index);
+    void IrqQueueUpdate(RequestQueue* queue);
+
+    // Pick the queue for a submission. Userspace drivers cannot learn which
+    // CPU they are running on, so queues are assigned per submitting thread,
+    // which gives the same locality when submitters are spread across CPUs.
+    RequestQueue* SelectQueue();
+
+    // saved block device configuration out of the pci config BAR
+    virtio_blk_config_t config_ = {};
 
-    void free_blk_req(size_t i) {
-        blk_req_bitmap_ &= ~(1 << i);
-    }
+    // negotiated features
+    bool indirect_desc_ = false;
+    bool event_idx_ = false;
 
-    // pending iotxns
-    list_node iotxn_list = LIST_INITIAL_VALUE(iotxn_list);
+    uint16_t num_queues_ = 1;
+    RequestQueue queues_[max_queues];
 };
 
 } // namespace virtio
@@ -33,20 +33,42 @@ namespace virtio {
 
 namespace {
 
-// Specifies how many packets can fit in each of the receive and transmit
-// backlogs.
-const size_t kBacklog = 32;
+// Upper bound on how many packets can fit in each of the receive and transmit
+// backlogs. The actual backlog is the largest power of two up to this that
+// both virtqueues support.
+const uint16_t kMaxBacklog = 256;
 
 // Specifies the maximum transfer unit we support and the maximum layer 1
 // Ethernet packet header length.
 const size_t kVirtioMtu = 1500;
 const size_t kL1EthHdrLen = 26;
+const size_t kMaxFrameLen = kL1EthHdrLen + kVirtioMtu;
 
 // Other constants determined by the values above and the memory architecture.
-// The goal here is to allocate single-page I/O buffers.
-const size_t kFrameSize = sizeof(virtio_net_hdr_t) + kL1EthHdrLen + kVirtioMtu;
+// The goal here is to allocate single-page I/O buffers. Frames leave room for
+// the larger header used with VIRTIO_NET_F_MRG_RXBUF.
+const size_t kFrameSize = sizeof(virtio_net_hdr_mrg_rxbuf_t) + kMaxFrameLen;
 const size_t kFramesInBuf = PAGE_SIZE / kFrameSize;
-const size_t kNumIoBufs = fbl::round_up(kBacklog * 2, kFramesInBuf) / kFramesInBuf;
+
+// Segmentation offload buffers; TSO frames are bounded by the 16-bit netbuf
+// length.
+const size_t kNumTsoBufs = 8;
+const size_t kMaxTsoLen = UINT16_MAX;
+const size_t kTsoBufSize = sizeof(virtio_net_hdr_mrg_rxbuf_t) + kMaxTsoLen;
+const uint8_t kNoTsoSlot = UINT8_MAX;
+static_assert(kNumTsoBufs < sizeof(uint32_t) * CHAR_BIT, "tso_free_ bitmap too small");
+
+// Header fields parsed for checksum and segmentation offload.
+const size_t kEthHdrLen = 14;
+const uint16_t kEthTypeIpv4 = 0x0800;
+const uint16_t kEthTypeIpv6 = 0x86dd;
+const size_t kIpv4MinHdrLen = 20;
+const size_t kIpv6HdrLen = 40;
+const size_t kTcpMinHdrLen = 20;
+const uint8_t kIpProtoTcp = 6;
+const uint8_t kIpProtoUdp = 17;
+const uint16_t kTcpCsumOffset = 16;
+const uint16_t kUdpCsumOffset = 6;
 
 const uint16_t kRxId = 0u;
 const uint16_t kTxId = 1u;
@@ -117,62 +139,45 @@ ethmac_protocol_ops_t kProtoOps = {
 };
 
 // I/O buffer helpers
-zx_status_t InitBuffers(fbl::unique_ptr<io_buffer_t[]>* out) {
-    zx_status_t rc;
-    fbl::AllocChecker ac;
-    fbl::unique_ptr<io_buffer_t[]> bufs(new (&ac) io_buffer_t[kNumIoBufs]);
-    if (!ac.check()) {
-        zxlogf(ERROR, "out of memory!\n");
-        return ZX_ERR_NO_MEMORY;
-    }
-    memset(bufs.get(), 0, sizeof(io_buffer_t) * kNumIoBufs);
-    size_t buf_size = kFrameSize * kFramesInBuf;
-    for (uint16_t id = 0; id < kNumIoBufs; ++id) {
-        if ((rc = io_buffer_init(&bufs[id], buf_size, IO_BUFFER_RW | IO_BUFFER_CONTIG)) != ZX_OK) {
-            zxlogf(ERROR, "failed to allocate I/O buffers: %s\n", zx_status_get_string(rc));
-            return rc;
-        }
-    }
-    *out = fbl::move(bufs);
-    return ZX_OK;
-}
-
-void ReleaseBuffers(fbl::unique_ptr<io_buffer_t[]> bufs) {
-    if (!bufs) {
+void ReleaseIoBuffers(fbl::unique_ptr<io_buffer_t[]>* bufs, size_t count) {
+    if (!*bufs) {
         return;
     }
-    for (size_t i = 0; i < kNumIoBufs; ++i) {
-        if (io_buffer_is_valid(&bufs[i])) {
-            io_buffer_release(&bufs[i]);
+    for (size_t i = 0; i < count; ++i) {
+        if (io_buffer_is_valid(&(*bufs)[i])) {
+            io_buffer_release(&(*bufs)[i]);
         }
     }
+    bufs->reset();
 }
 
-// Frame access helpers
-zx_off_t GetFrame(io_buffer_t** bufs, uint16_t ring_id, uint16_t desc_id) {
-    uint16_t i = static_cast<uint16_t>(desc_id + ring_id * kBacklog);
-    *bufs = &((*bufs)[i / kFramesInBuf]);
-    return (i % kFramesInBuf) * kFrameSize;
-}
-
-void* GetFrameVirt(io_buffer_t* bufs, uint16_t ring_id, uint16_t desc_id) {
-    zx_off_t offset = GetFrame(&bufs, ring_id, desc_id);
-    uintptr_t vaddr = reinterpret_cast<uintptr_t>(io_buffer_virt(bufs));
-    return reinterpret_cast<void*>(vaddr + offset);
+// Internet checksum helpers; see RFC 1071.
+uint16_t ReadBe16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
 }
 
-zx_paddr_t GetFramePhys(io_buffer_t* bufs, uint16_t ring_id, uint16_t desc_id) {
-    zx_off_t offset = GetFrame(&bufs, ring_id, desc_id);
-    return io_buffer_phys(bufs) + offset;
+void WriteBe16(uint8_t* p, uint16_t val) {
+    p[0] = static_cast<uint8_t>(val >> 8);
+    p[1] = static_cast<uint8_t>(val & 0xff);
 }
 
-virtio_net_hdr_t* GetFrameHdr(io_buffer_t* bufs, uint16_t ring_id, uint16_t desc_id) {
-    return reinterpret_cast<virtio_net_hdr_t*>(GetFrameVirt(bufs, ring_id, desc_id));
+// Adds |len| bytes at |data| to a ones' complement sum of 16-bit words. Frames
+// are at most 64KB, so the sum cannot overflow 32 bits.
+uint32_t ChecksumAdd(uint32_t sum, const uint8_t* data, size_t len) {
+    for (; len > 1; data += 2, len -= 2) {
+        sum += ReadBe16(data);
+    }
+    if (len) {
+        sum += static_cast<uint32_t>(data[0] << 8);
+    }
+    return sum;
 }
 
-uint8_t* GetFrameData(io_buffer_t* bufs, uint16_t ring_id, uint16_t desc_id) {
-    uintptr_t vaddr = reinterpret_cast<uintptr_t>(GetFrameHdr(bufs, ring_id, desc_id));
-    return reinterpret_cast<uint8_t*>(vaddr + sizeof(virtio_net_hdr_t));
+uint16_t ChecksumFold(uint32_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(sum);
 }
 
 } // namespace
@@ -186,6 +191,106 @@ EthernetDevice::~EthernetDevice() {
     LTRACE_ENTRY;
 }
 
+void EthernetDevice::NegotiateFeatures() {
+    auto negotiate = [this](uint32_t feature) {
+        uint32_t bit = __builtin_ctz(feature);
+        if (!DeviceFeatureSupported(bit)) {
+            return false;
+        }
+        DriverFeatureAck(bit);
+        return true;
+    };
+    mrg_rxbuf_ = negotiate(VIRTIO_NET_F_MRG_RXBUF);
+    guest_csum_ = negotiate(VIRTIO_NET_F_GUEST_CSUM);
+    host_csum_ = negotiate(VIRTIO_NET_F_CSUM);
+    // Segmentation offload depends on the device completing checksums.
+    if (host_csum_) {
+        host_tso4_ = negotiate(VIRTIO_NET_F_HOST_TSO4);
+        host_tso6_ = negotiate(VIRTIO_NET_F_HOST_TSO6);
+    }
+    // Transitional devices use the larger header in both directions once
+    // mergeable rx buffers are in use.
+    hdr_len_ = mrg_rxbuf_ ? sizeof(virtio_net_hdr_mrg_rxbuf_t) : sizeof(virtio_net_hdr_t);
+}
+
+zx_status_t EthernetDevice::InitBuffers() {
+    zx_status_t rc;
+    fbl::AllocChecker ac;
+    num_bufs_ = fbl::round_up<size_t>(backlog_ * 2, kFramesInBuf) / kFramesInBuf;
+    bufs_.reset(new (&ac) io_buffer_t[num_bufs_]);
+    if (!ac.check()) {
+        zxlogf(ERROR, "out of memory!\n");
+        return ZX_ERR_NO_MEMORY;
+    }
+    memset(bufs_.get(), 0, sizeof(io_buffer_t) * num_bufs_);
+    size_t buf_size = kFrameSize * kFramesInBuf;
+    for (size_t i = 0; i < num_bufs_; ++i) {
+        if ((rc = io_buffer_init(&bufs_[i], buf_size, IO_BUFFER_RW | IO_BUFFER_CONTIG)) != ZX_OK) {
+            zxlogf(ERROR, "failed to allocate I/O buffers: %s\n", zx_status_get_string(rc));
+            return rc;
+        }
+    }
+
+    if (mrg_rxbuf_) {
+        for (auto& merge : rx_merge_) {
+            merge.reset(new (&ac) uint8_t[kMaxFrameLen]);
+            if (!ac.check()) {
+                zxlogf(ERROR, "out of memory!\n");
+                return ZX_ERR_NO_MEMORY;
+            }
+        }
+    }
+
+    if (!host_tso4_ && !host_tso6_) {
+        return ZX_OK;
+    }
+    // Segmentation offload is optional; do without it rather than fail.
+    auto disable_tso = fbl::MakeAutoCall([this]() {
+        zxlogf(ERROR, "%s: not enough memory for TSO, disabling it\n", tag());
+        ReleaseIoBuffers(&tso_bufs_, kNumTsoBufs);
+        host_tso4_ = host_tso6_ = false;
+    });
+    fbl::AutoLock lock(&tx_lock_);
+    tso_bufs_.reset(new (&ac) io_buffer_t[kNumTsoBufs]);
+    if (!ac.check()) {
+        return ZX_OK;
+    }
+    memset(tso_bufs_.get(), 0, sizeof(io_buffer_t) * kNumTsoBufs);
+    tso_slot_.reset(new (&ac) uint8_t[backlog_]);
+    if (!ac.check()) {
+        return ZX_OK;
+    }
+    memset(tso_slot_.get(), kNoTsoSlot, backlog_);
+    for (size_t i = 0; i < kNumTsoBufs; ++i) {
+        if (io_buffer_init(&tso_bufs_[i], kTsoBufSize, IO_BUFFER_RW | IO_BUFFER_CONTIG) != ZX_OK) {
+            return ZX_OK;
+        }
+    }
+    tso_free_ = (1u << kNumTsoBufs) - 1;
+    disable_tso.cancel();
+    return ZX_OK;
+}
+
+void EthernetDevice::ReleaseBuffers() {
+    ReleaseIoBuffers(&tso_bufs_, kNumTsoBufs);
+    ReleaseIoBuffers(&bufs_, num_bufs_);
+}
+
+void* EthernetDevice::GetFrameVirt(uint16_t ring_id, uint16_t desc_id) {
+    size_t i = desc_id + ring_id * backlog_;
+    uintptr_t vaddr = reinterpret_cast<uintptr_t>(io_buffer_virt(&bufs_[i / kFramesInBuf]));
+    return reinterpret_cast<void*>(vaddr + (i % kFramesInBuf) * kFrameSize);
+}
+
+zx_paddr_t EthernetDevice::GetFramePhys(uint16_t ring_id, uint16_t desc_id) {
+    size_t i = desc_id + ring_id * backlog_;
+    return io_buffer_phys(&bufs_[i / kFramesInBuf]) + (i % kFramesInBuf) * kFrameSize;
+}
+
+uint8_t* EthernetDevice::GetFrameData(uint16_t ring_id, uint16_t desc_id) {
+    return static_cast<uint8_t*>(GetFrameVirt(ring_id, desc_id)) + hdr_len_;
+}
+
 zx_status_t EthernetDevice::Init() {
     LTRACE_ENTRY;
     zx_status_t rc;
@@ -206,15 +311,29 @@ zx_status_t EthernetDevice::Init() {
     // Ack and set the driver status bit
     DriverStatusAck();
 
-    // TODO(aarongreen): Check features bits and ack/nak them
+    NegotiateFeatures();
+    if (DeviceStatusFeaturesOk() != ZX_OK) {
+        zxlogf(ERROR, "%s: feature negotiation failed\n", tag());
+        return ZX_ERR_NOT_SUPPORTED;
+    }
 
     // Plan to clean up unless everything goes right.
     auto cleanup = fbl::MakeAutoCall([this]() { Release(); });
 
+    // Make the rings as deep as both virtqueues allow.
+    uint16_t max_descs = fbl::min(GetRingSize(kRxId), GetRingSize(kTxId));
+    for (backlog_ = kMaxBacklog; backlog_ > max_descs; backlog_ >>= 1) {
+    }
+    if (backlog_ == 0) {
+        zxlogf(ERROR, "%s: virtqueues are not usable\n", tag());
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zxlogf(TRACE, "%s: backlog %u, mrg_rxbuf %d, csum %d/%d, tso %d/%d\n", tag(), backlog_,
+           mrg_rxbuf_, host_csum_, guest_csum_, host_tso4_, host_tso6_);
+
     // Allocate I/O buffers and virtqueues.
-    uint16_t num_descs = static_cast<uint16_t>(kBacklog & 0xffff);
-    if ((rc = InitBuffers(&bufs_)) != ZX_OK || (rc = rx_.Init(kRxId, num_descs)) != ZX_OK ||
-        (rc = tx_.Init(kTxId, num_descs)) != ZX_OK) {
+    if ((rc = InitBuffers()) != ZX_OK || (rc = rx_.Init(kRxId, backlog_)) != ZX_OK ||
+        (rc = tx_.Init(kTxId, backlog_)) != ZX_OK) {
         zxlogf(ERROR, "failed to allocate virtqueue: %s\n", zx_status_get_string(rc));
         return rc;
     }
@@ -225,9 +344,9 @@ zx_status_t EthernetDevice::Init() {
 
     // For rx buffers, we queue a bunch of "reads" from the network that
     // complete when packets arrive.
-    for (uint16_t i = 0; i < num_descs; ++i) {
+    for (uint16_t i = 0; i < backlog_; ++i) {
         desc = rx_.AllocDescChain(1, &id);
-        desc->addr = GetFramePhys(bufs_.get(), kRxId, id);
+        desc->addr = GetFramePhys(kRxId, id);
         desc->len = kFrameSize;
         desc->flags |= VRING_DESC_F_WRITE;
         LTRACE_DO(virtio_dump_desc(desc));
@@ -235,9 +354,9 @@ zx_status_t EthernetDevice::Init() {
     }
 
     // For tx buffers, we hold onto them until we need to send a packet.
-    for (uint16_t id = 0; id < num_descs; ++id) {
+    for (uint16_t id = 0; id < backlog_; ++id) {
         desc = tx_.DescFromIndex(id);
-        desc->addr = GetFramePhys(bufs_.get(), kTxId, id);
+        desc->addr = GetFramePhys(kTxId, id);
         desc->len = 0;
         desc->flags &= static_cast<uint16_t>(~VRING_DESC_F_WRITE);
         LTRACE_DO(virtio_dump_desc(desc));
@@ -276,7 +395,7 @@ void EthernetDevice::Release() {
 
 void EthernetDevice::ReleaseLocked() {
     ifc_ = nullptr;
-    ReleaseBuffers(fbl::move(bufs_));
+    ReleaseBuffers();
     Device::Release();
 }
 
@@ -293,22 +412,14 @@ void EthernetDevice::IrqRingUpdate() {
         // Thread safety analysis is explicitly disabled as clang isn't able to determine that the
         // state_lock_ is  held when the lambda invoked.
         rx_.IrqRingUpdate([this](vring_used_elem* used_elem) TA_NO_THREAD_SAFETY_ANALYSIS {
-            uint16_t id = static_cast<uint16_t>(used_elem->id & 0xffff);
-            desc_t* desc = rx_.DescFromIndex(id);
-
-            // Transitional driver does not merge rx buffers.
-            assert(used_elem->len < desc->len);
-            uint8_t* data = GetFrameData(bufs_.get(), kRxId, id);
-            size_t len = used_elem->len - sizeof(virtio_net_hdr_t);
-            LTRACEF("Receiving %zu bytes:\n", len);
-            LTRACE_DO(hexdump8_ex(data, len, 0));
-
-            // Pass the data up the stack to the generic Ethernet driver
-            ifc_->recv(cookie_, data, len, 0);
-            assert((desc->flags & VRING_DESC_F_NEXT) == 0);
-            LTRACE_DO(virtio_dump_desc(desc));
-            rx_.FreeDesc(id);
+            RxUsedElem(used_elem);
         });
+        // Frames are passed up one step behind, so that all but the last frame
+        // of the batch are flagged with ETHMAC_RECV_OPT_MORE.
+        if (rx_has_pending_) {
+            rx_has_pending_ = false;
+            RxDeliverFrame(rx_pending_, 0);
+        }
     }
 
     // Now recycle the rx buffers.  As in Init(), this means queuing a bunch of
@@ -328,6 +439,102 @@ void EthernetDevice::IrqRingUpdate() {
     }
 }
 
+void EthernetDevice::RxUsedElem(vring_used_elem* used_elem) {
+    uint16_t id = static_cast<uint16_t>(used_elem->id & 0xffff);
+    desc_t* desc = rx_.DescFromIndex(id);
+    assert((desc->flags & VRING_DESC_F_NEXT) == 0);
+    LTRACE_DO(virtio_dump_desc(desc));
+    uint8_t* buf = static_cast<uint8_t*>(GetFrameVirt(kRxId, id));
+    size_t len = fbl::min<size_t>(used_elem->len, desc->len);
+
+    if (rx_merge_left_ == 0) {
+        // This is the first buffer of a frame, which starts with the header.
+        if (len < hdr_len_) {
+            LTRACEF("dropping runt buffer of %zu bytes\n", len);
+            rx_.FreeDesc(id);
+            return;
+        }
+        const virtio_net_hdr_t* hdr = reinterpret_cast<virtio_net_hdr_t*>(buf);
+        uint16_t num_buffers = 1;
+        if (mrg_rxbuf_) {
+            num_buffers = reinterpret_cast<virtio_net_hdr_mrg_rxbuf_t*>(buf)->num_buffers;
+        }
+        buf += hdr_len_;
+        len -= hdr_len_;
+        if (num_buffers <= 1) {
+            RxQueueFrame({buf, len, RxChecksum(hdr, buf, len), true, id});
+            return;
+        }
+        // The frame continues in the next buffers; gather it up.
+        rx_merge_hdr_ = *hdr;
+        rx_merge_left_ = num_buffers;
+        rx_merge_len_ = 0;
+        rx_merge_drop_ = false;
+    }
+
+    uint8_t* merge = rx_merge_[rx_merge_idx_].get();
+    if (rx_merge_drop_ || len > kMaxFrameLen - rx_merge_len_) {
+        rx_merge_drop_ = true;
+    } else {
+        memcpy(merge + rx_merge_len_, buf, len);
+        rx_merge_len_ += len;
+    }
+    rx_.FreeDesc(id);
+    if (--rx_merge_left_ > 0) {
+        return;
+    }
+    if (rx_merge_drop_) {
+        LTRACEF("dropping oversized frame\n");
+        return;
+    }
+    RxQueueFrame({merge, rx_merge_len_, RxChecksum(&rx_merge_hdr_, merge, rx_merge_len_),
+                  false, 0});
+    // Keep the next merged frame from overwriting this one while it is pending.
+    rx_merge_idx_ ^= 1;
+}
+
+void EthernetDevice::RxQueueFrame(const RxFrame& frame) {
+    if (rx_has_pending_) {
+        RxDeliverFrame(rx_pending_, ETHMAC_RECV_OPT_MORE);
+    }
+    rx_pending_ = frame;
+    rx_has_pending_ = true;
+}
+
+void EthernetDevice::RxDeliverFrame(const RxFrame& frame, uint32_t flags) {
+    LTRACEF("Receiving %zu bytes:\n", frame.len);
+    LTRACE_DO(hexdump8_ex(frame.data, frame.len, 0));
+
+    // Pass the data up the stack to the generic Ethernet driver
+    ifc_->recv(cookie_, frame.data, frame.len, frame.flags | flags);
+    if (frame.has_desc) {
+        rx_.FreeDesc(frame.desc_id);
+    }
+}
+
+uint32_t EthernetDevice::RxChecksum(const virtio_net_hdr_t* hdr, uint8_t* data, size_t len) {
+    if (!guest_csum_) {
+        return 0;
+    }
+    if (hdr->flags & VIRTIO_NET_HDR_F_NEEDS_CSUM) {
+        // The frame carries a partial checksum, e.g. because it was sent by
+        // another guest on the same host, so finish it here. The checksum
+        // field already holds the pseudo-header sum.
+        size_t start = hdr->csum_start;
+        size_t field = start + hdr->csum_offset;
+        if (field + sizeof(uint16_t) > len) {
+            return 0;
+        }
+        uint16_t csum = ChecksumFold(ChecksumAdd(0, data + start, len - start));
+        WriteBe16(data + field, static_cast<uint16_t>(~csum));
+        return ETHMAC_RECV_CSUM_VALID;
+    }
+    if (hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID) {
+        return ETHMAC_RECV_CSUM_VALID;
+    }
+    return 0;
+}
+
 void EthernetDevice::IrqConfigChange() {
     LTRACE_ENTRY;
     fbl::AutoLock lock(&state_lock_);
@@ -347,7 +554,16 @@ zx_status_t EthernetDevice::Query(uint32_t options, ethmac_info_t* info) {
     }
     fbl::AutoLock lock(&state_lock_);
     if (info) {
-        // TODO(aarongreen): Add info->features = GetFeatures();
+        info->features = 0;
+        if (host_csum_) {
+            info->features |= ETHMAC_FEATURE_TX_CSUM;
+        }
+        if (guest_csum_) {
+            info->features |= ETHMAC_FEATURE_RX_CSUM;
+        }
+        if (host_tso4_ || host_tso6_) {
+            info->features |= ETHMAC_FEATURE_TSO;
+        }
         info->mtu = kVirtioMtu;
         memcpy(info->mac, config_.mac, sizeof(info->mac));
     }
@@ -375,12 +591,105 @@ zx_status_t EthernetDevice::Start(ethmac_ifc_t* ifc, void* cookie) {
     return ZX_OK;
 }
 
+zx_status_t EthernetDevice::TxPrepare(uint8_t* frame, size_t len, uint32_t flags,
+                                      virtio_net_hdr_t* hdr) {
+    if (!(flags & (ETHMAC_NETBUF_CSUM | ETHMAC_NETBUF_TSO))) {
+        return ZX_OK;
+    }
+    if (!host_csum_) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // Find the transport header and start the checksum with the pseudo-header.
+    if (len < kEthHdrLen) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+    const uint8_t* ip = frame + kEthHdrLen;
+    size_t ip_len = len - kEthHdrLen;
+    size_t ip_hdr_len;
+    uint8_t proto;
+    uint32_t sum;
+    bool ipv6 = false;
+    switch (ReadBe16(frame + 12)) {
+    case kEthTypeIpv4:
+        if (ip_len < kIpv4MinHdrLen) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        ip_hdr_len = (ip[0] & 0xf) * 4;
+        proto = ip[9];
+        sum = ChecksumAdd(0, ip + 12, 8);
+        break;
+    case kEthTypeIpv6:
+        if (ip_len < kIpv6HdrLen) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        // Extension headers are not parsed.
+        ip_hdr_len = kIpv6HdrLen;
+        proto = ip[6];
+        sum = ChecksumAdd(0, ip + 8, 32);
+        ipv6 = true;
+        break;
+    default:
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    uint16_t csum_offset;
+    if (proto == kIpProtoTcp) {
+        csum_offset = kTcpCsumOffset;
+    } else if (proto == kIpProtoUdp) {
+        csum_offset = kUdpCsumOffset;
+    } else {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    size_t l4_off = kEthHdrLen + ip_hdr_len;
+    if (ip_hdr_len < kIpv4MinHdrLen || l4_off + csum_offset + sizeof(uint16_t) > len) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+    sum += proto;
+
+    if (len > kMaxFrameLen) {
+        // Only TCP segmentation is offered.
+        if (!(flags & ETHMAC_NETBUF_TSO) || proto != kIpProtoTcp ||
+            !(ipv6 ? host_tso6_ : host_tso4_)) {
+            return ZX_ERR_NOT_SUPPORTED;
+        }
+        size_t tcp_hdr_len = (frame[l4_off + 12] >> 4) * 4;
+        if (tcp_hdr_len < kTcpMinHdrLen || l4_off + tcp_hdr_len > len) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        hdr->gso_type = ipv6 ? VIRTIO_NET_HDR_GSO_TCPV6 : VIRTIO_NET_HDR_GSO_TCPV4;
+        hdr->hdr_len = static_cast<uint16_t>(l4_off + tcp_hdr_len);
+        hdr->gso_size = static_cast<uint16_t>(kVirtioMtu - ip_hdr_len - tcp_hdr_len);
+        // The device adds the length of each segment to the pseudo-header sum.
+    } else {
+        sum += static_cast<uint32_t>(len - l4_off);
+    }
+
+    // Seed the checksum field with the pseudo-header sum and let the device
+    // add in the rest.
+    WriteBe16(frame + l4_off + csum_offset, ChecksumFold(sum));
+    hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    hdr->csum_start = static_cast<uint16_t>(l4_off);
+    hdr->csum_offset = csum_offset;
+    return ZX_OK;
+}
+
+void EthernetDevice::TxFreeDesc(uint16_t id) {
+    if (tso_slot_ && tso_slot_[id] != kNoTsoSlot) {
+        tso_free_ |= 1u << tso_slot_[id];
+        tso_slot_[id] = kNoTsoSlot;
+        tx_.DescFromIndex(id)->addr = GetFramePhys(kTxId, id);
+    }
+    tx_.FreeDesc(id);
+}
+
 zx_status_t EthernetDevice::QueueTx(uint32_t options, ethmac_netbuf_t* netbuf) {
     LTRACE_ENTRY;
     void* data = netbuf->data;
     size_t length = netbuf->len;
+    bool tso = length > kMaxFrameLen && (netbuf->flags & ETHMAC_NETBUF_TSO) && tso_bufs_;
     // First, validate the packet
-    if (!data || length > sizeof(virtio_net_hdr_t) + kVirtioMtu) {
+    if (!data || (length > kMaxFrameLen && !tso)) {
         LTRACEF("dropping packet; invalid packet\n");
         return ZX_ERR_INVALID_ARGS;
     }
@@ -389,12 +698,12 @@ zx_status_t EthernetDevice::QueueTx(uint32_t options, ethmac_netbuf_t* netbuf) {
 
     // Flush outstanding descriptors.  Ring::IrqRingUpdate will call this lambda
     // on each sent tx_buffer, allowing us to reclaim them.
-    auto flush = [this](vring_used_elem* used_elem) {
+    auto flush = [this](vring_used_elem* used_elem) TA_NO_THREAD_SAFETY_ANALYSIS {
         uint16_t id = static_cast<uint16_t>(used_elem->id & 0xffff);
         desc_t* desc = tx_.DescFromIndex(id);
         assert((desc->flags & VRING_DESC_F_NEXT) == 0);
         LTRACE_DO(virtio_dump_desc(desc));
-        tx_.FreeDesc(id);
+        TxFreeDesc(id);
     };
 
     // Grab a free descriptor
@@ -409,12 +718,36 @@ zx_status_t EthernetDevice::QueueTx(uint32_t options, ethmac_netbuf_t* netbuf) {
         return ZX_ERR_NO_RESOURCES;
     }
 
+    // Large frames go through one of the TSO buffers.
+    uint8_t* tx_hdr = static_cast<uint8_t*>(GetFrameVirt(kTxId, id));
+    if (tso) {
+        if (tso_free_ == 0) {
+            tx_.IrqRingUpdate(flush);
+        }
+        if (tso_free_ == 0) {
+            tx_.FreeDesc(id);
+            LTRACEF("dropping packet; out of TSO buffers\n");
+            return ZX_ERR_NO_RESOURCES;
+        }
+        uint8_t slot = static_cast<uint8_t>(__builtin_ctz(tso_free_));
+        tso_free_ &= ~(1u << slot);
+        tso_slot_[id] = slot;
+        tx_hdr = static_cast<uint8_t*>(io_buffer_virt(&tso_bufs_[slot]));
+        desc->addr = io_buffer_phys(&tso_bufs_[slot]);
+    }
+
     // Add the data to be sent
-    void* tx_hdr = GetFrameHdr(bufs_.get(), kTxId, id);
-    memset(tx_hdr, 0, sizeof(virtio_net_hdr_t));
-    void* tx_buf = GetFrameData(bufs_.get(), kTxId, id);
+    memset(tx_hdr, 0, hdr_len_);
+    uint8_t* tx_buf = tx_hdr + hdr_len_;
     memcpy(tx_buf, data, length);
-    desc->len = static_cast<uint32_t>(sizeof(virtio_net_hdr_t) + length);
+    zx_status_t rc = TxPrepare(tx_buf, length, netbuf->flags,
+                               reinterpret_cast<virtio_net_hdr_t*>(tx_hdr));
+    if (rc != ZX_OK) {
+        LTRACEF("dropping packet; cannot offload: %d\n", rc);
+        TxFreeDesc(id);
+        return rc;
+    }
+    desc->len = static_cast<uint32_t>(hdr_len_ + length);
 
     // Submit the descriptor and notify the back-end.
     LTRACE_DO(virtio_dump_desc(desc));
@@ -422,7 +755,7 @@ zx_status_t EthernetDevice::QueueTx(uint32_t options, ethmac_netbuf_t* netbuf) {
     LTRACE_DO(hexdump8_ex(tx_buf, length, 0));
     tx_.SubmitChain(id);
     ++unkicked_;
-    if ((options & ETHMAC_TX_OPT_MORE) == 0 || unkicked_ > kBacklog / 2) {
+    if ((options & ETHMAC_TX_OPT_MORE) == 0 || unkicked_ > backlog_ / 2) {
         tx_.Kick();
         unkicked_ = 0;
     }
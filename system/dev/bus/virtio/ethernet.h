@@ -46,9 +46,41 @@ public:
 private:
     DISALLOW_COPY_ASSIGN_AND_MOVE(EthernetDevice);
 
+    // A received frame, either in place in an rx buffer or reassembled into
+    // one of the rx_merge_ buffers.
+    struct RxFrame {
+        uint8_t* data;
+        size_t len;
+        uint32_t flags;
+        bool has_desc;
+        uint16_t desc_id;
+    };
+
     // DDK device hooks; see ddk/device.h
     void ReleaseLocked() TA_REQ(state_lock_);
 
+    // Feature negotiation and buffer setup
+    void NegotiateFeatures();
+    zx_status_t InitBuffers();
+    void ReleaseBuffers();
+
+    // Frame access helpers
+    void* GetFrameVirt(uint16_t ring_id, uint16_t desc_id);
+    zx_paddr_t GetFramePhys(uint16_t ring_id, uint16_t desc_id);
+    uint8_t* GetFrameData(uint16_t ring_id, uint16_t desc_id);
+
+    // Receive helpers; called from IrqRingUpdate with state_lock_ held.
+    void RxUsedElem(vring_used_elem* used_elem) TA_REQ(state_lock_);
+    void RxQueueFrame(const RxFrame& frame) TA_REQ(state_lock_);
+    void RxDeliverFrame(const RxFrame& frame, uint32_t flags) TA_REQ(state_lock_);
+    uint32_t RxChecksum(const virtio_net_hdr_t* hdr, uint8_t* data, size_t len);
+
+    // Fills in |hdr| for a frame copied to |frame|, completing or offloading its
+    // checksum and setting up segmentation as requested by |flags|.
+    zx_status_t TxPrepare(uint8_t* frame, size_t len, uint32_t flags, virtio_net_hdr_t* hdr);
+    // Returns a tx descriptor to the ring, along with any TSO buffer it used.
+    void TxFreeDesc(uint16_t id) TA_REQ(tx_lock_);
+
     // Mutexes to control concurrent access
     mtx_t state_lock_;
     mtx_t tx_lock_;
@@ -59,9 +91,43 @@ private:
     // each direction.
     Ring rx_;
     Ring tx_;
+    // Number of descriptors, and so frames, in each of rx_ and tx_.
+    uint16_t backlog_ = 0;
     fbl::unique_ptr<io_buffer_t[]> bufs_;
+    size_t num_bufs_ = 0;
     size_t unkicked_ TA_GUARDED(tx_lock_);
 
+    // Negotiated features
+    bool mrg_rxbuf_ = false;
+    bool guest_csum_ = false;
+    bool host_csum_ = false;
+    bool host_tso4_ = false;
+    bool host_tso6_ = false;
+    // Size of the virtio-net header preceding each frame
+    size_t hdr_len_ = sizeof(virtio_net_hdr_t);
+
+    // Large tx buffers for segmentation offload. A tx descriptor carrying a
+    // TSO frame points at one of these instead of its own frame buffer until
+    // the device hands it back.
+    fbl::unique_ptr<io_buffer_t[]> tso_bufs_;
+    uint32_t tso_free_ TA_GUARDED(tx_lock_) = 0;
+    fbl::unique_ptr<uint8_t[]> tso_slot_ TA_GUARDED(tx_lock_);
+
+    // Reassembly of rx frames spread over several buffers with
+    // VIRTIO_NET_F_MRG_RXBUF. Two buffers are used in turn, as the previous
+    // frame may still be waiting to be passed up; see IrqRingUpdate.
+    fbl::unique_ptr<uint8_t[]> rx_merge_[2];
+    uint8_t rx_merge_idx_ = 0;
+    size_t rx_merge_len_ = 0;
+    uint16_t rx_merge_left_ = 0;
+    bool rx_merge_drop_ = false;
+    virtio_net_hdr_t rx_merge_hdr_ = {};
+
+    // The frame held back so that it can be flagged ETHMAC_RECV_OPT_MORE if
+    // another one follows it in the same interrupt.
+    RxFrame rx_pending_ TA_GUARDED(state_lock_) = {};
+    bool rx_has_pending_ TA_GUARDED(state_lock_) = false;
+
     // Saved net device configuration out of the pci config BAR
     virtio_net_config_t config_ TA_GUARDED(state_lock_);
 
@@ -129,14 +129,33 @@ void Ring::SubmitChain(uint16_t desc_index) {
     struct vring_avail* avail = ring_.avail;
 
     avail->ring[avail->idx & ring_.num_mask] = desc_index;
-    //mb();
+    hw_wmb();
     avail->idx++;
 }
 
 void Ring::Kick() {
     LTRACE_ENTRY;
 
-    device_->RingKick(index_);
+    // Make the new avail->idx visible before reading the device's
+    // notification state.
+    hw_mb();
+
+    uint16_t new_idx = ring_.avail->idx;
+    uint16_t old_idx = kicked_idx_;
+    kicked_idx_ = new_idx;
+    if (new_idx == old_idx) {
+        return;
+    }
+
+    bool needs_kick;
+    if (event_idx_) {
+        needs_kick = vring_need_event(vring_avail_event(&ring_), new_idx, old_idx);
+    } else {
+        needs_kick = !(ring_.used->flags & VRING_USED_F_NO_NOTIFY);
+    }
+    if (needs_kick) {
+        device_->RingKick(index_);
+    }
 }
 
 } // namespace virtio
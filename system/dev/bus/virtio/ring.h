@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 #pragma once
 
+#include <hw/arch_ops.h>
 #include <virtio/virtio_ring.h>
 #include <zircon/types.h>
 
@@ -19,11 +20,20 @@ public:
 
     zx_status_t Init(uint16_t index, uint16_t count);
 
+    // Use the avail_event / used_event fields to suppress notifications in
+    // both directions. Must only be enabled if VIRTIO_F_RING_EVENT_IDX was
+    // negotiated with the device.
+    void SetEventIdx(bool enabled) { event_idx_ = enabled; }
+
     void FreeDesc(uint16_t desc_index);
     struct vring_desc* AllocDescChain(uint16_t count, uint16_t* start_index);
     void SubmitChain(uint16_t desc_index);
+    // Notify the device of all chains submitted since the last kick, unless
+    // the device has indicated that it does not need to be notified.
     void Kick();
 
+    uint16_t index() const { return index_; }
+
     struct vring_desc* DescFromIndex(uint16_t index) {
         return &ring_.desc[index];
     }
@@ -40,6 +50,10 @@ private:
 
     uint16_t index_ = 0;
 
+    // Value of avail->idx when the device was last considered for a kick.
+    uint16_t kicked_idx_ = 0;
+    bool event_idx_ = false;
+
     vring ring_ = {};
 };
 
@@ -49,19 +63,33 @@ inline void Ring::IrqRingUpdate(T free_chain) {
     // TRACEF("used flags %#x idx %#x last_used %u\n",
     //         ring_.used->flags, ring_.used->idx, ring_.last_used);
 
-    // find a new free chain of descriptors
-    uint16_t cur_idx = ring_.used->idx;
-    uint16_t i = ring_.last_used;
-    for (; i != cur_idx; ++i) {
-        // TRACEF("looking at idx %u\n", i);
-
-        struct vring_used_elem* used_elem = &ring_.used->ring[i & ring_.num_mask];
-        // TRACEF("used chain id %u, len %u\n", used_elem->id, used_elem->len);
-
-        // free the chain
-        free_chain(used_elem);
+    for (;;) {
+        // find a new free chain of descriptors
+        uint16_t cur_idx = ring_.used->idx;
+        hw_rmb();
+        uint16_t i = ring_.last_used;
+        for (; i != cur_idx; ++i) {
+            // TRACEF("looking at idx %u\n", i);
+
+            struct vring_used_elem* used_elem = &ring_.used->ring[i & ring_.num_mask];
+            // TRACEF("used chain id %u, len %u\n", used_elem->id, used_elem->len);
+
+            // free the chain
+            free_chain(used_elem);
+        }
+        ring_.last_used = i;
+
+        if (!event_idx_) {
+            break;
+        }
+        // Ask for an interrupt on the next used entry only, then check that
+        // the device did not complete more work before it could see that.
+        vring_used_event(&ring_) = ring_.last_used;
+        hw_mb();
+        if (ring_.used->idx == ring_.last_used) {
+            break;
+        }
     }
-    ring_.last_used = i;
 }
 
 void virtio_dump_desc(const struct vring_desc* desc);
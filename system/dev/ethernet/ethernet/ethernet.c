@@ -13,6 +13,7 @@
 #include <zircon/listnode.h>
 #include <zircon/process.h>
 #include <zircon/syscalls.h>
+#include <zircon/syscalls/fifo.h>
 #include <zircon/thread_annotations.h>
 #include <zircon/types.h>
 
@@ -102,6 +103,17 @@ typedef struct ethdev {
     mtx_t lock;  // Protects free_tx_bufs
     list_node_t free_tx_bufs;  // tx_info_t elements
 
+    // The rx state below is only touched on the receive paths, which hold edev0->lock.
+
+    // rx buffers read from the rx fifo in bulk but not yet filled
+    eth_fifo_entry_t rx_cache[FIFO_DEPTH];
+    uint32_t rx_cache_head;
+    uint32_t rx_cache_count;
+
+    // filled rx buffers not yet returned to the client
+    eth_fifo_entry_t rx_done[FIFO_DEPTH];
+    uint32_t rx_done_count;
+
     // fifo thread
     thrd_t tx_thr;
 
@@ -123,13 +135,53 @@ static inline ssize_t eth_set_promisc_locked(ethdev0_t* edev0, const void* buf,
     return edev0->mac.ops->set_param(edev0->mac.ctx, ETHMAC_SETPARAM_PROMISC, *(bool*)buf, NULL);
 }
 
+// Return all filled rx buffers to the client with a single fifo write.
+static void eth_rx_flush(ethdev_t* edev) {
+    if (edev->rx_done_count == 0) {
+        return;
+    }
+
+    zx_status_t status;
+    uint32_t count = 0;
+    status = zx_fifo_write(edev->rx_fifo, edev->rx_done,
+                           sizeof(eth_fifo_entry_t) * edev->rx_done_count, &count);
+    if ((status == ZX_ERR_SHOULD_WAIT) || ((status == ZX_OK) && (count < edev->rx_done_count))) {
+        if ((edev->fail_rx_write++ % FAIL_REPORT_RATE) == 0) {
+            zxlogf(ERROR, "eth [%s]: no rx_fifo space available (%u times)\n",
+                   edev->name, edev->fail_rx_write);
+        }
+    } else if (status < 0) {
+        // Fatal, should force teardown
+        zxlogf(ERROR, "eth [%s]: rx_fifo write failed %d\n", edev->name, status);
+    }
+    edev->rx_done_count = 0;
+}
+
+// Take the next rx buffer supplied by the client. The local cache is refilled
+// with everything the rx fifo holds, so most packets need no fifo read.
+static zx_status_t eth_rx_get_buffer(ethdev_t* edev, eth_fifo_entry_t* e) {
+    if (edev->rx_cache_count == 0) {
+        zx_status_t status;
+        uint32_t count;
+        if ((status = zx_fifo_read(edev->rx_fifo, edev->rx_cache, sizeof(edev->rx_cache),
+                                   &count)) < 0) {
+            return status;
+        }
+        edev->rx_cache_head = 0;
+        edev->rx_cache_count = count;
+    }
+    *e = edev->rx_cache[edev->rx_cache_head++];
+    edev->rx_cache_count--;
+    return ZX_OK;
+}
+
+// Copy a packet into the next client rx buffer. The buffer is queued for
+// return to the client; callers must eth_rx_flush() at the end of a batch.
 static void eth_handle_rx(ethdev_t* edev, const void* data, size_t len, uint32_t extra) {
     eth_fifo_entry_t e;
     zx_status_t status;
-    uint32_t count;
 
-    // TODO: read multiple and cache locally to reduce syscalls
-    if ((status = zx_fifo_read(edev->rx_fifo, &e, sizeof(e), &count)) < 0) {
+    if ((status = eth_rx_get_buffer(edev, &e)) < 0) {
         if (status == ZX_ERR_SHOULD_WAIT) {
             if ((edev->fail_rx_read++ % FAIL_REPORT_RATE) == 0) {
                 zxlogf(ERROR, "eth [%s]: no rx buffers available (%u times)\n",
@@ -156,17 +208,9 @@ static void eth_handle_rx(ethdev_t* edev, const void* data, size_t len, uint32_t
         e.flags = ETH_FIFO_RX_OK | extra;
     }
 
-    if ((status = zx_fifo_write(edev->rx_fifo, &e, sizeof(e), &count)) < 0) {
-        if (status == ZX_ERR_SHOULD_WAIT) {
-            if ((edev->fail_rx_write++ % FAIL_REPORT_RATE) == 0) {
-                zxlogf(ERROR, "eth [%s]: no rx_fifo space available (%u times)\n",
-                       edev->name, edev->fail_rx_write);
-            }
-        } else {
-            // Fatal, should force teardown
-            zxlogf(ERROR, "eth [%s]: rx_fifo write failed %d\n", edev->name, status);
-        }
-        return;
+    edev->rx_done[edev->rx_done_count++] = e;
+    if (edev->rx_done_count == countof(edev->rx_done)) {
+        eth_rx_flush(edev);
     }
 }
 
@@ -205,10 +249,16 @@ static int tx_fifo_write(ethdev_t* edev, eth_fifo_entry_t* entries, uint32_t cou
 static void eth0_recv(void* cookie, void* data, size_t len, uint32_t flags) {
     ethdev0_t* edev0 = cookie;
 
+    uint32_t extra = (flags & ETHMAC_RECV_CSUM_VALID) ? ETH_FIFO_RX_CSUM_VALID : 0;
+
     ethdev_t* edev;
     mtx_lock(&edev0->lock);
     list_for_every_entry(&edev0->list_active, edev, ethdev_t, node) {
-        eth_handle_rx(edev, data, len, 0);
+        eth_handle_rx(edev, data, len, extra);
+        // Hold completions while the driver has more frames for us in this batch.
+        if (!(flags & ETHMAC_RECV_OPT_MORE)) {
+            eth_rx_flush(edev);
+        }
     }
     mtx_unlock(&edev0->lock);
 }
@@ -243,6 +293,7 @@ static void eth_tx_echo(ethdev0_t* edev0, const void* data, size_t len) {
     list_for_every_entry(&edev0->list_active, edev, ethdev_t, node) {
         if (edev->state & ETHDEV_TX_LISTEN) {
             eth_handle_rx(edev, data, len, ETH_FIFO_RX_TX);
+            eth_rx_flush(edev);
         }
     }
     mtx_unlock(&edev0->lock);
@@ -303,6 +354,13 @@ static int eth_send(ethdev_t* edev, eth_fifo_entry_t* entries, uint32_t count) {
                                        (e->offset & PAGE_MASK);
             }
             tx_info->netbuf.len = e->length;
+            tx_info->netbuf.flags = 0;
+            if ((e->flags & ETH_FIFO_TX_CSUM) && (edev0->info.features & ETHMAC_FEATURE_TX_CSUM)) {
+                tx_info->netbuf.flags |= ETHMAC_NETBUF_CSUM;
+            }
+            if ((e->flags & ETH_FIFO_TX_TSO) && (edev0->info.features & ETHMAC_FEATURE_TSO)) {
+                tx_info->netbuf.flags |= ETHMAC_NETBUF_TSO;
+            }
             tx_info->fifo_cookie = e->cookie;
             status = edev0->mac.ops->queue_tx(edev0->mac.ctx, opts, &tx_info->netbuf);
             if (edev->state & ETHDEV_TX_LOOPBACK) {
@@ -372,11 +430,13 @@ static zx_status_t eth_get_fifos_locked(ethdev_t* edev, void* out_buf, size_t ou
     eth_fifos_t* fifos = out_buf;
 
     zx_status_t status;
-    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, 0, &fifos->tx_fifo, &edev->tx_fifo)) < 0) {
+    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, ZX_FIFO_SHARED_RING,
+                                  &fifos->tx_fifo, &edev->tx_fifo)) < 0) {
         zxlogf(ERROR, "eth_create  [%s]: failed to create tx fifo: %d\n", edev->name, status);
         return status;
     }
-    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, 0, &fifos->rx_fifo, &edev->rx_fifo)) < 0) {
+    if ((status = zx_fifo_create(FIFO_DEPTH, FIFO_ESIZE, ZX_FIFO_SHARED_RING,
+                                  &fifos->rx_fifo, &edev->rx_fifo)) < 0) {
         zxlogf(ERROR, "eth_create  [%s]: failed to create rx fifo: %d\n", edev->name, status);
         zx_handle_close(fifos->tx_fifo);
         zx_handle_close(edev->tx_fifo);
@@ -505,6 +565,8 @@ static zx_status_t eth_stop_locked(ethdev_t* edev) TA_NO_THREAD_SAFETY_ANALYSIS
     ethdev0_t* edev0 = edev->edev0;
 
     if (edev->state & ETHDEV_RUNNING) {
+        // Return any rx buffers held back by a batch that was cut short.
+        eth_rx_flush(edev);
         edev->state &= (~ETHDEV_RUNNING);
         list_delete(&edev->node);
         list_add_tail(&edev0->list_idle, &edev->node);
@@ -584,6 +646,15 @@ static zx_status_t eth_ioctl(void* ctx, uint32_t op,
             if (edev->edev0->info.features & ETHMAC_FEATURE_SYNTH) {
                 info->features |= ETH_FEATURE_SYNTH;
             }
+            if (edev->edev0->info.features & ETHMAC_FEATURE_TX_CSUM) {
+                info->features |= ETH_FEATURE_TX_CSUM;
+            }
+            if (edev->edev0->info.features & ETHMAC_FEATURE_RX_CSUM) {
+                info->features |= ETH_FEATURE_RX_CSUM;
+            }
+            if (edev->edev0->info.features & ETHMAC_FEATURE_TSO) {
+                info->features |= ETH_FEATURE_TSO;
+            }
             info->mtu = edev->edev0->info.mtu;
             *out_actual = sizeof(*info);
             status = ZX_OK;
@@ -152,7 +152,7 @@ zx_status_t TapDevice::EthmacSetParam(uint32_t param, int32_t value, void* data)
 int TapDevice::Thread() {
     ethertap_trace("starting main thread\n");
     zx_signals_t pending;
-    fbl::unique_ptr<uint8_t[]> buf(new uint8_t[mtu_]);
+    fbl::unique_ptr<uint8_t[]> buf(new uint8_t[2 * mtu_]);
 
     zx_status_t status = ZX_OK;
     const zx_signals_t wait = ZX_SOCKET_READABLE | ZX_SOCKET_PEER_CLOSED | ETHERTAP_SIGNAL_ONLINE
@@ -240,6 +240,7 @@ zx_status_t TapDevice::UpdateLinkStatus(zx_signals_t observed) {
 }
 
 zx_status_t TapDevice::Recv(uint8_t* buffer, uint32_t capacity) {
+    uint8_t* next = buffer + capacity;
     size_t actual = 0;
     zx_status_t status = data_.read(0u, buffer, capacity, &actual);
     if (status != ZX_OK) {
@@ -247,13 +248,33 @@ zx_status_t TapDevice::Recv(uint8_t* buffer, uint32_t capacity) {
         return status;
     }
 
-    fbl::AutoLock lock(&lock_);
-    if (unlikely(options_ & ETHERTAP_OPT_TRACE_PACKETS)) {
-        ethertap_trace("received %zu bytes\n", actual);
-        hexdump8_ex(buffer, actual, 0);
-    }
-    if (ethmac_proxy_ != nullptr) {
-        ethmac_proxy_->Recv(buffer, actual, 0u);
+    // Read one frame ahead so the ethernet driver can be told whether another frame follows,
+    // which lets it return rx buffers to its clients once per batch instead of once per frame.
+    for (size_t n = 1; ; n++) {
+        size_t next_actual = 0;
+        bool more = false;
+        if (n < kMaxRecvBatch) {
+            more = data_.read(0u, next, capacity, &next_actual) == ZX_OK;
+        }
+
+        {
+            fbl::AutoLock lock(&lock_);
+            if (unlikely(options_ & ETHERTAP_OPT_TRACE_PACKETS)) {
+                ethertap_trace("received %zu bytes\n", actual);
+                hexdump8_ex(buffer, actual, 0);
+            }
+            if (ethmac_proxy_ != nullptr) {
+                ethmac_proxy_->Recv(buffer, actual, more ? ETHMAC_RECV_OPT_MORE : 0u);
+            }
+        }
+
+        if (!more) {
+            break;
+        }
+        uint8_t* tmp = buffer;
+        buffer = next;
+        next = tmp;
+        actual = next_actual;
     }
     return ZX_OK;
 }
@@ -46,6 +46,8 @@ class TapDevice : public ddk::Device<TapDevice, ddk::Unbindable>,
 
   private:
     zx_status_t UpdateLinkStatus(zx_signals_t observed);
+    // Reads and delivers a batch of frames from the socket. |buffer| must hold two frames of
+    // |capacity| bytes each, so that one frame can be read ahead of the one being delivered.
     zx_status_t Recv(uint8_t* buffer, uint32_t capacity);
 
     // ethertap options
@@ -56,6 +58,9 @@ class TapDevice : public ddk::Device<TapDevice, ddk::Unbindable>,
     uint32_t mtu_ = 0;
     uint8_t mac_[6] = {};
 
+    // Upper bound on the number of frames delivered by a single Recv() call.
+    static constexpr size_t kMaxRecvBatch = 64;
+
     fbl::Mutex lock_;
     fbl::unique_ptr<ddk::EthmacIfcProxy> ethmac_proxy_ __TA_GUARDED(lock_);
 
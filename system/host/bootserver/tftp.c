@@ -252,6 +252,9 @@ int tftp_xfer(struct sockaddr_in6* addr, const char* fn, const char* name) {
     uint16_t default_block_size = DEFAULT_TFTP_BLOCK_SZ;
     uint16_t default_window_size = DEFAULT_TFTP_WIN_SZ;
     tftp_set_options(session, &default_block_size, NULL, &default_window_size);
+    // Start with a small window and let it grow, rather than bursting a whole window at
+    // targets that can't keep up. Ignored by targets that don't support it.
+    tftp_session_set_adaptive_window_use(session, true);
 
     char err_msg[128];
     tftp_request_opts opts = {0};
@@ -0,0 +1,214 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// mkdrivermanifest reads bootfs manifests (target=srcpath lines) and writes
+// the driver manifest (see driver-info.h) for the drivers they install in
+// one directory, so that devmgr does not have to open every driver at boot.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <driver-info/driver-info.h>
+
+typedef struct entry entry_t;
+struct entry {
+    entry_t* next;
+    di_manifest_entry_t hdr;
+    zx_bind_inst_t* binding;
+    char* name;
+};
+
+static entry_t* first_entry;
+static entry_t* last_entry;
+static uint32_t entry_count;
+static size_t manifest_size = sizeof(di_manifest_header_t);
+
+static size_t align(size_t n) {
+    return (n + DI_MANIFEST_ALIGN - 1) & ~((size_t)DI_MANIFEST_ALIGN - 1);
+}
+
+static char* trim(char* str) {
+    while (isspace(*str)) {
+        str++;
+    }
+    char* end = str + strlen(str);
+    while ((end > str) && isspace(end[-1])) {
+        *--end = 0;
+    }
+    return str;
+}
+
+static void found_driver(zircon_driver_note_payload_t* note,
+                         const zx_bind_inst_t* bi, void* cookie) {
+    const char* name = cookie;
+    size_t bindlen = note->bindcount * sizeof(zx_bind_inst_t);
+
+    entry_t* e = calloc(1, sizeof(*e));
+    if ((e == NULL) ||
+        ((e->binding = malloc(bindlen + 1)) == NULL) ||
+        ((e->name = strdup(name)) == NULL)) {
+        fprintf(stderr, "error: out of memory\n");
+        exit(-1);
+    }
+    memcpy(&e->hdr.payload, note, sizeof(*note));
+    memcpy(e->binding, bi, bindlen);
+    e->hdr.name_len = strlen(name) + 1;
+    e->hdr.size = align(sizeof(e->hdr) + bindlen + e->hdr.name_len);
+
+    if (last_entry) {
+        last_entry->next = e;
+    } else {
+        first_entry = e;
+    }
+    last_entry = e;
+    entry_count++;
+    manifest_size += e->hdr.size;
+}
+
+// Adds the drivers installed directly in |dir| by the manifest |fn|, in the
+// order they appear in it, which is the order bootfs will list them in.
+static int import_manifest(const char* fn, const char* dir) {
+    FILE* fp = fopen(fn, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "error: cannot open '%s'\n", fn);
+        return -1;
+    }
+
+    size_t dirlen = strlen(dir);
+    int lineno = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lineno++;
+        char* eq = strchr(line, '=');
+        if (eq == NULL) {
+            continue;
+        }
+        *eq++ = 0;
+        char* dstfn = trim(line);
+        char* srcfn = trim(eq);
+
+        if (dstfn[0] == '{') {
+            char* end = strchr(dstfn + 1, '}');
+            if (end == NULL) {
+                fprintf(stderr, "%s:%d: unterminated group designator\n", fn, lineno);
+                fclose(fp);
+                return -1;
+            }
+            dstfn = end + 1;
+        }
+        if (strncmp(dstfn, dir, dirlen) || (dstfn[dirlen] != '/')) {
+            continue;
+        }
+        const char* name = dstfn + dirlen + 1;
+        if ((name[0] == 0) || (name[0] == '.') || strchr(name, '/')) {
+            continue;
+        }
+
+        int fd = open(srcfn, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "%s:%d: cannot open '%s'\n", fn, lineno, srcfn);
+            fclose(fp);
+            return -1;
+        }
+        zx_status_t status = di_read_driver_info(fd, (void*)name, found_driver);
+        close(fd);
+        if (status == ZX_ERR_NOT_FOUND) {
+            fprintf(stderr, "warning: no driver info in '%s'\n", srcfn);
+        } else if (status != ZX_OK) {
+            fprintf(stderr, "error: cannot read driver info from '%s'\n", srcfn);
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+static int write_manifest(const char* fn) {
+    if (manifest_size > UINT32_MAX) {
+        fprintf(stderr, "error: driver manifest too large\n");
+        return -1;
+    }
+
+    FILE* fp = fopen(fn, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "error: cannot create '%s'\n", fn);
+        return -1;
+    }
+
+    di_manifest_header_t hdr = {
+        .magic = DI_MANIFEST_MAGIC,
+        .version = DI_MANIFEST_VERSION,
+        .count = entry_count,
+        .size = manifest_size,
+    };
+    static const uint8_t zeros[DI_MANIFEST_ALIGN];
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (entry_t* e = first_entry; ok && (e != NULL); e = e->next) {
+        size_t bindlen = e->hdr.payload.bindcount * sizeof(zx_bind_inst_t);
+        size_t pad = e->hdr.size - (sizeof(e->hdr) + bindlen + e->hdr.name_len);
+        ok = (fwrite(&e->hdr, sizeof(e->hdr), 1, fp) == 1) &&
+             (fwrite(e->binding, 1, bindlen, fp) == bindlen) &&
+             (fwrite(e->name, 1, e->hdr.name_len, fp) == e->hdr.name_len) &&
+             (fwrite(zeros, 1, pad, fp) == pad);
+    }
+    if (fclose(fp) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "error: cannot write '%s'\n", fn);
+        unlink(fn);
+        return -1;
+    }
+    return 0;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+    "usage: mkdrivermanifest -o <output> [-d <dir>] <manifest>...\n"
+    "\n"
+    "       Writes the driver manifest for the drivers which the bootfs\n"
+    "       manifests install in <dir> (default 'driver'). devmgr looks\n"
+    "       for it as <dir>/" DI_MANIFEST_NAME ".\n"
+    );
+}
+
+int main(int argc, char** argv) {
+    const char* output_file = NULL;
+    const char* dir = "driver";
+
+    argc--;
+    argv++;
+    while ((argc > 0) && (argv[0][0] == '-')) {
+        if (!strcmp(argv[0], "-o") && (argc > 1)) {
+            output_file = argv[1];
+        } else if (!strcmp(argv[0], "-d") && (argc > 1)) {
+            dir = argv[1];
+        } else {
+            usage();
+            return -1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if ((output_file == NULL) || (argc == 0)) {
+        usage();
+        return -1;
+    }
+
+    for (; argc > 0; argc--, argv++) {
+        if (import_manifest(argv[0], dir) < 0) {
+            return -1;
+        }
+    }
+    return write_manifest(output_file) < 0 ? -1 : 0;
+}
@@ -218,6 +218,7 @@ static int transfer_file(bool push, int s, struct sockaddr_in6* addr, const char
 
     // Set our preferred transport options
     tftp_set_options(session, &tftp_block_size, NULL, &tftp_window_size);
+    tftp_session_set_adaptive_window_use(session, true);
 
     // Prepare buffers
     char err_msg[128];
@@ -15,6 +15,7 @@ HOSTAPPS := \
 	$(LOCAL_DIR)/merkleroot/rules.mk \
 	$(LOCAL_DIR)/minfs/rules.mk \
 	$(LOCAL_DIR)/mkbootfs/rules.mk \
+	$(LOCAL_DIR)/mkdrivermanifest/rules.mk \
 	$(LOCAL_DIR)/mkfs-msdosfs/rules.mk \
 	$(LOCAL_DIR)/mkkdtb/rules.mk \
 	$(LOCAL_DIR)/netprotocol/rules.mk \
@@ -78,6 +78,11 @@
 // since it will allow "activating" updated partitions.
 #define IOCTL_BLOCK_FVM_UPGRADE \
     IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_BLOCK, 17)
+// Migrates the slices of a virtual partition so that each range of
+// contiguous vslices is backed by contiguous physical slices, where free space
+// allows. The partition remains usable while this occurs.
+#define IOCTL_BLOCK_FVM_DEFRAG \
+    IOCTL(IOCTL_KIND_DEFAULT, IOCTL_FAMILY_BLOCK, 18)
 
 // Block Core ioctls (specific to each block device):
 
@@ -208,6 +213,9 @@ typedef struct {
 // ssize_t ioctl_block_fvm_upgrade(int fd, const upgrade_req_t* req);
 IOCTL_WRAPPER_IN(ioctl_block_fvm_upgrade, IOCTL_BLOCK_FVM_UPGRADE, upgrade_req_t);
 
+// ssize_t ioctl_block_fvm_defrag(int fd);
+IOCTL_WRAPPER(ioctl_block_fvm_defrag, IOCTL_BLOCK_FVM_DEFRAG);
+
 // Multiple Block IO operations may be sent at once before a response is actually sent back.
 // Block IO ops may be sent concurrently to different vmoids, and they also may be sent
 // to different transactions at any point in time. Up to MAX_TXN_COUNT transactions may
@@ -33,6 +33,12 @@ typedef struct eth_info_t {
 #define ETH_FEATURE_WLAN  1
 // Device is a synthetic network device
 #define ETH_FEATURE_SYNTH 2
+// Device fills in TCP/UDP checksums of tx packets flagged ETH_FIFO_TX_CSUM
+#define ETH_FEATURE_TX_CSUM 4
+// Device verifies TCP/UDP checksums of rx packets and flags them ETH_FIFO_RX_CSUM_VALID
+#define ETH_FEATURE_RX_CSUM 8
+// Device segments TCP packets of up to 64KB flagged ETH_FIFO_TX_TSO into mtu-sized packets
+#define ETH_FEATURE_TSO 16
 
 // Get the fifos to submit tx and rx operations
 //   in: none
@@ -109,13 +115,15 @@ typedef struct eth_fifos_t {
 // are returned along with the fifo handles in the eth_fifos_t.
 
 // flags values for request messages
-// - none -
+#define ETH_FIFO_TX_CSUM (0x100u) // fill in the TCP/UDP checksum (ETH_FEATURE_TX_CSUM)
+#define ETH_FIFO_TX_TSO  (0x200u) // segment a TCP packet larger than the mtu (ETH_FEATURE_TSO)
 
 // flags values for response messages
 #define ETH_FIFO_RX_OK   (1u)   // packet received okay
 #define ETH_FIFO_TX_OK   (1u)   // packet transmitted okay
 #define ETH_FIFO_INVALID (2u)   // offset+length not within io_vmo bounds
 #define ETH_FIFO_RX_TX   (4u)   // received our own tx packet (when TX_LISTEN)
+#define ETH_FIFO_RX_CSUM_VALID (8u) // TCP/UDP checksum verified by the device
 
 typedef struct eth_fifo_entry {
     // offset from start of io_vmo to packet data
@@ -209,6 +209,30 @@ struct zx_loader_svc_msg {
 // obtain a new loader service connection/context
 // arg=0, data[] empty, request includes channel for new connection
 
+#define LOADER_SVC_OP_LOAD_OBJECTS 9
+// arg=count, data[] count object names (asciiz), back to back
+// reply arg=status, data[] count int32_t statuses, one per name,
+// reply includes one vmo handle for each name whose status is ZX_OK, in order
+// A service which predates this op replies with ZX_ERR_INVALID_ARGS
+// and no data, and the client should fall back to LOADER_SVC_OP_LOAD_OBJECT.
+
+#define LOADER_SVC_BATCH_MAX 32
+// maximum count for LOADER_SVC_OP_LOAD_OBJECTS and LOADER_SVC_OP_LOAD_PRELINKED
+
+#define LOADER_SVC_OP_LOAD_PRELINKED 10
+// arg=count, data[] count object names (asciiz), back to back
+// reply arg=status, data[] count zx_loader_svc_prelink_t, one per name
+// reply includes, for each name whose status is ZX_OK, its vmo handle,
+// followed by a second vmo handle if its bias is not zero: a copy of the
+// object with its relative relocations applied for that load bias.
+// A service which does not prelink replies with every bias zero.
+
+typedef struct zx_loader_svc_prelink {
+    int32_t status;
+    uint32_t reserved;
+    uint64_t bias;
+} zx_loader_svc_prelink_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -71,6 +71,9 @@
 #define ZX_DEFAULT_VMAR_RIGHTS \
     (ZX_RIGHTS_BASIC)
 
+#define ZX_DEFAULT_WAIT_SET_RIGHTS \
+    (ZX_RIGHT_DUPLICATE | ZX_RIGHT_TRANSFER | ZX_RIGHTS_IO)
+
 #define ZX_DEFAULT_VMO_RIGHTS\
     (ZX_RIGHTS_BASIC | ZX_RIGHTS_IO | ZX_RIGHTS_PROPERTY |\
      ZX_RIGHT_EXECUTE | ZX_RIGHT_MAP | ZX_RIGHT_SIGNAL)
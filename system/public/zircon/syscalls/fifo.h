@@ -0,0 +1,45 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// zx_fifo_create() options
+
+// Keep the entries of both directions in a VMO which the endpoints can map
+// with zx_fifo_get_ring(), so that entries can be moved with plain memory
+// operations. zx_fifo_read() and zx_fifo_write() keep working on such fifos.
+#define ZX_FIFO_SHARED_RING         1u
+
+// The indices of one direction of a shared ring fifo. Both are free running:
+// entry |i| lives in slot |i & (elem_count - 1)|, and |head - tail| entries,
+// never more than elem_count, are queued. Each index sits on its own cache
+// line.
+typedef struct zx_fifo_ring_header {
+    // Advanced by the writer once the entries before it are in place.
+    uint32_t head;
+    uint32_t reserved0[15];
+    // Advanced by the reader once it is done with the entries before it.
+    uint32_t tail;
+    uint32_t reserved1[15];
+} zx_fifo_ring_header_t;
+
+// Describes the ring VMO of a shared ring fifo as seen from one endpoint.
+// Offsets are in bytes from the start of the VMO.
+typedef struct zx_fifo_ring_info {
+    uint32_t elem_count;
+    uint32_t elem_size;
+    // The direction this endpoint reads.
+    uint64_t rx_header_offset;
+    uint64_t rx_data_offset;
+    // The direction this endpoint writes.
+    uint64_t tx_header_offset;
+    uint64_t tx_data_offset;
+    uint64_t vmo_size;
+} zx_fifo_ring_info_t;
+
+__END_CDECLS
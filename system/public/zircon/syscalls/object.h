@@ -55,6 +55,7 @@ typedef enum {
     ZX_OBJ_TYPE_VCPU                = 21,
     ZX_OBJ_TYPE_TIMER               = 22,
     ZX_OBJ_TYPE_IOMMU               = 23,
+    ZX_OBJ_TYPE_WAIT_SET            = 24,
     ZX_OBJ_TYPE_LAST
 } zx_obj_type_t;
 
@@ -376,6 +377,10 @@ typedef struct zx_info_resource {
 // Argument is an zx_job_importance_t value.
 #define ZX_PROP_JOB_IMPORTANCE             7u
 
+// Argument is a size_t, the number of bytes a socket endpoint buffers for
+// reading. Larger values are backed by page-sized buffers.
+#define ZX_PROP_SOCKET_RX_BUF_MAX           8u
+
 // Describes how important a job is.
 typedef int32_t zx_job_importance_t;
 
@@ -181,6 +181,17 @@ typedef struct {
     zx_signals_t pending;
 } zx_wait_item_t;
 
+// zx_waitset_add() options
+#define ZX_WAITSET_LEVEL_TRIGGERED 0u
+#define ZX_WAITSET_EDGE_TRIGGERED  1u
+
+// Structure for zx_waitset_wait():
+typedef struct {
+    uint64_t cookie;
+    zx_status_t status;
+    zx_signals_t observed;
+} zx_waitset_result_t;
+
 typedef uint32_t zx_rights_t;
 #define ZX_RIGHT_NONE             ((zx_rights_t)0u)
 #define ZX_RIGHT_DUPLICATE        ((zx_rights_t)1u << 0)
@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <threads.h>
 
 #include <zircon/compiler.h>
 #include <zircon/syscalls.h>
@@ -112,6 +113,91 @@ void do_test(uint32_t duration, const TestArgs& test_args) {
            test_args.size, test_args.handles, test_args.queue, its_per_second);
 }
 
+// Echoes every message it reads from |arg| back until the peer goes away.
+int call_server(void* arg) {
+    zx_handle_t channel = static_cast<zx_handle_t>(reinterpret_cast<uintptr_t>(arg));
+    uint8_t data[ZX_CHANNEL_MAX_MSG_BYTES];
+    for (;;) {
+        zx_signals_t pending;
+        zx_status_t status = zx_object_wait_one(channel,
+                                                ZX_CHANNEL_READABLE | ZX_CHANNEL_PEER_CLOSED,
+                                                ZX_TIME_INFINITE, &pending);
+        if (status != ZX_OK || !(pending & ZX_CHANNEL_READABLE))
+            break;
+
+        uint32_t r_size;
+        uint32_t r_handles;
+        status = zx_channel_read(channel, 0u, data, nullptr, sizeof(data), 0u,
+                                 &r_size, &r_handles);
+        if (status != ZX_OK)
+            break;
+        status = zx_channel_write(channel, 0u, data, r_size, nullptr, 0u);
+        if (status != ZX_OK)
+            break;
+    }
+    zx_handle_close(channel);
+    return 0;
+}
+
+// Measures zx_channel_call() round trips to a server thread.
+void do_call_test(uint32_t duration, uint32_t size) {
+    __UNUSED zx_status_t status;
+
+    uint64_t duration_ns = duration * 1000000000ull;
+
+    // Room for the transaction id.
+    if (size < sizeof(zx_txid_t))
+        size = sizeof(zx_txid_t);
+
+    zx_handle_t mp[2] = {ZX_HANDLE_INVALID, ZX_HANDLE_INVALID};
+    status = zx_channel_create(0u, &mp[0], &mp[1]);
+    assert(status == ZX_OK);
+
+    thrd_t server;
+    int rc = thrd_create(&server, call_server, reinterpret_cast<void*>(
+                                                   static_cast<uintptr_t>(mp[1])));
+    assert(rc == thrd_success);
+
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[size]);
+    fbl::unique_ptr<uint8_t[]> reply(new uint8_t[size]);
+    for (uint32_t i = 0; i < size; i++)
+        data[i] = static_cast<uint8_t>(i);
+
+    zx_channel_call_args_t args = {
+        data.get(), nullptr, reply.get(), nullptr, size, 0u, size, 0u,
+    };
+
+    static constexpr uint32_t big_it_size = 1000;
+    uint64_t big_its = 0;
+    uint64_t start_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            uint32_t r_size;
+            uint32_t r_handles;
+            zx_status_t read_status;
+            status = zx_channel_call(mp[0], 0u, ZX_TIME_INFINITE, &args, &r_size, &r_handles,
+                                     &read_status);
+            assert(status == ZX_OK);
+            assert(r_size == size);
+        }
+
+        end_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    status = zx_handle_close(mp[0]);
+    assert(status == ZX_OK);
+    thrd_join(server, nullptr);
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    double its_per_second = static_cast<double>(big_its) * big_it_size / real_duration;
+    printf("call %" PRIu32 " bytes: %.0f round trips/second (%.0f ns/round trip)\n",
+           size, its_per_second, 1000000000.0 / its_per_second);
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -122,6 +208,7 @@ int main(int argc, char** argv) {
         "  -h    show help (this)\n"
         "  -o    run single test (default)\n"
         "  -s    run suite (ignores -S/-H/-Q)\n"
+        "  -c    run channel call round trips to a server thread (ignores -H/-Q)\n"
         "  -n N  set test repetition count to N (default: 1)\n"
         "  -d N  set test duration to N seconds (default: 5)\n"
         "  -S N  set message size to N bytes (default: 10)\n"
@@ -129,6 +216,7 @@ int main(int argc, char** argv) {
         "  -Q N  set message pre-queue count to N messages (default: 0)\n";
 
     bool run_suite = false;  // -o/-s
+    bool run_call = false;   // -c
     uint32_t duration = 5;   // -d
     uint32_t repeats = 1;    // -n
     // Ignored when running a suite:
@@ -139,7 +227,7 @@ int main(int argc, char** argv) {
     };
 
     int opt;
-    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:")) != -1) {
+    while ((opt = getopt(argc, argv, "+hoscn:d:S:H:Q:")) != -1) {
         // Our option values are always unsigned numbers.
         uint32_t value = 0;
         if (optarg) {
@@ -161,6 +249,9 @@ int main(int argc, char** argv) {
             case 's':
                 run_suite = true;
                 break;
+            case 'c':
+                run_call = true;
+                break;
             case 'n':
                 assert(optarg);
                 repeats = value;
@@ -197,7 +288,9 @@ int main(int argc, char** argv) {
                    repeats);
         }
 
-        if (run_suite) {
+        if (run_call) {
+            do_call_test(duration, test_args.size);
+        } else if (run_suite) {
             static constexpr TestArgs suite[] = {
                 {10, 0, 0},
                 {100, 0, 0},
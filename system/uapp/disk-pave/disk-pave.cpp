@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include <block-client/client.h>
@@ -24,6 +25,7 @@
 #include <fs/mapped-vmo.h>
 #include <gpt/cros.h>
 #include <gpt/gpt.h>
+#include <sync/completion.h>
 #include <zircon/device/block.h>
 #include <zircon/device/device.h>
 #include <zircon/syscalls.h>
@@ -108,11 +110,112 @@ zx_status_t register_fast_block_io(const fbl::unique_fd& fd, zx_handle_t vmo,
     return ZX_OK;
 }
 
+// Streams an image to a block device, overlapping reads from the source with
+// writes to disk. The VMO is split in two halves: while one half is written out
+// by a helper thread, the caller fills the other with the next chunk of the
+// image.
+class StreamWriter {
+public:
+    StreamWriter(MappedVmo* mvmo, fifo_client_t* client, const block_fifo_request_t& request)
+        : mvmo_(mvmo), client_(client), request_(request), capacity_(mvmo->GetSize() / 2) {
+        // No write is outstanding yet
+        completion_signal(&done_);
+    }
+    ~StreamWriter();
+
+    zx_status_t Start();
+
+    // The half of the VMO which may currently be filled.
+    uint8_t* buffer() const {
+        return reinterpret_cast<uint8_t*>(mvmo_->GetData()) + current_ * capacity_;
+    }
+    size_t capacity() const { return capacity_; }
+
+    // Queues |length| bytes of buffer() to be written at |dev_offset|, and
+    // switches buffer() to the other half. Returns the status of the write
+    // previously issued from that half, which must complete first.
+    zx_status_t Write(size_t length, uint64_t dev_offset);
+
+    // Waits for the outstanding write, if any, and returns its status.
+    zx_status_t Flush();
+
+private:
+    static int WriterThread(void* arg);
+
+    MappedVmo* mvmo_;
+    fifo_client_t* client_;
+    block_fifo_request_t request_;
+    const size_t capacity_;
+    size_t current_ = 0;
+
+    thrd_t thread_;
+    bool started_ = false;
+    bool stop_ = false;
+    completion_t queued_;
+    completion_t done_;
+    zx_status_t status_ = ZX_OK;
+};
+
+StreamWriter::~StreamWriter() {
+    if (started_) {
+        Flush();
+        stop_ = true;
+        completion_signal(&queued_);
+        thrd_join(thread_, nullptr);
+    }
+}
+
+zx_status_t StreamWriter::Start() {
+    if (thrd_create_with_name(&thread_, WriterThread, this, "paver-writer") != thrd_success) {
+        ERROR("Couldn't create writer thread\n");
+        return ZX_ERR_NO_RESOURCES;
+    }
+    started_ = true;
+    return ZX_OK;
+}
+
+zx_status_t StreamWriter::Write(size_t length, uint64_t dev_offset) {
+    zx_status_t status = Flush();
+    if (status != ZX_OK) {
+        return status;
+    }
+    completion_reset(&done_);
+    request_.length = length;
+    request_.vmo_offset = current_ * capacity_;
+    request_.dev_offset = dev_offset;
+    completion_signal(&queued_);
+    current_ ^= 1;
+    return ZX_OK;
+}
+
+zx_status_t StreamWriter::Flush() {
+    completion_wait(&done_, ZX_TIME_INFINITE);
+    return status_;
+}
+
+int StreamWriter::WriterThread(void* arg) {
+    StreamWriter* writer = static_cast<StreamWriter*>(arg);
+    while (true) {
+        completion_wait(&writer->queued_, ZX_TIME_INFINITE);
+        completion_reset(&writer->queued_);
+        if (writer->stop_) {
+            return 0;
+        }
+        writer->status_ = block_fifo_txn(writer->client_, &writer->request_, 1);
+        completion_signal(&writer->done_);
+    }
+}
+
 // Stream an FVM partition to disk.
 zx_status_t stream_fvm_partition(partition_info* part, MappedVmo* mvmo,
                                  fifo_client_t* client, size_t slice_size,
                                  block_fifo_request_t* request, const fbl::unique_fd& src_fd) {
-    const size_t vmo_cap = mvmo->GetSize();
+    StreamWriter writer(mvmo, client, *request);
+    zx_status_t status;
+    if ((status = writer.Start()) != ZX_OK) {
+        return status;
+    }
+    const size_t buf_cap = writer.capacity();
     for (size_t e = 0; e < part->pd->extent_count; e++) {
         LOG("Writing extent %zu... \n", e);
         fvm::extent_descriptor_t* ext = get_extent(part->pd, e);
@@ -122,16 +225,17 @@ zx_status_t stream_fvm_partition(partition_info* part, MappedVmo* mvmo,
         // Write real data
         while (bytes_left > 0) {
             ssize_t r;
-            size_t vmo_sz = 0;
-            while ((r = read(src_fd.get(), &reinterpret_cast<uint8_t*>(mvmo->GetData())[vmo_sz],
-                             fbl::min(bytes_left, vmo_cap - vmo_sz))) > 0) {
-                vmo_sz += r;
+            size_t buf_sz = 0;
+            uint8_t* buf = writer.buffer();
+            while ((r = read(src_fd.get(), &buf[buf_sz],
+                             fbl::min(bytes_left, buf_cap - buf_sz))) > 0) {
+                buf_sz += r;
                 bytes_left -= r;
                 if (bytes_left == 0) {
                     break;
                 }
             }
-            if (vmo_sz == 0) {
+            if (buf_sz == 0) {
                 ERROR("Read nothing from src_fd; %zu bytes left\n", bytes_left);
                 return ZX_ERR_IO;
             }
@@ -140,16 +244,12 @@ zx_status_t stream_fvm_partition(partition_info* part, MappedVmo* mvmo,
                 return static_cast<zx_status_t>(r);
             }
 
-            request->length = vmo_sz;
-            request->vmo_offset = 0;
-            request->dev_offset = offset;
-
-            if ((r = block_fifo_txn(client, request, 1)) != ZX_OK) {
+            if ((status = writer.Write(buf_sz, offset)) != ZX_OK) {
                 ERROR("Error writing partition data\n");
-                return static_cast<zx_status_t>(r);
+                return status;
             }
 
-            offset += request->length;
+            offset += buf_sz;
         }
 
         // Write trailing zeroes (which are implied, but were omitted from
@@ -157,41 +257,50 @@ zx_status_t stream_fvm_partition(partition_info* part, MappedVmo* mvmo,
         bytes_left = (ext->slice_count * slice_size) - ext->extent_length;
         if (bytes_left > 0) {
             LOG("%zu bytes written, %zu zeroes left\n", ext->extent_length, bytes_left);
-            memset(mvmo->GetData(), 0, vmo_cap);
+            // Both halves are cleared, so the last chunk of data must be on disk first
+            if ((status = writer.Flush()) != ZX_OK) {
+                ERROR("Error writing partition data\n");
+                return status;
+            }
+            memset(mvmo->GetData(), 0, mvmo->GetSize());
         }
         while (bytes_left > 0) {
-            request->length = fbl::min(bytes_left, vmo_cap);
-            request->vmo_offset = 0;
-            request->dev_offset = offset;
-
-            zx_status_t status;
-            if ((status = block_fifo_txn(client, request, 1)) != ZX_OK) {
+            size_t length = fbl::min(bytes_left, buf_cap);
+            if ((status = writer.Write(length, offset)) != ZX_OK) {
                 ERROR("Error writing trailing zeroes\n");
                 return status;
             }
 
-            offset += request->length;
-            bytes_left -= request->length;
+            offset += length;
+            bytes_left -= length;
         }
     }
-    return ZX_OK;
+    if ((status = writer.Flush()) != ZX_OK) {
+        ERROR("Error writing partition data\n");
+    }
+    return status;
 }
 
 // Stream a raw (non-FVM) partition to disk.
 zx_status_t stream_partition(MappedVmo* mvmo, fifo_client_t* client,
                              block_fifo_request_t* request, const fbl::unique_fd& src_fd,
                              const block_info_t& info) {
-    const size_t vmo_cap = mvmo->GetSize();
-    ZX_ASSERT(vmo_cap % info.block_size == 0);
+    StreamWriter writer(mvmo, client, *request);
+    zx_status_t status;
+    if ((status = writer.Start()) != ZX_OK) {
+        return status;
+    }
+    const size_t buf_cap = writer.capacity();
+    ZX_ASSERT(buf_cap % info.block_size == 0);
     size_t offset = 0;
 
     while (true) {
         ssize_t r;
-        size_t vmo_sz = 0;
-        while ((r = read(src_fd.get(), &reinterpret_cast<uint8_t*>(mvmo->GetData())[vmo_sz],
-                         vmo_cap - vmo_sz)) > 0) {
-            vmo_sz += r;
-            if (vmo_cap - vmo_sz == 0) {
+        size_t buf_sz = 0;
+        uint8_t* buf = writer.buffer();
+        while ((r = read(src_fd.get(), &buf[buf_sz], buf_cap - buf_sz)) > 0) {
+            buf_sz += r;
+            if (buf_cap - buf_sz == 0) {
                 // The buffer is full, let's write to disk.
                 break;
             }
@@ -200,36 +309,35 @@ zx_status_t stream_partition(MappedVmo* mvmo, fifo_client_t* client,
             ERROR("Error reading partition data\n");
             return static_cast<zx_status_t>(r);
         }
-        if (vmo_sz == 0) {
+        if (buf_sz == 0) {
             // Nothing left to write.
-            return ZX_OK;
+            break;
         }
 
-        if ((r == 0) && (vmo_sz % info.block_size)) {
+        if ((r == 0) && (buf_sz % info.block_size)) {
             // We have a partial block to write.
-            size_t rounded_length = fbl::round_up(vmo_sz, info.block_size);
-            memset(&reinterpret_cast<uint8_t*>(mvmo->GetData())[vmo_sz], 0,
-                   rounded_length - vmo_sz);
-            vmo_sz = rounded_length;
+            size_t rounded_length = fbl::round_up(buf_sz, info.block_size);
+            memset(&buf[buf_sz], 0, rounded_length - buf_sz);
+            buf_sz = rounded_length;
         }
 
-        request->length = vmo_sz;
-        request->vmo_offset = 0;
-        request->dev_offset = offset;
-
-        zx_status_t status;
-        if ((status = block_fifo_txn(client, request, 1)) != ZX_OK) {
+        if ((status = writer.Write(buf_sz, offset)) != ZX_OK) {
             ERROR("Error writing partition data\n");
             return status;
         }
 
         if (r == 0) {
             // We have nothing left to read on the input pipe.
-            return ZX_OK;
+            break;
         }
 
-        offset += request->length;
+        offset += buf_sz;
     }
+
+    if ((status = writer.Flush()) != ZX_OK) {
+        ERROR("Error writing partition data\n");
+    }
+    return status;
 }
 
 // Finds a partition with "FVM type GUID" within a GPT,
@@ -1058,7 +1166,8 @@ zx_status_t partition_pave(fbl::unique_fd fd) {
         return status;
     }
 
-    const size_t vmo_sz = fbl::round_up(1LU << 20, info.block_size);
+    // Two halves of 512KiB, one being read into while the other is written out
+    const size_t vmo_sz = 2 * fbl::round_up(1LU << 19, info.block_size);
     fbl::unique_ptr<MappedVmo> mvmo;
     if ((status = MappedVmo::Create(vmo_sz, "partition-pave", &mvmo)) != ZX_OK) {
         ERROR("Failed to create stream VMO\n");
@@ -0,0 +1,223 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <threads.h>
+
+#include <zircon/compiler.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/object.h>
+#include <fbl/algorithm.h>
+#include <fbl/unique_ptr.h>
+
+namespace {
+
+void argument_error(const char* argv0, const char* message) {
+    fprintf(stderr, "%s: error: %s\nRun with -h for help.\n", argv0, message);
+    exit(EXIT_FAILURE);
+}
+
+struct TestArgs {
+    uint32_t size;
+    // Receive buffer size of the reading end, or 0 for the default.
+    uint32_t buffer;
+};
+
+struct ReaderArgs {
+    zx_handle_t socket;
+    uint32_t size;
+    uint64_t total;
+};
+
+// Reads until the peer goes away, counting the bytes received.
+int reader_thread(void* arg) {
+    ReaderArgs* args = static_cast<ReaderArgs*>(arg);
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[args->size]);
+
+    for (;;) {
+        size_t actual;
+        zx_status_t status = zx_socket_read(args->socket, 0u, data.get(), args->size, &actual);
+        if (status == ZX_OK) {
+            args->total += actual;
+            continue;
+        }
+        if (status != ZX_ERR_SHOULD_WAIT)
+            break;
+        zx_signals_t pending;
+        status = zx_object_wait_one(args->socket, ZX_SOCKET_READABLE | ZX_SOCKET_PEER_CLOSED,
+                                    ZX_TIME_INFINITE, &pending);
+        assert(status == ZX_OK);
+    }
+    return 0;
+}
+
+void do_test(uint32_t duration, const TestArgs& test_args) {
+    __UNUSED zx_status_t status;
+
+    uint64_t duration_ns = duration * 1000000000ull;
+
+    // We'll write to sp[0] (and read from sp[1] on another thread).
+    zx_handle_t sp[2] = {ZX_HANDLE_INVALID, ZX_HANDLE_INVALID};
+    status = zx_socket_create(0u, &sp[0], &sp[1]);
+    assert(status == ZX_OK);
+
+    if (test_args.buffer) {
+        size_t buffer = test_args.buffer;
+        status = zx_object_set_property(sp[1], ZX_PROP_SOCKET_RX_BUF_MAX,
+                                        &buffer, sizeof(buffer));
+        assert(status == ZX_OK);
+    }
+    size_t buffer = 0;
+    status = zx_object_get_property(sp[1], ZX_PROP_SOCKET_RX_BUF_MAX, &buffer, sizeof(buffer));
+    assert(status == ZX_OK);
+
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[test_args.size]);
+    for (uint32_t i = 0; i < test_args.size; i++)
+        data[i] = static_cast<uint8_t>(i);
+
+    ReaderArgs reader_args = {sp[1], test_args.size, 0u};
+    thrd_t reader;
+    int ret = thrd_create_with_name(&reader, reader_thread, &reader_args, "socket-perf-reader");
+    assert(ret == thrd_success);
+
+    uint64_t written = 0;
+    uint64_t start_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        size_t actual;
+        status = zx_socket_write(sp[0], 0u, data.get(), test_args.size, &actual);
+        if (status == ZX_OK) {
+            written += actual;
+        } else {
+            assert(status == ZX_ERR_SHOULD_WAIT);
+            zx_signals_t pending;
+            status = zx_object_wait_one(sp[0], ZX_SOCKET_WRITABLE, ZX_TIME_INFINITE, &pending);
+            assert(status == ZX_OK);
+        }
+
+        end_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    status = zx_handle_close(sp[0]);
+    assert(status == ZX_OK);
+    ret = thrd_join(reader, nullptr);
+    assert(ret == thrd_success);
+    status = zx_handle_close(sp[1]);
+    assert(status == ZX_OK);
+    assert(reader_args.total == written);
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    double mb_per_second = static_cast<double>(written) / (1024.0 * 1024.0) / real_duration;
+    printf("write/read %" PRIu32 " bytes, %zu byte buffer: %.1f MB/second\n",
+           test_args.size, buffer, mb_per_second);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static constexpr char help[] =
+        "Usage: %s [options ...]\n"
+        "\n"
+        "Options:\n"
+        "  -h    show help (this)\n"
+        "  -o    run single test (default)\n"
+        "  -s    run suite (ignores -S/-B)\n"
+        "  -n N  set test repetition count to N (default: 1)\n"
+        "  -d N  set test duration to N seconds (default: 5)\n"
+        "  -S N  set write size to N bytes (default: 65536)\n"
+        "  -B N  set socket receive buffer to N bytes (default: kernel default)\n";
+
+    bool run_suite = false;  // -o/-s
+    uint32_t duration = 5;   // -d
+    uint32_t repeats = 1;    // -n
+    // Ignored when running a suite:
+    TestArgs test_args = {
+        65536,               // -S (size)
+        0                    // -B (buffer)
+    };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "+hosn:d:S:B:")) != -1) {
+        // Our option values are always unsigned numbers.
+        uint32_t value = 0;
+        if (optarg) {
+            errno = 0;
+            char* endptr = nullptr;
+            unsigned long long v = strtoull(optarg, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || v > UINT32_MAX)
+                argument_error(argv[0], "invalid numeric optional value");
+            value = static_cast<uint32_t>(v);
+        }
+
+        switch (opt) {
+            case 'h':
+                printf(help, argv[0]);
+                return EXIT_SUCCESS;
+            case 'o':
+                run_suite = false;
+                break;
+            case 's':
+                run_suite = true;
+                break;
+            case 'n':
+                assert(optarg);
+                repeats = value;
+                break;
+            case 'd':
+                assert(optarg);
+                duration = value;
+                break;
+            case 'S':
+                assert(optarg);
+                if (value == 0)
+                    argument_error(argv[0], "write size must be nonzero");
+                test_args.size = value;
+                break;
+            case 'B':
+                assert(optarg);
+                test_args.buffer = value;
+                break;
+            default:  // '?'
+                argument_error(argv[0], "invalid option");
+                break;
+        }
+    }
+    if (optind < argc)
+        argument_error(argv[0], "unexpected positional argument");
+
+    for (uint32_t i = 0; i < repeats; i++) {
+        if (repeats > 1u) {
+            if (i > 0u)
+                printf("\n");
+            printf("Test iteration #%" PRIu32 " (of %" PRIu32 "):\n", i + 1,
+                   repeats);
+        }
+
+        if (run_suite) {
+            static constexpr TestArgs suite[] = {
+                {100, 0},
+                {1000, 0},
+                {4096, 0},
+                {65536, 0},
+                {4096, 4 * 1024 * 1024},
+                {65536, 4 * 1024 * 1024},
+                {1024 * 1024, 4 * 1024 * 1024},
+            };
+            for (size_t i = 0; i < fbl::count_of(suite); i++)
+                do_test(duration, suite[i]);
+        } else {
+            do_test(duration, test_args);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
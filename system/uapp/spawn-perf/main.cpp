@@ -0,0 +1,156 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures how many processes per second launchpad can start, loading
+// each one from its file or from a launchpad ELF cache.  The processes
+// started are this same program, run with -c so that it exits at once.
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <launchpad/launchpad.h>
+#include <zircon/compiler.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/object.h>
+
+namespace {
+
+constexpr char kProgram[] = "/boot/bin/spawn-perf";
+
+void argument_error(const char* argv0, const char* message) {
+    fprintf(stderr, "%s: error: %s\nRun with -h for help.\n", argv0, message);
+    exit(EXIT_FAILURE);
+}
+
+// Starts one child, loading it from |cache| if that is not null, and waits
+// for it to exit.
+void spawn_one(const launchpad_elf_cache_t* cache) {
+    __UNUSED zx_status_t status;
+
+    launchpad_t* lp;
+    launchpad_create(ZX_HANDLE_INVALID, "spawn-perf child", &lp);
+    const char* const argv[] = {kProgram, "-c"};
+    launchpad_set_args(lp, 2, argv);
+    if (cache != nullptr) {
+        launchpad_load_from_elf_cache(lp, cache);
+    } else {
+        launchpad_load_from_file(lp, kProgram);
+    }
+
+    zx_handle_t proc;
+    const char* errmsg;
+    status = launchpad_go(lp, &proc, &errmsg);
+    if (status != ZX_OK) {
+        fprintf(stderr, "launchpad failed: %s: %d\n", errmsg, status);
+        exit(EXIT_FAILURE);
+    }
+
+    status = zx_object_wait_one(proc, ZX_PROCESS_TERMINATED, ZX_TIME_INFINITE, nullptr);
+    assert(status == ZX_OK);
+    zx_info_process_t info;
+    status = zx_object_get_info(proc, ZX_INFO_PROCESS, &info, sizeof(info), nullptr, nullptr);
+    assert(status == ZX_OK);
+    assert(info.return_code == 0);
+    zx_handle_close(proc);
+}
+
+void do_test(uint32_t duration, const char* label, const launchpad_elf_cache_t* cache) {
+    // Warm up the loader service's caches and the page cache.
+    spawn_one(cache);
+
+    uint64_t duration_ns = duration * 1000000000ull;
+    uint64_t spawns = 0;
+    uint64_t start_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        spawn_one(cache);
+        spawns++;
+        end_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    printf("%-9s: %.0f spawns/second, %.1f us/spawn\n", label,
+           static_cast<double>(spawns) / real_duration,
+           real_duration * 1000000.0 / static_cast<double>(spawns));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static constexpr char help[] =
+        "Usage: %s [options ...]\n"
+        "\n"
+        "Options:\n"
+        "  -h    show help (this)\n"
+        "  -n N  set test repetition count to N (default: 1)\n"
+        "  -d N  set test duration to N seconds (default: 1)\n"
+        "  -c    exit immediately (used for the processes started)\n";
+
+    uint32_t duration = 1;   // -d
+    uint32_t repeats = 1;    // -n
+
+    int opt;
+    while ((opt = getopt(argc, argv, "+hcn:d:")) != -1) {
+        // Our option values are always unsigned numbers.
+        uint32_t value = 0;
+        if (optarg) {
+            errno = 0;
+            char* endptr = nullptr;
+            unsigned long long v = strtoull(optarg, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || v > UINT32_MAX)
+                argument_error(argv[0], "invalid numeric optional value");
+            value = static_cast<uint32_t>(v);
+        }
+
+        switch (opt) {
+            case 'h':
+                printf(help, argv[0]);
+                return EXIT_SUCCESS;
+            case 'c':
+                return EXIT_SUCCESS;
+            case 'n':
+                assert(optarg);
+                repeats = value;
+                break;
+            case 'd':
+                assert(optarg);
+                duration = value;
+                break;
+            default:  // '?'
+                argument_error(argv[0], "invalid option");
+                break;
+        }
+    }
+    if (optind < argc)
+        argument_error(argv[0], "unexpected positional argument");
+
+    launchpad_elf_cache_t* cache;
+    zx_status_t status = launchpad_elf_cache_create_from_file(kProgram, &cache);
+    if (status != ZX_OK) {
+        fprintf(stderr, "%s: cannot create ELF cache from %s: %d\n", argv[0], kProgram, status);
+        return EXIT_FAILURE;
+    }
+
+    for (uint32_t i = 0; i < repeats; i++) {
+        if (repeats > 1u) {
+            if (i > 0u)
+                printf("\n");
+            printf("Test iteration #%" PRIu32 " (of %" PRIu32 "):\n", i + 1,
+                   repeats);
+        }
+
+        do_test(duration, "file", nullptr);
+        do_test(duration, "elf cache", cache);
+    }
+
+    launchpad_elf_cache_destroy(cache);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures libc's string and memory routines on inputs from 1 byte to
+// 1 MiB.  Each routine is made to scan its whole input: searches look for
+// a byte that is only at the end, and comparisons are of equal buffers.
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zircon/compiler.h>
+#include <zircon/syscalls.h>
+#include <fbl/algorithm.h>
+#include <fbl/unique_ptr.h>
+
+namespace {
+
+constexpr size_t kMaxSize = 1 << 20;
+
+void argument_error(const char* argv0, const char* message) {
+    fprintf(stderr, "%s: error: %s\nRun with -h for help.\n", argv0, message);
+    exit(EXIT_FAILURE);
+}
+
+// Keeps the compiler from hoisting a call out of the timing loop, or from
+// assuming it knows what the buffers hold.
+template <typename T>
+void escape(T value) {
+    __asm__ volatile("" : : "r"(value) : "memory");
+}
+
+struct Buffers {
+    char* left;
+    char* right;
+    size_t size;
+};
+
+struct Routine {
+    const char* name;
+    void (*run)(const Buffers& bufs);
+};
+
+// Each buffer holds |size| - 1 'a's, then 'z' at |size| - 1 and a NUL
+// terminator after it.
+const Routine kRoutines[] = {
+    {"strlen", [](const Buffers& b) { escape(strlen(b.left)); }},
+    {"strchr", [](const Buffers& b) { escape(strchr(b.left, 'z')); }},
+    {"memchr", [](const Buffers& b) { escape(memchr(b.left, 'z', b.size)); }},
+    {"memrchr", [](const Buffers& b) { escape(memrchr(b.left, '\0', b.size)); }},
+    {"memcmp", [](const Buffers& b) { escape(memcmp(b.left, b.right, b.size)); }},
+    {"strcmp", [](const Buffers& b) { escape(strcmp(b.left, b.right)); }},
+};
+
+void fill(char* buf, size_t size) {
+    memset(buf, 'a', size - 1);
+    buf[size - 1] = 'z';
+    buf[size] = '\0';
+}
+
+// Runs |routine| on inputs of |size| bytes for about |duration_ms|.
+void do_test(uint32_t duration_ms, const Routine& routine, size_t size,
+             char* left, char* right) {
+    fill(left, size);
+    fill(right, size);
+    Buffers bufs = {left, right, size};
+
+    uint64_t duration_ns = duration_ms * 1000000ull;
+    // Check the clock only every so often, so it stays out of the
+    // measurement for small sizes.
+    uint64_t batch = size < 4096 ? 4096 / size : 1;
+    uint64_t calls = 0;
+    uint64_t start_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        for (uint64_t i = 0; i < batch; i++) {
+            escape(left);
+            routine.run(bufs);
+        }
+        calls += batch;
+        end_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+        if (end_ns - start_ns >= duration_ns)
+            break;
+    }
+
+    double ns_per_call = static_cast<double>(end_ns - start_ns) / static_cast<double>(calls);
+    printf("%-8s %8zu bytes: %10.1f ns/call %8.2f GB/s\n", routine.name, size,
+           ns_per_call, static_cast<double>(size) / ns_per_call);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static constexpr char help[] =
+        "Usage: %s [options ...] [routine ...]\n"
+        "\n"
+        "Routines: strlen strchr memchr memrchr memcmp strcmp (default: all)\n"
+        "\n"
+        "Options:\n"
+        "  -h    show help (this)\n"
+        "  -d N  time each routine and size for N milliseconds (default: 100)\n";
+
+    uint32_t duration_ms = 100;   // -d
+
+    int opt;
+    while ((opt = getopt(argc, argv, "+hd:")) != -1) {
+        // Our option values are always unsigned numbers.
+        uint32_t value = 0;
+        if (optarg) {
+            errno = 0;
+            char* endptr = nullptr;
+            unsigned long long v = strtoull(optarg, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || v > UINT32_MAX)
+                argument_error(argv[0], "invalid numeric optional value");
+            value = static_cast<uint32_t>(v);
+        }
+
+        switch (opt) {
+            case 'h':
+                printf(help, argv[0]);
+                return EXIT_SUCCESS;
+            case 'd':
+                assert(optarg);
+                duration_ms = value;
+                break;
+            default:  // '?'
+                argument_error(argv[0], "invalid option");
+                break;
+        }
+    }
+
+    bool selected[fbl::count_of(kRoutines)] = {};
+    bool any_selected = false;
+    for (int i = optind; i < argc; i++) {
+        size_t r = 0;
+        while (r < fbl::count_of(kRoutines) && strcmp(argv[i], kRoutines[r].name) != 0)
+            r++;
+        if (r == fbl::count_of(kRoutines))
+            argument_error(argv[0], "unknown routine");
+        selected[r] = true;
+        any_selected = true;
+    }
+
+    fbl::unique_ptr<char[]> left(new char[kMaxSize + 1]);
+    fbl::unique_ptr<char[]> right(new char[kMaxSize + 1]);
+
+    for (size_t r = 0; r < fbl::count_of(kRoutines); r++) {
+        if (any_selected && !selected[r])
+            continue;
+        for (size_t size = 1; size <= kMaxSize; size *= 4)
+            do_test(duration_ms, kRoutines[r], size, left.get(), right.get());
+    }
+
+    return EXIT_SUCCESS;
+}
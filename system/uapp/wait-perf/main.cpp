@@ -0,0 +1,227 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Compares the cost of waiting for one ready handle out of N watched ones
+// using zx_object_wait_many(), a port with repeating async waits, and a
+// wait set.
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <zircon/compiler.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/port.h>
+#include <fbl/algorithm.h>
+#include <fbl/unique_ptr.h>
+
+namespace {
+
+void argument_error(const char* argv0, const char* message) {
+    fprintf(stderr, "%s: error: %s\nRun with -h for help.\n", argv0, message);
+    exit(EXIT_FAILURE);
+}
+
+enum class Mechanism {
+    kWaitMany,
+    kPort,
+    kWaitSet,
+};
+
+const char* mechanism_name(Mechanism mechanism) {
+    switch (mechanism) {
+    case Mechanism::kWaitMany:
+        return "wait_many";
+    case Mechanism::kPort:
+        return "port";
+    case Mechanism::kWaitSet:
+        return "waitset";
+    }
+    return "???";
+}
+
+// Each iteration signals one of |count| events, waits for it with
+// |mechanism| and clears it again.
+void do_test(uint32_t duration, Mechanism mechanism, uint32_t count) {
+    __UNUSED zx_status_t status;
+
+    if (mechanism == Mechanism::kWaitMany && count > ZX_WAIT_MANY_MAX_ITEMS) {
+        printf("%-9s %5" PRIu32 " handles: unsupported\n", mechanism_name(mechanism), count);
+        return;
+    }
+
+    uint64_t duration_ns = duration * 1000000000ull;
+
+    fbl::unique_ptr<zx_handle_t[]> events(new zx_handle_t[count]);
+    for (uint32_t i = 0; i < count; i++) {
+        status = zx_event_create(0u, &events[i]);
+        assert(status == ZX_OK);
+    }
+
+    zx_handle_t waiter = ZX_HANDLE_INVALID;
+    fbl::unique_ptr<zx_wait_item_t[]> items;
+    switch (mechanism) {
+    case Mechanism::kWaitMany:
+        items.reset(new zx_wait_item_t[count]);
+        break;
+    case Mechanism::kPort:
+        status = zx_port_create(0u, &waiter);
+        assert(status == ZX_OK);
+        for (uint32_t i = 0; i < count; i++) {
+            status = zx_object_wait_async(events[i], waiter, i, ZX_EVENT_SIGNALED,
+                                          ZX_WAIT_ASYNC_REPEATING);
+            assert(status == ZX_OK);
+        }
+        break;
+    case Mechanism::kWaitSet:
+        status = zx_waitset_create(0u, &waiter);
+        assert(status == ZX_OK);
+        for (uint32_t i = 0; i < count; i++) {
+            status = zx_waitset_add(waiter, events[i], i, ZX_EVENT_SIGNALED,
+                                    ZX_WAITSET_EDGE_TRIGGERED);
+            assert(status == ZX_OK);
+        }
+        break;
+    }
+
+    static constexpr uint32_t big_it_size = 1000;
+    uint64_t big_its = 0;
+    uint32_t next = 0;
+    uint64_t start_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+    uint64_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            uint32_t index = next;
+            next = (next + 7) % count;
+
+            status = zx_object_signal(events[index], 0u, ZX_EVENT_SIGNALED);
+            assert(status == ZX_OK);
+
+            uint64_t ready = 0;
+            switch (mechanism) {
+            case Mechanism::kWaitMany:
+                for (uint32_t j = 0; j < count; j++)
+                    items[j] = {events[j], ZX_EVENT_SIGNALED, 0u};
+                status = zx_object_wait_many(items.get(), count, ZX_TIME_INFINITE);
+                assert(status == ZX_OK);
+                while (!(items[ready].pending & ZX_EVENT_SIGNALED))
+                    ready++;
+                break;
+            case Mechanism::kPort: {
+                zx_port_packet_t packet;
+                status = zx_port_wait(waiter, ZX_TIME_INFINITE, &packet, 0u);
+                assert(status == ZX_OK);
+                ready = packet.key;
+                break;
+            }
+            case Mechanism::kWaitSet: {
+                zx_waitset_result_t result;
+                uint32_t actual;
+                status = zx_waitset_wait(waiter, ZX_TIME_INFINITE, &result, 1u, &actual);
+                assert(status == ZX_OK);
+                ready = result.cookie;
+                break;
+            }
+            }
+            assert(ready == index);
+
+            status = zx_object_signal(events[index], ZX_EVENT_SIGNALED, 0u);
+            assert(status == ZX_OK);
+        }
+
+        end_ns = zx_time_get(ZX_CLOCK_MONOTONIC);
+        if ((end_ns - start_ns) >= duration_ns)
+            break;
+    }
+
+    if (waiter != ZX_HANDLE_INVALID) {
+        status = zx_handle_close(waiter);
+        assert(status == ZX_OK);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        status = zx_handle_close(events[i]);
+        assert(status == ZX_OK);
+    }
+
+    double real_duration = static_cast<double>(end_ns - start_ns) / 1000000000.0;
+    double its_per_second = static_cast<double>(big_its) * big_it_size / real_duration;
+    printf("%-9s %5" PRIu32 " handles: %.0f wakeups/second\n",
+           mechanism_name(mechanism), count, its_per_second);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    static constexpr char help[] =
+        "Usage: %s [options ...]\n"
+        "\n"
+        "Options:\n"
+        "  -h    show help (this)\n"
+        "  -n N  set test repetition count to N (default: 1)\n"
+        "  -d N  set test duration to N seconds (default: 1)\n";
+
+    uint32_t duration = 1;   // -d
+    uint32_t repeats = 1;    // -n
+
+    int opt;
+    while ((opt = getopt(argc, argv, "+hn:d:")) != -1) {
+        // Our option values are always unsigned numbers.
+        uint32_t value = 0;
+        if (optarg) {
+            errno = 0;
+            char* endptr = nullptr;
+            unsigned long long v = strtoull(optarg, &endptr, 10);
+            if (errno != 0 || *endptr != '\0' || v > UINT32_MAX)
+                argument_error(argv[0], "invalid numeric optional value");
+            value = static_cast<uint32_t>(v);
+        }
+
+        switch (opt) {
+            case 'h':
+                printf(help, argv[0]);
+                return EXIT_SUCCESS;
+            case 'n':
+                assert(optarg);
+                repeats = value;
+                break;
+            case 'd':
+                assert(optarg);
+                duration = value;
+                break;
+            default:  // '?'
+                argument_error(argv[0], "invalid option");
+                break;
+        }
+    }
+    if (optind < argc)
+        argument_error(argv[0], "unexpected positional argument");
+
+    static constexpr uint32_t counts[] = {16, 256, 4096};
+    static constexpr Mechanism mechanisms[] = {
+        Mechanism::kWaitMany,
+        Mechanism::kPort,
+        Mechanism::kWaitSet,
+    };
+
+    for (uint32_t i = 0; i < repeats; i++) {
+        if (repeats > 1u) {
+            if (i > 0u)
+                printf("\n");
+            printf("Test iteration #%" PRIu32 " (of %" PRIu32 "):\n", i + 1,
+                   repeats);
+        }
+
+        for (size_t c = 0; c < fbl::count_of(counts); c++) {
+            for (size_t m = 0; m < fbl::count_of(mechanisms); m++)
+                do_test(duration, mechanisms[m], counts[c]);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -3,24 +3,69 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <stdbool.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include <zircon/compiler.h>
 #include <zircon/device/block.h>
 #include <zircon/syscalls.h>
+#include <fifo-ring/fifo-ring.h>
 #include <sync/completion.h>
 
 #include "block-client/client.h"
 
+typedef struct block_completion {
+    completion_t completion;
+    zx_status_t status;
+} block_completion_t;
+
+typedef struct fifo_client {
+    zx_handle_t fifo;
+    block_completion_t txns[MAX_TXN_COUNT];
+
+    // Set if the server created the fifo with ZX_FIFO_SHARED_RING, in which
+    // case requests and responses go through the mapped ring. The ring has a
+    // single reader and writer, so concurrent transactions take turns.
+    bool use_ring;
+    fifo_ring_t ring;
+    mtx_t ring_write_lock;
+    mtx_t ring_read_lock;
+} fifo_client_t;
+
+static zx_status_t fifo_write(fifo_client_t* client, block_fifo_request_t* request,
+                              size_t count, uint32_t* actual) {
+    size_t len = sizeof(block_fifo_request_t) * count;
+    if (!client->use_ring) {
+        return zx_fifo_write(client->fifo, request, len, actual);
+    }
+    mtx_lock(&client->ring_write_lock);
+    zx_status_t status = fifo_ring_write(&client->ring, request, len, actual);
+    mtx_unlock(&client->ring_write_lock);
+    return status;
+}
+
+static zx_status_t fifo_read(fifo_client_t* client, block_fifo_response_t* response,
+                             uint32_t* actual) {
+    if (!client->use_ring) {
+        return zx_fifo_read(client->fifo, response, sizeof(block_fifo_response_t), actual);
+    }
+    mtx_lock(&client->ring_read_lock);
+    zx_status_t status = fifo_ring_read(&client->ring, response,
+                                        sizeof(block_fifo_response_t), actual);
+    mtx_unlock(&client->ring_read_lock);
+    return status;
+}
+
 // Writes on a FIFO, repeating the write later if the FIFO is full.
-static zx_status_t do_write(zx_handle_t fifo, block_fifo_request_t* request, size_t count) {
+static zx_status_t do_write(fifo_client_t* client, block_fifo_request_t* request, size_t count) {
     zx_status_t status;
     while (true) {
         uint32_t actual;
-        status = zx_fifo_write(fifo, request, sizeof(block_fifo_request_t) * count, &actual);
+        status = fifo_write(client, request, count, &actual);
         if (status == ZX_ERR_SHOULD_WAIT) {
             zx_signals_t signals;
-            if ((status = zx_object_wait_one(fifo,
+            if ((status = zx_object_wait_one(client->fifo,
                                              ZX_FIFO_WRITABLE | ZX_FIFO_PEER_CLOSED,
                                              ZX_TIME_INFINITE, &signals)) != ZX_OK) {
                 return status;
@@ -40,14 +85,14 @@ static zx_status_t do_write(zx_handle_t fifo, block_fifo_request_t* request, siz
     }
 }
 
-static zx_status_t do_read(zx_handle_t fifo, block_fifo_response_t* response) {
+static zx_status_t do_read(fifo_client_t* client, block_fifo_response_t* response) {
     zx_status_t status;
     while (true) {
         uint32_t count;
-        status = zx_fifo_read(fifo, response, sizeof(block_fifo_response_t), &count);
+        status = fifo_read(client, response, &count);
         if (status == ZX_ERR_SHOULD_WAIT) {
             zx_signals_t signals;
-            if ((status = zx_object_wait_one(fifo,
+            if ((status = zx_object_wait_one(client->fifo,
                                              ZX_FIFO_READABLE | ZX_FIFO_PEER_CLOSED,
                                              ZX_TIME_INFINITE, &signals)) != ZX_OK) {
                 return status;
@@ -61,22 +106,17 @@ static zx_status_t do_read(zx_handle_t fifo, block_fifo_response_t* response) {
     }
 }
 
-typedef struct block_completion {
-    completion_t completion;
-    zx_status_t status;
-} block_completion_t;
-
-typedef struct fifo_client {
-    zx_handle_t fifo;
-    block_completion_t txns[MAX_TXN_COUNT];
-} fifo_client_t;
-
 zx_status_t block_fifo_create_client(zx_handle_t fifo, fifo_client_t** out) {
     fifo_client_t* client = calloc(sizeof(fifo_client_t), 1);
     if (client == NULL) {
         return ZX_ERR_NO_MEMORY;
     }
     client->fifo = fifo;
+    if (fifo_ring_init(&client->ring, fifo) == ZX_OK) {
+        client->use_ring = true;
+        mtx_init(&client->ring_write_lock, mtx_plain);
+        mtx_init(&client->ring_read_lock, mtx_plain);
+    }
     *out = client;
     return ZX_OK;
 }
@@ -86,6 +126,11 @@ void block_fifo_release_client(fifo_client_t* client) {
         return;
     }
 
+    if (client->use_ring) {
+        fifo_ring_release(&client->ring);
+        mtx_destroy(&client->ring_write_lock);
+        mtx_destroy(&client->ring_read_lock);
+    }
     zx_handle_close(client->fifo);
     free(client);
 }
@@ -108,14 +153,14 @@ zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests
         requests[i].opcode = (requests[i].opcode & BLOCKIO_OP_MASK) |
                              (i == count - 1 ? BLOCKIO_TXN_END : 0);
     }
-    if ((status = do_write(client->fifo, &requests[0], count)) != ZX_OK) {
+    if ((status = do_write(client, &requests[0], count)) != ZX_OK) {
         return status;
     }
 
     // As expected by the protocol, when we send one "BLOCKIO_TXN_END" message, we
     // must read a reply message.
     block_fifo_response_t response;
-    if ((status = do_read(client->fifo, &response)) != ZX_OK) {
+    if ((status = do_read(client, &response)) != ZX_OK) {
         return status;
     }
 
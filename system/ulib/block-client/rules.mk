@@ -20,6 +20,6 @@ MODULE_LIBS := \
     system/ulib/zircon \
     system/ulib/fdio \
 
-MODULE_HEADER_DEPS := system/ulib/ddk
+MODULE_HEADER_DEPS := system/ulib/ddk system/ulib/fifo-ring
 
 include make/module.mk
@@ -26,10 +26,22 @@ __BEGIN_CDECLS;
 //
 // The FEATURE_DMA flag indicates that the device can copy the buffer data using DMA and will ensure
 // that physical addresses are provided in netbufs.
+//
+// The FEATURE_TX_CSUM flag indicates that the device fills in TCP and UDP checksums of netbufs
+// queued with ETHMAC_NETBUF_CSUM.
+//
+// The FEATURE_RX_CSUM flag indicates that the device verifies TCP and UDP checksums and passes
+// ETHMAC_RECV_CSUM_VALID to ifc->recv() for frames whose checksum is known to be good.
+//
+// The FEATURE_TSO flag indicates that the device accepts TCP frames of up to 64KB queued with
+// ETHMAC_NETBUF_TSO and segments them into mtu-sized frames.
 
 #define ETHMAC_FEATURE_WLAN     (1u)
 #define ETHMAC_FEATURE_SYNTH    (2u)
 #define ETHMAC_FEATURE_DMA      (4u)
+#define ETHMAC_FEATURE_TX_CSUM  (8u)
+#define ETHMAC_FEATURE_RX_CSUM  (16u)
+#define ETHMAC_FEATURE_TSO      (32u)
 
 typedef struct ethmac_info {
     uint32_t features;
@@ -45,7 +57,7 @@ typedef struct ethmac_netbuf {
     zx_paddr_t phys;  // Only used if ETHMAC_FEATURE_DMA is available
     uint16_t len;
     uint16_t reserved;
-    uint32_t flags;
+    uint32_t flags;  // ETHMAC_NETBUF_* flags
 
     // Shared between the generic ethernet and ethmac drivers
     list_node_t node;
@@ -57,6 +69,14 @@ typedef struct ethmac_netbuf {
     };
 } ethmac_netbuf_t;
 
+// Requests that the driver fill in the TCP or UDP checksum of the frame; the checksum field's
+// contents are ignored. Only set if the device reports ETHMAC_FEATURE_TX_CSUM.
+#define ETHMAC_NETBUF_CSUM (1u)
+
+// Requests that the driver segment a TCP frame larger than the mtu, filling in checksums; only
+// set if the device reports ETHMAC_FEATURE_TSO.
+#define ETHMAC_NETBUF_TSO  (2u)
+
 typedef struct ethmac_ifc_virt {
     void (*status)(void* cookie, uint32_t status);
 
@@ -70,6 +90,14 @@ typedef struct ethmac_ifc_virt {
 // driver to batch tx to hardware if possible.
 #define ETHMAC_TX_OPT_MORE (1u)
 
+// Indicates that the driver will deliver another frame via ifc->recv() immediately after this
+// one, e.g. because more frames were pending when it serviced its interrupt. Allows the generic
+// ethernet driver to batch rx completions to its clients until a frame without this flag arrives.
+#define ETHMAC_RECV_OPT_MORE (1u)
+
+// Indicates that the device verified the frame's TCP or UDP checksum.
+#define ETHMAC_RECV_CSUM_VALID (2u)
+
 // SETPARAM_ values identify the parameter to set. Each call to set_param()
 // takes an int32_t |value| and void* |data| which have meaning specific to
 // the parameter being set.
@@ -4,7 +4,9 @@
 
 #include <driver-info/driver-info.h>
 
+#if !defined(__APPLE__)
 #include <elf.h>
+#endif
 #include <fcntl.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -14,6 +16,47 @@
 #include <zircon/driver/binding.h>
 #include <zircon/types.h>
 
+#if defined(__APPLE__)
+// This file is also built into the mkdrivermanifest host tool, and macOS
+// has no <elf.h>. Only what is needed to find the notes is defined here.
+#define ELFMAG "\177ELF"
+#define PT_NOTE 4
+
+typedef struct {
+    uint8_t e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+} Elf64_Ehdr;
+
+typedef struct {
+    uint32_t p_type;
+    uint32_t p_flags;
+    uint64_t p_offset;
+    uint64_t p_vaddr;
+    uint64_t p_paddr;
+    uint64_t p_filesz;
+    uint64_t p_memsz;
+    uint64_t p_align;
+} Elf64_Phdr;
+
+typedef struct {
+    uint32_t n_namesz;
+    uint32_t n_descsz;
+    uint32_t n_type;
+} Elf64_Nhdr;
+#endif
+
 typedef zx_status_t (*note_func_t)(void* note, size_t sz, void* cookie);
 
 typedef Elf64_Ehdr elfhdr;
@@ -144,6 +187,66 @@ zx_status_t di_read_driver_info(int fd, void *cookie, di_info_func_t func) {
                          data, sizeof(data), callback, &ctx);
 }
 
+static zx_status_t check_manifest_entry(const uint8_t* data, size_t len,
+                                        const di_manifest_entry_t** out) {
+    const di_manifest_entry_t* entry = (const void*)data;
+    if (len < sizeof(*entry)) {
+        return ZX_ERR_INTERNAL;
+    }
+    if ((entry->size < sizeof(*entry)) || (entry->size > len) ||
+        (entry->size % DI_MANIFEST_ALIGN)) {
+        return ZX_ERR_INTERNAL;
+    }
+    size_t bindlen = (size_t)entry->payload.bindcount * sizeof(zx_bind_inst_t);
+    size_t avail = entry->size - sizeof(*entry);
+    if ((bindlen > avail) || (entry->name_len == 0) || (entry->name_len > avail - bindlen)) {
+        return ZX_ERR_INTERNAL;
+    }
+    const char* name = (const char*)(entry + 1) + bindlen;
+    if (name[entry->name_len - 1] != 0) {
+        return ZX_ERR_INTERNAL;
+    }
+    *out = entry;
+    return ZX_OK;
+}
+
+zx_status_t di_read_driver_manifest(const void* data, size_t len,
+                                    void* cookie, di_manifest_func_t func) {
+    const di_manifest_header_t* hdr = data;
+    if ((len < sizeof(*hdr)) ||
+        (hdr->magic != DI_MANIFEST_MAGIC) ||
+        (hdr->version != DI_MANIFEST_VERSION) ||
+        (hdr->size != len)) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // Check every entry before reporting any of them.
+    const uint8_t* first = (const uint8_t*)(hdr + 1);
+    const uint8_t* end = (const uint8_t*)data + len;
+    const uint8_t* ptr = first;
+    for (uint32_t n = 0; n < hdr->count; n++) {
+        const di_manifest_entry_t* entry;
+        if (check_manifest_entry(ptr, end - ptr, &entry) != ZX_OK) {
+            return ZX_ERR_INTERNAL;
+        }
+        ptr += entry->size;
+    }
+    if (ptr != end) {
+        return ZX_ERR_INTERNAL;
+    }
+
+    ptr = first;
+    for (uint32_t n = 0; n < hdr->count; n++) {
+        const di_manifest_entry_t* entry = (const void*)ptr;
+        zircon_driver_note_payload_t note;
+        memcpy(&note, &entry->payload, sizeof(note));
+        const zx_bind_inst_t* binding = (const void*)(entry + 1);
+        func(&note, binding, (const char*)(binding + note.bindcount), cookie);
+        ptr += entry->size;
+    }
+    return ZX_OK;
+}
+
 const char* di_bind_param_name(uint32_t param_num) {
     switch (param_num) {
     case BIND_FLAGS:                  return "Flags";
@@ -22,6 +22,46 @@ typedef zx_status_t (*di_read_func_t)(void* obj, void* data, size_t len, size_t
 zx_status_t di_read_driver_info_etc(void* obj, di_read_func_t rfunc,
                                     void* cookie, di_info_func_t ifunc);
 
+// A driver manifest describes every driver in one directory, so that the
+// drivers can be found without opening each of them to read its note. It is
+// generated at build time by the mkdrivermanifest host tool and installed in
+// the directory it describes as DI_MANIFEST_NAME.
+//
+// The manifest is a di_manifest_header_t followed by |count| entries. Each
+// entry is a di_manifest_entry_t, then the driver's bind program of
+// |payload.bindcount| instructions, then the driver's file name (relative to
+// the directory, NUL terminated, |name_len| bytes including the NUL), padded
+// to DI_MANIFEST_ALIGN. All fields are little-endian.
+#define DI_MANIFEST_NAME ".driver-manifest"
+#define DI_MANIFEST_MAGIC 0x4d564944 // "DIVM"
+#define DI_MANIFEST_VERSION 1
+#define DI_MANIFEST_ALIGN 4
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    // Size of the whole manifest, including this header.
+    uint32_t size;
+} di_manifest_header_t;
+
+typedef struct {
+    // Size of the entry, including the bind program, the name and padding.
+    uint32_t size;
+    uint32_t name_len;
+    zircon_driver_note_payload_t payload;
+} di_manifest_entry_t;
+
+typedef void (*di_manifest_func_t)(zircon_driver_note_payload_t* note,
+                                   const zx_bind_inst_t* binding,
+                                   const char* name, void* cookie);
+
+// Calls |func| for each driver in the manifest in |data|. The manifest is
+// checked before |func| is called at all, so on error no driver has been
+// reported. |note| is a copy which |func| may modify.
+zx_status_t di_read_driver_manifest(const void* data, size_t len,
+                                    void* cookie, di_manifest_func_t func);
+
 // Lookup the human readable name of a bind program parameter, or return NULL if
 // the name is not known.  Used by debug code to do things like dump the
 // published parameters of a device, or dump the bind program of a driver.
@@ -19,16 +19,30 @@
 
 #if defined(__arm__)
 # define MY_MACHINE EM_ARM
+# define MY_RELATIVE R_ARM_RELATIVE
 #elif defined(__aarch64__)
 # define MY_MACHINE EM_AARCH64
+# define MY_RELATIVE R_AARCH64_RELATIVE
 #elif defined(__x86_64__)
 # define MY_MACHINE EM_X86_64
+# define MY_RELATIVE R_X86_64_RELATIVE
 #elif defined(__i386__)
 # define MY_MACHINE EM_386
+# define MY_RELATIVE R_386_RELATIVE
 #else
 # error what machine?
 #endif
 
+#ifdef _LP64
+typedef Elf64_Dyn elf_dyn_t;
+typedef Elf64_Rela elf_rela_t;
+# define MY_R_TYPE ELF64_R_TYPE
+#else
+typedef Elf32_Dyn elf_dyn_t;
+typedef Elf32_Rela elf_rela_t;
+# define MY_R_TYPE ELF32_R_TYPE
+#endif
+
 #define VMO_NAME_UNKNOWN "<unknown ELF file>"
 #define VMO_NAME_PREFIX_BSS "bss:"
 #define VMO_NAME_PREFIX_DATA "data:"
@@ -88,6 +102,29 @@ zx_status_t elf_load_read_phdrs(zx_handle_t vmo, elf_phdr_t phdrs[],
     return ZX_OK;
 }
 
+zx_status_t elf_load_get_span(const elf_load_header_t* header,
+                              const elf_phdr_t phdrs[],
+                              uintptr_t* low, uintptr_t* high) {
+    *low = *high = 0;
+    for (uint_fast16_t i = 0; i < header->e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_LOAD) {
+            uint_fast16_t j = header->e_phnum;
+            do {
+                --j;
+            } while (j > i && phdrs[j].p_type != PT_LOAD);
+            *low = phdrs[i].p_vaddr & -PAGE_SIZE;
+            *high = ((phdrs[j].p_vaddr +
+                      phdrs[j].p_memsz + PAGE_SIZE - 1) & -PAGE_SIZE);
+            break;
+        }
+    }
+    // Sanity check.  ELF requires that PT_LOAD phdrs be sorted in
+    // ascending p_vaddr order.
+    if (*low > *high)
+        return ERR_ELF_BAD_FORMAT;
+    return ZX_OK;
+}
+
 // An ET_DYN file can be loaded anywhere, so choose where.  This
 // allocates a VMAR to hold the image, and returns its handle and
 // absolute address.  This also computes the "load bias", which is the
@@ -105,30 +142,17 @@ static zx_status_t choose_load_bias(zx_handle_t root_vmar,
     // figure out the total span it will need and reserve a span
     // of address space that big.  The kernel decides where to put it.
 
-    uintptr_t low = 0, high = 0;
-    for (uint_fast16_t i = 0; i < header->e_phnum; ++i) {
-        if (phdrs[i].p_type == PT_LOAD) {
-            uint_fast16_t j = header->e_phnum;
-            do {
-                --j;
-            } while (j > i && phdrs[j].p_type != PT_LOAD);
-            low = phdrs[i].p_vaddr & -PAGE_SIZE;
-            high = ((phdrs[j].p_vaddr +
-                     phdrs[j].p_memsz + PAGE_SIZE - 1) & -PAGE_SIZE);
-            break;
-        }
-    }
-    // Sanity check.  ELF requires that PT_LOAD phdrs be sorted in
-    // ascending p_vaddr order.
-    if (low > high)
-        return ERR_ELF_BAD_FORMAT;
+    uintptr_t low, high;
+    zx_status_t status = elf_load_get_span(header, phdrs, &low, &high);
+    if (status != ZX_OK)
+        return status;
 
     const size_t span = high - low;
     if (span == 0)
         return ZX_OK;
 
     // Allocate a VMAR to reserve the whole address range.
-    zx_status_t status = zx_vmar_allocate(root_vmar, 0, span,
+    status = zx_vmar_allocate(root_vmar, 0, span,
                                           ZX_VM_FLAG_CAN_MAP_READ |
                                           ZX_VM_FLAG_CAN_MAP_WRITE |
                                           ZX_VM_FLAG_CAN_MAP_EXECUTE |
@@ -304,6 +328,201 @@ zx_status_t elf_load_map_segments(zx_handle_t root_vmar,
     return status;
 }
 
+// Find where the |size| bytes at |vaddr| come from in the file.  They
+// must lie within the file contents of a single PT_LOAD segment, which
+// must be writable if |writable| is set.
+static bool vaddr_to_offset(const elf_load_header_t* header,
+                            const elf_phdr_t phdrs[],
+                            uintptr_t vaddr, size_t size, bool writable,
+                            uintptr_t* offset) {
+    for (uint_fast16_t i = 0; i < header->e_phnum; ++i) {
+        const elf_phdr_t* ph = &phdrs[i];
+        if (ph->p_type != PT_LOAD || (writable && !(ph->p_flags & PF_W)))
+            continue;
+        if (vaddr >= ph->p_vaddr && vaddr - ph->p_vaddr <= ph->p_filesz &&
+            size <= ph->p_filesz - (vaddr - ph->p_vaddr)) {
+            *offset = ph->p_offset + (vaddr - ph->p_vaddr);
+            return true;
+        }
+    }
+    return false;
+}
+
+static zx_status_t write_page(zx_handle_t vmo, const uint8_t* page,
+                              uintptr_t offset, size_t len) {
+    size_t n;
+    zx_status_t status = zx_vmo_write(vmo, page, offset, len, &n);
+    if (status == ZX_OK && n != len)
+        status = ZX_ERR_IO;
+    return status;
+}
+
+zx_status_t elf_load_prelink(zx_handle_t vmo,
+                             const elf_load_header_t* header,
+                             const elf_phdr_t phdrs[],
+                             uintptr_t bias, zx_handle_t* out_vmo) {
+    const elf_phdr_t* dynamic = NULL;
+    for (uint_fast16_t i = 0; i < header->e_phnum; ++i) {
+        if (phdrs[i].p_type == PT_DYNAMIC)
+            dynamic = &phdrs[i];
+    }
+    if (dynamic == NULL)
+        return ERR_ELF_BAD_FORMAT;
+
+    // Scan the dynamic section for the relocation tables.
+    struct {
+        uintptr_t vaddr;
+        size_t size;
+        uintptr_t offset;
+    } tables[2] = {};
+    size_t relaent = sizeof(elf_rela_t);
+    bool unsupported = false;
+    bool done = false;
+    for (size_t pos = 0; !done && pos < dynamic->p_filesz;) {
+        elf_dyn_t dyn[16];
+        size_t len = dynamic->p_filesz - pos;
+        if (len > sizeof(dyn))
+            len = sizeof(dyn);
+        size_t n;
+        zx_status_t status = zx_vmo_read(vmo, dyn, dynamic->p_offset + pos,
+                                         len, &n);
+        if (status != ZX_OK)
+            return status;
+        if (n < sizeof(dyn[0]))
+            return ERR_ELF_BAD_FORMAT;
+        for (size_t i = 0; !done && i < n / sizeof(dyn[0]); ++i) {
+            switch (dyn[i].d_tag) {
+            case DT_NULL:
+                done = true;
+                break;
+            case DT_RELA:
+                tables[0].vaddr = dyn[i].d_un.d_ptr;
+                break;
+            case DT_RELASZ:
+                tables[0].size = dyn[i].d_un.d_val;
+                break;
+            case DT_RELAENT:
+                relaent = dyn[i].d_un.d_val;
+                break;
+            case DT_JMPREL:
+                tables[1].vaddr = dyn[i].d_un.d_ptr;
+                break;
+            case DT_PLTRELSZ:
+                tables[1].size = dyn[i].d_un.d_val;
+                break;
+            case DT_PLTREL:
+                if (dyn[i].d_un.d_val != DT_RELA)
+                    unsupported = true;
+                break;
+            case DT_REL:
+            case DT_TEXTREL:
+                unsupported = true;
+                break;
+            case DT_FLAGS:
+                if (dyn[i].d_un.d_val & DF_TEXTREL)
+                    unsupported = true;
+                break;
+            }
+        }
+        pos += n - n % sizeof(dyn[0]);
+    }
+
+    if (unsupported || tables[0].size == 0 || relaent != sizeof(elf_rela_t))
+        return ZX_ERR_NOT_SUPPORTED;
+    for (size_t t = 0; t < countof(tables); ++t) {
+        if (tables[t].size > 0 &&
+            !vaddr_to_offset(header, phdrs, tables[t].vaddr, tables[t].size,
+                             false, &tables[t].offset))
+            return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    uint64_t size;
+    zx_status_t status = zx_vmo_get_size(vmo, &size);
+    if (status != ZX_OK)
+        return status;
+    zx_handle_t clone;
+    status = zx_vmo_clone(vmo, ZX_VMO_CLONE_COPY_ON_WRITE, 0, size, &clone);
+    if (status != ZX_OK)
+        return status;
+
+    // Relocations are normally sorted by address, so working on one
+    // page of the clone at a time touches each page only once.
+    uint8_t page[PAGE_SIZE];
+    uintptr_t page_offset = 0;
+    size_t page_len = 0;
+    bool dirty = false;
+    for (size_t t = 0, pos = 0; status == ZX_OK && t < countof(tables);) {
+        if (pos == tables[t].size) {
+            ++t;
+            pos = 0;
+            continue;
+        }
+        elf_rela_t relocs[32];
+        size_t len = tables[t].size - pos;
+        if (len > sizeof(relocs))
+            len = sizeof(relocs);
+        size_t n;
+        status = zx_vmo_read(vmo, relocs, tables[t].offset + pos, len, &n);
+        if (status != ZX_OK)
+            break;
+        if (n < sizeof(relocs[0])) {
+            status = ERR_ELF_BAD_FORMAT;
+            break;
+        }
+        pos += n - n % sizeof(relocs[0]);
+
+        for (size_t i = 0; i < n / sizeof(relocs[0]); ++i) {
+            if (MY_R_TYPE(relocs[i].r_info) != MY_RELATIVE)
+                continue;
+            uintptr_t target;
+            if (!vaddr_to_offset(header, phdrs, relocs[i].r_offset,
+                                 sizeof(uintptr_t), true, &target) ||
+                target % sizeof(uintptr_t) != 0) {
+                status = ZX_ERR_NOT_SUPPORTED;
+                break;
+            }
+            if (page_len == 0 || (target & -PAGE_SIZE) != page_offset) {
+                if (dirty) {
+                    status = write_page(clone, page, page_offset, page_len);
+                    if (status != ZX_OK)
+                        break;
+                    dirty = false;
+                }
+                page_offset = target & -PAGE_SIZE;
+                status = zx_vmo_read(clone, page, page_offset,
+                                     sizeof(page), &page_len);
+                if (status != ZX_OK)
+                    break;
+                if (target - page_offset + sizeof(uintptr_t) > page_len) {
+                    status = ERR_ELF_BAD_FORMAT;
+                    break;
+                }
+            }
+            uintptr_t value = bias + relocs[i].r_addend;
+            memcpy(&page[target - page_offset], &value, sizeof(value));
+            dirty = true;
+        }
+    }
+    if (status == ZX_OK && dirty)
+        status = write_page(clone, page, page_offset, page_len);
+
+    // The relocated image is shared by every process loading the file at
+    // this bias, so no handle to it may write to it. A COW clone comes
+    // with ZX_RIGHT_WRITE, which zx_handle_replace() drops.
+    if (status == ZX_OK) {
+        status = zx_handle_replace(
+            clone,
+            ZX_RIGHT_DUPLICATE | ZX_RIGHT_TRANSFER | ZX_RIGHT_GET_PROPERTY |
+            ZX_RIGHT_READ | ZX_RIGHT_EXECUTE | ZX_RIGHT_MAP,
+            out_vmo);
+        if (status != ZX_OK)
+            zx_handle_close(clone);
+    } else {
+        zx_handle_close(clone);
+    }
+    return status;
+}
+
 bool elf_load_find_interp(const elf_phdr_t phdrs[], size_t phnum,
                           uintptr_t* interp_off, size_t* interp_len) {
     for (size_t i = 0; i < phnum; ++i) {
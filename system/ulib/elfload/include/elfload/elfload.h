@@ -56,6 +56,27 @@ zx_status_t elf_load_map_segments(zx_handle_t vmar,
                                   zx_handle_t* segments_vmar,
                                   zx_vaddr_t* bias, zx_vaddr_t* entry);
 
+// Compute the page-aligned span of p_vaddr values covered by the
+// PT_LOAD segments.  The image needs |*high - *low| bytes of address
+// space, and its load bias is the address chosen for |*low|, less |*low|.
+zx_status_t elf_load_get_span(const elf_load_header_t* header,
+                              const elf_phdr_t* phdrs,
+                              uintptr_t* low, uintptr_t* high);
+
+// Apply the file's relative relocations for the load bias |bias| to a
+// copy-on-write clone of |vmo|.  A process which loads the file at that
+// bias can clone its writable segments from the result instead of |vmo|
+// and skip those relocations.  Other relocations are left alone.  The
+// handle to the result has no ZX_RIGHT_WRITE, as the result is meant to
+// be shared.
+// Returns ZX_ERR_NOT_SUPPORTED if there is nothing to apply, if a
+// relative relocation lies outside the file contents of a writable
+// segment, or if the file uses DT_REL rather than DT_RELA.
+zx_status_t elf_load_prelink(zx_handle_t vmo,
+                             const elf_load_header_t* header,
+                             const elf_phdr_t* phdrs,
+                             uintptr_t bias, zx_handle_t* out_vmo);
+
 // Locate the PT_INTERP program header and extract its bounds in the file.
 // Returns false if there was no PT_INTERP.
 bool elf_load_find_interp(const elf_phdr_t* phdrs, size_t phnum,
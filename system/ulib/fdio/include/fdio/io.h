@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <poll.h>
 #include <stdbool.h>
+#include <sys/stat.h>
 #include <unistd.h> // for ssize_t
 
 #include <zircon/types.h>
@@ -65,6 +66,38 @@ zx_status_t fdio_get_vmo(int fd, zx_handle_t* out_vmo);
 // data into a new VMO).
 zx_status_t fdio_get_exact_vmo(int fd, zx_handle_t* out_vmo);
 
+// stat or open many entries of the directory dirfd at once.  Each names[i]
+// is treated as by fstatat(dirfd, names[i], &st[i], 0) or by
+// openat(dirfd, names[i], flags), with the outcome in results[i] (0 or a
+// negative errno value) or fds[i] (the new fd or a negative errno value).
+// Entries which are single path components go to a remote filesystem as
+// pipelined requests, costing about as many round trips as a single call.
+// O_CREAT is not supported.  Returns 0, or -1 with errno set if dirfd is
+// not valid.
+int fdio_stat_batch(int dirfd, const char* const* names, size_t count,
+                    struct stat* st, int* results);
+int fdio_open_batch(int dirfd, const char* const* names, size_t count,
+                    int flags, int* fds);
+
+// Cache, within this process, the attributes and the absence of paths
+// looked up by stat() and friends, for at most ttl.  Names added to or
+// removed from a directory are picked up through a watcher on it, and any
+// change this process makes to a remote filesystem empties the cache; other
+// changes, such as another process writing to a file, may be seen up to
+// ttl late.  A ttl of 0 turns the cache off.  Setting the environment
+// variable FDIO_STAT_CACHE_TTL_MS turns it on at startup.
+void fdio_stat_cache_enable(zx_duration_t ttl);
+
+typedef struct fdio_stat_cache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+} fdio_stat_cache_stats_t;
+
+// Counts of stat cache lookups answered from and missing the cache, and of
+// entries or whole cache generations thrown away, since the process began.
+void fdio_stat_cache_get_stats(fdio_stat_cache_stats_t* out);
+
 // create a fd that is backed by the given range of the vmo.
 // This function takes ownership of the vmo and will close the vmo when the fd
 // is closed.
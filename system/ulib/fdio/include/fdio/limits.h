@@ -16,6 +16,9 @@
 // at least this size.
 #define FDIO_CHUNK_SIZE 8192
 
+// Maximum size of a single remoteio READ_VMO or WRITE_VMO.
+#define FDIO_XFER_SIZE (256 * 1024)
+
 // Maximum size for an ioctl input.
 #define FDIO_IOCTL_MAX_INPUT 1024
 
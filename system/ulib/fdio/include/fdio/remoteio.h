@@ -8,6 +8,7 @@
 #include <zircon/types.h>
 
 #include <fdio/limits.h>
+#include <fdio/vfs.h>
 
 #include <assert.h>
 #include <limits.h>
@@ -58,7 +59,11 @@ __BEGIN_CDECLS
 #define ZXRIO_LINK        (0x0000001a | ZXRIO_ONE_HANDLE)
 #define ZXRIO_MMAP         0x0000001b
 #define ZXRIO_FCNTL        0x0000001c
-#define ZXRIO_NUM_OPS      29
+#define ZXRIO_XFER_VMO    (0x0000001d | ZXRIO_ONE_HANDLE)
+#define ZXRIO_READ_VMO     0x0000001e
+#define ZXRIO_WRITE_VMO    0x0000001f
+#define ZXRIO_STAT_BATCH   0x00000020
+#define ZXRIO_NUM_OPS      33
 
 #define ZXRIO_OP(n)        ((n) & 0x3FF) // opcode
 #define ZXRIO_HC(n)        (((n) >> 8) & 3) // handle count
@@ -71,7 +76,9 @@ __BEGIN_CDECLS
     "read_at", "write_at", "truncate", "rename", \
     "connect", "bind", "listen", "getsockname", \
     "getpeername", "getsockopt", "setsockopt", "getaddrinfo", \
-    "setattr", "sync", "link", "mmap", "fcntl" }
+    "setattr", "sync", "link", "mmap", \
+    "fcntl", "xfer_vmo", "read_vmo", "write_vmo", \
+    "stat_batch" }
 
 // dispatcher callback return code that there were no messages to read
 #define ERR_DISPATCHER_NO_WORK ZX_ERR_SHOULD_WAIT
@@ -182,6 +189,15 @@ typedef struct zxrio_mmap_data {
     int32_t flags;
 } zxrio_mmap_data_t;
 
+// One entry of a STAT_BATCH reply.
+typedef struct zxrio_stat_batch {
+    zx_status_t status;
+    uint32_t reserved;
+    vnattr_t attr;
+} zxrio_stat_batch_t;
+
+#define ZXRIO_STAT_BATCH_MAX (FDIO_CHUNK_SIZE / sizeof(zxrio_stat_batch_t))
+
 static_assert(FDIO_CHUNK_SIZE >= PATH_MAX, "FDIO_CHUNK_SIZE must be large enough to contain paths");
 
 #define READDIR_CMD_NONE  0
@@ -189,6 +205,9 @@ static_assert(FDIO_CHUNK_SIZE >= PATH_MAX, "FDIO_CHUNK_SIZE must be large enough
 
 // - msg.datalen is the size of data sent or received and must be <= FDIO_CHUNK_SIZE
 // - msg.arg is the return code on replies
+// - msg.txid of a reply is that of its request; a client may send further
+//   requests on a connection before earlier ones are answered, and match
+//   the replies up by txid
 
 // request---------------------------------------    response------------------------------
 // op          arg        arg2     data              arg2        data            handle[]
@@ -220,6 +239,23 @@ static_assert(FDIO_CHUNK_SIZE >= PATH_MAX, "FDIO_CHUNK_SIZE must be large enough
 // LINK        0          0        <name1>0<name2>0  0           -               -
 // MMAP        maxreply   0        mmap_data_msg     0           mmap_data_msg   vmohandle
 // FCNTL       cmd        flags    0                 flags       -               -
+// XFER_VMO    0          0        -                 0           -               -
+// READ_VMO    maxread    offset   -                 newoffset   -               -
+// WRITE_VMO   len        offset   -                 newoffset   -               -
+// STAT_BATCH  count      0        <name>0<name>0... 0           <stat_batch[]>  -
+//
+// XFER_VMO hands the server a vmo of up to FDIO_XFER_SIZE bytes, which
+// READ_VMO and WRITE_VMO then use in place of the data payload: the bytes
+// read are left at the start of the vmo, and the bytes to write are taken
+// from there.  An offset of -1 means the connection's seek offset, which
+// is then advanced as by READ and WRITE.  Servers which do not support
+// XFER_VMO reply ZX_ERR_NOT_SUPPORTED, and clients fall back to READ and
+// WRITE.
+//
+// STAT_BATCH looks up each of up to ZXRIO_STAT_BATCH_MAX names, which must
+// be single path components, in the directory and replies with one
+// zxrio_stat_batch_t per name.  An entry whose status is ZX_ERR_NOT_SUPPORTED
+// (for example a mount point) must be resolved with OPEN and STAT instead.
 //
 // proposed:
 //
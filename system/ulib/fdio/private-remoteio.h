@@ -19,6 +19,15 @@ struct zxrio {
 
     // transaction id used for synchronous remoteio calls
     _Atomic zx_txid_t txid;
+
+    // vmo shared with the server for reads and writes larger than
+    // FDIO_CHUNK_SIZE, created on first use; xfer_lock serializes its use
+    mtx_t xfer_lock;
+    zx_handle_t xfer_vmo;
+    bool xfer_unsupported;
+
+    // held while reading the replies to pipelined transactions off h
+    mtx_t pipeline_lock;
 };
 
 // These are for the benefit of namespace.c
@@ -42,6 +51,18 @@ zx_status_t zxrio_open(fdio_t* io, const char* path, uint32_t flags,
 zx_status_t zxrio_misc(fdio_t* io, uint32_t op, int64_t off,
                        uint32_t maxreply, void* ptr, size_t len);
 
+// Batched operations on the entries |names| of the directory |io|, each of
+// which must be a single path component.  The requests are pipelined, so
+// the batch costs about as many round trips as one entry would.  Return
+// ZX_ERR_NOT_SUPPORTED if |io| is not a remoteio directory, in which case
+// nothing was done; otherwise the result for each name is in statuses[i].
+// An entry whose status is ZX_ERR_NOT_SUPPORTED was not handled and needs
+// the unbatched operation.
+zx_status_t zxrio_stat_batch(fdio_t* io, const char* const* names, size_t count,
+                             vnattr_t* attrs, zx_status_t* statuses);
+zx_status_t zxrio_open_batch(fdio_t* io, const char* const* names, size_t count,
+                             uint32_t flags, fdio_t** outs, zx_status_t* statuses);
+
 
 // Shared with remotesocket.c
 
@@ -204,6 +204,34 @@ void __fdio_startup_handles_init(uint32_t num, zx_handle_t handles[],
 
 void __fdio_rchannel_init(void) __attribute__((visibility("hidden")));
 
+// stat-cache.c: the attributes or absence of a path, as looked up by
+// __fdio_stat_cache_lookup() and then recorded by __fdio_stat_cache_insert().
+typedef struct fdio_stat_cache_ticket {
+    char path[PATH_MAX];    // empty if the path is not to be cached
+    uint64_t gen;
+    int dir;
+    uint64_t dir_gen;
+    uint64_t dir_events;
+} fdio_stat_cache_ticket_t;
+
+struct stat;
+
+// On a hit, sets *status to ZX_OK (filling in *s) or ZX_ERR_NOT_FOUND
+// and returns true.  On a miss, returns false having filled in t for the
+// caller to pass to __fdio_stat_cache_insert() with the result it gets
+// from the server.
+bool __fdio_stat_cache_lookup(int dirfd, const char* path,
+                              fdio_stat_cache_ticket_t* t,
+                              struct stat* s, zx_status_t* status)
+    __attribute__((visibility("hidden")));
+void __fdio_stat_cache_insert(const fdio_stat_cache_ticket_t* t,
+                              const struct stat* s, zx_status_t status)
+    __attribute__((visibility("hidden")));
+
+// Forgets everything in the stat cache.  Called after this process
+// changes a remote filesystem.
+void __fdio_stat_cache_invalidate(void) __attribute__((visibility("hidden")));
+
 typedef struct {
     mtx_t lock;
     mtx_t cwd_lock;
@@ -36,6 +36,9 @@
 #define POLL_SHIFT  24
 #define POLL_MASK   0x1F
 
+// Maximum number of requests the batched operations keep in flight.
+#define ZXRIO_PIPELINE_MAX 8
+
 static_assert(ZX_USER_SIGNAL_0 == (1 << POLL_SHIFT), "");
 static_assert((POLLIN << POLL_SHIFT) == DEVICE_SIGNAL_READABLE, "");
 static_assert((POLLPRI << POLL_SHIFT) == DEVICE_SIGNAL_OOB, "");
@@ -241,6 +244,89 @@ fail_discard_handles:
     return r;
 }
 
+// Like zxrio_txn() for each of |count| (at most ZXRIO_PIPELINE_MAX) messages,
+// except that every request is sent before any reply is waited for.  Replies
+// are matched to requests by txid.  On return msgs[i].arg is the status of
+// each transaction, and when it is not negative msgs[i] holds the reply.
+static void zxrio_txn_pipelined(zxrio_t* rio, zxrio_msg_t* msgs, size_t count) {
+    bool done[ZXRIO_PIPELINE_MAX] = {};
+    size_t pending = 0;
+
+    // Replies to zx_channel_call() go straight to their caller, so only the
+    // replies to pipelined requests queue up on the channel; the lock keeps
+    // concurrent pipelines from reading each other's.
+    mtx_lock(&rio->pipeline_lock);
+
+    zx_txid_t first = atomic_fetch_add(&rio->txid, count);
+    for (size_t i = 0; i < count; i++) {
+        zxrio_msg_t* msg = &msgs[i];
+        msg->txid = first + i;
+        xprintf("txn pipelined h=%x txid=%x op=%d len=%u\n", rio->h, msg->txid, msg->op,
+                msg->datalen);
+        zx_status_t r = ZX_ERR_INVALID_ARGS;
+        if (!is_message_valid(msg) ||
+            (r = zx_channel_write(rio->h, 0, msg, ZXRIO_HDR_SZ + msg->datalen,
+                                  msg->handle, msg->hcount)) < 0) {
+            discard_handles(msg->handle, msg->hcount);
+            msg->hcount = 0;
+            msg->arg = r;
+            done[i] = true;
+        } else {
+            pending++;
+        }
+    }
+
+    zxrio_msg_t reply;
+    while (pending > 0) {
+        uint32_t dsize;
+        uint32_t hcount;
+        zx_status_t r = zx_channel_read(rio->h, 0, &reply, reply.handle, sizeof(reply),
+                                        FDIO_MAX_HANDLES, &dsize, &hcount);
+        if (r == ZX_ERR_SHOULD_WAIT) {
+            zx_signals_t observed;
+            r = zx_object_wait_one(rio->h, ZX_CHANNEL_READABLE | ZX_CHANNEL_PEER_CLOSED,
+                                   ZX_TIME_INFINITE, &observed);
+            if (r == ZX_OK) {
+                continue;
+            }
+        }
+        if (r < 0) {
+            for (size_t i = 0; i < count; i++) {
+                if (!done[i]) {
+                    msgs[i].hcount = 0;
+                    msgs[i].arg = r;
+                }
+            }
+            break;
+        }
+        reply.hcount = hcount;
+
+        size_t i = reply.txid - first;
+        if ((i >= count) || done[i]) {
+            // not a reply to this batch
+            discard_handles(reply.handle, reply.hcount);
+            continue;
+        }
+        done[i] = true;
+        pending--;
+
+        if (!is_message_reply_valid(&reply, dsize) ||
+            (ZXRIO_OP(reply.op) != ZXRIO_STATUS)) {
+            discard_handles(reply.handle, reply.hcount);
+            msgs[i].hcount = 0;
+            msgs[i].arg = ZX_ERR_IO;
+            continue;
+        }
+        if (reply.arg < 0) {
+            discard_handles(reply.handle, reply.hcount);
+            reply.hcount = 0;
+        }
+        memcpy(&msgs[i], &reply, ZXRIO_HDR_SZ + reply.datalen);
+    }
+
+    mtx_unlock(&rio->pipeline_lock);
+}
+
 ssize_t zxrio_ioctl(fdio_t* io, uint32_t op, const void* in_buf,
                     size_t in_len, void* out_buf, size_t out_len) {
     zxrio_t* rio = (zxrio_t*)io;
@@ -340,6 +426,138 @@ ssize_t zxrio_ioctl(fdio_t* io, uint32_t op, const void* in_buf,
     return r;
 }
 
+// Returns the connection's transfer vmo, creating it and handing it to the
+// server on first use, or ZX_HANDLE_INVALID if there is none to use.
+// Must be called with rio->xfer_lock held.
+static zx_handle_t get_xfer_vmo(zxrio_t* rio) {
+    if ((rio->xfer_vmo != ZX_HANDLE_INVALID) || rio->xfer_unsupported) {
+        return rio->xfer_vmo;
+    }
+
+    zx_handle_t vmo;
+    if (zx_vmo_create(FDIO_XFER_SIZE, 0, &vmo) != ZX_OK) {
+        return ZX_HANDLE_INVALID;
+    }
+
+    zxrio_msg_t msg;
+    memset(&msg, 0, ZXRIO_HDR_SZ);
+    msg.op = ZXRIO_XFER_VMO;
+    msg.hcount = 1;
+    if (zx_handle_duplicate(vmo, ZX_RIGHT_TRANSFER | ZX_RIGHT_READ | ZX_RIGHT_WRITE,
+                            &msg.handle[0]) != ZX_OK) {
+        zx_handle_close(vmo);
+        return ZX_HANDLE_INVALID;
+    }
+
+    zx_status_t r;
+    if ((r = zxrio_txn(rio, &msg)) < 0) {
+        // Most likely ZX_ERR_NOT_SUPPORTED: don't ask again.
+        xprintf("xfer_vmo: r=%d, falling back to chunked io\n", r);
+        rio->xfer_unsupported = true;
+        zx_handle_close(vmo);
+        return ZX_HANDLE_INVALID;
+    }
+    discard_handles(msg.handle, msg.hcount);
+
+    rio->xfer_vmo = vmo;
+    return vmo;
+}
+
+// Writes through the transfer vmo, one round trip per FDIO_XFER_SIZE bytes.
+static ssize_t write_vmo(zxrio_t* rio, zx_handle_t vmo, uint32_t op,
+                         const uint8_t* data, size_t len, off_t offset) {
+    ssize_t count = 0;
+    zx_status_t r = 0;
+    zxrio_msg_t msg;
+    ssize_t xfer;
+
+    while (len > 0) {
+        xfer = (len > FDIO_XFER_SIZE) ? FDIO_XFER_SIZE : len;
+
+        size_t actual;
+        if ((r = zx_vmo_write(vmo, data, 0, xfer, &actual)) < 0) {
+            break;
+        }
+        if ((ssize_t)actual != xfer) {
+            r = ZX_ERR_IO;
+            break;
+        }
+
+        memset(&msg, 0, ZXRIO_HDR_SZ);
+        msg.op = ZXRIO_WRITE_VMO;
+        msg.arg = xfer;
+        msg.arg2.off = (op == ZXRIO_WRITE_AT) ? offset : -1;
+
+        if ((r = zxrio_txn(rio, &msg)) < 0) {
+            break;
+        }
+        discard_handles(msg.handle, msg.hcount);
+
+        if (r > xfer) {
+            r = ZX_ERR_IO;
+            break;
+        }
+        count += r;
+        data += r;
+        len -= r;
+        if (op == ZXRIO_WRITE_AT)
+            offset += r;
+        // stop at short write
+        if (r < xfer) {
+            break;
+        }
+    }
+    return count ? count : r;
+}
+
+// Reads through the transfer vmo, one round trip per FDIO_XFER_SIZE bytes.
+static ssize_t read_vmo(zxrio_t* rio, zx_handle_t vmo, uint32_t op,
+                        uint8_t* data, size_t len, off_t offset) {
+    ssize_t count = 0;
+    zx_status_t r = 0;
+    zxrio_msg_t msg;
+    ssize_t xfer;
+
+    while (len > 0) {
+        xfer = (len > FDIO_XFER_SIZE) ? FDIO_XFER_SIZE : len;
+
+        memset(&msg, 0, ZXRIO_HDR_SZ);
+        msg.op = ZXRIO_READ_VMO;
+        msg.arg = xfer;
+        msg.arg2.off = (op == ZXRIO_READ_AT) ? offset : -1;
+
+        if ((r = zxrio_txn(rio, &msg)) < 0) {
+            break;
+        }
+        discard_handles(msg.handle, msg.hcount);
+
+        if (r > xfer) {
+            r = ZX_ERR_IO;
+            break;
+        }
+        size_t actual;
+        ssize_t n = r;
+        if ((r = zx_vmo_read(vmo, data, 0, n, &actual)) < 0) {
+            break;
+        }
+        if ((ssize_t)actual != n) {
+            r = ZX_ERR_IO;
+            break;
+        }
+        count += n;
+        data += n;
+        len -= n;
+        if (op == ZXRIO_READ_AT)
+            offset += n;
+
+        // stop at short read
+        if (n < xfer) {
+            break;
+        }
+    }
+    return count ? count : r;
+}
+
 static ssize_t write_common(uint32_t op, fdio_t* io, const void* _data, size_t len, off_t offset) {
     zxrio_t* rio = (zxrio_t*)io;
     const uint8_t* data = _data;
@@ -348,6 +566,17 @@ static ssize_t write_common(uint32_t op, fdio_t* io, const void* _data, size_t l
     zxrio_msg_t msg;
     ssize_t xfer;
 
+    if (len > FDIO_CHUNK_SIZE) {
+        mtx_lock(&rio->xfer_lock);
+        zx_handle_t vmo = get_xfer_vmo(rio);
+        if (vmo != ZX_HANDLE_INVALID) {
+            count = write_vmo(rio, vmo, op, data, len, offset);
+            mtx_unlock(&rio->xfer_lock);
+            return count;
+        }
+        mtx_unlock(&rio->xfer_lock);
+    }
+
     while (len > 0) {
         xfer = (len > FDIO_CHUNK_SIZE) ? FDIO_CHUNK_SIZE : len;
 
@@ -381,11 +610,19 @@ static ssize_t write_common(uint32_t op, fdio_t* io, const void* _data, size_t l
 }
 
 static ssize_t zxrio_write(fdio_t* io, const void* _data, size_t len) {
-    return write_common(ZXRIO_WRITE, io, _data, len, 0);
+    ssize_t r = write_common(ZXRIO_WRITE, io, _data, len, 0);
+    if (r > 0) {
+        __fdio_stat_cache_invalidate();
+    }
+    return r;
 }
 
 static ssize_t zxrio_write_at(fdio_t* io, const void* _data, size_t len, off_t offset) {
-    return write_common(ZXRIO_WRITE_AT, io, _data, len, offset);
+    ssize_t r = write_common(ZXRIO_WRITE_AT, io, _data, len, offset);
+    if (r > 0) {
+        __fdio_stat_cache_invalidate();
+    }
+    return r;
 }
 
 static ssize_t read_common(uint32_t op, fdio_t* io, void* _data, size_t len, off_t offset) {
@@ -396,6 +633,17 @@ static ssize_t read_common(uint32_t op, fdio_t* io, void* _data, size_t len, off
     zxrio_msg_t msg;
     ssize_t xfer;
 
+    if (len > FDIO_CHUNK_SIZE) {
+        mtx_lock(&rio->xfer_lock);
+        zx_handle_t vmo = get_xfer_vmo(rio);
+        if (vmo != ZX_HANDLE_INVALID) {
+            count = read_vmo(rio, vmo, op, data, len, offset);
+            mtx_unlock(&rio->xfer_lock);
+            return count;
+        }
+        mtx_unlock(&rio->xfer_lock);
+    }
+
     while (len > 0) {
         xfer = (len > FDIO_CHUNK_SIZE) ? FDIO_CHUNK_SIZE : len;
 
@@ -475,13 +723,17 @@ zx_status_t zxrio_close(fdio_t* io) {
         rio->h2 = 0;
         zx_handle_close(h);
     }
+    if (rio->xfer_vmo != ZX_HANDLE_INVALID) {
+        zx_handle_close(rio->xfer_vmo);
+        rio->xfer_vmo = ZX_HANDLE_INVALID;
+    }
 
     return r;
 }
 
-// Synchronously (non-pipelined) open an object
-static zx_status_t zxrio_sync_open_connection(zx_handle_t rio_h, zxrio_msg_t* msg,
-                                              zxrio_describe_t* info, zx_handle_t* out) {
+// Send the (one-way) request message of an open which describes the object,
+// returning the channel on which the description will arrive
+static zx_status_t zxrio_open_send(zx_handle_t rio_h, zxrio_msg_t* msg, zx_handle_t* out) {
     zx_status_t r;
     zx_handle_t h;
     if ((r = zx_channel_create(0, &h, &msg->handle[0])) < 0) {
@@ -489,14 +741,21 @@ static zx_status_t zxrio_sync_open_connection(zx_handle_t rio_h, zxrio_msg_t* ms
     }
     msg->hcount = 1;
 
-    // Write the (one-way) request message
     if ((r = zx_channel_write(rio_h, 0, msg, ZXRIO_HDR_SZ + msg->datalen,
                               msg->handle, msg->hcount)) < 0) {
         zx_handle_close(msg->handle[0]);
         zx_handle_close(h);
         return r;
     }
+    *out = h;
+    return ZX_OK;
+}
 
+// Wait for the description of an object opened by zxrio_open_send()
+// This function always consumes the h handle
+static zx_status_t zxrio_open_describe(zx_handle_t h, zxrio_describe_t* info,
+                                       zx_handle_t* out) {
+    zx_status_t r;
     zx_object_wait_one(h, ZX_CHANNEL_READABLE | ZX_CHANNEL_PEER_CLOSED,
                        ZX_TIME_INFINITE, NULL);
 
@@ -528,6 +787,17 @@ static zx_status_t zxrio_sync_open_connection(zx_handle_t rio_h, zxrio_msg_t* ms
     return r;
 }
 
+// Synchronously (non-pipelined) open an object
+static zx_status_t zxrio_sync_open_connection(zx_handle_t rio_h, zxrio_msg_t* msg,
+                                              zxrio_describe_t* info, zx_handle_t* out) {
+    zx_status_t r;
+    zx_handle_t h;
+    if ((r = zxrio_open_send(rio_h, msg, &h)) < 0) {
+        return r;
+    }
+    return zxrio_open_describe(h, info, out);
+}
+
 // This function always consumes the cnxn handle
 // The svc handle is only used to send a message
 static zx_status_t zxrio_connect(zx_handle_t svc, zx_handle_t cnxn,
@@ -649,6 +919,16 @@ zx_status_t zxrio_misc(fdio_t* io, uint32_t op, int64_t off,
         return r;
     }
 
+    switch (op) {
+    case ZXRIO_UNLINK:
+    case ZXRIO_RENAME:
+    case ZXRIO_LINK:
+    case ZXRIO_TRUNCATE:
+    case ZXRIO_SETATTR:
+        __fdio_stat_cache_invalidate();
+        break;
+    }
+
     switch (op) {
     case ZXRIO_MMAP: {
         // Ops which receive single handles:
@@ -834,6 +1114,9 @@ zx_status_t zxrio_getobject(zx_handle_t rio_h, uint32_t op, const char* name,
         return ZX_ERR_BAD_PATH;
     }
 
+    // Whether or not the open goes through, treat the path as changed.
+    bool changes = flags & (ZX_FS_FLAG_CREATE | ZX_FS_FLAG_TRUNCATE);
+
     if (flags & ZX_FS_FLAG_DESCRIBE) {
         zxrio_msg_t msg;
         memset(&msg, 0, ZXRIO_HDR_SZ);
@@ -842,14 +1125,22 @@ zx_status_t zxrio_getobject(zx_handle_t rio_h, uint32_t op, const char* name,
         msg.arg = flags;
         msg.arg2.mode = mode;
         memcpy(msg.data, name, len);
-        return zxrio_sync_open_connection(rio_h, &msg, info, out);
+        zx_status_t r = zxrio_sync_open_connection(rio_h, &msg, info, out);
+        if (changes) {
+            __fdio_stat_cache_invalidate();
+        }
+        return r;
     } else {
         zx_handle_t h0, h1;
         zx_status_t r;
         if ((r = zx_channel_create(0, &h0, &h1)) < 0) {
             return r;
         }
-        if ((r = zxrio_connect(rio_h, h1, ZXRIO_OPEN, flags, mode, name)) < 0) {
+        r = zxrio_connect(rio_h, h1, ZXRIO_OPEN, flags, mode, name);
+        if (changes) {
+            __fdio_stat_cache_invalidate();
+        }
+        if (r < 0) {
             zx_handle_close(h0);
             return r;
         }
@@ -904,6 +1195,156 @@ zx_status_t zxrio_open(fdio_t* io, const char* path, uint32_t flags, uint32_t mo
     return zxrio_open_handle(rio->h, path, flags, mode, out);
 }
 
+static fdio_ops_t zx_remote_ops;
+
+// Names which the batched operations handle: a single path component,
+// which is not "." or ".."
+static bool is_batch_name(const char* name, size_t len) {
+    if ((len == 0) || (len > NAME_MAX) || (memchr(name, '/', len) != NULL)) {
+        return false;
+    }
+    return strcmp(name, ".") && strcmp(name, "..");
+}
+
+zx_status_t zxrio_stat_batch(fdio_t* io, const char* const* names, size_t count,
+                             vnattr_t* attrs, zx_status_t* statuses) {
+    if (io->ops != &zx_remote_ops) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zxrio_t* rio = (zxrio_t*)io;
+    zxrio_msg_t* msgs = malloc(ZXRIO_PIPELINE_MAX * sizeof(zxrio_msg_t));
+    if (msgs == NULL) {
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    size_t next = 0;
+    while (next < count) {
+        // Pack as many names as fit into each of up to ZXRIO_PIPELINE_MAX
+        // messages, remembering where each message's names begin.
+        size_t start[ZXRIO_PIPELINE_MAX];
+        size_t nmsgs = 0;
+        while ((next < count) && (nmsgs < ZXRIO_PIPELINE_MAX)) {
+            zxrio_msg_t* msg = &msgs[nmsgs];
+            memset(msg, 0, ZXRIO_HDR_SZ);
+            msg->op = ZXRIO_STAT_BATCH;
+            start[nmsgs++] = next;
+            for (; next < count; next++) {
+                size_t len = strlen(names[next]);
+                if (!is_batch_name(names[next], len)) {
+                    statuses[next] = ZX_ERR_NOT_SUPPORTED;
+                    continue;
+                }
+                if (((size_t)msg->arg == ZXRIO_STAT_BATCH_MAX) ||
+                    (msg->datalen + len + 1 > FDIO_CHUNK_SIZE)) {
+                    break;
+                }
+                memcpy(msg->data + msg->datalen, names[next], len + 1);
+                msg->datalen += len + 1;
+                msg->arg++;
+            }
+            if (msg->arg == 0) {
+                nmsgs--;
+            }
+        }
+
+        // Each message got an arg of its count; keep them for the replies.
+        int32_t sent[ZXRIO_PIPELINE_MAX];
+        for (size_t m = 0; m < nmsgs; m++) {
+            sent[m] = msgs[m].arg;
+        }
+
+        zxrio_txn_pipelined(rio, msgs, nmsgs);
+
+        for (size_t m = 0; m < nmsgs; m++) {
+            zxrio_msg_t* msg = &msgs[m];
+            zxrio_stat_batch_t* entries = (zxrio_stat_batch_t*)msg->data;
+            zx_status_t r = msg->arg;
+            if ((r >= 0) && (msg->datalen != sent[m] * sizeof(zxrio_stat_batch_t))) {
+                r = ZX_ERR_IO;
+            }
+            if (r >= 0) {
+                discard_handles(msg->handle, msg->hcount);
+            }
+            int32_t e = 0;
+            for (size_t i = start[m]; e < sent[m]; i++) {
+                if (!is_batch_name(names[i], strlen(names[i]))) {
+                    continue;
+                }
+                if (r < 0) {
+                    statuses[i] = r;
+                } else {
+                    statuses[i] = entries[e].status;
+                    memcpy(&attrs[i], &entries[e].attr, sizeof(vnattr_t));
+                }
+                e++;
+            }
+        }
+    }
+
+    free(msgs);
+    return ZX_OK;
+}
+
+zx_status_t zxrio_open_batch(fdio_t* io, const char* const* names, size_t count,
+                             uint32_t flags, fdio_t** outs, zx_status_t* statuses) {
+    if (io->ops != &zx_remote_ops) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    zxrio_t* rio = (zxrio_t*)io;
+    zxrio_msg_t msg;
+
+    // As in zxrio_getobject, whether or not the opens go through, treat
+    // the paths as changed.
+    bool changes = flags & (ZX_FS_FLAG_CREATE | ZX_FS_FLAG_TRUNCATE);
+
+    // Each open replies on its own channel, so no txids are involved: send
+    // a window of requests, then collect their descriptions.
+    for (size_t base = 0; base < count; base += ZXRIO_PIPELINE_MAX) {
+        size_t n = count - base;
+        if (n > ZXRIO_PIPELINE_MAX) {
+            n = ZXRIO_PIPELINE_MAX;
+        }
+        zx_handle_t h[ZXRIO_PIPELINE_MAX];
+        for (size_t i = 0; i < n; i++) {
+            const char* name = names[base + i];
+            size_t len = strlen(name);
+            h[i] = ZX_HANDLE_INVALID;
+            outs[base + i] = NULL;
+            if (!is_batch_name(name, len)) {
+                statuses[base + i] = ZX_ERR_NOT_SUPPORTED;
+                continue;
+            }
+            memset(&msg, 0, ZXRIO_HDR_SZ);
+            msg.op = ZXRIO_OPEN;
+            msg.datalen = len;
+            msg.arg = flags | ZX_FS_FLAG_DESCRIBE;
+            memcpy(msg.data, name, len);
+            statuses[base + i] = zxrio_open_send(rio->h, &msg, &h[i]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (h[i] == ZX_HANDLE_INVALID) {
+                continue;
+            }
+            zxrio_describe_t info;
+            zx_handle_t control_channel;
+            zx_status_t r = zxrio_open_describe(h[i], &info, &control_channel);
+            if (r == ZX_OK) {
+                zx_handle_t handles[2];
+                size_t hcount = (info.handle != ZX_HANDLE_INVALID) ? 2 : 1;
+                handles[0] = control_channel;
+                handles[1] = info.handle;
+                r = fdio_from_handles(info.type, handles, hcount, &info.extra,
+                                      &outs[base + i]);
+            }
+            statuses[base + i] = r;
+        }
+        if (changes) {
+            __fdio_stat_cache_invalidate();
+        }
+    }
+    return ZX_OK;
+}
+
 static zx_status_t zxrio_clone(fdio_t* io, zx_handle_t* handles, uint32_t* types) {
     zxrio_t* rio = (void*)io;
     zx_handle_t h;
@@ -1002,5 +1443,7 @@ fdio_t* fdio_remote_create(zx_handle_t h, zx_handle_t e) {
     rio->h = h;
     rio->h2 = e;
     atomic_init(&rio->txid, 1);
+    mtx_init(&rio->xfer_lock, mtx_plain);
+    mtx_init(&rio->pipeline_lock, mtx_plain);
     return &rio->io;
 }
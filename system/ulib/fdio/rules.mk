@@ -22,6 +22,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/remoteio.c \
     $(LOCAL_DIR)/service.c \
     $(LOCAL_DIR)/socketpair.c \
+    $(LOCAL_DIR)/stat-cache.c \
     $(LOCAL_DIR)/stubs.c \
     $(LOCAL_DIR)/uname.c \
     $(LOCAL_DIR)/unistd.c \
@@ -0,0 +1,441 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
+
+#include <zircon/device/vfs.h>
+#include <zircon/syscalls.h>
+#include <zircon/types.h>
+
+#include <fdio/io.h>
+#include <fdio/private.h>
+
+#include "private.h"
+#include "unistd.h"
+
+// The stat cache remembers the attributes, or the absence, of recently
+// looked up paths, keyed by their cleaned absolute path.  An entry is
+// dropped when:
+//
+// - the ttl given to fdio_stat_cache_enable() runs out,
+// - a watcher on its directory reports the name added or removed, or
+//   the directory itself going away, or
+// - this process changes anything on a remote filesystem, which bumps
+//   the cache generation.
+//
+// Watchers do not report changes to the attributes of a file which stays
+// in place, nor changes to directories further up the path, so those
+// changes made by other processes are seen once the entry expires.
+//
+// A directory's watcher is only given up for another directory once the
+// directory has gone unused for a ttl, by which time its entries have
+// expired anyway. Until then, paths in directories beyond the first
+// CACHE_DIRS are not cached, rather than evicting watchers which are
+// still in use.
+
+#define CACHE_SLOTS 1024
+#define CACHE_DIRS 128
+
+typedef struct {
+    char* path;     // NULL if the slot is empty
+    uint64_t hash;
+    uint64_t gen;
+    int dir;        // index into cache.dirs
+    uint64_t dir_gen;
+    zx_time_t expires;
+    zx_status_t status;
+    struct stat st;
+} cache_entry_t;
+
+typedef struct {
+    char* path;     // NULL if the slot is empty
+    zx_handle_t h;  // ZX_HANDLE_INVALID if the directory cannot be watched
+    uint64_t gen;   // bumped whenever the slot is taken or given up
+    uint64_t events; // bumped whenever a name is added or removed
+    zx_time_t last_use;
+} cache_dir_t;
+
+static struct {
+    mtx_t lock;
+    atomic_bool enabled;
+    zx_duration_t ttl;
+    cache_entry_t* slots;
+    cache_dir_t dirs[CACHE_DIRS];
+    fdio_stat_cache_stats_t stats;
+} cache = {
+    .lock = MTX_INIT,
+};
+
+static atomic_uint_fast64_t cache_gen;
+
+// FNV-1a
+static uint64_t hash_path(const char* path) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *path; path++) {
+        hash = (hash ^ (uint8_t)*path) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static cache_entry_t* find_entry(const char* path, uint64_t hash) {
+    cache_entry_t* e = &cache.slots[hash % CACHE_SLOTS];
+    if ((e->path != NULL) && (e->hash == hash) && !strcmp(e->path, path)) {
+        return e;
+    }
+    return NULL;
+}
+
+static void drop_entry(cache_entry_t* e) {
+    free(e->path);
+    e->path = NULL;
+}
+
+// Drops the entry for the name in the directory d, if there is one.
+static void drop_name(const cache_dir_t* d, const char* name, size_t namelen) {
+    char path[PATH_MAX];
+    size_t dirlen = strlen(d->path);
+    if (dirlen == 1) {
+        // Children of "/"
+        dirlen = 0;
+    }
+    if (dirlen + 1 + namelen >= sizeof(path)) {
+        return;
+    }
+    memcpy(path, d->path, dirlen);
+    path[dirlen] = '/';
+    memcpy(path + dirlen + 1, name, namelen);
+    path[dirlen + 1 + namelen] = 0;
+
+    cache_entry_t* e = find_entry(path, hash_path(path));
+    if (e != NULL) {
+        drop_entry(e);
+        cache.stats.invalidations++;
+    }
+}
+
+// Gives up the directory slot, which also invalidates every entry
+// recorded against it.
+static void drop_dir(cache_dir_t* d) {
+    if (d->h != ZX_HANDLE_INVALID) {
+        zx_handle_close(d->h);
+        d->h = ZX_HANDLE_INVALID;
+    }
+    free(d->path);
+    d->path = NULL;
+    d->gen++;
+}
+
+// Applies the events already queued on the watcher of d, without waiting.
+static void poll_dir(cache_dir_t* d) {
+    uint8_t msg[VFS_WATCH_MSG_MAX];
+    while (d->h != ZX_HANDLE_INVALID) {
+        uint32_t len;
+        zx_status_t status = zx_channel_read(d->h, 0, msg, NULL, sizeof(msg), 0,
+                                             &len, NULL);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            return;
+        } else if (status != ZX_OK) {
+            // The server went away; nothing it served can be trusted.
+            drop_dir(d);
+            cache.stats.invalidations++;
+            return;
+        }
+
+        // Message Format: { OP, LEN, DATA[LEN] }
+        const uint8_t* p = msg;
+        while (len >= 2) {
+            unsigned event = *p++;
+            unsigned namelen = *p++;
+            if (len < (namelen + 2u)) {
+                break;
+            }
+            switch (event) {
+            case VFS_WATCH_EVT_ADDED:
+            case VFS_WATCH_EVT_REMOVED:
+                // Also counted, for a lookup still out at the server
+                // which has no entry here to drop yet.
+                drop_name(d, (const char*)p, namelen);
+                d->events++;
+                break;
+            case VFS_WATCH_EVT_DELETED:
+                drop_dir(d);
+                cache.stats.invalidations++;
+                return;
+            }
+            p += namelen;
+            len -= namelen + 2;
+        }
+    }
+}
+
+// Returns the slot watching the directory at path, or -1 if it is not
+// watched yet.
+static int find_dir(const char* path) {
+    for (int i = 0; i < CACHE_DIRS; i++) {
+        if ((cache.dirs[i].path != NULL) && !strcmp(cache.dirs[i].path, path)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Returns a free slot, or the one given up by a directory which has not
+// been used for a ttl, or -1 if every watcher is still in use.
+static int free_dir(zx_time_t now) {
+    int lru = 0;
+    for (int i = 0; i < CACHE_DIRS; i++) {
+        if (cache.dirs[i].path == NULL) {
+            return i;
+        }
+        if (cache.dirs[i].last_use < cache.dirs[lru].last_use) {
+            lru = i;
+        }
+    }
+    if (now - cache.dirs[lru].last_use < cache.ttl) {
+        return -1;
+    }
+    drop_dir(&cache.dirs[lru]);
+    return lru;
+}
+
+// Returns a channel on which the directory at path reports names being
+// added or removed, or ZX_HANDLE_INVALID if it cannot be watched. This
+// talks to the filesystem, so it is called without cache.lock held.
+static zx_handle_t open_watcher(const char* path) {
+    fdio_t* io;
+    if (__fdio_open(&io, path, O_RDONLY | O_DIRECTORY, 0) != ZX_OK) {
+        return ZX_HANDLE_INVALID;
+    }
+    vfs_watch_dir_t wd = {
+        .mask = VFS_WATCH_MASK_ADDED | VFS_WATCH_MASK_REMOVED | VFS_WATCH_MASK_DELETED,
+        .options = 0,
+    };
+    zx_handle_t h;
+    if (zx_channel_create(0, &wd.channel, &h) == ZX_OK) {
+        // The ioctl consumes wd.channel, whether or not it succeeds.
+        if (io->ops->ioctl(io, IOCTL_VFS_WATCH_DIR, &wd, sizeof(wd), NULL, 0) < 0) {
+            zx_handle_close(h);
+            h = ZX_HANDLE_INVALID;
+        }
+    } else {
+        h = ZX_HANDLE_INVALID;
+    }
+    fdio_close(io);
+    fdio_release(io);
+    return h;
+}
+
+// Returns the slot watching the directory at path, setting up a watcher
+// if there is none yet, or -1 if the directory is not to be cached.
+// Called with cache.lock held, which is dropped while the watcher is set
+// up.
+static int watch_dir(const char* path) {
+    zx_time_t now = zx_time_get(ZX_CLOCK_MONOTONIC);
+    int i = find_dir(path);
+    if (i < 0) {
+        // Check for room first, so that a thrashing table does not cost
+        // a round trip to the filesystem on every miss.
+        if (free_dir(now) < 0) {
+            return -1;
+        }
+        mtx_unlock(&cache.lock);
+        zx_handle_t h = open_watcher(path);
+        mtx_lock(&cache.lock);
+
+        // Things may have changed while the lock was dropped.
+        if ((cache.slots == NULL) || ((i = find_dir(path)) >= 0) ||
+            ((i = free_dir(now)) < 0)) {
+            zx_handle_close(h);
+        } else {
+            cache_dir_t* d = &cache.dirs[i];
+            if ((d->path = strdup(path)) == NULL) {
+                zx_handle_close(h);
+                return -1;
+            }
+            // A directory which cannot be watched keeps its slot, so that
+            // it is not retried on every miss, and its entries live until
+            // they expire.
+            d->h = h;
+            d->gen++;
+        }
+        if ((cache.slots == NULL) || (i < 0)) {
+            return -1;
+        }
+    }
+    cache.dirs[i].last_use = now;
+    return i;
+}
+
+static void flush(void) {
+    for (size_t i = 0; i < CACHE_SLOTS; i++) {
+        drop_entry(&cache.slots[i]);
+    }
+    for (size_t i = 0; i < CACHE_DIRS; i++) {
+        drop_dir(&cache.dirs[i]);
+    }
+}
+
+bool __fdio_stat_cache_lookup(int dirfd, const char* path,
+                              fdio_stat_cache_ticket_t* t,
+                              struct stat* s, zx_status_t* status) {
+    t->path[0] = 0;
+    if (!atomic_load(&cache.enabled) || (path == NULL) || (path[0] == 0)) {
+        return false;
+    }
+
+    // Read the generation before the path is resolved, so that a chdir()
+    // or a change made while the caller goes to the server keeps the
+    // result out of the cache.
+    t->gen = atomic_load(&cache_gen);
+
+    char full[PATH_MAX];
+    int n;
+    if (path[0] == '/') {
+        n = snprintf(full, sizeof(full), "%s", path);
+    } else if (dirfd == AT_FDCWD) {
+        mtx_lock(&fdio_cwd_lock);
+        n = snprintf(full, sizeof(full), "%s/%s", fdio_cwd_path, path);
+        mtx_unlock(&fdio_cwd_lock);
+    } else {
+        // Paths relative to other directories have no name to key on.
+        return false;
+    }
+    if ((n < 0) || ((size_t)n >= sizeof(full)) || (full[0] != '/')) {
+        return false;
+    }
+    size_t len;
+    bool is_dir;
+    if ((__fdio_cleanpath(full, t->path, &len, &is_dir) != ZX_OK) || is_dir) {
+        t->path[0] = 0;
+        return false;
+    }
+
+    mtx_lock(&cache.lock);
+    if (cache.slots == NULL) {
+        goto uncached;
+    }
+
+    // Watch the parent before the caller looks the path up, so that no
+    // change after the lookup goes unseen.
+    char* slash = strrchr(t->path, '/');
+    *slash = 0;
+    t->dir = watch_dir((slash == t->path) ? "/" : t->path);
+    *slash = '/';
+    if (t->dir < 0) {
+        goto uncached;
+    }
+    cache_dir_t* d = &cache.dirs[t->dir];
+    poll_dir(d);
+    if (d->path == NULL) {
+        goto uncached;
+    }
+    t->dir_gen = d->gen;
+    t->dir_events = d->events;
+
+    cache_entry_t* e = find_entry(t->path, hash_path(t->path));
+    if (e != NULL) {
+        if ((e->gen == t->gen) && (cache.dirs[e->dir].gen == e->dir_gen) &&
+            (zx_time_get(ZX_CLOCK_MONOTONIC) < e->expires)) {
+            *status = e->status;
+            if (e->status == ZX_OK) {
+                *s = e->st;
+            }
+            cache.stats.hits++;
+            mtx_unlock(&cache.lock);
+            return true;
+        }
+        drop_entry(e);
+    }
+    cache.stats.misses++;
+    mtx_unlock(&cache.lock);
+    return false;
+
+uncached:
+    mtx_unlock(&cache.lock);
+    t->path[0] = 0;
+    return false;
+}
+
+void __fdio_stat_cache_insert(const fdio_stat_cache_ticket_t* t,
+                              const struct stat* s, zx_status_t status) {
+    if (t->path[0] == 0) {
+        return;
+    }
+    // Only a definite answer is worth keeping.
+    if (!((status == ZX_OK && s != NULL) || (status == ZX_ERR_NOT_FOUND))) {
+        return;
+    }
+
+    mtx_lock(&cache.lock);
+    if (cache.slots == NULL) {
+        mtx_unlock(&cache.lock);
+        return;
+    }
+    // Any change to the directory since the lookup, whether or not
+    // another thread has already seen it, may have made the result stale.
+    cache_dir_t* d = &cache.dirs[t->dir];
+    if (d->gen == t->dir_gen) {
+        poll_dir(d);
+    }
+    if ((t->gen == atomic_load(&cache_gen)) && (d->gen == t->dir_gen) &&
+        (d->events == t->dir_events)) {
+        uint64_t hash = hash_path(t->path);
+        cache_entry_t* e = &cache.slots[hash % CACHE_SLOTS];
+        drop_entry(e);
+        if ((e->path = strdup(t->path)) != NULL) {
+            e->hash = hash;
+            e->gen = t->gen;
+            e->dir = t->dir;
+            e->dir_gen = t->dir_gen;
+            e->expires = zx_time_get(ZX_CLOCK_MONOTONIC) + cache.ttl;
+            e->status = status;
+            if (status == ZX_OK) {
+                e->st = *s;
+            }
+        }
+    }
+    mtx_unlock(&cache.lock);
+}
+
+void __fdio_stat_cache_invalidate(void) {
+    if (atomic_load(&cache.enabled)) {
+        atomic_fetch_add(&cache_gen, 1);
+    }
+}
+
+void fdio_stat_cache_enable(zx_duration_t ttl) {
+    mtx_lock(&cache.lock);
+    if (ttl == 0) {
+        atomic_store(&cache.enabled, false);
+        if (cache.slots != NULL) {
+            flush();
+            free(cache.slots);
+            cache.slots = NULL;
+        }
+    } else {
+        if (cache.slots == NULL) {
+            cache.slots = calloc(CACHE_SLOTS, sizeof(cache_entry_t));
+        }
+        if (cache.slots != NULL) {
+            cache.ttl = ttl;
+            atomic_store(&cache.enabled, true);
+        }
+    }
+    mtx_unlock(&cache.lock);
+}
+
+void fdio_stat_cache_get_stats(fdio_stat_cache_stats_t* out) {
+    mtx_lock(&cache.lock);
+    *out = cache.stats;
+    out->invalidations += atomic_load(&cache_gen);
+    mtx_unlock(&cache.lock);
+}
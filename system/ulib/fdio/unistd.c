@@ -39,6 +39,7 @@
 #include <fdio/socket.h>
 
 #include "private.h"
+#include "private-remoteio.h"
 #include "unistd.h"
 
 static_assert(FDIO_FLAG_CLOEXEC == FD_CLOEXEC, "Unexpected fdio flags value");
@@ -603,6 +604,11 @@ void __libc_extensions_init(uint32_t handle_count,
 
     update_cwd_path(cwd);
 
+    const char* ttl = getenv("FDIO_STAT_CACHE_TTL_MS");
+    if (ttl != NULL) {
+        fdio_stat_cache_enable(ZX_MSEC(strtoull(ttl, NULL, 10)));
+    }
+
     fdio_t* use_for_stdio = (stdio_fd >= 0) ? fdio_fdtab[stdio_fd] : NULL;
 
     // configure stdin/out/err if not init'd
@@ -776,6 +782,20 @@ zx_status_t fdio_wait_fd(int fd, uint32_t events, uint32_t* _pending, zx_time_t
     return status;
 }
 
+static void vnattr_to_stat(const vnattr_t* attr, struct stat* s) {
+    memset(s, 0, sizeof(struct stat));
+    s->st_mode = attr->mode;
+    s->st_ino = attr->inode;
+    s->st_size = attr->size;
+    s->st_blksize = attr->blksize;
+    s->st_blocks = attr->blkcount;
+    s->st_nlink = attr->nlink;
+    s->st_ctim.tv_sec = attr->create_time / ZX_SEC(1);
+    s->st_ctim.tv_nsec = attr->create_time % ZX_SEC(1);
+    s->st_mtim.tv_sec = attr->modify_time / ZX_SEC(1);
+    s->st_mtim.tv_nsec = attr->modify_time % ZX_SEC(1);
+}
+
 int fdio_stat(fdio_t* io, struct stat* s) {
     vnattr_t attr;
     int r = io->ops->misc(io, ZXRIO_STAT, 0, sizeof(attr), &attr, 0);
@@ -785,17 +805,7 @@ int fdio_stat(fdio_t* io, struct stat* s) {
     if (r < (int)sizeof(attr)) {
         return ZX_ERR_IO;
     }
-    memset(s, 0, sizeof(struct stat));
-    s->st_mode = attr.mode;
-    s->st_ino = attr.inode;
-    s->st_size = attr.size;
-    s->st_blksize = attr.blksize;
-    s->st_blocks = attr.blkcount;
-    s->st_nlink = attr.nlink;
-    s->st_ctim.tv_sec = attr.create_time / ZX_SEC(1);
-    s->st_ctim.tv_nsec = attr.create_time % ZX_SEC(1);
-    s->st_mtim.tv_sec = attr.modify_time / ZX_SEC(1);
-    s->st_mtim.tv_nsec = attr.modify_time % ZX_SEC(1);
+    vnattr_to_stat(&attr, s);
     return 0;
 }
 
@@ -1382,7 +1392,18 @@ static int vopenat(int dirfd, const char* path, int flags, va_list args) {
         }
         mode = va_arg(args, uint32_t) & 0777;
     }
+    // Paths the stat cache knows to be missing fail without a round trip.
+    fdio_stat_cache_ticket_t ticket;
+    bool lookup = !(flags & O_CREAT);
+    struct stat st;
+    if (lookup && __fdio_stat_cache_lookup(dirfd, path, &ticket, &st, &r) &&
+        (r != ZX_OK)) {
+        return ERROR(r);
+    }
     if ((r = __fdio_open_at(&io, dirfd, path, flags, mode)) < 0) {
+        if (lookup) {
+            __fdio_stat_cache_insert(&ticket, NULL, r);
+        }
         return ERROR(r);
     }
     if (flags & O_NONBLOCK) {
@@ -1412,6 +1433,51 @@ int openat(int dirfd, const char* path, int flags, ...) {
     return ret;
 }
 
+int fdio_open_batch(int dirfd, const char* const* names, size_t count,
+                    int flags, int* fds) {
+    if (flags & O_CREAT) {
+        return ERRNO(EINVAL);
+    }
+    const char* dot = ".";
+    fdio_t* iodir = fdio_iodir(&dot, dirfd);
+    if (iodir == NULL) {
+        return ERRNO(EBADF);
+    }
+    fdio_t** ios = malloc(count * sizeof(fdio_t*));
+    zx_status_t* statuses = malloc(count * sizeof(zx_status_t));
+    zx_status_t r = ZX_ERR_NO_MEMORY;
+    if (flags & O_PIPELINE) {
+        // plain opens don't wait for the server anyway
+        r = ZX_ERR_NOT_SUPPORTED;
+    } else if ((ios != NULL) && (statuses != NULL)) {
+        r = zxrio_open_batch(iodir, names, count, fdio_flags_to_zxio(flags),
+                             ios, statuses);
+    }
+    fdio_release(iodir);
+
+    for (size_t i = 0; i < count; i++) {
+        if ((r != ZX_OK) || (statuses[i] == ZX_ERR_NOT_SUPPORTED)) {
+            int fd = openat(dirfd, names[i], flags);
+            fds[i] = (fd < 0) ? -errno : fd;
+        } else if (statuses[i] != ZX_OK) {
+            fds[i] = -fdio_status_to_errno(statuses[i]);
+        } else {
+            fdio_t* io = ios[i];
+            if (flags & O_NONBLOCK) {
+                io->flags |= FDIO_FLAG_NONBLOCK;
+            }
+            if ((fds[i] = fdio_bind_to_fd(io, -1, 0)) < 0) {
+                io->ops->close(io);
+                fdio_release(io);
+                fds[i] = -EMFILE;
+            }
+        }
+    }
+    free(ios);
+    free(statuses);
+    return 0;
+}
+
 int mkdir(const char* path, mode_t mode) {
     return mkdirat(AT_FDCWD, path, mode);
 }
@@ -1468,12 +1534,18 @@ int fstatat(int dirfd, const char* fn, struct stat* s, int flags) {
     fdio_t* io;
     zx_status_t r;
 
+    fdio_stat_cache_ticket_t ticket;
+    if (__fdio_stat_cache_lookup(dirfd, fn, &ticket, s, &r)) {
+        return STATUS(r);
+    }
     if ((r = __fdio_open_at(&io, dirfd, fn, O_PATH, 0)) < 0) {
+        __fdio_stat_cache_insert(&ticket, NULL, r);
         return ERROR(r);
     }
     r = fdio_stat(io, s);
     fdio_close(io);
     fdio_release(io);
+    __fdio_stat_cache_insert(&ticket, s, r);
     return STATUS(r);
 }
 
@@ -1481,6 +1553,36 @@ int stat(const char* fn, struct stat* s) {
     return fstatat(AT_FDCWD, fn, s, 0);
 }
 
+int fdio_stat_batch(int dirfd, const char* const* names, size_t count,
+                    struct stat* st, int* results) {
+    const char* dot = ".";
+    fdio_t* iodir = fdio_iodir(&dot, dirfd);
+    if (iodir == NULL) {
+        return ERRNO(EBADF);
+    }
+    vnattr_t* attrs = malloc(count * sizeof(vnattr_t));
+    zx_status_t* statuses = malloc(count * sizeof(zx_status_t));
+    zx_status_t r = ZX_ERR_NO_MEMORY;
+    if ((attrs != NULL) && (statuses != NULL)) {
+        r = zxrio_stat_batch(iodir, names, count, attrs, statuses);
+    }
+    fdio_release(iodir);
+
+    for (size_t i = 0; i < count; i++) {
+        if ((r != ZX_OK) || (statuses[i] == ZX_ERR_NOT_SUPPORTED)) {
+            results[i] = (fstatat(dirfd, names[i], &st[i], 0) < 0) ? -errno : 0;
+        } else if (statuses[i] != ZX_OK) {
+            results[i] = -fdio_status_to_errno(statuses[i]);
+        } else {
+            vnattr_to_stat(&attrs[i], &st[i]);
+            results[i] = 0;
+        }
+    }
+    free(attrs);
+    free(statuses);
+    return 0;
+}
+
 int lstat(const char* path, struct stat* buf) {
     return stat(path, buf);
 }
@@ -1638,13 +1740,19 @@ int faccessat(int dirfd, const char* filename, int amode, int flag) {
     // file exists a la fstatat.
     fdio_t* io;
     zx_status_t status;
+    fdio_stat_cache_ticket_t ticket;
+    struct stat s;
+    if (__fdio_stat_cache_lookup(dirfd, filename, &ticket, &s, &status)) {
+        return STATUS(status);
+    }
     if ((status = __fdio_open_at(&io, dirfd, filename, 0, 0)) < 0) {
+        __fdio_stat_cache_insert(&ticket, NULL, status);
         return ERROR(status);
     }
-    struct stat s;
     status = fdio_stat(io, &s);
     fdio_close(io);
     fdio_release(io);
+    __fdio_stat_cache_insert(&ticket, &s, status);
     return STATUS(status);
 }
 
@@ -1678,6 +1786,7 @@ char* getcwd(char* buf, size_t size) {
 void fdio_chdir(fdio_t* io, const char* path) {
     mtx_lock(&fdio_cwd_lock);
     update_cwd_path(path);
+    __fdio_stat_cache_invalidate();
     mtx_lock(&fdio_lock);
     fdio_t* old = fdio_cwd_handle;
     fdio_cwd_handle = io;
@@ -0,0 +1,200 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <zircon/compiler.h>
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/fifo.h>
+#include <zircon/types.h>
+
+__BEGIN_CDECLS
+
+// Moves entries through the mapped ring of a fifo created with
+// ZX_FIFO_SHARED_RING, so that the common case needs no syscall at all.
+//
+// fifo_ring_read() and fifo_ring_write() behave like zx_fifo_read() and
+// zx_fifo_write(), and the fifo's READABLE and WRITABLE signals can still be
+// waited on: they only call zx_fifo_ring_notify() when the other side may be
+// waiting, that is when a write fills an empty ring, when a read makes room
+// in a full one, or when they find nothing to do.
+//
+// A ring has a single reader and a single writer: calls for one direction
+// must be serialized by the caller, and must not be mixed with
+// zx_fifo_read() or zx_fifo_write() on the same endpoint.
+
+typedef struct fifo_ring {
+    zx_handle_t fifo;
+    uintptr_t mapping;
+    size_t mapping_size;
+    uint32_t elem_count;
+    uint32_t elem_size;
+    zx_fifo_ring_header_t* rx;
+    uint8_t* rx_data;
+    zx_fifo_ring_header_t* tx;
+    uint8_t* tx_data;
+} fifo_ring_t;
+
+// Maps the ring of |fifo|, which stays owned by the caller. Returns
+// ZX_ERR_NOT_SUPPORTED if |fifo| was not created with ZX_FIFO_SHARED_RING, in
+// which case the caller should keep using zx_fifo_read() and zx_fifo_write().
+static inline zx_status_t fifo_ring_init(fifo_ring_t* ring, zx_handle_t fifo) {
+    zx_fifo_ring_info_t info;
+    zx_handle_t vmo;
+    zx_status_t status = zx_fifo_get_ring(fifo, &info, &vmo);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    uintptr_t mapping;
+    status = zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, info.vmo_size,
+                         ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_PERM_WRITE, &mapping);
+    zx_handle_close(vmo);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    ring->fifo = fifo;
+    ring->mapping = mapping;
+    ring->mapping_size = info.vmo_size;
+    ring->elem_count = info.elem_count;
+    ring->elem_size = info.elem_size;
+    ring->rx = (zx_fifo_ring_header_t*)(mapping + info.rx_header_offset);
+    ring->rx_data = (uint8_t*)(mapping + info.rx_data_offset);
+    ring->tx = (zx_fifo_ring_header_t*)(mapping + info.tx_header_offset);
+    ring->tx_data = (uint8_t*)(mapping + info.tx_data_offset);
+    return ZX_OK;
+}
+
+// Unmaps the ring. Does not close the fifo.
+static inline void fifo_ring_release(fifo_ring_t* ring) {
+    if (ring->mapping != 0) {
+        zx_vmar_unmap(zx_vmar_root_self(), ring->mapping, ring->mapping_size);
+        ring->mapping = 0;
+    }
+}
+
+// Copies |count| entries starting at ring index |index| out of, or into, the
+// slots at |data|, wrapping around the end of the ring.
+static inline void fifo_ring_copy_out(const fifo_ring_t* ring, const uint8_t* data,
+                                      uint32_t index, uint8_t* out, uint32_t count) {
+    uint32_t offset = index & (ring->elem_count - 1);
+    uint32_t n = ring->elem_count - offset;
+    if (n > count) {
+        n = count;
+    }
+    memcpy(out, data + offset * ring->elem_size, n * ring->elem_size);
+    memcpy(out + n * ring->elem_size, data, (count - n) * ring->elem_size);
+}
+
+static inline void fifo_ring_copy_in(const fifo_ring_t* ring, uint8_t* data,
+                                     uint32_t index, const uint8_t* in, uint32_t count) {
+    uint32_t offset = index & (ring->elem_count - 1);
+    uint32_t n = ring->elem_count - offset;
+    if (n > count) {
+        n = count;
+    }
+    memcpy(data + offset * ring->elem_size, in, n * ring->elem_size);
+    memcpy(data, in + n * ring->elem_size, (count - n) * ring->elem_size);
+}
+
+// Writes as many of the entries in |entries| (|len| bytes) as fit.
+static inline zx_status_t fifo_ring_write(fifo_ring_t* ring, const void* entries, size_t len,
+                                          uint32_t* actual) {
+    size_t count = len / ring->elem_size;
+    if (count == 0) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    uint32_t head = ring->tx->head;
+    uint32_t tail = __atomic_load_n(&ring->tx->tail, __ATOMIC_ACQUIRE);
+    uint32_t avail = ring->elem_count - (head - tail);
+    if (avail == 0) {
+        // Our WRITABLE signal may be stale: refresh it before the caller
+        // waits on it, then look again in case the reader made room since.
+        zx_status_t status = zx_fifo_ring_notify(ring->fifo);
+        if (status != ZX_OK) {
+            return status;
+        }
+        tail = __atomic_load_n(&ring->tx->tail, __ATOMIC_ACQUIRE);
+        avail = ring->elem_count - (head - tail);
+        if (avail == 0) {
+            return ZX_ERR_SHOULD_WAIT;
+        }
+    }
+    if (count > avail) {
+        count = avail;
+    }
+
+    fifo_ring_copy_in(ring, ring->tx_data, head, (const uint8_t*)entries, (uint32_t)count);
+    __atomic_store_n(&ring->tx->head, head + (uint32_t)count, __ATOMIC_RELEASE);
+
+    // If the reader had caught up with the old head it may be waiting for
+    // READABLE. The fence orders our head store before the tail load, and
+    // pairs with the one in fifo_ring_read().
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->tx->tail, __ATOMIC_ACQUIRE) == head) {
+        zx_status_t status = zx_fifo_ring_notify(ring->fifo);
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+
+    *actual = (uint32_t)count;
+    return ZX_OK;
+}
+
+// Reads as many entries as are queued, up to |len| bytes worth, into |entries|.
+static inline zx_status_t fifo_ring_read(fifo_ring_t* ring, void* entries, size_t len,
+                                         uint32_t* actual) {
+    size_t count = len / ring->elem_size;
+    if (count == 0) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    uint32_t tail = ring->rx->tail;
+    uint32_t head = __atomic_load_n(&ring->rx->head, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        // Our READABLE signal may be stale: refresh it before the caller
+        // waits on it, then look again in case the writer queued more since.
+        zx_status_t status = zx_fifo_ring_notify(ring->fifo);
+        if (status != ZX_OK) {
+            return status;
+        }
+        head = __atomic_load_n(&ring->rx->head, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            return ZX_ERR_SHOULD_WAIT;
+        }
+    }
+    if (head - tail > ring->elem_count) {
+        // The writer left the ring inconsistent.
+        return ZX_ERR_BAD_STATE;
+    }
+    if (count > head - tail) {
+        count = head - tail;
+    }
+
+    fifo_ring_copy_out(ring, ring->rx_data, tail, (uint8_t*)entries, (uint32_t)count);
+    __atomic_store_n(&ring->rx->tail, tail + (uint32_t)count, __ATOMIC_RELEASE);
+
+    // If the ring was full before we made room, the writer may be waiting
+    // for WRITABLE. See fifo_ring_write() for the fence.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->rx->head, __ATOMIC_ACQUIRE) - tail == ring->elem_count) {
+        zx_status_t status = zx_fifo_ring_notify(ring->fifo);
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+
+    *actual = (uint32_t)count;
+    return ZX_OK;
+}
+
+__END_CDECLS
@@ -15,6 +15,7 @@
 #include <fdio/io.h>
 #include <fdio/remoteio.h>
 #include <fdio/vfs.h>
+#include <fbl/algorithm.h>
 #include <fs/trace.h>
 #include <fs/vnode.h>
 #include <zircon/assert.h>
@@ -304,6 +305,119 @@ zx_status_t Connection::HandleMessage(zxrio_msg_t* msg) {
         }
         return status;
     }
+    case ZXRIO_XFER_VMO: {
+        TRACE_DURATION("vfs", "ZXRIO_XFER_VMO");
+        zx::vmo vmo(msg->handle[0]); // take ownership
+        if (IsPathOnly(flags_)) {
+            return ZX_ERR_BAD_HANDLE;
+        }
+        xfer_vmo_ = fbl::move(vmo);
+        return ZX_OK;
+    }
+    case ZXRIO_READ_VMO: {
+        TRACE_DURATION("vfs", "ZXRIO_READ_VMO");
+        if (!IsReadable(flags_)) {
+            return ZX_ERR_BAD_HANDLE;
+        }
+        if (!xfer_vmo_) {
+            return ZX_ERR_BAD_STATE;
+        }
+        bool seek = (msg->arg2.off == -1);
+        if ((arg < 0) || (arg > FDIO_XFER_SIZE) || (!seek && msg->arg2.off < 0)) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        size_t offset = seek ? offset_ : static_cast<size_t>(msg->arg2.off);
+
+        // The client owns the vmo and may shrink it at any time, so it is
+        // accessed through vmo writes from msg->data rather than mapped.
+        size_t count = 0;
+        zx_status_t status = ZX_OK;
+        while (count < static_cast<size_t>(arg)) {
+            size_t xfer = fbl::min(static_cast<size_t>(arg) - count,
+                                   static_cast<size_t>(FDIO_CHUNK_SIZE));
+            size_t actual;
+            if ((status = vnode_->Read(msg->data, xfer, offset + count, &actual)) != ZX_OK) {
+                break;
+            }
+            ZX_DEBUG_ASSERT(actual <= xfer);
+            size_t copied;
+            if ((status = xfer_vmo_.write(msg->data, count, actual, &copied)) != ZX_OK) {
+                break;
+            }
+            // Only what reached the vmo counts; a shrunk vmo ends the read.
+            ZX_DEBUG_ASSERT(copied <= actual);
+            count += copied;
+            if ((copied < actual) || (actual < xfer)) {
+                break;
+            }
+        }
+        if (count == 0 && status != ZX_OK) {
+            return status;
+        }
+        if (seek) {
+            offset_ += count;
+            msg->arg2.off = offset_;
+        }
+        return static_cast<zx_status_t>(count);
+    }
+    case ZXRIO_WRITE_VMO: {
+        TRACE_DURATION("vfs", "ZXRIO_WRITE_VMO");
+        if (!IsWritable(flags_)) {
+            return ZX_ERR_BAD_HANDLE;
+        }
+        if (!xfer_vmo_) {
+            return ZX_ERR_BAD_STATE;
+        }
+        bool seek = (msg->arg2.off == -1);
+        if ((arg < 0) || (arg > FDIO_XFER_SIZE) || (!seek && msg->arg2.off < 0)) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        bool append = seek && (flags_ & ZX_FS_FLAG_APPEND);
+        size_t offset = seek ? offset_ : static_cast<size_t>(msg->arg2.off);
+
+        size_t count = 0;
+        zx_status_t status = ZX_OK;
+        while (count < static_cast<size_t>(arg)) {
+            size_t xfer = fbl::min(static_cast<size_t>(arg) - count,
+                                   static_cast<size_t>(FDIO_CHUNK_SIZE));
+            size_t actual;
+            if ((status = xfer_vmo_.read(msg->data, count, xfer, &actual)) != ZX_OK) {
+                break;
+            }
+            // A vmo shrunk by the client yields fewer bytes than asked for;
+            // write only those, and stop after them.
+            ZX_DEBUG_ASSERT(actual <= xfer);
+            bool short_read = (actual < xfer);
+            if ((xfer = actual) == 0) {
+                break;
+            }
+            if (append) {
+                size_t end;
+                if ((status = vnode_->Append(msg->data, xfer, &end, &actual)) != ZX_OK) {
+                    break;
+                }
+                offset_ = end;
+            } else if ((status = vnode_->Write(msg->data, xfer, offset + count,
+                                               &actual)) != ZX_OK) {
+                break;
+            }
+            ZX_DEBUG_ASSERT(actual <= xfer);
+            count += actual;
+            if (short_read || (actual < xfer)) {
+                break;
+            }
+        }
+        if (count == 0 && status != ZX_OK) {
+            return status;
+        }
+        if (seek) {
+            if (!append) {
+                offset_ += count;
+            }
+            msg->arg2.off = offset_;
+        }
+        return static_cast<zx_status_t>(count);
+    }
     case ZXRIO_SEEK: {
         TRACE_DURATION("vfs", "ZXRIO_SEEK");
         if (IsPathOnly(flags_)) {
@@ -370,6 +484,36 @@ zx_status_t Connection::HandleMessage(zxrio_msg_t* msg) {
         }
         return msg->datalen;
     }
+    case ZXRIO_STAT_BATCH: {
+        TRACE_DURATION("vfs", "ZXRIO_STAT_BATCH");
+        if ((arg < 0) || (static_cast<size_t>(arg) > ZXRIO_STAT_BATCH_MAX)) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        // The replies overwrite the names as they are produced, so work
+        // from a copy of the names.
+        char names[FDIO_CHUNK_SIZE];
+        memcpy(names, msg->data, len);
+        zxrio_stat_batch_t* entries = reinterpret_cast<zxrio_stat_batch_t*>(msg->data);
+        size_t off = 0;
+        for (int32_t i = 0; i < arg; i++) {
+            const char* name = names + off;
+            size_t n = strnlen(name, len - off);
+            if (n == len - off) {
+                return ZX_ERR_INVALID_ARGS;
+            }
+            off += n + 1;
+            zxrio_stat_batch_t entry;
+            memset(&entry, 0, sizeof(entry));
+            if ((n == 0) || (n > NAME_MAX) || (memchr(name, '/', n) != nullptr)) {
+                entry.status = ZX_ERR_INVALID_ARGS;
+            } else {
+                entry.status = vfs_->Stat(vnode_, fbl::StringPiece(name, n), &entry.attr);
+            }
+            memcpy(&entries[i], &entry, sizeof(entry));
+        }
+        msg->datalen = static_cast<uint32_t>(arg * sizeof(zxrio_stat_batch_t));
+        return ZX_OK;
+    }
     case ZXRIO_SETATTR: {
         TRACE_DURATION("vfs", "ZXRIO_SETATTR");
         // TODO(smklein): Prevent read-only files from setting attributes,
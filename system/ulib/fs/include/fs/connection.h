@@ -17,6 +17,7 @@
 #include <fs/vfs.h>
 #include <fs/vnode.h>
 #include <zx/event.h>
+#include <zx/vmo.h>
 
 namespace fs {
 
@@ -85,6 +86,10 @@ private:
 
     // Current seek offset.
     size_t offset_{};
+
+    // Vmo supplied by the client with ZXRIO_XFER_VMO, which carries the data
+    // of ZXRIO_READ_VMO and ZXRIO_WRITE_VMO in place of the message payload.
+    zx::vmo xfer_vmo_{};
 };
 
 } // namespace fs
@@ -139,6 +139,12 @@ public:
     // modification operations for the duration of the operation.
     zx_status_t Readdir(Vnode* vn, vdircookie_t* cookie,
                         void* dirents, size_t len, size_t* out_actual) __TA_EXCLUDES(vfs_lock_);
+    // Looks up the single path component |name| in |vndir| and gets its
+    // attributes, without opening it. Returns ZX_ERR_NOT_SUPPORTED if
+    // |name| is a remote node, whose attributes are those of the remote
+    // filesystem's root.
+    zx_status_t Stat(fbl::RefPtr<Vnode> vndir, fbl::StringPiece name,
+                     vnattr_t* attr) __TA_EXCLUDES(vfs_lock_);
 
     Vfs(async_t* async);
 
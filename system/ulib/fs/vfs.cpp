@@ -354,6 +354,19 @@ zx_status_t Vfs::Readdir(Vnode* vn, vdircookie_t* cookie,
     return vn->Readdir(cookie, dirents, len, out_actual);
 }
 
+zx_status_t Vfs::Stat(fbl::RefPtr<Vnode> vndir, fbl::StringPiece name, vnattr_t* attr) {
+    fbl::AutoLock lock(&vfs_lock_);
+    fbl::RefPtr<Vnode> vn;
+    zx_status_t r;
+    if ((r = vfs_lookup(fbl::move(vndir), &vn, name)) != ZX_OK) {
+        return r;
+    }
+    if (vn->IsRemote()) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    return vn->Getattr(attr);
+}
+
 zx_status_t Vfs::Link(zx::event token, fbl::RefPtr<Vnode> oldparent,
                       fbl::StringPiece oldStr, fbl::StringPiece newStr) {
     fbl::AutoLock lock(&vfs_lock_);
@@ -5,6 +5,7 @@
 #include "eth-client.h"
 
 #include <zircon/syscalls.h>
+#include <fifo-ring/fifo-ring.h>
 
 #include <limits.h>
 #include <stdlib.h>
@@ -17,7 +18,45 @@
 #define IORING_TRACE(fmt...) do {} while (0)
 #endif
 
+// Maps the ring of |fifo|, or returns NULL if it does not have one.
+static fifo_ring_t* eth_ring_create(zx_handle_t fifo) {
+    fifo_ring_t* ring = calloc(1, sizeof(*ring));
+    if (ring == NULL) {
+        return NULL;
+    }
+    if (fifo_ring_init(ring, fifo) != ZX_OK) {
+        free(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+static void eth_ring_destroy(fifo_ring_t* ring) {
+    if (ring != NULL) {
+        fifo_ring_release(ring);
+        free(ring);
+    }
+}
+
+static zx_status_t eth_fifo_write(zx_handle_t fifo, fifo_ring_t* ring,
+                                  const void* entries, size_t len, uint32_t* actual) {
+    if (ring != NULL) {
+        return fifo_ring_write(ring, entries, len, actual);
+    }
+    return zx_fifo_write(fifo, entries, len, actual);
+}
+
+static zx_status_t eth_fifo_read(zx_handle_t fifo, fifo_ring_t* ring,
+                                 void* entries, size_t len, uint32_t* actual) {
+    if (ring != NULL) {
+        return fifo_ring_read(ring, entries, len, actual);
+    }
+    return zx_fifo_read(fifo, entries, len, actual);
+}
+
 void eth_destroy(eth_client_t* eth) {
+    eth_ring_destroy(eth->tx_ring);
+    eth_ring_destroy(eth->rx_ring);
     zx_handle_close(eth->rx_fifo);
     zx_handle_close(eth->tx_fifo);
     free(eth);
@@ -58,6 +97,8 @@ zx_status_t eth_create(int fd, zx_handle_t io_vmo, void* io_mem, eth_client_t**
     eth->rx_size = fifos.rx_depth;
     eth->tx_size = fifos.tx_depth;
     eth->iobuf = io_mem;
+    eth->tx_ring = eth_ring_create(eth->tx_fifo);
+    eth->rx_ring = eth_ring_create(eth->rx_fifo);
 
     *out = eth;
     return ZX_OK;
@@ -80,7 +121,7 @@ zx_status_t eth_queue_tx(eth_client_t* eth, void* cookie,
     uint32_t actual;
     IORING_TRACE("eth:tx+ c=%p o=%u l=%u f=%u\n",
                  e.cookie, e.offset, e.length, e.flags);
-    return zx_fifo_write(eth->tx_fifo, &e, sizeof(e), &actual);
+    return eth_fifo_write(eth->tx_fifo, eth->tx_ring, &e, sizeof(e), &actual);
 }
 
 zx_status_t eth_queue_rx(eth_client_t* eth, void* cookie,
@@ -94,7 +135,7 @@ zx_status_t eth_queue_rx(eth_client_t* eth, void* cookie,
     uint32_t actual;
     IORING_TRACE("eth:rx+ c=%p o=%u l=%u f=%u\n",
                  e.cookie, e.offset, e.length, e.flags);
-    return zx_fifo_write(eth->rx_fifo, &e, sizeof(e), &actual);
+    return eth_fifo_write(eth->rx_fifo, eth->rx_ring, &e, sizeof(e), &actual);
 }
 
 zx_status_t eth_complete_tx(eth_client_t* eth, void* ctx,
@@ -102,7 +143,7 @@ zx_status_t eth_complete_tx(eth_client_t* eth, void* ctx,
     eth_fifo_entry_t entries[eth->tx_size];
     zx_status_t status;
     uint32_t count;
-    if ((status = zx_fifo_read(eth->tx_fifo, entries, sizeof(entries), &count)) < 0) {
+    if ((status = eth_fifo_read(eth->tx_fifo, eth->tx_ring, entries, sizeof(entries), &count)) < 0) {
         if (status == ZX_ERR_SHOULD_WAIT) {
             return ZX_OK;
         } else {
@@ -123,7 +164,7 @@ zx_status_t eth_complete_rx(eth_client_t* eth, void* ctx,
     eth_fifo_entry_t entries[eth->rx_size];
     zx_status_t status;
     uint32_t count;
-    if ((status = zx_fifo_read(eth->rx_fifo, entries, sizeof(entries), &count)) < 0) {
+    if ((status = eth_fifo_read(eth->rx_fifo, eth->rx_ring, entries, sizeof(entries), &count)) < 0) {
         if (status == ZX_ERR_SHOULD_WAIT) {
             return ZX_OK;
         } else {
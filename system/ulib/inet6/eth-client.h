@@ -16,6 +16,10 @@ typedef struct eth_client {
     uint32_t tx_size;
     uint32_t rx_size;
     void* iobuf;
+    // The mapped rings of the fifos, if the driver created them with
+    // ZX_FIFO_SHARED_RING. NULL otherwise.
+    struct fifo_ring* tx_ring;
+    struct fifo_ring* rx_ring;
 } eth_client_t;
 
 zx_status_t eth_create(int fd, zx_handle_t io_vmo, void* io_mem, eth_client_t** out);
@@ -15,4 +15,6 @@ MODULE_SRCS += \
 
 MODULE_LIBS += system/ulib/fdio system/ulib/zircon system/ulib/c
 
+MODULE_HEADER_DEPS := system/ulib/fifo-ring
+
 include make/module.mk
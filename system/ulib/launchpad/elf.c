@@ -8,7 +8,10 @@
 
 #include <zircon/process.h>
 #include <zircon/syscalls.h>
+#include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
 
 struct elf_load_info {
     elf_load_header_t header;
@@ -81,3 +84,201 @@ size_t elf_load_get_stack_size(elf_load_info_t* info) {
     }
     return 0;
 }
+
+#define VMO_NAME_PREFIX_DATA "data:"
+
+typedef struct {
+    // ZX_HANDLE_INVALID to map the file itself.
+    zx_handle_t vmo;
+    uint64_t vmo_offset;
+    size_t vmar_offset;
+    size_t size;
+    uint32_t flags;
+    bool copy_on_write;
+} elf_image_segment_t;
+
+struct elf_image {
+    zx_handle_t file_vmo;
+    uintptr_t low;
+    size_t span;
+    uintptr_t entry;
+    size_t segment_count;
+    elf_image_segment_t segments[];
+};
+
+void elf_image_destroy(elf_image_t* image) {
+    for (size_t i = 0; i < image->segment_count; ++i) {
+        if (image->segments[i].vmo != ZX_HANDLE_INVALID)
+            zx_handle_close(image->segments[i].vmo);
+    }
+    zx_handle_close(image->file_vmo);
+    free(image);
+}
+
+// Copy |size| bytes at |offset| in |vmo| to the start of |data_vmo|.
+static zx_status_t copy_segment_data(zx_handle_t vmo, uint64_t offset,
+                                     size_t size, zx_handle_t data_vmo) {
+    char buffer[PAGE_SIZE];
+    for (size_t done = 0; done < size; ) {
+        size_t chunk = size - done < sizeof(buffer) ? size - done : sizeof(buffer);
+        size_t n;
+        zx_status_t status = zx_vmo_read(vmo, buffer, offset + done, chunk, &n);
+        if (status != ZX_OK)
+            return status;
+        if (n != chunk)
+            return ERR_ELF_BAD_FORMAT;
+        status = zx_vmo_write(data_vmo, buffer, done, chunk, &n);
+        if (status != ZX_OK)
+            return status;
+        if (n != chunk)
+            return ZX_ERR_IO;
+        done += chunk;
+    }
+    return ZX_OK;
+}
+
+// Fill in |seg| for one PT_LOAD segment.  This follows the same page
+// rounding as elf_load_finish.
+static zx_status_t image_segment(zx_handle_t vmo, const char* vmo_name,
+                                 const elf_phdr_t* ph, uintptr_t low,
+                                 elf_image_segment_t* seg) {
+    uintptr_t start = ph->p_vaddr & -PAGE_SIZE;
+    uintptr_t end = (ph->p_vaddr + ph->p_memsz + PAGE_SIZE - 1) & -PAGE_SIZE;
+    uintptr_t file_start = ph->p_offset & -PAGE_SIZE;
+
+    seg->vmo = ZX_HANDLE_INVALID;
+    seg->vmo_offset = file_start;
+    seg->vmar_offset = start - low;
+    seg->size = end - start;
+    seg->flags = ZX_VM_FLAG_SPECIFIC |
+        ((ph->p_flags & PF_R) ? ZX_VM_FLAG_PERM_READ : 0) |
+        ((ph->p_flags & PF_W) ? ZX_VM_FLAG_PERM_WRITE : 0) |
+        ((ph->p_flags & PF_X) ? ZX_VM_FLAG_PERM_EXECUTE : 0);
+    seg->copy_on_write = (ph->p_flags & PF_W) != 0;
+
+    if (!seg->copy_on_write && ph->p_filesz == ph->p_memsz)
+        return ZX_OK;
+
+    // Lay out the segment's initial contents once: the file data, then
+    // zeros for the bss, including the rest of the last file page.
+    zx_handle_t data_vmo;
+    zx_status_t status = zx_vmo_create(seg->size, 0, &data_vmo);
+    if (status != ZX_OK)
+        return status;
+    char name[ZX_MAX_NAME_LEN] = VMO_NAME_PREFIX_DATA;
+    memcpy(&name[sizeof(VMO_NAME_PREFIX_DATA) - 1],
+           vmo_name, ZX_MAX_NAME_LEN - sizeof(VMO_NAME_PREFIX_DATA));
+    zx_object_set_property(data_vmo, ZX_PROP_NAME, name, strlen(name));
+    status = copy_segment_data(vmo, file_start,
+                               ph->p_offset + ph->p_filesz - file_start,
+                               data_vmo);
+    if (status != ZX_OK) {
+        zx_handle_close(data_vmo);
+        return status;
+    }
+    seg->vmo = data_vmo;
+    seg->vmo_offset = 0;
+    return ZX_OK;
+}
+
+zx_status_t elf_image_create(elf_load_info_t* info, zx_handle_t vmo,
+                             elf_image_t** imagep) {
+    uintptr_t low, high;
+    zx_status_t status = elf_load_get_span(&info->header, info->phdrs,
+                                           &low, &high);
+    if (status != ZX_OK)
+        return status;
+    if (high == low)
+        return ERR_ELF_BAD_FORMAT;
+
+    size_t count = 0;
+    for (uint_fast16_t i = 0; i < info->header.e_phnum; ++i) {
+        if (info->phdrs[i].p_type == PT_LOAD && info->phdrs[i].p_memsz > 0)
+            ++count;
+    }
+
+    elf_image_t* image = calloc(1, sizeof(*image) +
+                                count * sizeof(image->segments[0]));
+    if (image == NULL)
+        return ZX_ERR_NO_MEMORY;
+    status = zx_handle_duplicate(vmo, ZX_RIGHT_SAME_RIGHTS, &image->file_vmo);
+    if (status != ZX_OK) {
+        free(image);
+        return status;
+    }
+    image->low = low;
+    image->span = high - low;
+    image->entry = info->header.e_entry;
+
+    char vmo_name[ZX_MAX_NAME_LEN];
+    if (zx_object_get_property(vmo, ZX_PROP_NAME,
+                               vmo_name, sizeof(vmo_name)) != ZX_OK ||
+        vmo_name[0] == '\0')
+        strcpy(vmo_name, "<unknown ELF file>");
+
+    for (uint_fast16_t i = 0; i < info->header.e_phnum; ++i) {
+        const elf_phdr_t* ph = &info->phdrs[i];
+        if (ph->p_type != PT_LOAD || ph->p_memsz == 0)
+            continue;
+        status = image_segment(vmo, vmo_name, ph, low,
+                               &image->segments[image->segment_count]);
+        if (status != ZX_OK) {
+            elf_image_destroy(image);
+            return status;
+        }
+        ++image->segment_count;
+    }
+
+    *imagep = image;
+    return ZX_OK;
+}
+
+zx_status_t elf_image_map(zx_handle_t root_vmar, const elf_image_t* image,
+                          zx_handle_t* segments_vmar,
+                          zx_vaddr_t* base, zx_vaddr_t* entry) {
+    zx_handle_t vmar;
+    uintptr_t vmar_base;
+    zx_status_t status = zx_vmar_allocate(root_vmar, 0, image->span,
+                                          ZX_VM_FLAG_CAN_MAP_READ |
+                                          ZX_VM_FLAG_CAN_MAP_WRITE |
+                                          ZX_VM_FLAG_CAN_MAP_EXECUTE |
+                                          ZX_VM_FLAG_CAN_MAP_SPECIFIC,
+                                          &vmar, &vmar_base);
+    if (status != ZX_OK)
+        return status;
+
+    for (size_t i = 0; status == ZX_OK && i < image->segment_count; ++i) {
+        const elf_image_segment_t* seg = &image->segments[i];
+        uintptr_t addr;
+        if (seg->vmo == ZX_HANDLE_INVALID) {
+            status = zx_vmar_map(vmar, seg->vmar_offset, image->file_vmo,
+                                 seg->vmo_offset, seg->size, seg->flags, &addr);
+        } else if (!seg->copy_on_write) {
+            status = zx_vmar_map(vmar, seg->vmar_offset, seg->vmo,
+                                 0, seg->size, seg->flags, &addr);
+        } else {
+            zx_handle_t clone;
+            status = zx_vmo_clone(seg->vmo, ZX_VMO_CLONE_COPY_ON_WRITE,
+                                  0, seg->size, &clone);
+            if (status == ZX_OK) {
+                status = zx_vmar_map(vmar, seg->vmar_offset, clone,
+                                     0, seg->size, seg->flags, &addr);
+                zx_handle_close(clone);
+            }
+        }
+    }
+
+    if (status == ZX_OK && segments_vmar != NULL)
+        *segments_vmar = vmar;
+    else
+        zx_handle_close(vmar);
+
+    if (status == ZX_OK) {
+        uintptr_t bias = vmar_base - image->low;
+        if (base != NULL)
+            *base = vmar_base;
+        if (entry != NULL)
+            *entry = image->entry != 0 ? image->entry + bias : 0;
+    }
+    return status;
+}
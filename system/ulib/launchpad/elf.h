@@ -37,4 +37,24 @@ zx_status_t elf_load_finish(zx_handle_t vmar, elf_load_info_t* info,
                             zx_handle_t* segments_vmar,
                             zx_vaddr_t* base, zx_vaddr_t* entry);
 
+// A snapshot of how an ELF file's segments are laid out in memory, so it
+// can be mapped into many processes without reading the file again.
+// Writable segments (and any with bss) get a VM object that already
+// holds their initial contents, and each process maps a copy-on-write
+// clone of it; the other segments are mapped straight from the file.
+typedef struct elf_image elf_image_t;
+
+// Build an image from the headers read by elf_load_start.
+// This does not consume |vmo|.
+zx_status_t elf_image_create(elf_load_info_t* info, zx_handle_t vmo,
+                             elf_image_t** imagep);
+
+// Free the image and close its VM object handles.
+void elf_image_destroy(elf_image_t* image);
+
+// Map the image into a process, like elf_load_finish.
+zx_status_t elf_image_map(zx_handle_t vmar, const elf_image_t* image,
+                          zx_handle_t* segments_vmar,
+                          zx_vaddr_t* base, zx_vaddr_t* entry);
+
 #pragma GCC visibility pop
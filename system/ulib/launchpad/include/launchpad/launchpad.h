@@ -133,6 +133,45 @@ zx_status_t launchpad_load_from_fd(launchpad_t* lp, int fd);
 zx_status_t launchpad_load_from_vmo(launchpad_t* lp, zx_handle_t vmo);
 
 
+// ELF CACHES
+// An ELF cache holds a binary whose headers have already been read and
+// parsed, along with its dynamic linker and the vDSO, so that starting
+// many processes from the same binary does not repeat that work.  The
+// writable segments' initial contents are kept in a VMO, and each
+// process gets copy-on-write clones of them; read-only segments are
+// shared.
+//
+// This is not a snapshot of a running process: dynamic linking and libc
+// initialization still happen in each new process, just as with
+// launchpad_load_from_file.
+//
+// A cache is not modified by loading from it, so it can be used by
+// several threads at once.  Scripts (#!) are not supported.
+// -------------------------------------------------------------------
+
+typedef struct launchpad_elf_cache launchpad_elf_cache_t;
+
+// Create an ELF cache from a binary in a vmo, which is consumed.  A
+// PT_INTERP dynamic linker is looked up now, with the default loader
+// service; the processes loaded from the cache still get a loader
+// service connection of their own, as with launchpad_load_from_file.
+zx_status_t launchpad_elf_cache_create(zx_handle_t vmo,
+                                       launchpad_elf_cache_t** cache);
+
+// Create an ELF cache from a binary at path.
+zx_status_t launchpad_elf_cache_create_from_file(const char* path,
+                                                 launchpad_elf_cache_t** cache);
+
+// Free an ELF cache.  Processes already loaded from it are unaffected.
+void launchpad_elf_cache_destroy(launchpad_elf_cache_t* cache);
+
+// Load the cached binary, dynamic linker and vDSO into the launchpad's
+// process.  This takes the place of launchpad_load_from_file and behaves
+// the same way.
+zx_status_t launchpad_load_from_elf_cache(launchpad_t* lp,
+                                          const launchpad_elf_cache_t* cache);
+
+
 // ADDING ARGUMENTS, ENVIRONMENT, AND HANDLES
 // These functions setup arguments, environment, or handles to be
 // passed to the new process via the processargs protocol.
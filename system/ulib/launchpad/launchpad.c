@@ -1311,3 +1311,153 @@ zx_status_t launchpad_load_from_fd(launchpad_t* lp, int fd) {
 zx_status_t launchpad_load_from_vmo(launchpad_t* lp, zx_handle_t vmo) {
     return launchpad_file_load_with_vdso(lp, vmo);
 }
+
+struct launchpad_elf_cache {
+    // The executable or, if it has PT_INTERP, its dynamic linker.
+    elf_image_t* image;
+    elf_image_t* vdso;
+    // With PT_INTERP, the executable for the dynamic linker to load.
+    zx_handle_t exec_vmo;
+    // Without PT_INTERP, the executable's PT_GNU_STACK size.
+    size_t stack_size;
+};
+
+void launchpad_elf_cache_destroy(launchpad_elf_cache_t* cache) {
+    if (cache->image != NULL)
+        elf_image_destroy(cache->image);
+    if (cache->vdso != NULL)
+        elf_image_destroy(cache->vdso);
+    if (cache->exec_vmo != ZX_HANDLE_INVALID)
+        zx_handle_close(cache->exec_vmo);
+    free(cache);
+}
+
+// Does not consume |vmo|.
+static zx_status_t elf_cache_image(zx_handle_t vmo, elf_image_t** image) {
+    elf_load_info_t* elf;
+    zx_status_t status = elf_load_start(vmo, NULL, 0, &elf);
+    if (status == ZX_OK) {
+        status = elf_image_create(elf, vmo, image);
+        elf_load_destroy(elf);
+    }
+    return status;
+}
+
+static zx_status_t elf_cache_load(launchpad_elf_cache_t* cache, zx_handle_t vmo) {
+    elf_load_info_t* elf;
+    zx_status_t status = elf_load_start(vmo, NULL, 0, &elf);
+    if (status != ZX_OK)
+        return status;
+
+    char* interp;
+    size_t interp_len;
+    status = elf_load_get_interp(elf, vmo, &interp, &interp_len);
+    if (status != ZX_OK) {
+        elf_load_destroy(elf);
+        return status;
+    }
+
+    if (interp == NULL) {
+        cache->stack_size = elf_load_get_stack_size(elf);
+        status = elf_image_create(elf, vmo, &cache->image);
+        elf_load_destroy(elf);
+        return status;
+    }
+    elf_load_destroy(elf);
+
+    zx_handle_t loader_svc;
+    status = loader_service_get_default(&loader_svc);
+    if (status == ZX_OK) {
+        zx_handle_t interp_vmo;
+        status = loader_svc_rpc(loader_svc, LOADER_SVC_OP_LOAD_OBJECT,
+                                interp, interp_len, &interp_vmo);
+        zx_handle_close(loader_svc);
+        if (status == ZX_OK) {
+            status = elf_cache_image(interp_vmo, &cache->image);
+            zx_handle_close(interp_vmo);
+        }
+    }
+    free(interp);
+    if (status == ZX_OK)
+        status = zx_handle_duplicate(vmo, ZX_RIGHT_SAME_RIGHTS, &cache->exec_vmo);
+    return status;
+}
+
+zx_status_t launchpad_elf_cache_create(zx_handle_t vmo,
+                                       launchpad_elf_cache_t** result) {
+    launchpad_elf_cache_t* cache = calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        zx_handle_close(vmo);
+        return ZX_ERR_NO_MEMORY;
+    }
+
+    zx_status_t status = elf_cache_load(cache, vmo);
+    zx_handle_close(vmo);
+    if (status == ZX_OK) {
+        vdso_lock();
+        status = elf_cache_image(vdso_get_vmo(), &cache->vdso);
+        vdso_unlock();
+    }
+
+    if (status != ZX_OK) {
+        launchpad_elf_cache_destroy(cache);
+        return status;
+    }
+    *result = cache;
+    return ZX_OK;
+}
+
+zx_status_t launchpad_elf_cache_create_from_file(const char* path,
+                                                 launchpad_elf_cache_t** result) {
+    zx_handle_t vmo;
+    zx_status_t status = launchpad_vmo_from_file(path, &vmo);
+    if (status != ZX_OK)
+        return status;
+    return launchpad_elf_cache_create(vmo, result);
+}
+
+zx_status_t launchpad_load_from_elf_cache(launchpad_t* lp,
+                                          const launchpad_elf_cache_t* cache) {
+    if (lp->error)
+        return lp->error;
+
+    zx_status_t status;
+    zx_handle_t segments_vmar;
+    if (cache->exec_vmo == ZX_HANDLE_INVALID) {
+        status = elf_image_map(lp_vmar(lp), cache->image, &segments_vmar,
+                               &lp->base, &lp->entry);
+        if (status != ZX_OK)
+            return lp_error(lp, status, "load_from_elf_cache: cannot map executable");
+        if (cache->stack_size > 0)
+            launchpad_set_stack_size(lp, cache->stack_size);
+        lp->loader_message = false;
+        launchpad_add_handle(lp, segments_vmar, PA_HND(PA_VMAR_LOADED, 0));
+    } else {
+        status = setup_loader_svc(lp);
+        if (status != ZX_OK)
+            return lp_error(lp, status, "load_from_elf_cache: cannot get loader service");
+        // As in handle_interp, keep a fresh process's low address space free.
+        if (lp->fresh_process && (status = reserve_low_address_space(lp)) != ZX_OK)
+            return lp_error(lp, status, "load_from_elf_cache: cannot reserve low address space");
+        zx_handle_t exec_vmo;
+        status = zx_handle_duplicate(cache->exec_vmo, ZX_RIGHT_SAME_RIGHTS, &exec_vmo);
+        if (status != ZX_OK)
+            return lp_error(lp, status, "load_from_elf_cache: cannot duplicate executable");
+        status = elf_image_map(lp_vmar(lp), cache->image, &segments_vmar,
+                               &lp->base, &lp->entry);
+        if (status != ZX_OK) {
+            zx_handle_close(exec_vmo);
+            return lp_error(lp, status, "load_from_elf_cache: cannot map dynamic linker");
+        }
+        close_handles(&lp->special_handles[HND_EXEC_VMO], 1);
+        lp->special_handles[HND_EXEC_VMO] = exec_vmo;
+        close_handles(&lp->special_handles[HND_SEGMENTS_VMAR], 1);
+        lp->special_handles[HND_SEGMENTS_VMAR] = segments_vmar;
+        lp->loader_message = true;
+    }
+
+    status = elf_image_map(lp_vmar(lp), cache->vdso, NULL, &lp->vdso_base, NULL);
+    if (status != ZX_OK)
+        return lp_error(lp, status, "load_from_elf_cache: cannot map vDSO");
+    return launchpad_add_vdso_vmo(lp);
+}
@@ -4,6 +4,7 @@
 
 #include <launchpad/loader-service.h>
 
+#include <elfload/elfload.h>
 #include <fdio/debug.h>
 #include <fdio/dispatcher.h>
 #include <fdio/io.h>
@@ -134,13 +135,16 @@ zx_status_t loader_service_publish_data_sink_fs(const char* sink_name, zx_handle
 
 
 // When loading a library object, search in the hard-coded locations.
-static int open_from_libpath(const char* fn) {
+// On success, *index is the entry of libpaths the object was found in.
+static int open_from_libpath(const char* fn, size_t* index) {
     int fd = -1;
-    for (size_t n = 0; fd < 0 && n < countof(libpaths); ++n) {
+    size_t n;
+    for (n = 0; fd < 0 && n < countof(libpaths); ++n) {
         char path[PATH_MAX];
         snprintf(path, sizeof(path), "%s/%s", libpaths[n], fn);
         fd = open(path, O_RDONLY);
     }
+    *index = n - 1;
     return fd;
 }
 
@@ -153,11 +157,169 @@ static zx_handle_t load_object_fd(int fd, const char* fn, zx_handle_t* out) {
     return status;
 }
 
+// fs_load_object() keeps the VMOs of recently loaded libraries, so that
+// starting another process which links against them does not go back to
+// the filesystem. fdio_get_vmo() hands out a copy-on-write clone without
+// write rights, so one VMO can be shared by every client.
+//
+// Each directory in libpaths is watched for files being added or removed.
+// A change flushes what was found in that directory or any later one,
+// since a new file may now shadow it. Files rewritten in place are not
+// noticed. Nothing found in a directory is cached while it, or one before
+// it, cannot be watched (e.g. /system/lib before it is mounted).
+#define LIB_CACHE_SIZE 64
+
+typedef struct {
+    char* name;
+    size_t libpath;
+    zx_handle_t vmo;
+    zx_koid_t koid;
+    uint64_t last_use;
+} lib_cache_entry_t;
+
+static mtx_t lib_cache_lock = MTX_INIT;
+static lib_cache_entry_t lib_cache[LIB_CACHE_SIZE];
+static uint64_t lib_cache_clock;
+// Bumped by every flush, so that an object opened before a change
+// is not cached after it.
+static uint64_t lib_cache_generation;
+static zx_handle_t lib_watch[countof(libpaths)];
+
+static void prelink_forget(zx_koid_t koid);
+
+static void lib_cache_evict(lib_cache_entry_t* e) {
+    prelink_forget(e->koid);
+    free(e->name);
+    zx_handle_close(e->vmo);
+    memset(e, 0, sizeof(*e));
+}
+
+// Returns true if the VMO with |koid| is held by the cache, so that the
+// koid keeps standing for the same file until the entry is evicted.
+// Called with lib_cache_lock held.
+static bool lib_cache_contains(zx_koid_t koid) {
+    for (size_t i = 0; i < LIB_CACHE_SIZE; ++i) {
+        if (lib_cache[i].name != NULL && lib_cache[i].koid == koid)
+            return true;
+    }
+    return false;
+}
+
+// Returns true if libpaths[n] is being watched.
+static bool lib_watch_start(size_t n) {
+    if (lib_watch[n] != ZX_HANDLE_INVALID)
+        return true;
+    int fd = open(libpaths[n], O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+    vfs_watch_dir_t wd = {
+        .mask = VFS_WATCH_MASK_ADDED | VFS_WATCH_MASK_REMOVED |
+                VFS_WATCH_MASK_DELETED,
+        .options = 0,
+    };
+    zx_handle_t h;
+    if (zx_channel_create(0, &h, &wd.channel) != ZX_OK) {
+        close(fd);
+        return false;
+    }
+    ssize_t r = ioctl_vfs_watch_dir(fd, &wd);
+    close(fd);
+    if (r < 0) {
+        zx_handle_close(wd.channel);
+        zx_handle_close(h);
+        return false;
+    }
+    lib_watch[n] = h;
+    return true;
+}
+
+// Drops every entry which a change to a watched directory may have made
+// stale. Called with lib_cache_lock held.
+static void lib_cache_revalidate(void) {
+    for (size_t n = 0; n < countof(libpaths); ++n) {
+        if (lib_watch[n] == ZX_HANDLE_INVALID)
+            continue;
+        zx_signals_t pending;
+        zx_status_t status = zx_object_wait_one(
+            lib_watch[n], ZX_CHANNEL_READABLE | ZX_CHANNEL_PEER_CLOSED,
+            0, &pending);
+        if (status == ZX_ERR_TIMED_OUT)
+            continue;
+        // The watch is re-armed by the next miss.
+        zx_handle_close(lib_watch[n]);
+        lib_watch[n] = ZX_HANDLE_INVALID;
+        ++lib_cache_generation;
+        for (size_t i = 0; i < LIB_CACHE_SIZE; ++i) {
+            if (lib_cache[i].name != NULL && lib_cache[i].libpath >= n)
+                lib_cache_evict(&lib_cache[i]);
+        }
+    }
+}
+
+// Called with lib_cache_lock held.
+static void lib_cache_insert(const char* name, size_t libpath,
+                             zx_handle_t vmo) {
+    lib_cache_entry_t* e = &lib_cache[0];
+    for (size_t i = 0; i < LIB_CACHE_SIZE; ++i) {
+        if (lib_cache[i].name == NULL) {
+            e = &lib_cache[i];
+            break;
+        }
+        if (lib_cache[i].last_use < e->last_use)
+            e = &lib_cache[i];
+    }
+    if (e->name != NULL)
+        lib_cache_evict(e);
+
+    zx_info_handle_basic_t info;
+    if (zx_object_get_info(vmo, ZX_INFO_HANDLE_BASIC, &info, sizeof(info),
+                           NULL, NULL) != ZX_OK)
+        return;
+    char* copy = strdup(name);
+    if (copy == NULL)
+        return;
+    if (zx_handle_duplicate(vmo, ZX_RIGHT_SAME_RIGHTS, &e->vmo) != ZX_OK) {
+        free(copy);
+        return;
+    }
+    e->name = copy;
+    e->koid = info.koid;
+    e->libpath = libpath;
+    e->last_use = ++lib_cache_clock;
+}
+
 static zx_status_t fs_load_object(void *ctx, const char* name, zx_handle_t* out) {
-    int fd = open_from_libpath(name);
-    if (fd >= 0)
-        return load_object_fd(fd, name, out);
-    return ZX_ERR_NOT_FOUND;
+    mtx_lock(&lib_cache_lock);
+    lib_cache_revalidate();
+    for (size_t i = 0; i < LIB_CACHE_SIZE; ++i) {
+        lib_cache_entry_t* e = &lib_cache[i];
+        if (e->name != NULL && !strcmp(e->name, name) &&
+            zx_handle_duplicate(e->vmo, ZX_RIGHT_SAME_RIGHTS, out) == ZX_OK) {
+            e->last_use = ++lib_cache_clock;
+            mtx_unlock(&lib_cache_lock);
+            return ZX_OK;
+        }
+    }
+    // Watch before looking, so that a change made while
+    // the object is being read is not missed.
+    size_t watched = 0;
+    while (watched < countof(libpaths) && lib_watch_start(watched))
+        ++watched;
+    uint64_t generation = lib_cache_generation;
+    mtx_unlock(&lib_cache_lock);
+
+    size_t libpath;
+    int fd = open_from_libpath(name, &libpath);
+    if (fd < 0)
+        return ZX_ERR_NOT_FOUND;
+    zx_status_t status = load_object_fd(fd, name, out);
+    if (status == ZX_OK && libpath < watched) {
+        mtx_lock(&lib_cache_lock);
+        if (generation == lib_cache_generation)
+            lib_cache_insert(name, libpath, *out);
+        mtx_unlock(&lib_cache_lock);
+    }
+    return status;
 }
 
 static zx_status_t fs_load_abspath(void *ctx, const char* path, zx_handle_t* out) {
@@ -262,9 +424,285 @@ struct startup {
     zx_handle_t syslog_handle;
 };
 
+// Multiloader services answer LOADER_SVC_OP_LOAD_PRELINKED by applying
+// each library's relative relocations once, for a load bias chosen here,
+// and handing the result to every process which loads the same VMO.
+// Processes which manage to map the library at that bias share the
+// relocated pages copy-on-write rather than each relocating their own.
+//
+// Entries are keyed by the VMO's koid, and only VMOs held by the library
+// cache (see fs_load_object) are prelinked: a koid there keeps standing
+// for the same file, and evicting it from the library cache drops its
+// prelinked copy too. Objects from other sources, which get a new VMO
+// on every load, would never be found again, so they are not prelinked.
+#define PRELINK_CACHE_SIZE 64
+#define PRELINK_PHDRS_MAX 16
+
+typedef struct {
+    zx_koid_t koid;
+    uintptr_t bias;
+    // The address window reserved for the object, guard page included,
+    // or zero if it has none.
+    uintptr_t start;
+    size_t size;
+    // ZX_HANDLE_INVALID if the object cannot be prelinked.
+    zx_handle_t vmo;
+    uint64_t last_use;
+} prelink_entry_t;
+
+typedef struct {
+    uintptr_t start;
+    size_t size;    // zero if the slot is unused
+} prelink_window_t;
+
+static mtx_t prelink_lock = MTX_INIT;
+static prelink_entry_t prelink_cache[PRELINK_CACHE_SIZE];
+static uint64_t prelink_clock;
+static uintptr_t prelink_next, prelink_end;
+// Windows given back by entries which were dropped, for reuse before
+// prelink_next moves on.
+static prelink_window_t prelink_free[PRELINK_CACHE_SIZE];
+
+// Libraries are packed one after another from a random point in the
+// upper half of the address space, so their addresses differ from boot
+// to boot but stay put for the life of this loader. The lower half is
+// left alone, as launchpad leaves it to sanitizer shadow memory. Each
+// window has a guard page after the library.
+// Called with prelink_lock held.
+static bool prelink_reserve(size_t size, uintptr_t* start) {
+    for (size_t i = 0; i < PRELINK_CACHE_SIZE; ++i) {
+        prelink_window_t* w = &prelink_free[i];
+        if (w->size >= size) {
+            *start = w->start;
+            w->start += size;
+            w->size -= size;
+            return true;
+        }
+    }
+    if (prelink_end == 0) {
+        zx_info_vmar_t info;
+        if (zx_object_get_info(zx_vmar_root_self(), ZX_INFO_VMAR,
+                               &info, sizeof(info), NULL, NULL) != ZX_OK)
+            return false;
+        uint64_t random;
+        size_t actual;
+        if (zx_cprng_draw(&random, sizeof(random), &actual) != ZX_OK ||
+            actual != sizeof(random))
+            return false;
+        uintptr_t middle = (info.base + info.len / 2) & -PAGE_SIZE;
+        size_t pages = info.len / 4 / PAGE_SIZE;
+        prelink_next = middle + (random % pages) * PAGE_SIZE;
+        prelink_end = info.base + info.len;
+    }
+    if (size > prelink_end - prelink_next)
+        return false;
+    *start = prelink_next;
+    prelink_next += size;
+    return true;
+}
+
+// Gives a window back, merging it with its neighbours. If there is no
+// room to remember it, the window is lost for the life of this loader.
+// Called with prelink_lock held.
+static void prelink_release(uintptr_t start, size_t size) {
+    prelink_window_t* slot = NULL;
+    for (size_t i = 0; i < PRELINK_CACHE_SIZE; ++i) {
+        prelink_window_t* w = &prelink_free[i];
+        if (w->size > 0 && w->start + w->size == start) {
+            start = w->start;
+            size += w->size;
+            w->size = 0;
+        } else if (w->size > 0 && start + size == w->start) {
+            size += w->size;
+            w->size = 0;
+        }
+        if (w->size == 0 && slot == NULL)
+            slot = w;
+    }
+    if (start + size == prelink_next) {
+        prelink_next = start;
+    } else if (slot != NULL) {
+        slot->start = start;
+        slot->size = size;
+    }
+}
+
+// Called with prelink_lock held.
+static void prelink_drop(prelink_entry_t* e) {
+    if (e->size > 0)
+        prelink_release(e->start, e->size);
+    zx_handle_close(e->vmo);
+    memset(e, 0, sizeof(*e));
+}
+
+// Drops the prelinked copy of the VMO with |koid|, if there is one.
+static void prelink_forget(zx_koid_t koid) {
+    mtx_lock(&prelink_lock);
+    for (size_t i = 0; i < PRELINK_CACHE_SIZE; ++i) {
+        if (prelink_cache[i].koid == koid) {
+            prelink_drop(&prelink_cache[i]);
+            break;
+        }
+    }
+    mtx_unlock(&prelink_lock);
+}
+
+// Called with prelink_lock held.
+static prelink_entry_t* prelink_find(zx_koid_t koid) {
+    for (size_t i = 0; i < PRELINK_CACHE_SIZE; ++i) {
+        if (prelink_cache[i].koid == koid)
+            return &prelink_cache[i];
+    }
+    return NULL;
+}
+
+// Relocates a copy of |vmo| into a window of its own. prelink_lock is
+// only taken, briefly, to reserve the window.
+static zx_status_t prelink_vmo(zx_handle_t vmo, prelink_entry_t* e) {
+    elf_load_header_t header;
+    uintptr_t phoff;
+    zx_status_t status = elf_load_prepare(vmo, NULL, 0, &header, &phoff);
+    if (status != ZX_OK)
+        return status;
+    if (header.e_phnum > PRELINK_PHDRS_MAX)
+        return ZX_ERR_NOT_SUPPORTED;
+    elf_phdr_t phdrs[PRELINK_PHDRS_MAX];
+    status = elf_load_read_phdrs(vmo, phdrs, phoff, header.e_phnum);
+    if (status != ZX_OK)
+        return status;
+    uintptr_t low, high;
+    status = elf_load_get_span(&header, phdrs, &low, &high);
+    if (status != ZX_OK)
+        return status;
+    if (high == low)
+        return ZX_ERR_NO_RESOURCES;
+
+    mtx_lock(&prelink_lock);
+    bool reserved = prelink_reserve(high - low + PAGE_SIZE, &e->start);
+    mtx_unlock(&prelink_lock);
+    if (!reserved)
+        return ZX_ERR_NO_RESOURCES;
+    e->size = high - low + PAGE_SIZE;
+    e->bias = e->start - low;
+
+    status = elf_load_prelink(vmo, &header, phdrs, e->bias, &e->vmo);
+    if (status != ZX_OK) {
+        mtx_lock(&prelink_lock);
+        prelink_release(e->start, e->size);
+        mtx_unlock(&prelink_lock);
+        e->start = 0;
+        e->size = 0;
+    }
+    return status;
+}
+
+// Finds or makes the prelinked copy of |vmo|.
+static zx_status_t prelink_object(zx_handle_t vmo, uintptr_t* bias,
+                                  zx_handle_t* out) {
+    zx_info_handle_basic_t info;
+    zx_status_t status = zx_object_get_info(vmo, ZX_INFO_HANDLE_BASIC,
+                                            &info, sizeof(info), NULL, NULL);
+    if (status != ZX_OK)
+        return status;
+
+    mtx_lock(&lib_cache_lock);
+    bool cached = lib_cache_contains(info.koid);
+    mtx_unlock(&lib_cache_lock);
+    if (!cached)
+        return ZX_ERR_NOT_SUPPORTED;
+
+    mtx_lock(&prelink_lock);
+    prelink_entry_t* e = prelink_find(info.koid);
+    if (e == NULL) {
+        mtx_unlock(&prelink_lock);
+        // An object which cannot be prelinked is remembered as such, so
+        // that it is not tried again.
+        prelink_entry_t made = {
+            .koid = info.koid,
+            .vmo = ZX_HANDLE_INVALID,
+        };
+        if (prelink_vmo(vmo, &made) != ZX_OK)
+            made.vmo = ZX_HANDLE_INVALID;
+
+        // Evicting the object from the library cache, which may have
+        // happened meanwhile, is what drops its prelinked copy, so check
+        // again with both locks held, in the order lib_cache_evict()
+        // takes them.
+        mtx_lock(&lib_cache_lock);
+        mtx_lock(&prelink_lock);
+        cached = lib_cache_contains(info.koid);
+        mtx_unlock(&lib_cache_lock);
+        if (!cached) {
+            prelink_drop(&made);
+            mtx_unlock(&prelink_lock);
+            return ZX_ERR_NOT_SUPPORTED;
+        }
+        // Another request may have prelinked the same object meanwhile.
+        if ((e = prelink_find(info.koid)) != NULL) {
+            prelink_drop(&made);
+        } else {
+            e = &prelink_cache[0];
+            for (size_t i = 1; i < PRELINK_CACHE_SIZE; ++i) {
+                if (prelink_cache[i].last_use < e->last_use)
+                    e = &prelink_cache[i];
+            }
+            prelink_drop(e);
+            *e = made;
+        }
+    }
+    e->last_use = ++prelink_clock;
+
+    status = ZX_ERR_NOT_SUPPORTED;
+    if (e->vmo != ZX_HANDLE_INVALID) {
+        status = zx_handle_duplicate(e->vmo, ZX_RIGHT_SAME_RIGHTS, out);
+        *bias = e->bias;
+    }
+    mtx_unlock(&prelink_lock);
+    return status;
+}
+
+// Loads each of the names packed into a LOADER_SVC_OP_LOAD_OBJECTS or
+// LOADER_SVC_OP_LOAD_PRELINKED request, storing one status per name in
+// |statuses| and one VMO per name in |vmos| (ZX_HANDLE_INVALID where the
+// status is not ZX_OK). Returns the status of the request as a whole.
+static zx_status_t load_objects(const zx_loader_svc_msg_t* msg, uint32_t sz,
+                                loader_service_fn_t loader, void* loader_arg,
+                                int32_t* statuses, zx_handle_t* vmos) {
+    if (msg->arg <= 0 || msg->arg > LOADER_SVC_BATCH_MAX)
+        return ZX_ERR_INVALID_ARGS;
+    uint32_t count = msg->arg;
+
+    const char* names[LOADER_SVC_BATCH_MAX];
+    const char* p = (const char*) msg->data;
+    const char* end = (const char*) msg + sz;
+    for (uint32_t i = 0; i < count; ++i) {
+        const char* nul = memchr(p, 0, end - p);
+        if (nul == NULL || nul == p)
+            return ZX_ERR_INVALID_ARGS;
+        names[i] = p;
+        p = nul + 1;
+    }
+    if (p != end)
+        return ZX_ERR_INVALID_ARGS;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        vmos[i] = ZX_HANDLE_INVALID;
+        statuses[i] = (*loader)(loader_arg, LOADER_SVC_OP_LOAD_OBJECT,
+                                ZX_HANDLE_INVALID, names[i], &vmos[i]);
+        if (statuses[i] == ZX_ERR_NOT_FOUND)
+            fprintf(stderr, "dlsvc: could not open '%s'\n", names[i]);
+        if (statuses[i] != ZX_OK && vmos[i] != ZX_HANDLE_INVALID) {
+            zx_handle_close(vmos[i]);
+            vmos[i] = ZX_HANDLE_INVALID;
+        }
+    }
+    return ZX_OK;
+}
+
 static zx_status_t handle_loader_rpc(zx_handle_t h,
                                      loader_service_fn_t loader,
-                                     void* loader_arg, zx_handle_t sys_log) {
+                                     void* loader_arg, zx_handle_t sys_log,
+                                     bool prelink) {
     uint8_t data[1024];
     zx_loader_svc_msg_t* msg = (void*) data;
     uint32_t sz = sizeof(data);
@@ -290,7 +728,14 @@ static zx_status_t handle_loader_rpc(zx_handle_t h,
     // forcibly null-terminate the message data argument
     data[sz - 1] = 0;
 
-    zx_handle_t handle = ZX_HANDLE_INVALID;
+    // A prelinked batch can carry two VMOs per name.
+    zx_handle_t handles[2 * LOADER_SVC_BATCH_MAX];
+    uint32_t nhandles_out = 0;
+    union {
+        int32_t statuses[LOADER_SVC_BATCH_MAX];
+        zx_loader_svc_prelink_t prelinks[LOADER_SVC_BATCH_MAX];
+    } reply;
+    size_t reply_len = 0;
     switch (msg->opcode) {
     case LOADER_SVC_OP_CONFIG:
     case LOADER_SVC_OP_LOAD_OBJECT:
@@ -300,15 +745,49 @@ static zx_status_t handle_loader_rpc(zx_handle_t h,
     case LOADER_SVC_OP_CLONE:
         // TODO(ZX-491): Use a threadpool for loading, and guard against
         // other starvation attacks.
+        handles[0] = ZX_HANDLE_INVALID;
         r = (*loader)(loader_arg, msg->opcode,
-                      request_handle, (const char*) msg->data, &handle);
+                      request_handle, (const char*) msg->data, &handles[0]);
         if (r == ZX_ERR_NOT_FOUND) {
             fprintf(stderr, "dlsvc: could not open '%s'\n",
                     (const char*) msg->data);
         }
+        if (handles[0] != ZX_HANDLE_INVALID)
+            nhandles_out = 1;
         request_handle = ZX_HANDLE_INVALID;
         msg->arg = r;
         break;
+    case LOADER_SVC_OP_LOAD_OBJECTS:
+    case LOADER_SVC_OP_LOAD_PRELINKED: {
+        int32_t statuses[LOADER_SVC_BATCH_MAX];
+        zx_handle_t vmos[LOADER_SVC_BATCH_MAX];
+        r = load_objects(msg, sz, loader, loader_arg, statuses, vmos);
+        if (r == ZX_OK) {
+            bool prelinked = msg->opcode == LOADER_SVC_OP_LOAD_PRELINKED;
+            for (int32_t i = 0; i < msg->arg; ++i) {
+                if (statuses[i] == ZX_OK)
+                    handles[nhandles_out++] = vmos[i];
+                if (!prelinked) {
+                    reply.statuses[i] = statuses[i];
+                    continue;
+                }
+                reply.prelinks[i] = (zx_loader_svc_prelink_t){
+                    .status = statuses[i],
+                };
+                uintptr_t bias;
+                if (prelink && statuses[i] == ZX_OK &&
+                    prelink_object(vmos[i], &bias,
+                                   &handles[nhandles_out]) == ZX_OK) {
+                    reply.prelinks[i].bias = bias;
+                    ++nhandles_out;
+                }
+            }
+            reply_len = msg->arg * (prelinked ? sizeof(reply.prelinks[0]) :
+                                    sizeof(reply.statuses[0]));
+        }
+        msg->arg = r;
+        break;
+    }
     case LOADER_SVC_OP_DEBUG_PRINT:
         log_printf(sys_log, "dlsvc: debug: %s\n", (const char*) msg->data);
         msg->arg = ZX_OK;
@@ -331,8 +810,9 @@ static zx_status_t handle_loader_rpc(zx_handle_t h,
     msg->opcode = LOADER_SVC_OP_STATUS;
     msg->reserved0 = 0;
     msg->reserved1 = 0;
-    if ((r = zx_channel_write(h, 0, msg, sizeof(zx_loader_svc_msg_t),
-                              &handle, handle != ZX_HANDLE_INVALID ? 1 : 0)) < 0) {
+    memcpy(msg->data, &reply, reply_len);
+    if ((r = zx_channel_write(h, 0, msg, sizeof(zx_loader_svc_msg_t) + reply_len,
+                              handles, nhandles_out)) < 0) {
         fprintf(stderr, "dlsvc: msg write error: %d: %s\n", r, zx_status_get_string(r));
         return r;
     }
@@ -357,7 +837,7 @@ static int loader_service_thread(void* arg) {
                 fprintf(stderr, "dlsvc: wait error %d: %s\n", r, zx_status_get_string(r));
             break;
         }
-        if ((r = handle_loader_rpc(h, loader, loader_arg, sys_log)) < 0) {
+        if ((r = handle_loader_rpc(h, loader, loader_arg, sys_log, false)) < 0) {
             break;
         }
     }
@@ -400,7 +880,7 @@ static zx_status_t multiloader_cb(zx_handle_t h, void* cb, void* cookie) {
     // This uses svc->dispatcher_log without grabbing the lock, but
     // it will never change once the dispatcher that called us is created.
     loader_service_t* svc = cookie;
-    return handle_loader_rpc(h, default_load_fn, svc, svc->dispatcher_log);
+    return handle_loader_rpc(h, default_load_fn, svc, svc->dispatcher_log, true);
 }
 
 zx_status_t loader_service_attach(loader_service_t* svc, zx_handle_t h) {
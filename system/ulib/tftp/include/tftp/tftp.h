@@ -244,6 +244,16 @@ void tftp_session_set_opcode_prefix_use(tftp_session* session,
 void tftp_session_set_block_host_endianness(tftp_session* session,
                                             bool enable);
 
+// Specify whether a client should request the adaptive window extension. When
+// the server accepts it, the sender starts with a small window and grows it
+// towards the negotiated window size while windows are acknowledged cleanly,
+// halving it on timeouts and lost blocks. The receiver acknowledges whenever
+// the sender marks the end of a window. Servers always honor the request.
+// This extension is not RFC-compatible, but it is only used when both ends
+// agree to it.
+void tftp_session_set_adaptive_window_use(tftp_session* session,
+                                          bool enable);
+
 // When acting as a server, the options that will be overridden when a
 // value is requested by the client. Note that if the client does not
 // specify a setting, the default will be used regardless of server
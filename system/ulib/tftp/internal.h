@@ -16,6 +16,12 @@
 #define OPCODE_ERROR 5
 #define OPCODE_OACK 6
 
+// Set in the top bit of the opcode prefix byte of a DATA packet when the
+// adaptive window extension is in use, to ask the receiver to acknowledge the
+// window ending with this block. Not RFC-compatible; only sent after the peer
+// has accepted the ADAPTIVEWINDOW option.
+#define OPCODE_FLAG_ACK_REQ 0x8000
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -40,6 +46,7 @@ typedef struct tftp_data_msg_t {
 #define BLOCKSIZE_OPTION 0x01  // RFC 2348
 #define TIMEOUT_OPTION 0x02    // RFC 2349
 #define WINDOWSIZE_OPTION 0x04 // RFC 7440
+#define ADAPTIVE_WINDOW_OPTION 0x08
 
 #define DEFAULT_BLOCKSIZE 512
 #define DEFAULT_TIMEOUT 1
@@ -49,6 +56,10 @@ typedef struct tftp_data_msg_t {
 #define DEFAULT_MAX_TIMEOUTS 5
 #define DEFAULT_USE_OPCODE_PREFIX true
 #define DEFAULT_USE_HOST_BLOCK_ENDIANNESS false
+#define DEFAULT_USE_ADAPTIVE_WINDOW false
+
+// Number of blocks the sender starts with when the window is adaptive.
+#define ADAPTIVE_WINDOW_INITIAL 16
 
 typedef struct tftp_options_t {
     // A bitmask of the options that have been set
@@ -179,12 +190,27 @@ struct tftp_session_t {
     // behavior.
     bool use_host_block_endianness;
 
+    // When true, a client asks the server to use an adaptive window (see
+    // |adaptive_window| below). Servers always accept the option.
+    bool use_adaptive_window;
+
     // "Negotiated" values
     size_t file_size;
     uint16_t window_size;
     uint16_t block_size;
     uint8_t timeout;
 
+    // Set when both ends agreed on the adaptive window extension. The sender
+    // then limits itself to |send_window| blocks before asking for an ACK,
+    // growing it on windows that are acknowledged in full and halving it when
+    // blocks are lost. |window_size| remains the upper bound.
+    bool adaptive_window;
+    uint16_t send_window;
+    uint16_t send_window_threshold;
+    // Receiver side: whether the current gap in the received blocks was already
+    // reported to an adaptive sender.
+    bool gap_acked;
+
     // Callbacks
     tftp_file_interface file_interface;
     tftp_transport_interface transport_interface;
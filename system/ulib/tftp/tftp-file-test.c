@@ -5,14 +5,18 @@
 #include <tftp/tftp.h>
 #include <unittest/unittest.h>
 
+#include <arpa/inet.h>
 #include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 // This test simulates a tftp file transfer by running two threads. Both the
-// file and transport interfaces are implemented in memory buffers.
+// file and transport interfaces are implemented in memory buffers. The
+// transport can optionally drop DATA packets and delay delivery, to exercise
+// retransmission and the adaptive window.
 
 typedef enum { DIR_SEND, DIR_RECEIVE } xfer_dir_t;
 
@@ -21,8 +25,26 @@ struct test_params {
     uint32_t filesz;
     uint16_t winsz;
     uint16_t blksz;
+    bool adaptive;
+    // If non-zero, every |drop_freq|-th DATA packet is discarded by the transport.
+    uint32_t drop_freq;
+    // Delay before a packet becomes visible to the receiving side.
+    uint32_t latency_us;
 };
 
+static uint32_t drop_freq;
+static uint32_t latency_us;
+
+// TFTP timeouts are at least a second; when simulating loss, the transport scales them
+// down so that the tests run quickly.
+#define TIMEOUT_SCALE 100
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 static uint8_t *src_file;
 static uint8_t *dst_file;
 
@@ -147,8 +169,16 @@ static fake_socket_t server_out_socket = { .size = FAKE_SOCK_BUF_SZ };
 typedef struct {
     fake_socket_t* in_sock;
     fake_socket_t* out_sock;
+    uint32_t timeout_ms;
+    uint32_t data_sent;
 } transport_info_t;
 
+// Each message in a fake socket is preceded by this header
+typedef struct {
+    size_t len;
+    uint64_t deliver_at_us;
+} fake_msg_hdr_t;
+
 void clear_sockets(void) {
     client_out_socket.read_ndx = 0;
     client_out_socket.write_ndx = 0;
@@ -165,6 +195,8 @@ void transport_init(transport_info_t* transport_info, bool is_server) {
         transport_info->in_sock = &server_out_socket;
         transport_info->out_sock = &client_out_socket;
     }
+    transport_info->timeout_ms = 0;
+    transport_info->data_sent = 0;
 }
 
 // Write to our circular message buffer.
@@ -188,12 +220,23 @@ void write_to_buf(fake_socket_t* sock, void* data, size_t size) {
 tftp_status transport_send(void* data, size_t len, void* transport_cookie) {
     transport_info_t* transport_info = transport_cookie;
     fake_socket_t* sock = transport_info->out_sock;
-    while ((sock->write_ndx + sizeof(len) + len - sock->read_ndx)
+
+    // Only DATA packets are dropped: a lost request is not retried by the client, and a
+    // lost final ACK leaves the sender retransmitting until it gives up, as with real TFTP.
+    uint16_t opcode;
+    memcpy(&opcode, data, sizeof(opcode));
+    if ((ntohs(opcode) & 0xff) == 3 /* OPCODE_DATA */ && drop_freq &&
+        (++transport_info->data_sent % drop_freq) == 0) {
+        return TFTP_NO_ERROR;
+    }
+
+    fake_msg_hdr_t hdr = { .len = len, .deliver_at_us = now_us() + latency_us };
+    while ((sock->write_ndx + sizeof(hdr) + len - sock->read_ndx)
            > sock->size) {
         // Wait for the other thread to catch up
         usleep(10);
     }
-    write_to_buf(sock, &len, sizeof(len));
+    write_to_buf(sock, &hdr, sizeof(hdr));
     write_to_buf(sock, data, len);
     return TFTP_NO_ERROR;
 }
@@ -218,31 +261,44 @@ void read_from_buf(fake_socket_t* sock, void* data, size_t size,
     }
 }
 
+// Returns true if a message is available and its delivery time has passed.
+static bool msg_ready(fake_socket_t* sock, fake_msg_hdr_t* hdr) {
+    if ((sock->read_ndx + sizeof(*hdr)) >= sock->write_ndx) {
+        return false;
+    }
+    read_from_buf(sock, hdr, sizeof(*hdr), false);
+    return hdr->deliver_at_us <= now_us();
+}
+
 // Receive a message. Note that the buffer's read_ndx and write_ndx don't
-// wrap, which makes it easier to recognize underflow.
+// wrap, which makes it easier to recognize underflow. Blocking receives only
+// time out when loss is being simulated.
 int transport_recv(void* data, size_t len, bool block, void* transport_cookie) {
     transport_info_t* transport_info = transport_cookie;
+    fake_socket_t* sock = transport_info->in_sock;
+    fake_msg_hdr_t hdr;
     if (block) {
-        while ((transport_info->in_sock->read_ndx + sizeof(size_t)) >=
-               transport_info->in_sock->write_ndx) {
+        uint64_t deadline = now_us() + (uint64_t)transport_info->timeout_ms * 1000 / TIMEOUT_SCALE;
+        while (!msg_ready(sock, &hdr)) {
+            if (drop_freq && now_us() >= deadline) {
+                return TFTP_ERR_TIMED_OUT;
+            }
             usleep(10);
         }
-    } else if ((transport_info->in_sock->read_ndx + sizeof(size_t)) >=
-               transport_info->in_sock->write_ndx) {
+    } else if (!msg_ready(sock, &hdr)) {
         return TFTP_ERR_TIMED_OUT;
     }
-    size_t block_len;
-    read_from_buf(transport_info->in_sock, &block_len, sizeof(block_len),
-                  false);
-    if (block_len > len) {
+    if (hdr.len > len) {
         return TFTP_ERR_BUFFER_TOO_SMALL;
     }
-    transport_info->in_sock->read_ndx += sizeof(block_len);
-    read_from_buf(transport_info->in_sock, data, block_len, true);
-    return block_len;
+    sock->read_ndx += sizeof(hdr);
+    read_from_buf(sock, data, hdr.len, true);
+    return hdr.len;
 }
 
 int transport_timeout_set(uint32_t timeout_ms, void* transport_cookie) {
+    transport_info_t* transport_info = transport_cookie;
+    transport_info->timeout_ms = timeout_ms;
     return 0;
 }
 
@@ -259,6 +315,7 @@ bool run_client_test(struct test_params* tp) {
 
     tftp_status status = tftp_init(&session, session_buf, session_size);
     ASSERT_EQ(status, TFTP_NO_ERROR, "unable to initialize a tftp session");
+    tftp_session_set_adaptive_window_use(session, tp->adaptive);
 
     // Configure file interface
     file_info_t file_info;
@@ -393,6 +450,8 @@ bool run_one_test(struct test_params* tp) {
     ASSERT_EQ(init_result, 0, "failure to initialize state");
 
     clear_sockets();
+    drop_freq = tp->drop_freq;
+    latency_us = tp->latency_us;
 
     pthread_t client_thread, server_thread;
     pthread_create(&client_thread, NULL, tftp_client_main, tp);
@@ -444,6 +503,51 @@ bool test_tftp_receive_file_lg_window(void) {
     return run_one_test(&tp);
 }
 
+bool test_tftp_send_file_adaptive(void) {
+    struct test_params tp = {.direction = DIR_SEND, .filesz = 1000000, .winsz = 256,
+                             .blksz = 1024, .adaptive = true};
+    return run_one_test(&tp);
+}
+
+bool test_tftp_receive_file_adaptive(void) {
+    struct test_params tp = {.direction = DIR_RECEIVE, .filesz = 1000000, .winsz = 256,
+                             .blksz = 1024, .adaptive = true};
+    return run_one_test(&tp);
+}
+
+bool test_tftp_send_file_lossy(void) {
+    struct test_params tp = {.direction = DIR_SEND, .filesz = 1000000, .winsz = 64,
+                             .blksz = 1024, .drop_freq = 97};
+    return run_one_test(&tp);
+}
+
+bool test_tftp_receive_file_lossy(void) {
+    struct test_params tp = {.direction = DIR_RECEIVE, .filesz = 1000000, .winsz = 64,
+                             .blksz = 1024, .drop_freq = 97};
+    return run_one_test(&tp);
+}
+
+bool test_tftp_send_file_adaptive_lossy(void) {
+    // Drop often enough that the window keeps shrinking and regrowing
+    struct test_params tp = {.direction = DIR_SEND, .filesz = 1000000, .winsz = 256,
+                             .blksz = 1024, .adaptive = true, .drop_freq = 97,
+                             .latency_us = 100};
+    return run_one_test(&tp);
+}
+
+bool test_tftp_receive_file_adaptive_lossy(void) {
+    struct test_params tp = {.direction = DIR_RECEIVE, .filesz = 1000000, .winsz = 256,
+                             .blksz = 1024, .adaptive = true, .drop_freq = 97,
+                             .latency_us = 100};
+    return run_one_test(&tp);
+}
+
+bool test_tftp_send_file_latency(void) {
+    struct test_params tp = {.direction = DIR_SEND, .filesz = 1000000, .winsz = 64,
+                             .blksz = 1024, .adaptive = true, .latency_us = 500};
+    return run_one_test(&tp);
+}
+
 BEGIN_TEST_CASE(tftp_transfer_file)
 RUN_TEST(test_tftp_send_file)
 RUN_TEST(test_tftp_send_file_wrapping_block_count)
@@ -451,5 +555,12 @@ RUN_TEST(test_tftp_send_file_lg_window)
 RUN_TEST(test_tftp_receive_file)
 RUN_TEST(test_tftp_receive_file_wrapping_block_count)
 RUN_TEST(test_tftp_receive_file_lg_window)
+RUN_TEST(test_tftp_send_file_adaptive)
+RUN_TEST(test_tftp_receive_file_adaptive)
+RUN_TEST(test_tftp_send_file_lossy)
+RUN_TEST(test_tftp_receive_file_lossy)
+RUN_TEST(test_tftp_send_file_adaptive_lossy)
+RUN_TEST(test_tftp_receive_file_adaptive_lossy)
+RUN_TEST(test_tftp_send_file_latency)
 END_TEST_CASE(tftp_transfer_file)
 
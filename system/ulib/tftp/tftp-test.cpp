@@ -1818,6 +1818,165 @@ static bool test_tftp_send_data_receive_ack_skip_block_wrap(void) {
     END_TEST;
 }
 
+static bool test_tftp_send_data_adaptive_window(void) {
+    BEGIN_TEST;
+
+    test_state ts;
+    ts.reset(1024, 100 * DEFAULT_BLOCKSIZE, 1500);
+
+    const uint16_t kWindowSize = 64;
+    tftp_session_set_adaptive_window_use(ts.session, true);
+    auto status = tftp_generate_request(ts.session, SEND_FILE, kLocalFilename, kRemoteFilename,
+        MODE_OCTET, ts.msg_size, NULL, NULL, &kWindowSize, ts.out, &ts.outlen, &ts.timeout);
+    ASSERT_EQ(TFTP_NO_ERROR, status, "error generating write request");
+    ASSERT_TRUE(verify_write_request(ts), "bad write request");
+    const char adaptive_str[] = "ADAPTIVEWINDOW\0" "1";
+    EXPECT_TRUE(find_str_in_mem(adaptive_str, sizeof(adaptive_str), static_cast<char*>(ts.out),
+                                ts.outlen), "adaptive window not requested");
+
+    char oack_buf[256];
+    oack_buf[0] = 0x00;
+    oack_buf[1] = OPCODE_OACK;
+    size_t oack_buf_sz = 2 + snprintf(&oack_buf[2], sizeof(oack_buf) - 2,
+                                      "TSIZE%c%zu%cWINDOWSIZE%c%d%cADAPTIVEWINDOW%c1",
+                                      '\0', ts.msg_size, '\0', '\0', kWindowSize, '\0', '\0')
+                           + 1;
+
+    tftp_file_interface ifc = {NULL, NULL, NULL, NULL, NULL};
+    ifc.read = [](void* data, size_t* length, off_t offset, void* cookie) -> tftp_status {
+                   return TFTP_NO_ERROR;
+               };
+    tftp_session_set_file_interface(ts.session, &ifc);
+
+    ts.outlen = ts.out_size;
+    status = tftp_process_msg(ts.session, oack_buf, oack_buf_sz, ts.out, &ts.outlen, &ts.timeout,
+                              nullptr);
+    ASSERT_EQ(TFTP_NO_ERROR, status, "receive error");
+    ASSERT_TRUE(ts.session->adaptive_window, "adaptive window not negotiated");
+    EXPECT_EQ(ADAPTIVE_WINDOW_INITIAL, ts.session->send_window, "bad initial send window");
+    auto msg = reinterpret_cast<tftp_data_msg*>(ts.out);
+    EXPECT_EQ(0, ntohs(msg->opcode) & OPCODE_FLAG_ACK_REQ, "unexpected ACK request");
+
+    // Transmits the rest of the current window, returning the number of blocks sent
+    auto send_window = [&ts]() -> uint32_t {
+        while (tftp_session_has_pending(ts.session)) {
+            ts.outlen = ts.out_size;
+            tftp_prepare_data(ts.session, ts.out, &ts.outlen, &ts.timeout, nullptr);
+        }
+        return ts.session->window_index;
+    };
+    auto send_ack = [&ts](uint16_t block) -> tftp_status {
+        tftp_data_msg ack_msg;
+        ack_msg.opcode = htons(OPCODE_ACK);
+        ack_msg.block = htons(block);
+        ts.outlen = ts.out_size;
+        return tftp_process_msg(ts.session, &ack_msg, sizeof(ack_msg), ts.out, &ts.outlen,
+                                &ts.timeout, nullptr);
+    };
+
+    // Only the last block of the window asks for an ACK
+    EXPECT_EQ(ADAPTIVE_WINDOW_INITIAL, send_window(), "bad window");
+    EXPECT_NE(0, ntohs(msg->opcode) & OPCODE_FLAG_ACK_REQ, "no ACK request at end of window");
+
+    // A clean window doubles the send window
+    uint16_t block = ADAPTIVE_WINDOW_INITIAL;
+    ASSERT_EQ(TFTP_NO_ERROR, send_ack(block), "receive error");
+    EXPECT_EQ(2 * ADAPTIVE_WINDOW_INITIAL, ts.session->send_window, "send window didn't grow");
+    EXPECT_EQ(2 * ADAPTIVE_WINDOW_INITIAL, send_window(), "bad window");
+
+    // An ACK in the middle of the window means a block was lost
+    block += 10;
+    ASSERT_EQ(TFTP_NO_ERROR, send_ack(block), "receive error");
+    EXPECT_EQ(ADAPTIVE_WINDOW_INITIAL, ts.session->send_window, "send window didn't shrink");
+    EXPECT_EQ(block + 1, ntohs(msg->block), "didn't resend after the ACKed block");
+
+    // So does a repeated ACK once we have sent past it
+    ASSERT_EQ(TFTP_NO_ERROR, send_ack(block), "receive error");
+    EXPECT_EQ(ADAPTIVE_WINDOW_INITIAL / 2, ts.session->send_window, "send window didn't shrink");
+    EXPECT_EQ(block + 1, ntohs(msg->block), "didn't resend after the ACKed block");
+
+    // Past the threshold, the window grows linearly
+    EXPECT_EQ(ADAPTIVE_WINDOW_INITIAL / 2, send_window(), "bad window");
+    block += ADAPTIVE_WINDOW_INITIAL / 2;
+    ASSERT_EQ(TFTP_NO_ERROR, send_ack(block), "receive error");
+    EXPECT_EQ(ADAPTIVE_WINDOW_INITIAL / 2 + 1, ts.session->send_window, "bad window growth");
+
+    // A timeout shrinks the window and resends from the last ACK
+    ts.outlen = ts.out_size;
+    status = tftp_timeout(ts.session, ts.out, &ts.outlen, ts.out_size, &ts.timeout, nullptr);
+    ASSERT_EQ(TFTP_NO_ERROR, status, "timeout handling failed");
+    EXPECT_EQ((ADAPTIVE_WINDOW_INITIAL / 2 + 1) / 2, ts.session->send_window,
+              "send window didn't shrink");
+    EXPECT_EQ(block + 1, ntohs(msg->block), "didn't resend after the ACKed block");
+
+    END_TEST;
+}
+
+static bool test_tftp_receive_data_adaptive_window(void) {
+    BEGIN_TEST;
+
+    test_state ts;
+    ts.reset(1024, 1024, 1500);
+    tftp_file_interface ifc = {NULL, mock_open_write, NULL, NULL, NULL};
+    ifc.write = [](const void* data, size_t* length, off_t offset, void* cookie) -> tftp_status {
+                    return TFTP_NO_ERROR;
+                };
+    tftp_session_set_file_interface(ts.session, &ifc);
+
+    char req_buf[256];
+    req_buf[0] = 0x00;
+    req_buf[1] = OPCODE_WRQ;
+    size_t req_buf_sz = 2 + snprintf(&req_buf[2], sizeof(req_buf) - 2,
+                                     "%s%cOCTET%cTSIZE%c%d%cWINDOWSIZE%c%d%cADAPTIVEWINDOW%c1",
+                                     kRemoteFilename, '\0', '\0', '\0', 100 * DEFAULT_BLOCKSIZE,
+                                     '\0', '\0', 8, '\0', '\0')
+                          + 1;
+    auto status = tftp_process_msg(ts.session, req_buf, req_buf_sz, ts.out, &ts.outlen,
+                                   &ts.timeout, nullptr);
+    ASSERT_EQ(TFTP_NO_ERROR, status, "receive write request failed");
+    ASSERT_TRUE(verify_response_opcode(ts, OPCODE_OACK), "bad response");
+    const char adaptive_str[] = "ADAPTIVEWINDOW\0" "1";
+    EXPECT_TRUE(find_str_in_mem(adaptive_str, sizeof(adaptive_str), static_cast<char*>(ts.out),
+                                ts.outlen), "adaptive window not acknowledged");
+    EXPECT_TRUE(ts.session->adaptive_window, "adaptive window not negotiated");
+
+    uint8_t data_buf[4 + DEFAULT_BLOCKSIZE] = {
+        0x00, 0x03,  // Opcode (DATA)
+        0x00, 0x01,  // Block
+    };
+    auto send_data = [&ts, &data_buf](uint16_t block, bool ack_req) -> tftp_status {
+        data_buf[0] = ack_req ? (OPCODE_FLAG_ACK_REQ >> 8) : 0;
+        data_buf[3] = static_cast<uint8_t>(block);
+        ts.outlen = ts.out_size;
+        return tftp_process_msg(ts.session, data_buf, sizeof(data_buf), ts.out, &ts.outlen,
+                                &ts.timeout, nullptr);
+    };
+    auto msg = reinterpret_cast<tftp_data_msg*>(ts.out);
+
+    // The sender, not the window size, decides when we ACK
+    ASSERT_EQ(TFTP_NO_ERROR, send_data(1, false), "receive data failed");
+    EXPECT_EQ(0, ts.outlen, "no response expected");
+    ASSERT_EQ(TFTP_NO_ERROR, send_data(2, true), "receive data failed");
+    ASSERT_TRUE(verify_response_opcode(ts, OPCODE_ACK), "bad response");
+    EXPECT_EQ(2, ntohs(msg->block), "bad ACK block");
+
+    // Gaps are only reported once
+    ASSERT_EQ(TFTP_NO_ERROR, send_data(4, false), "receive data failed");
+    ASSERT_TRUE(verify_response_opcode(ts, OPCODE_ACK), "bad response");
+    EXPECT_EQ(2, ntohs(msg->block), "bad ACK block");
+    ASSERT_EQ(TFTP_NO_ERROR, send_data(5, true), "receive data failed");
+    EXPECT_EQ(0, ts.outlen, "no response expected");
+
+    // A repeated request for an ACK is answered, even for blocks we already have
+    ASSERT_EQ(TFTP_NO_ERROR, send_data(3, false), "receive data failed");
+    EXPECT_EQ(0, ts.outlen, "no response expected");
+    ASSERT_EQ(TFTP_NO_ERROR, send_data(3, true), "receive data failed");
+    ASSERT_TRUE(verify_response_opcode(ts, OPCODE_ACK), "bad response");
+    EXPECT_EQ(3, ntohs(msg->block), "bad ACK block");
+
+    END_TEST;
+}
+
 static ssize_t open_read_should_wait(const char* filename, void* cookie) {
     return TFTP_ERR_SHOULD_WAIT;
 }
@@ -2052,6 +2211,11 @@ RUN_TEST(test_tftp_send_data_receive_ack_block_wrapping)
 RUN_TEST(test_tftp_send_data_receive_ack_skip_block_wrap)
 END_TEST_CASE(tftp_send_data)
 
+BEGIN_TEST_CASE(tftp_adaptive_window)
+RUN_TEST(test_tftp_send_data_adaptive_window)
+RUN_TEST(test_tftp_receive_data_adaptive_window)
+END_TEST_CASE(tftp_adaptive_window)
+
 BEGIN_TEST_CASE(tftp_send_err)
 RUN_TEST(test_tftp_open_read_should_wait)
 RUN_TEST(test_tftp_open_write_should_wait)
@@ -59,6 +59,12 @@ static const char* kWindowSize = "WINDOWSIZE";
 static const size_t kWindowSizeLen = 10; // strlen(kWindowSize);
 static const size_t kMaxWindowSizeOpt = 18; // kWindowSizeLen + strlen("!") + 1 + strlen(65535) + 1;
 
+// ADAPTIVEWINDOW
+// Fuchsia extension, value is always "1"
+static const char* kAdaptiveWindow = "ADAPTIVEWINDOW";
+static const size_t kAdaptiveWindowLen = 14; // strlen(kAdaptiveWindow)
+static const size_t kMaxAdaptiveWindowOpt = 17; // kAdaptiveWindowLen + 1 + strlen(1) + 1
+
 // Since RRQ and WRQ come before option negotation, they are limited to max TFTP
 // blocksize of 512 (RFC 1350 and 2347).
 static const size_t kMaxRequestSize = 512;
@@ -121,10 +127,16 @@ static void __ATTR_PRINTF(5, 6) append_option(char** body, size_t* left, const c
     *left = leftp;
 }
 
+// With the adaptive window extension the top bit of the prefix byte carries
+// OPCODE_FLAG_ACK_REQ, leaving seven bits for the retransmission count.
 #define OPCODE(session, msg, value)                                                           \
     do {                                                                                      \
         if (session->use_opcode_prefix) {                                                     \
-            (msg)->opcode = htons((value & 0xff) | ((uint16_t)session->opcode_prefix << 8));  \
+            uint16_t prefix = session->opcode_prefix;                                         \
+            if (session->adaptive_window) {                                                   \
+                prefix &= 0x7f;                                                               \
+            }                                                                                 \
+            (msg)->opcode = htons((value & 0xff) | (prefix << 8));                            \
         } else {                                                                              \
             (msg)->opcode = htons(value);                                                     \
         }                                                                                     \
@@ -179,12 +191,51 @@ static void set_error(tftp_session* session, uint16_t err_code, void* resp_buf,
     session->state = ERROR;
 }
 
+// The number of blocks the sender transmits before waiting for an ACK.
+static uint16_t send_window(tftp_session* session) {
+    return session->adaptive_window ? session->send_window : session->window_size;
+}
+
+static void adaptive_window_init(tftp_session* session) {
+    session->send_window = MIN(ADAPTIVE_WINDOW_INITIAL, session->window_size);
+    session->send_window_threshold = session->window_size;
+}
+
+// Called when a full window was acknowledged. Like TCP's congestion window, the window
+// doubles until it first reaches the threshold, after which it grows by one block.
+static void adaptive_window_grow(tftp_session* session) {
+    uint32_t window = session->send_window;
+    if (window < session->send_window_threshold) {
+        window *= 2;
+    } else {
+        window++;
+    }
+    session->send_window = MIN(window, session->window_size);
+    xprintf(" -> Send window grown to %d\n", session->send_window);
+}
+
+// Called when blocks were lost, either because the receiver acknowledged only part of a window
+// or because we timed out waiting for an ACK.
+static void adaptive_window_shrink(tftp_session* session) {
+    uint16_t window = session->send_window / 2;
+    if (window < 1) {
+        window = 1;
+    }
+    session->send_window = window;
+    session->send_window_threshold = window;
+    xprintf(" -> Send window shrunk to %d\n", session->send_window);
+}
+
 tftp_status tx_data(tftp_session* session, tftp_data_msg* resp, size_t* outlen, void* cookie) {
     session->offset = (session->block_number + session->window_index) * session->block_size;
     *outlen = 0;
     if (session->offset <= session->file_size) {
         session->window_index++;
         OPCODE(session, resp, OPCODE_DATA);
+        if (session->adaptive_window && session->window_index >= send_window(session)) {
+            // The receiver does not know our window, tell it when to ACK
+            resp->opcode |= htons(OPCODE_FLAG_ACK_REQ);
+        }
         if (session->use_host_block_endianness) {
             resp->block = session->block_number + session->window_index;
         } else {
@@ -211,11 +262,11 @@ tftp_status tx_data(tftp_session* session, tftp_data_msg* resp, size_t* outlen,
         }
         *outlen = sizeof(*resp) + len;
 
-        if (session->window_index < session->window_size) {
-            xprintf(" -> TRANSMIT_MORE(%d < %d)\n", session->window_index, session->window_size);
+        if (session->window_index < send_window(session)) {
+            xprintf(" -> TRANSMIT_MORE(%d < %d)\n", session->window_index, send_window(session));
         } else {
             xprintf(" -> TRANSMIT_WAIT_ON_ACK(%d >= %d)\n", session->window_index,
-                    session->window_size);
+                    send_window(session));
         }
     } else {
         xprintf(" -> TRANSMIT_WAIT_ON_ACK(completed)\n");
@@ -244,6 +295,7 @@ int tftp_init(tftp_session** session, void* buffer, size_t size) {
     s->max_timeouts = DEFAULT_MAX_TIMEOUTS;
     s->use_opcode_prefix = DEFAULT_USE_OPCODE_PREFIX;
     s->use_host_block_endianness = DEFAULT_USE_HOST_BLOCK_ENDIANNESS;
+    s->use_adaptive_window = DEFAULT_USE_ADAPTIVE_WINDOW;
 
     return TFTP_NO_ERROR;
 }
@@ -270,7 +322,7 @@ tftp_status tftp_session_set_transport_interface(tftp_session* session,
 bool tftp_session_has_pending(tftp_session* session) {
     return session->direction == SEND_FILE &&
            session->window_index > 0 &&
-           session->window_index < session->window_size &&
+           session->window_index < send_window(session) &&
            ((session->block_number + session->window_index) * session->block_size) <=
             session->file_size;
 }
@@ -315,6 +367,8 @@ tftp_status tftp_generate_request(tftp_session* session,
     session->block_size = DEFAULT_BLOCKSIZE;
     session->timeout = DEFAULT_TIMEOUT;
     session->window_size = DEFAULT_WINDOWSIZE;
+    session->adaptive_window = false;
+    session->gap_acked = false;
 
     tftp_msg* ack = outgoing;
     OPCODE(session, ack, (direction == SEND_FILE) ? OPCODE_WRQ : OPCODE_RRQ);
@@ -401,6 +455,14 @@ tftp_status tftp_generate_request(tftp_session* session,
         sent_opts->mask |= WINDOWSIZE_OPTION;
     }
 
+    if (session->use_adaptive_window) {
+        if (left < kMaxAdaptiveWindowOpt) {
+            return TFTP_ERR_BUFFER_TOO_SMALL;
+        }
+        append_option(&body, &left, kAdaptiveWindow, false, "1");
+        sent_opts->mask |= ADAPTIVE_WINDOW_OPTION;
+    }
+
     *outlen = *outlen - left;
     // Nothing has been negotiated yet so use default
     *timeout_ms = 1000 * session->timeout;
@@ -466,6 +528,8 @@ tftp_status tftp_handle_request(tftp_session* session,
     session->block_size = DEFAULT_BLOCKSIZE;
     session->timeout = DEFAULT_TIMEOUT;
     session->window_size = DEFAULT_WINDOWSIZE;
+    session->adaptive_window = false;
+    session->gap_acked = false;
 
     // TODO(tkilbourn): refactor option handling code to share with
     // tftp_handle_oack
@@ -543,6 +607,11 @@ tftp_status tftp_handle_request(tftp_session* session,
             } else {
                 session->window_size = override_opts->window_size;
             }
+        } else if (!strncasecmp(option, kAdaptiveWindow, kAdaptiveWindowLen)) {
+            // The only defined value is "1"; anything else is treated as unsupported.
+            if (atol(value) == 1) {
+                requested_options.mask |= ADAPTIVE_WINDOW_OPTION;
+            }
         } else {
             // Options which the server does not support should be omitted from the
             // OACK; they should not cause an ERROR packet to be generated.
@@ -631,11 +700,17 @@ tftp_status tftp_handle_request(tftp_session* session,
         // TODO(jpoichet) Make sure this timeout is possible. Need API upwards to
         // request allocation of block size * window size memory
         append_option(&body, &left, kTimeout, false, "%d", session->timeout);
-        *timeout_ms = 1000 * session->timeout;
     }
+    // The caller's timeout was computed before the session was initialized above
+    *timeout_ms = 1000 * session->timeout;
     if (requested_options.mask & WINDOWSIZE_OPTION) {
         append_option(&body, &left, kWindowSize, false, "%d", session->window_size);
     }
+    if (requested_options.mask & ADAPTIVE_WINDOW_OPTION) {
+        append_option(&body, &left, kAdaptiveWindow, false, "1");
+        session->adaptive_window = true;
+        adaptive_window_init(session);
+    }
     *resp_len = *resp_len - left;
     session->state = REQ_RECEIVED;
     session->direction = direction;
@@ -654,6 +729,7 @@ tftp_status tftp_handle_request(tftp_session* session,
     xprintf("    Block Size : %d\n", session->block_size);
     xprintf("    Timeout    : %d\n", session->timeout);
     xprintf("    Window Size: %d\n", session->window_size);
+    xprintf("    Adaptive   : %s\n", session->adaptive_window ? "yes" : "no");
 
     return TFTP_NO_ERROR;
 }
@@ -713,6 +789,8 @@ tftp_status tftp_handle_data(tftp_session* session,
     }
 
     tftp_data_msg* data = (tftp_data_msg*)msg;
+    bool ack_requested = session->adaptive_window &&
+                         (ntohs(data->opcode) & OPCODE_FLAG_ACK_REQ);
 
     uint16_t block_num;
     if (session->use_host_block_endianness) {
@@ -750,18 +828,27 @@ tftp_status tftp_handle_data(tftp_session* session,
         }
         session->block_number++;
         session->window_index++;
+        session->gap_acked = false;
     } else if (block_delta > 1) {
         // Force sending a ACK with the last block_number we received
         xprintf("Skipped: got %" PRIu64 ", expected %" PRIu64 "\n",
                 session->block_number + block_delta, session->block_number + 1);
-        session->window_index = session->window_size;
+        // An adaptive sender resends as soon as it sees the ACK, so only send one per gap;
+        // the rest of the blocks in flight would only trigger more retransmissions.
+        if (!session->adaptive_window || !session->gap_acked) {
+            session->window_index = session->window_size;
+            session->gap_acked = true;
+        }
         // It's possible that a previous ACK wasn't received, increment the prefix
         if (session->use_opcode_prefix) {
             session->opcode_prefix++;
         }
     }
 
-    if (session->window_index == session->window_size ||
+    // With an adaptive window the sender marks the last block of each window. This also
+    // covers retransmitted blocks we already have, so the sender learns where we are
+    // without waiting for our timeout.
+    if (session->window_index == session->window_size || (ack_requested && block_delta <= 1) ||
             session->block_number * session->block_size > session->file_size) {
         tftp_prepare_ack(session, resp, resp_len);
         if (session->block_number * session->block_size > session->file_size) {
@@ -804,19 +891,29 @@ tftp_status tftp_handle_ack(tftp_session* session,
     // signed 16 bit offset to determine the adjustment to the current position.
     int16_t block_offset = ack_block - (uint16_t)session->block_number;
 
-    if (session->state != FIRST_DATA && session->state != REQ_RECEIVED && block_offset == 0) {
-        // Don't acknowledge duplicate ACKs, avoiding the "Sorcerer's Apprentice Syndrome"
+    if (session->state != FIRST_DATA && session->state != REQ_RECEIVED && block_offset == 0 &&
+        !(session->adaptive_window && session->window_index > 0)) {
+        // Don't acknowledge duplicate ACKs, avoiding the "Sorcerer's Apprentice Syndrome".
+        // An adaptive receiver only repeats an ACK once we have sent past it if the block
+        // that follows was lost, so in that case resend the window.
         *resp_len = 0;
         return TFTP_NO_ERROR;
     }
 
-    if (block_offset < session->window_size) {
+    if (block_offset < send_window(session)) {
         // If it looks like some of our data might have been dropped, modify the prefix
         // before resending.
         if (session->use_opcode_prefix) {
             session->opcode_prefix++;
         }
     }
+    if (session->adaptive_window && session->window_index > 0) {
+        if (block_offset < (int32_t)session->window_index) {
+            adaptive_window_shrink(session);
+        } else {
+            adaptive_window_grow(session);
+        }
+    }
     session->state = SENDING_DATA;
     session->block_number += block_offset;
     session->window_index = 0;
@@ -928,6 +1025,14 @@ tftp_status tftp_handle_oack(tftp_session* session,
                 return TFTP_ERR_INTERNAL;
             }
             session->window_size = val;
+        } else if (!strncasecmp(option, kAdaptiveWindow, kAdaptiveWindowLen)) {
+            if (!(session->client_sent_opts.mask & ADAPTIVE_WINDOW_OPTION)) {
+                xprintf("adaptive window not requested\n");
+                set_error(session, TFTP_ERR_CODE_BAD_OPTIONS, resp, resp_len,
+                          "no adaptive window");
+                return TFTP_ERR_INTERNAL;
+            }
+            session->adaptive_window = true;
         } else {
             // Options which the server does not support should be omitted from the
             // OACK; they should not cause an ERROR packet to be generated.
@@ -937,12 +1042,17 @@ tftp_status tftp_handle_oack(tftp_session* session,
         left -= offset;
     }
     *timeout_ms = 1000 * session->timeout;
+    if (session->adaptive_window) {
+        // The window size may have been negotiated after the adaptive window option
+        adaptive_window_init(session);
+    }
 
     xprintf("Options negotiated\n");
     xprintf("    File Size  : %zu\n", session->file_size);
     xprintf("    Block Size : %d\n", session->block_size);
     xprintf("    Timeout    : %d\n", session->timeout);
     xprintf("    Window Size: %d\n", session->window_size);
+    xprintf("    Adaptive   : %s\n", session->adaptive_window ? "yes" : "no");
 
     session->offset = 0;
     session->block_number = 0;
@@ -1042,6 +1152,11 @@ void tftp_session_set_block_host_endianness(tftp_session* session,
     session->use_host_block_endianness = enable;
 }
 
+void tftp_session_set_adaptive_window_use(tftp_session* session,
+                                          bool enable) {
+    session->use_adaptive_window = enable;
+}
+
 tftp_status tftp_timeout(tftp_session* session,
                          void* msg_buf,
                          size_t* msg_len,
@@ -1063,6 +1178,9 @@ tftp_status tftp_timeout(tftp_session* session,
     }
     *msg_len = buf_sz;
     if (session->direction == SEND_FILE) {
+        if (session->adaptive_window) {
+            adaptive_window_shrink(session);
+        }
         // Reset back to the last-acknowledged block
         session->window_index = 0;
         return tftp_prepare_data(session, msg_buf, msg_len, timeout_ms, file_cookie);
@@ -33,6 +33,7 @@
 #define VIRTIO_NET_F_CTRL_MAC_ADDR          (1u << 23)
 
 #define VIRTIO_NET_HDR_F_NEEDS_CSUM 1u
+#define VIRTIO_NET_HDR_F_DATA_VALID 2u
 
 #define VIRTIO_NET_HDR_GSO_NONE     0u
 #define VIRTIO_NET_HDR_GSO_TCPV4    1u
@@ -62,4 +63,10 @@ typedef struct virtio_net_hdr {
     uint16_t csum_offset;
 } __PACKED virtio_net_hdr_t;
 
+// Header used in both directions once VIRTIO_NET_F_MRG_RXBUF is negotiated.
+typedef struct virtio_net_hdr_mrg_rxbuf {
+    virtio_net_hdr_t hdr;
+    uint16_t num_buffers;
+} __PACKED virtio_net_hdr_mrg_rxbuf_t;
+
 __END_CDECLS
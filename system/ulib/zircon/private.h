@@ -7,10 +7,12 @@
 #include <zircon/compiler.h>
 #include <zircon/syscalls.h>
 
-// This defines the struct shared with the kernel.
+// These define the structs shared with the kernel.
+#include <lib/vdso-clock.h>
 #include <lib/vdso-constants.h>
 
 extern __LOCAL const struct vdso_constants DATA_CONSTANTS;
+extern __LOCAL const struct vdso_clock DATA_CLOCK;
 
 extern "C" {
 
@@ -20,6 +22,7 @@ extern "C" {
 #include <zircon/syscall-vdso-definitions.h>
 
 __LOCAL decltype(zx_ticks_get) CODE_soft_ticks_get;
+__LOCAL decltype(zx_time_get) CODE_syscall_time_get;
 
 };
 
@@ -0,0 +1,53 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <zircon/syscalls.h>
+
+#include "private.h"
+
+// This is u64_mul_u64_fp32_64() from the kernel's lib/fixed_point, so that
+// times computed here are exactly what current_time() would return.
+static uint64_t ticks_to_nanos(uint64_t ticks) {
+    uint32_t a_r32 = (uint32_t)(ticks >> 32);
+    uint32_t a_0 = (uint32_t)ticks;
+    uint64_t res_0;
+    uint64_t res_l32;
+    uint64_t tmp;
+
+    res_0 = ((uint64_t)a_r32 * DATA_CLOCK.ns_per_tick_l0) << 32;
+    res_0 += (uint64_t)a_0 * DATA_CLOCK.ns_per_tick_l0;
+    res_0 += (uint64_t)a_r32 * DATA_CLOCK.ns_per_tick_l32;
+    tmp = (uint64_t)a_0 * DATA_CLOCK.ns_per_tick_l32;
+    res_0 += tmp >> 32;
+    res_l32 = (uint32_t)tmp;
+    tmp = (uint64_t)a_r32 * DATA_CLOCK.ns_per_tick_l64;
+    res_0 += tmp >> 32;
+    res_l32 += (uint32_t)tmp;
+    tmp = (uint64_t)a_0 * DATA_CLOCK.ns_per_tick_l64;
+    res_l32 += tmp >> 32;
+    res_0 += res_l32 >> 32;
+    return res_0 + ((uint32_t)res_l32 >> 31);
+}
+
+zx_time_t _zx_time_get(uint32_t clock_id) {
+    if (DATA_CLOCK.use_ticks) {
+        switch (clock_id) {
+        case ZX_CLOCK_MONOTONIC:
+            return ticks_to_nanos(VDSO_zx_ticks_get());
+        case ZX_CLOCK_UTC:
+            return ticks_to_nanos(VDSO_zx_ticks_get()) +
+                __atomic_load_n(&DATA_CLOCK.utc_offset, __ATOMIC_RELAXED);
+        }
+    }
+    return SYSCALL_zx_time_get_fallback(clock_id);
+}
+
+VDSO_INTERFACE_FUNCTION(zx_time_get);
+
+// The kernel redirects the {_,}zx_time_get dynamic symbol table entries of
+// the vDSO variants to point to this instead, since it only keeps the
+// |utc_offset| of the full vDSO up to date.  See VDso::CreateVariant.
+VDSO_KERNEL_EXPORT zx_time_t CODE_syscall_time_get(uint32_t clock_id) {
+    return SYSCALL_zx_time_get_fallback(clock_id);
+}
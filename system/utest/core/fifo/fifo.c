@@ -9,7 +9,10 @@
 #include <threads.h>
 #include <unistd.h>
 
+#include <zircon/process.h>
 #include <zircon/syscalls.h>
+#include <zircon/syscalls/fifo.h>
+#include <zircon/syscalls/object.h>
 #include <unittest/unittest.h>
 
 static zx_signals_t get_signals(zx_handle_t h) {
@@ -118,8 +121,139 @@ static bool options_test(void) {
     END_TEST;
 }
 
+static bool shared_ring_test(void) {
+    BEGIN_TEST;
+    zx_handle_t a, b;
+    uint64_t n[8] = { 1, 2, 3, 4, 5, 6, 7, 8};
+    uint32_t actual;
+
+    ASSERT_EQ(zx_fifo_create(8, 8, ZX_FIFO_SHARED_RING, &a, &b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_WRITABLE);
+    EXPECT_SIGNALS(b, ZX_FIFO_WRITABLE);
+
+    zx_fifo_ring_info_t info_a, info_b;
+    zx_handle_t vmo;
+    ASSERT_EQ(zx_fifo_get_ring(a, &info_a, &vmo), ZX_OK, "");
+    ASSERT_EQ(zx_handle_close(vmo), ZX_OK, "");
+    ASSERT_EQ(zx_fifo_get_ring(b, &info_b, &vmo), ZX_OK, "");
+    EXPECT_EQ(info_a.elem_count, 8u, "");
+    EXPECT_EQ(info_a.elem_size, 8u, "");
+    EXPECT_EQ(info_a.rx_header_offset, info_b.tx_header_offset, "");
+    EXPECT_EQ(info_a.rx_data_offset, info_b.tx_data_offset, "");
+    EXPECT_EQ(info_a.tx_header_offset, info_b.rx_header_offset, "");
+    EXPECT_EQ(info_a.tx_data_offset, info_b.rx_data_offset, "");
+
+    uintptr_t mapping;
+    ASSERT_EQ(zx_vmar_map(zx_vmar_root_self(), 0, vmo, 0, info_b.vmo_size,
+                          ZX_VM_FLAG_PERM_READ | ZX_VM_FLAG_PERM_WRITE, &mapping), ZX_OK, "");
+    ASSERT_EQ(zx_handle_close(vmo), ZX_OK, "");
+    zx_fifo_ring_header_t* rx = (zx_fifo_ring_header_t*)(mapping + info_b.rx_header_offset);
+    uint64_t* rx_data = (uint64_t*)(mapping + info_b.rx_data_offset);
+    zx_fifo_ring_header_t* tx = (zx_fifo_ring_header_t*)(mapping + info_b.tx_header_offset);
+    uint64_t* tx_data = (uint64_t*)(mapping + info_b.tx_data_offset);
+
+    // entries written with zx_fifo_write() show up in b's mapped ring
+    ASSERT_EQ(zx_fifo_write(a, n, sizeof(uint64_t) * 3, &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 3u, "");
+    EXPECT_SIGNALS(b, ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+    EXPECT_EQ(rx->head, 3u, "");
+    EXPECT_EQ(rx->tail, 0u, "");
+    EXPECT_EQ(rx_data[0], 1u, "");
+    EXPECT_EQ(rx_data[2], 3u, "");
+
+    // consume them through the mapping; the signal follows once notified
+    rx->tail = 3u;
+    EXPECT_SIGNALS(b, ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+    ASSERT_EQ(zx_fifo_ring_notify(b), ZX_OK, "");
+    EXPECT_SIGNALS(b, ZX_FIFO_WRITABLE);
+    EXPECT_EQ(zx_fifo_read(b, n, sizeof(n), &actual), ZX_ERR_SHOULD_WAIT, "");
+
+    // fill a's ring through the mapping, wrapping around its end
+    tx->head = 6u;
+    tx->tail = 6u;
+    for (uint32_t i = 0; i < 8; i++) {
+        tx_data[(6u + i) & 7u] = 100u + i;
+    }
+    tx->head = 14u;
+    ASSERT_EQ(zx_fifo_ring_notify(b), ZX_OK, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_READABLE | ZX_FIFO_WRITABLE);
+    EXPECT_SIGNALS(b, 0u);
+    EXPECT_EQ(zx_fifo_write(b, n, sizeof(n), &actual), ZX_ERR_SHOULD_WAIT, "");
+
+    // and read them back with zx_fifo_read()
+    memset(n, 0, sizeof(n));
+    ASSERT_EQ(zx_fifo_read(a, n, sizeof(n), &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 8u, "");
+    for (uint32_t i = 0; i < 8; i++) {
+        EXPECT_EQ(n[i], 100u + i, "");
+    }
+    EXPECT_EQ(tx->tail, 14u, "");
+    EXPECT_SIGNALS(a, ZX_FIFO_WRITABLE);
+    EXPECT_SIGNALS(b, ZX_FIFO_WRITABLE);
+
+    // inconsistent indices are rejected
+    tx->head = tx->tail + 9u;
+    EXPECT_EQ(zx_fifo_read(a, n, sizeof(n), &actual), ZX_ERR_BAD_STATE, "");
+    EXPECT_EQ(zx_fifo_ring_notify(b), ZX_ERR_BAD_STATE, "");
+
+    // fifos without a ring have nothing to map
+    zx_handle_t c, d;
+    ASSERT_EQ(zx_fifo_create(8, 8, 0, &c, &d), ZX_OK, "");
+    EXPECT_EQ(zx_fifo_get_ring(c, &info_a, &vmo), ZX_ERR_NOT_SUPPORTED, "");
+    EXPECT_EQ(zx_fifo_ring_notify(c), ZX_ERR_NOT_SUPPORTED, "");
+    zx_handle_close(c);
+    zx_handle_close(d);
+
+    zx_vmar_unmap(zx_vmar_root_self(), mapping, info_b.vmo_size);
+    zx_handle_close(a);
+    zx_handle_close(b);
+
+    END_TEST;
+}
+
+static bool shared_ring_resize_test(void) {
+    BEGIN_TEST;
+    zx_handle_t a, b;
+    uint64_t n[2] = { 1, 2 };
+    uint32_t actual;
+
+    ASSERT_EQ(zx_fifo_create(8, 8, ZX_FIFO_SHARED_RING, &a, &b), ZX_OK, "");
+
+    // one peer tries to shrink the ring out from under the other
+    zx_fifo_ring_info_t info;
+    zx_handle_t vmo;
+    ASSERT_EQ(zx_fifo_get_ring(a, &info, &vmo), ZX_OK, "");
+    EXPECT_EQ(zx_vmo_set_size(vmo, 0), ZX_ERR_UNAVAILABLE, "");
+    uint64_t size;
+    ASSERT_EQ(zx_vmo_get_size(vmo, &size), ZX_OK, "");
+    EXPECT_EQ(size, info.vmo_size, "");
+
+    zx_info_handle_basic_t basic;
+    ASSERT_EQ(zx_object_get_info(vmo, ZX_INFO_HANDLE_BASIC, &basic, sizeof(basic),
+                                 NULL, NULL), ZX_OK, "");
+    EXPECT_EQ(basic.rights & (ZX_RIGHT_SET_PROPERTY | ZX_RIGHT_EXECUTE), 0u, "");
+    ASSERT_EQ(zx_handle_close(vmo), ZX_OK, "");
+
+    // and the other peer's ring keeps working
+    ASSERT_EQ(zx_fifo_write(a, n, sizeof(n), &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 2u, "");
+    memset(n, 0, sizeof(n));
+    ASSERT_EQ(zx_fifo_read(b, n, sizeof(n), &actual), ZX_OK, "");
+    ASSERT_EQ(actual, 2u, "");
+    EXPECT_EQ(n[0], 1u, "");
+    EXPECT_EQ(n[1], 2u, "");
+
+    zx_handle_close(a);
+    zx_handle_close(b);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(fifo_tests)
 RUN_TEST(basic_test)
+RUN_TEST(options_test)
+RUN_TEST(shared_ring_test)
+RUN_TEST(shared_ring_resize_test)
 END_TEST_CASE(fifo_tests)
 
 #ifndef BUILD_COMBINED_TESTS
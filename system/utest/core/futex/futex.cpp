@@ -452,6 +452,126 @@ static bool test_futex_misaligned() {
     END_TEST;
 }
 
+// Pairs of threads ping-pong on their own futex. With the futex table split
+// into independently locked buckets, the pairs should not serialize on each
+// other in the kernel.
+struct FutexPingPong {
+    zx_futex_t turn;
+    int side;
+};
+
+static constexpr int kPingPongPairs = 4;
+static constexpr int kPingPongRounds = 10000;
+
+static int futex_ping_pong_thread(void* arg) {
+    FutexPingPong* state = reinterpret_cast<FutexPingPong*>(arg);
+    zx_futex_t* turn = &state[-state->side].turn;
+    for (int i = 0; i < kPingPongRounds; ++i) {
+        int value;
+        while ((value = __atomic_load_n(turn, __ATOMIC_ACQUIRE)) != state->side) {
+            zx_status_t status = zx_futex_wait(turn, value, ZX_TIME_INFINITE);
+            if (status != ZX_OK && status != ZX_ERR_BAD_STATE)
+                return -1;
+        }
+        __atomic_store_n(turn, 1 - state->side, __ATOMIC_RELEASE);
+        if (zx_futex_wake(turn, 1) != ZX_OK)
+            return -1;
+    }
+    return 0;
+}
+
+static bool test_futex_multi_contention() {
+    BEGIN_TEST;
+
+    FutexPingPong states[kPingPongPairs][2] = {};
+    thrd_t threads[kPingPongPairs][2];
+
+    zx_time_t start = zx_time_get(ZX_CLOCK_MONOTONIC);
+    for (int i = 0; i < kPingPongPairs; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            states[i][j].side = j;
+            ASSERT_EQ(thrd_create_with_name(&threads[i][j], futex_ping_pong_thread,
+                                            &states[i][j], "ping pong"),
+                      thrd_success, "");
+        }
+    }
+    for (int i = 0; i < kPingPongPairs; ++i) {
+        for (int j = 0; j < 2; ++j) {
+            int result;
+            ASSERT_EQ(thrd_join(threads[i][j], &result), thrd_success, "");
+            EXPECT_EQ(result, 0, "");
+        }
+    }
+    zx_time_t elapsed = zx_time_get(ZX_CLOCK_MONOTONIC) - start;
+    unittest_printf("\n%d pairs x %d round trips: %" PRIu64 " ns per round trip\n",
+                    kPingPongPairs, kPingPongRounds,
+                    elapsed / (kPingPongPairs * kPingPongRounds));
+
+    // Waking a futex nobody waits on should not need to take any lock.
+    zx_futex_t idle = 0;
+    start = zx_time_get(ZX_CLOCK_MONOTONIC);
+    for (int i = 0; i < kPingPongRounds; ++i)
+        ASSERT_EQ(zx_futex_wake(&idle, 1), ZX_OK, "");
+    elapsed = zx_time_get(ZX_CLOCK_MONOTONIC) - start;
+    unittest_printf("wake with no waiters: %" PRIu64 " ns per call\n",
+                    elapsed / kPingPongRounds);
+
+    END_TEST;
+}
+
+// A waker changes the futex value and wakes just as the waiter goes to sleep
+// on the old value, over and over. If the waiter's count of itself and the
+// waker's check of that count ever miss each other, the wakeup is lost and
+// the waiter sleeps until its deadline.
+struct FutexRace {
+    zx_futex_t value;
+    zx_futex_t ready;
+};
+
+static constexpr int kRaceRounds = 20000;
+
+static int futex_race_waker(void* arg) {
+    FutexRace* race = reinterpret_cast<FutexRace*>(arg);
+    for (int i = 1; i <= kRaceRounds; ++i) {
+        // Wait until the waiter is about to sleep on i - 1.
+        while (__atomic_load_n(&race->ready, __ATOMIC_ACQUIRE) != i - 1)
+            sched_yield();
+        __atomic_store_n(&race->value, i, __ATOMIC_RELEASE);
+        if (zx_futex_wake(&race->value, 1) != ZX_OK)
+            return -1;
+    }
+    return 0;
+}
+
+static bool test_futex_wake_wait_race() {
+    BEGIN_TEST;
+
+    FutexRace race = {};
+    thrd_t waker;
+    ASSERT_EQ(thrd_create_with_name(&waker, futex_race_waker, &race, "waker"),
+              thrd_success, "");
+
+    int lost = 0;
+    for (int i = 0; i < kRaceRounds; ++i) {
+        __atomic_store_n(&race.ready, i, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&race.value, __ATOMIC_ACQUIRE) == i) {
+            zx_status_t status = zx_futex_wait(&race.value, i, zx_deadline_after(ZX_SEC(1)));
+            if (status == ZX_ERR_TIMED_OUT) {
+                ++lost;
+            } else {
+                ASSERT_TRUE(status == ZX_OK || status == ZX_ERR_BAD_STATE, "");
+            }
+        }
+    }
+
+    int result;
+    ASSERT_EQ(thrd_join(waker, &result), thrd_success, "");
+    EXPECT_EQ(result, 0, "");
+    EXPECT_EQ(lost, 0, "wakeups were lost");
+
+    END_TEST;
+}
+
 static void log(const char* str) {
     uint64_t now = zx_time_get(ZX_CLOCK_MONOTONIC);
     unittest_printf("[%08" PRIu64 ".%08" PRIu64 "]: %s",
@@ -544,6 +664,8 @@ RUN_TEST(test_futex_requeue_unqueued_on_timeout);
 RUN_TEST(test_futex_thread_killed);
 RUN_TEST(test_futex_thread_suspended);
 RUN_TEST(test_futex_misaligned);
+RUN_TEST(test_futex_multi_contention);
+RUN_TEST(test_futex_wake_wait_race);
 RUN_TEST(test_event_signaling);
 END_TEST_CASE(futex_tests)
 
@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 static zx_signals_t get_satisfied_signals(zx_handle_t handle) {
@@ -569,6 +570,61 @@ static bool socket_datagram_no_short_write(void) {
     END_TEST;
 }
 
+static bool socket_rx_buf_max(void) {
+    BEGIN_TEST;
+
+    zx_status_t status;
+
+    zx_handle_t h0, h1;
+    status = zx_socket_create(0, &h0, &h1);
+    ASSERT_EQ(status, ZX_OK, "");
+
+    size_t buf_max = 0;
+    status = zx_object_get_property(h1, ZX_PROP_SOCKET_RX_BUF_MAX, &buf_max, sizeof(buf_max));
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_GT(buf_max, 0u, "");
+
+    buf_max = 0;
+    status = zx_object_set_property(h1, ZX_PROP_SOCKET_RX_BUF_MAX, &buf_max, sizeof(buf_max));
+    EXPECT_EQ(status, ZX_ERR_OUT_OF_RANGE, "");
+
+    // A larger buffer takes a single write bigger than the default.
+    buf_max = 1024 * 1024;
+    status = zx_object_set_property(h1, ZX_PROP_SOCKET_RX_BUF_MAX, &buf_max, sizeof(buf_max));
+    EXPECT_EQ(status, ZX_OK, "");
+
+    const size_t buffer_size = buf_max + 1;
+    unsigned char* buffer = malloc(buffer_size);
+    for (size_t i = 0; i < buffer_size; i++)
+        buffer[i] = (unsigned char)(i * 7);
+    size_t written = 0;
+    status = zx_socket_write(h0, 0u, buffer, buffer_size, &written);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(written, buf_max, "");
+    EXPECT_EQ(get_satisfied_signals(h0) & ZX_SOCKET_WRITABLE, 0u, "");
+
+    // Shrinking the buffer below what is queued keeps the writer blocked,
+    // and draining it makes the writer writable again.
+    buf_max = 4096;
+    status = zx_object_set_property(h1, ZX_PROP_SOCKET_RX_BUF_MAX, &buf_max, sizeof(buf_max));
+    EXPECT_EQ(status, ZX_OK, "");
+
+    unsigned char* rbuf = malloc(buffer_size);
+    size_t count = 0;
+    status = zx_socket_read(h1, 0u, rbuf, buffer_size, &count);
+    EXPECT_EQ(status, ZX_OK, "");
+    EXPECT_EQ(count, written, "");
+    EXPECT_EQ(memcmp(buffer, rbuf, count), 0, "");
+    EXPECT_EQ(get_satisfied_signals(h0) & ZX_SOCKET_WRITABLE, ZX_SOCKET_WRITABLE, "");
+
+    free(rbuf);
+    free(buffer);
+    zx_handle_close(h0);
+    zx_handle_close(h1);
+
+    END_TEST;
+}
+
 static bool socket_control_plane_absent(void) {
     BEGIN_TEST;
 
@@ -810,6 +866,7 @@ RUN_TEST(socket_bytes_outstanding_shutdown_read)
 RUN_TEST(socket_short_write)
 RUN_TEST(socket_datagram)
 RUN_TEST(socket_datagram_no_short_write)
+RUN_TEST(socket_rx_buf_max)
 RUN_TEST(socket_control_plane_absent)
 RUN_TEST(socket_control_plane)
 RUN_TEST(socket_control_plane_shutdown)
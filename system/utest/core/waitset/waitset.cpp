@@ -0,0 +1,239 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdio.h>
+#include <threads.h>
+
+#include <zircon/syscalls.h>
+#include <fbl/algorithm.h>
+
+#include <unittest/unittest.h>
+
+static bool create_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t ws;
+    EXPECT_EQ(zx_waitset_create(1u, &ws), ZX_ERR_INVALID_ARGS);
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+
+    zx_info_handle_basic_t info;
+    ASSERT_EQ(zx_object_get_info(ws, ZX_INFO_HANDLE_BASIC, &info, sizeof(info),
+                                 nullptr, nullptr), ZX_OK);
+    EXPECT_EQ(info.type, static_cast<uint32_t>(ZX_OBJ_TYPE_WAIT_SET));
+
+    zx_waitset_result_t result;
+    uint32_t actual = 0u;
+    EXPECT_EQ(zx_waitset_wait(ws, 0u, &result, 0u, &actual), ZX_ERR_INVALID_ARGS);
+    EXPECT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_ERR_TIMED_OUT);
+
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+static bool add_remove_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t ws, event;
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK);
+
+    EXPECT_EQ(zx_waitset_add(ws, event, 1u, ZX_USER_SIGNAL_0, 7u), ZX_ERR_INVALID_ARGS);
+    EXPECT_EQ(zx_waitset_add(ws, event, 1u, ZX_USER_SIGNAL_0, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_OK);
+    EXPECT_EQ(zx_waitset_add(ws, event, 1u, ZX_USER_SIGNAL_1, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_ERR_ALREADY_EXISTS);
+    EXPECT_EQ(zx_waitset_add(ws, event, 2u, ZX_USER_SIGNAL_1, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_OK);
+
+    EXPECT_EQ(zx_waitset_remove(ws, event, 3u), ZX_ERR_NOT_FOUND);
+    EXPECT_EQ(zx_waitset_remove(ws, event, 1u), ZX_OK);
+    EXPECT_EQ(zx_waitset_remove(ws, event, 1u), ZX_ERR_NOT_FOUND);
+
+    // The cookie can be reused once removed.
+    EXPECT_EQ(zx_waitset_add(ws, event, 1u, ZX_USER_SIGNAL_0, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_OK);
+
+    EXPECT_EQ(zx_object_signal(event, 0u, ZX_USER_SIGNAL_1), ZX_OK);
+    zx_waitset_result_t results[2];
+    uint32_t actual = 0u;
+    ASSERT_EQ(zx_waitset_wait(ws, 0u, results, 2u, &actual), ZX_OK);
+    ASSERT_EQ(actual, 1u);
+    EXPECT_EQ(results[0].cookie, 2u);
+    EXPECT_EQ(results[0].status, ZX_OK);
+    EXPECT_EQ(results[0].observed & ZX_USER_SIGNAL_1, ZX_USER_SIGNAL_1);
+
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+static bool level_triggered_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t ws, event;
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK);
+    ASSERT_EQ(zx_waitset_add(ws, event, 5u, ZX_EVENT_SIGNALED, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_OK);
+
+    zx_waitset_result_t result;
+    uint32_t actual = 0u;
+    EXPECT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_ERR_TIMED_OUT);
+
+    // Stays ready for as long as the signal is asserted.
+    ASSERT_EQ(zx_object_signal(event, 0u, ZX_EVENT_SIGNALED), ZX_OK);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_OK);
+        EXPECT_EQ(actual, 1u);
+        EXPECT_EQ(result.cookie, 5u);
+        EXPECT_EQ(result.observed & ZX_EVENT_SIGNALED, ZX_EVENT_SIGNALED);
+    }
+
+    ASSERT_EQ(zx_object_signal(event, ZX_EVENT_SIGNALED, 0u), ZX_OK);
+    EXPECT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_ERR_TIMED_OUT);
+
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+static bool edge_triggered_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t ws, event;
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK);
+    ASSERT_EQ(zx_waitset_add(ws, event, 5u, ZX_EVENT_SIGNALED, ZX_WAITSET_EDGE_TRIGGERED),
+              ZX_OK);
+
+    ASSERT_EQ(zx_object_signal(event, 0u, ZX_EVENT_SIGNALED), ZX_OK);
+
+    zx_waitset_result_t result;
+    uint32_t actual = 0u;
+    ASSERT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_OK);
+    EXPECT_EQ(result.cookie, 5u);
+
+    // Reported once, even though the signal is still asserted.
+    EXPECT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_ERR_TIMED_OUT);
+
+    // A further state change while asserted reports it again.
+    ASSERT_EQ(zx_object_signal(event, 0u, ZX_USER_SIGNAL_0), ZX_OK);
+    ASSERT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_OK);
+    EXPECT_EQ(result.cookie, 5u);
+
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+static bool handle_closed_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t ws, event;
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK);
+    ASSERT_EQ(zx_waitset_add(ws, event, 9u, ZX_EVENT_SIGNALED, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_OK);
+
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+
+    zx_waitset_result_t result;
+    uint32_t actual = 0u;
+    ASSERT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_OK);
+    EXPECT_EQ(actual, 1u);
+    EXPECT_EQ(result.cookie, 9u);
+    EXPECT_EQ(result.status, ZX_ERR_CANCELED);
+    EXPECT_EQ(result.observed, ZX_SIGNAL_HANDLE_CLOSED);
+
+    // Reported once, then gone.
+    EXPECT_EQ(zx_waitset_wait(ws, 0u, &result, 1u, &actual), ZX_ERR_TIMED_OUT);
+
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+static bool many_handles_test(void) {
+    BEGIN_TEST;
+
+    constexpr uint32_t kCount = 256u;
+    zx_handle_t ws;
+    zx_handle_t events[kCount];
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+    for (uint32_t i = 0; i < kCount; i++) {
+        ASSERT_EQ(zx_event_create(0u, &events[i]), ZX_OK);
+        ASSERT_EQ(zx_waitset_add(ws, events[i], i, ZX_EVENT_SIGNALED,
+                                 ZX_WAITSET_EDGE_TRIGGERED), ZX_OK);
+    }
+
+    // Signal every seventh event and expect exactly those back.
+    uint32_t expected = 0u;
+    for (uint32_t i = 0; i < kCount; i += 7) {
+        ASSERT_EQ(zx_object_signal(events[i], 0u, ZX_EVENT_SIGNALED), ZX_OK);
+        expected++;
+    }
+
+    zx_waitset_result_t results[kCount];
+    uint32_t actual = 0u;
+    ASSERT_EQ(zx_waitset_wait(ws, 0u, results, kCount, &actual), ZX_OK);
+    EXPECT_EQ(actual, expected);
+    for (uint32_t i = 0; i < actual; i++)
+        EXPECT_EQ(results[i].cookie % 7u, 0u);
+
+    for (uint32_t i = 0; i < kCount; i++)
+        EXPECT_EQ(zx_handle_close(events[i]), ZX_OK);
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+static int signal_thread(void* arg) {
+    zx_nanosleep(zx_deadline_after(ZX_MSEC(1)));
+    zx_object_signal(*reinterpret_cast<zx_handle_t*>(arg), 0u, ZX_EVENT_SIGNALED);
+    return 0;
+}
+
+static bool blocking_wait_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t ws, event;
+    ASSERT_EQ(zx_waitset_create(0u, &ws), ZX_OK);
+    ASSERT_EQ(zx_event_create(0u, &event), ZX_OK);
+    ASSERT_EQ(zx_waitset_add(ws, event, 1u, ZX_EVENT_SIGNALED, ZX_WAITSET_LEVEL_TRIGGERED),
+              ZX_OK);
+
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, signal_thread, &event), thrd_success);
+
+    zx_waitset_result_t result;
+    uint32_t actual = 0u;
+    EXPECT_EQ(zx_waitset_wait(ws, ZX_TIME_INFINITE, &result, 1u, &actual), ZX_OK);
+    EXPECT_EQ(result.cookie, 1u);
+
+    EXPECT_EQ(thrd_join(thread, nullptr), thrd_success);
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+    EXPECT_EQ(zx_handle_close(ws), ZX_OK);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(waitset_tests)
+RUN_TEST(create_test)
+RUN_TEST(add_remove_test)
+RUN_TEST(level_triggered_test)
+RUN_TEST(edge_triggered_test)
+RUN_TEST(handle_closed_test)
+RUN_TEST(many_handles_test)
+RUN_TEST(blocking_wait_test)
+END_TEST_CASE(waitset_tests)
+
+#ifndef BUILD_COMBINED_TESTS
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
+#endif
@@ -4,12 +4,15 @@
 
 #include <fcntl.h>
 #include <inttypes.h>
+#include <launchpad/launchpad.h>
 #include <launchpad/vmo.h>
 #include <launchpad/loader-service.h>
 #include <zircon/dlfcn.h>
 #include <zircon/processargs.h>
 #include <zircon/syscalls.h>
+#include <zircon/syscalls/object.h>
 
+#include <limits.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
@@ -160,6 +163,256 @@ bool clone_test(void) {
     END_TEST;
 }
 
+static zx_status_t batch_loader_service(void* arg, uint32_t load_op,
+                                        zx_handle_t request_handle,
+                                        const char* name, zx_handle_t* out) {
+    if (request_handle != ZX_HANDLE_INVALID)
+        zx_handle_close(request_handle);
+    if (load_op != LOADER_SVC_OP_LOAD_OBJECT || strcmp(name, "present"))
+        return ZX_ERR_NOT_FOUND;
+    return zx_vmo_create(4096, 0, out);
+}
+
+bool loader_service_batch_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t svc;
+    zx_status_t status = loader_service_simple(&batch_loader_service, NULL, &svc);
+    ASSERT_EQ(status, ZX_OK, "loader_service_simple");
+
+    static const char names[] = "present\0missing\0present";
+    struct {
+        zx_loader_svc_msg_t header;
+        uint8_t data[sizeof(names)];
+    } req = {
+        .header = {
+            .txid = 1,
+            .opcode = LOADER_SVC_OP_LOAD_OBJECTS,
+            .arg = 3,
+        },
+    };
+    memcpy(req.data, names, sizeof(names));
+    struct {
+        zx_loader_svc_msg_t header;
+        int32_t statuses[LOADER_SVC_BATCH_MAX];
+    } rsp;
+    zx_handle_t handles[LOADER_SVC_BATCH_MAX];
+    zx_channel_call_args_t call = {
+        .wr_bytes = &req,
+        .wr_num_bytes = sizeof(req),
+        .rd_bytes = &rsp,
+        .rd_num_bytes = sizeof(rsp),
+        .rd_handles = handles,
+        .rd_num_handles = LOADER_SVC_BATCH_MAX,
+    };
+    uint32_t actual_bytes, actual_handles;
+    zx_status_t read_status;
+    status = zx_channel_call(svc, 0, ZX_TIME_INFINITE, &call,
+                             &actual_bytes, &actual_handles, &read_status);
+    ASSERT_EQ(status, ZX_OK, "zx_channel_call");
+    EXPECT_EQ(rsp.header.arg, ZX_OK, "batch status");
+    ASSERT_EQ(actual_bytes, sizeof(rsp.header) + 3 * sizeof(int32_t), "reply size");
+    EXPECT_EQ(rsp.statuses[0], ZX_OK, "first name");
+    EXPECT_EQ(rsp.statuses[1], ZX_ERR_NOT_FOUND, "second name");
+    EXPECT_EQ(rsp.statuses[2], ZX_OK, "third name");
+    EXPECT_EQ(actual_handles, 2u, "one vmo per name found");
+    for (uint32_t i = 0; i < actual_handles; ++i)
+        zx_handle_close(handles[i]);
+
+    // A batch whose count does not match its names is rejected whole.
+    req.header.arg = 4;
+    call.wr_num_bytes = sizeof(req);
+    status = zx_channel_call(svc, 0, ZX_TIME_INFINITE, &call,
+                             &actual_bytes, &actual_handles, &read_status);
+    ASSERT_EQ(status, ZX_OK, "zx_channel_call");
+    EXPECT_EQ(rsp.header.arg, ZX_ERR_INVALID_ARGS, "bad count");
+    EXPECT_EQ(actual_bytes, sizeof(rsp.header), "reply size");
+    EXPECT_EQ(actual_handles, 0u, "no handles");
+
+    zx_handle_close(svc);
+
+    END_TEST;
+}
+
+#define STARTUP_HELPER "/boot/bin/dlfcn-startup-helper"
+#define STARTUP_LAUNCHES 20
+
+// Serves each library straight from the filesystem, without batching,
+// caching or prelinking.
+static zx_status_t plain_loader_service(void* arg, uint32_t load_op,
+                                        zx_handle_t request_handle,
+                                        const char* name, zx_handle_t* out) {
+    if (request_handle != ZX_HANDLE_INVALID)
+        zx_handle_close(request_handle);
+    if (load_op != LOADER_SVC_OP_LOAD_OBJECT)
+        return ZX_ERR_NOT_SUPPORTED;
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), LIBPREFIX "%s", name);
+    return launchpad_vmo_from_file(path, out);
+}
+
+static zx_status_t plain_loader_connect(zx_handle_t* out) {
+    return loader_service_simple(&plain_loader_service, NULL, out);
+}
+
+static zx_status_t prelink_loader_connect(zx_handle_t* out) {
+    static loader_service_t* svc;
+    if (svc == NULL) {
+        zx_status_t status = loader_service_create_fs("dlfcn-prelink", &svc);
+        if (status != ZX_OK)
+            return status;
+    }
+    return loader_service_connect(svc, out);
+}
+
+static bool launch_startup_helper(zx_status_t (*connect)(zx_handle_t*),
+                                  int argc, const char* const* argv) {
+    BEGIN_HELPER;
+
+    zx_handle_t svc;
+    ASSERT_EQ(connect(&svc), ZX_OK, "loader service");
+
+    launchpad_t* lp;
+    launchpad_create(ZX_HANDLE_INVALID, "dlfcn-startup-helper", &lp);
+    zx_handle_t old = launchpad_use_loader_service(lp, svc);
+    EXPECT_EQ(old, ZX_HANDLE_INVALID, "launchpad had a loader service");
+    launchpad_load_from_file(lp, STARTUP_HELPER);
+    launchpad_set_args(lp, argc, argv);
+    zx_handle_t proc;
+    const char* errmsg;
+    zx_status_t status = launchpad_go(lp, &proc, &errmsg);
+    ASSERT_EQ(status, ZX_OK, errmsg);
+
+    status = zx_object_wait_one(proc, ZX_PROCESS_TERMINATED,
+                                ZX_TIME_INFINITE, NULL);
+    ASSERT_EQ(status, ZX_OK, "zx_object_wait_one");
+    zx_info_process_t info;
+    status = zx_object_get_info(proc, ZX_INFO_PROCESS, &info, sizeof(info),
+                                NULL, NULL);
+    zx_handle_close(proc);
+    ASSERT_EQ(status, ZX_OK, "zx_object_get_info");
+    EXPECT_EQ(info.return_code, 0, "helper failed");
+
+    END_HELPER;
+}
+
+static bool time_startup(const char* label,
+                         zx_status_t (*connect)(zx_handle_t*)) {
+    BEGIN_HELPER;
+
+    const char* const argv[] = { "dlfcn-startup-helper" };
+
+    // The first launch fills the loader service's caches.
+    ASSERT_TRUE(launch_startup_helper(connect, 1, argv), "");
+
+    uint64_t start = zx_ticks_get();
+    for (int i = 0; i < STARTUP_LAUNCHES; ++i)
+        ASSERT_TRUE(launch_startup_helper(connect, 1, argv), "");
+    uint64_t ticks = zx_ticks_get() - start;
+
+    printf("\nBenchmark %s: [%10" PRIu64 "] usec per launch\n", label,
+           ticks * 1000000 / zx_ticks_per_second() / STARTUP_LAUNCHES);
+
+    END_HELPER;
+}
+
+// Compares process startup through a plain loader service with startup
+// through a filesystem loader service, which batches, caches and
+// prelinks libraries.
+bool startup_benchmark_test(void) {
+    BEGIN_TEST;
+
+    EXPECT_TRUE(time_startup("startup (plain loader)",
+                             &plain_loader_connect), "");
+    EXPECT_TRUE(time_startup("startup (prelinking loader)",
+                             &prelink_loader_connect), "");
+
+    END_TEST;
+}
+
+#if __has_feature(address_sanitizer)
+# define PRELINK_LIB "asan/libfdio.so"
+#else
+# define PRELINK_LIB "libfdio.so"
+#endif
+
+// Asks |svc| to prelink PRELINK_LIB, and returns its bias.
+static bool prelink_request(zx_handle_t svc, uintptr_t* bias) {
+    BEGIN_HELPER;
+
+    struct {
+        zx_loader_svc_msg_t header;
+        char name[sizeof(PRELINK_LIB)];
+    } req = {
+        .header = {
+            .txid = 1,
+            .opcode = LOADER_SVC_OP_LOAD_PRELINKED,
+            .arg = 1,
+        },
+        .name = PRELINK_LIB,
+    };
+    struct {
+        zx_loader_svc_msg_t header;
+        zx_loader_svc_prelink_t prelink;
+    } rsp;
+    zx_handle_t handles[2];
+    zx_channel_call_args_t call = {
+        .wr_bytes = &req,
+        .wr_num_bytes = sizeof(req),
+        .rd_bytes = &rsp,
+        .rd_num_bytes = sizeof(rsp),
+        .rd_handles = handles,
+        .rd_num_handles = countof(handles),
+    };
+    uint32_t actual_bytes, actual_handles;
+    zx_status_t read_status;
+    zx_status_t status = zx_channel_call(svc, 0, ZX_TIME_INFINITE, &call,
+                                         &actual_bytes, &actual_handles,
+                                         &read_status);
+    ASSERT_EQ(status, ZX_OK, "zx_channel_call");
+    if (actual_handles == 2) {
+        // Every process shares the prelinked copy, so none may write it.
+        zx_info_handle_basic_t info;
+        EXPECT_EQ(zx_object_get_info(handles[1], ZX_INFO_HANDLE_BASIC, &info,
+                                     sizeof(info), NULL, NULL), ZX_OK, "");
+        EXPECT_EQ(info.rights & (ZX_RIGHT_WRITE | ZX_RIGHT_SET_PROPERTY), 0u,
+                  "prelinked copy is writable");
+    }
+    for (uint32_t i = 0; i < actual_handles; ++i)
+        zx_handle_close(handles[i]);
+    EXPECT_EQ(rsp.header.arg, ZX_OK, "batch status");
+    ASSERT_EQ(actual_bytes, sizeof(rsp), "reply size");
+    EXPECT_EQ(rsp.prelink.status, ZX_OK, "library status");
+    EXPECT_NE(rsp.prelink.bias, 0u, "library not prelinked");
+    EXPECT_EQ(actual_handles, 2u, "library and its prelinked copy");
+    *bias = rsp.prelink.bias;
+
+    END_HELPER;
+}
+
+// A library prelinked by the filesystem loader service keeps its bias
+// from one request to the next, is mapped at that bias in a process
+// started with the service, and works there.
+bool prelink_test(void) {
+    BEGIN_TEST;
+
+    zx_handle_t svc;
+    ASSERT_EQ(prelink_loader_connect(&svc), ZX_OK, "loader service");
+    uintptr_t bias, again;
+    ASSERT_TRUE(prelink_request(svc, &bias), "");
+    ASSERT_TRUE(prelink_request(svc, &again), "");
+    zx_handle_close(svc);
+    EXPECT_EQ(again, bias, "library prelinked afresh");
+
+    char bias_arg[32];
+    snprintf(bias_arg, sizeof(bias_arg), "%#" PRIxPTR, bias);
+    const char* const argv[] = { "dlfcn-startup-helper", "libfdio.so", bias_arg };
+    EXPECT_TRUE(launch_startup_helper(&prelink_loader_connect,
+                                      countof(argv), argv), "");
+
+    END_TEST;
+}
+
 int main(int argc, char** argv);
 static bool dladdr_main_test(void) {
     BEGIN_TEST;
@@ -179,6 +432,9 @@ static bool dladdr_main_test(void) {
 BEGIN_TEST_CASE(dlfcn_tests)
 RUN_TEST(dlopen_vmo_test);
 RUN_TEST(loader_service_test);
+RUN_TEST(loader_service_batch_test);
+RUN_TEST(startup_benchmark_test);
+RUN_TEST(prelink_test);
 RUN_TEST(clone_test);
 RUN_TEST(dladdr_main_test);
 END_TEST_CASE(dlfcn_tests)
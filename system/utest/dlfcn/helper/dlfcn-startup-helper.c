@@ -0,0 +1,53 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <link.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+struct lookup {
+    const char* name;
+    uintptr_t bias;
+    int found;
+};
+
+static int find_library(struct dl_phdr_info* info, size_t size, void* arg) {
+    struct lookup* lookup = arg;
+    if (info->dlpi_name != NULL && !strcmp(info->dlpi_name, lookup->name)) {
+        lookup->bias = info->dlpi_addr;
+        lookup->found = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// With no arguments, this does nothing itself.  Given a library name and
+// a load bias, it checks that the library was loaded at that bias, and
+// then uses it: a pipe goes through libfdio's tables of operations,
+// which are pointers fixed up by relative relocations.
+int main(int argc, char** argv) {
+    if (argc != 3)
+        return 0;
+
+    struct lookup lookup = { .name = argv[1] };
+    dl_iterate_phdr(&find_library, &lookup);
+    if (!lookup.found)
+        return 1;
+    if (lookup.bias != (uintptr_t)strtoull(argv[2], NULL, 0))
+        return 2;
+
+    int fds[2];
+    char buf[6];
+    if (pipe(fds) != 0)
+        return 3;
+    if (write(fds[1], "hello", sizeof(buf)) != (ssize_t)sizeof(buf) ||
+        read(fds[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) ||
+        strcmp(buf, "hello"))
+        return 4;
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,26 @@
+# Copyright 2017 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := userapp
+MODULE_GROUP := test
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/dlfcn-startup-helper.c
+
+MODULE_NAME := dlfcn-startup-helper
+
+# The helper gives the dynamic linker a few shared libraries to load when
+# dlfcn-test times its startup, and checks where one of them was loaded.
+MODULE_LIBS := \
+    system/ulib/launchpad \
+    system/ulib/unittest \
+    system/ulib/fdio \
+    system/ulib/zircon \
+    system/ulib/c
+
+include make/module.mk
@@ -20,3 +20,5 @@ MODULE_STATIC_LIBS := system/ulib/launchpad system/ulib/elfload
 MODULE_LIBS := system/ulib/unittest system/ulib/fdio system/ulib/zircon system/ulib/c
 
 include make/module.mk
+
+include $(LOCAL_DIR)/helper/rules.mk
@@ -13,6 +13,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <fdio/io.h>
 #include <zircon/device/vfs.h>
 #include <zircon/syscalls.h>
 #include <fbl/alloc_checker.h>
@@ -202,14 +203,88 @@ bool benchmark_path_walk(void) {
     END_TEST;
 }
 
+constexpr int kStatPasses = 10;
+
+bool stat_tree_pass(size_t dirs, size_t files) {
+    BEGIN_HELPER;
+    char path[PATH_MAX];
+    struct stat buf;
+    for (size_t i = 0; i < dirs; i++) {
+        for (size_t j = 0; j < files; j++) {
+            snprintf(path, sizeof(path), MOUNT_POINT "/tree/d%03zu/f%03zu", i, j);
+            ASSERT_EQ(stat(path, &buf), 0, "Could not stat file");
+        }
+        // Probe for a name which does not exist, as a search path would.
+        snprintf(path, sizeof(path), MOUNT_POINT "/tree/d%03zu/missing", i);
+        ASSERT_EQ(stat(path, &buf), -1);
+    }
+    END_HELPER;
+}
+
+// Repeated stat() of every file in a tree, without and with the fdio stat
+// cache.
+template <size_t Dirs, size_t FilesPerDir>
+bool benchmark_stat_tree(void) {
+    BEGIN_TEST;
+    printf("\nBenchmarking Repeated stat (%lu directories of %lu files, %d passes)\n",
+           Dirs, FilesPerDir, kStatPasses);
+    char path[PATH_MAX];
+    ASSERT_EQ(mkdir(MOUNT_POINT "/tree", 0755), 0);
+    for (size_t i = 0; i < Dirs; i++) {
+        snprintf(path, sizeof(path), MOUNT_POINT "/tree/d%03zu", i);
+        ASSERT_EQ(mkdir(path, 0755), 0);
+        for (size_t j = 0; j < FilesPerDir; j++) {
+            snprintf(path, sizeof(path), MOUNT_POINT "/tree/d%03zu/f%03zu", i, j);
+            int fd = open(path, O_CREAT | O_RDWR | O_EXCL, 0644);
+            ASSERT_GT(fd, 0);
+            ASSERT_EQ(close(fd), 0);
+        }
+    }
+
+    uint64_t start = zx_ticks_get();
+    for (int n = 0; n < kStatPasses; n++) {
+        ASSERT_TRUE(stat_tree_pass(Dirs, FilesPerDir));
+    }
+    time_end("stat, uncached", start);
+
+    fdio_stat_cache_stats_t before, after;
+    fdio_stat_cache_get_stats(&before);
+    fdio_stat_cache_enable(ZX_SEC(10));
+    start = zx_ticks_get();
+    for (int n = 0; n < kStatPasses; n++) {
+        ASSERT_TRUE(stat_tree_pass(Dirs, FilesPerDir));
+    }
+    time_end("stat, cached", start);
+    fdio_stat_cache_enable(0);
+    fdio_stat_cache_get_stats(&after);
+    printf("Stat cache: %lu hits, %lu misses, %lu invalidations\n",
+           after.hits - before.hits, after.misses - before.misses,
+           after.invalidations - before.invalidations);
+
+    for (size_t i = 0; i < Dirs; i++) {
+        for (size_t j = 0; j < FilesPerDir; j++) {
+            snprintf(path, sizeof(path), MOUNT_POINT "/tree/d%03zu/f%03zu", i, j);
+            ASSERT_EQ(unlink(path), 0);
+        }
+        snprintf(path, sizeof(path), MOUNT_POINT "/tree/d%03zu", i);
+        ASSERT_EQ(unlink(path), 0);
+    }
+    ASSERT_EQ(unlink(MOUNT_POINT "/tree"), 0);
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(basic_benchmarks)
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 1024>))
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 2048>))
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 4096>))
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 8192>))
 RUN_TEST_PERFORMANCE((benchmark_write_read<16 * KB, 16384>))
+RUN_TEST_PERFORMANCE((benchmark_write_read<256 * KB, 256>))
+RUN_TEST_PERFORMANCE((benchmark_write_read<1 * MB, 64>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<125>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<250>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<500>))
 RUN_TEST_PERFORMANCE((benchmark_path_walk<1000>))
+RUN_TEST_PERFORMANCE((benchmark_stat_tree<16, 32>))
+RUN_TEST_PERFORMANCE((benchmark_stat_tree<64, 16>))
 END_TEST_CASE(basic_benchmarks)
@@ -21,11 +21,13 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/test-attr.c \
     $(LOCAL_DIR)/test-append.cpp \
     $(LOCAL_DIR)/test-basic.c \
+    $(LOCAL_DIR)/test-batch.cpp \
     $(LOCAL_DIR)/test-clone.cpp \
     $(LOCAL_DIR)/test-directory.cpp \
     $(LOCAL_DIR)/test-dot-dot.c \
     $(LOCAL_DIR)/test-link.c \
     $(LOCAL_DIR)/test-fcntl.cpp \
+    $(LOCAL_DIR)/test-large-io.cpp \
     $(LOCAL_DIR)/test-maxfile.cpp \
     $(LOCAL_DIR)/test-minfs.cpp \
     $(LOCAL_DIR)/test-mmap.cpp \
@@ -37,6 +39,7 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/test-resize.cpp \
     $(LOCAL_DIR)/test-rw-workers.c \
     $(LOCAL_DIR)/test-sparse.cpp \
+    $(LOCAL_DIR)/test-stat-cache.cpp \
     $(LOCAL_DIR)/test-sync.c \
     $(LOCAL_DIR)/test-threading.cpp \
     $(LOCAL_DIR)/test-truncate.cpp \
@@ -0,0 +1,154 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
+#include <fdio/io.h>
+#include <unittest/unittest.h>
+
+#include "filesystems.h"
+
+namespace {
+
+// Enough entries to need several pipelined STAT_BATCH messages.
+constexpr size_t kNumFiles = 300;
+
+// Entries which are not single path components, or do not exist, go
+// through the fallback or report their own error.
+const char* const kOddNames[] = {"missing", ".", "subdir/inner", "subdir"};
+
+bool make_tree(char (*names)[16]) {
+    BEGIN_HELPER;
+    ASSERT_EQ(mkdir("::batch", 0755), 0);
+    ASSERT_EQ(mkdir("::batch/subdir", 0755), 0);
+    int fd = open("::batch/subdir/inner", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(close(fd), 0);
+    for (size_t i = 0; i < kNumFiles; i++) {
+        char path[32];
+        snprintf(names[i], 16, "file-%03zu", i);
+        snprintf(path, sizeof(path), "::batch/%s", names[i]);
+        fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        ASSERT_GT(fd, 0);
+        // Give each file a distinct size.
+        ASSERT_EQ(write(fd, path, i % 16), (ssize_t)(i % 16));
+        ASSERT_EQ(close(fd), 0);
+    }
+    END_HELPER;
+}
+
+bool remove_tree(char (*names)[16]) {
+    BEGIN_HELPER;
+    for (size_t i = 0; i < kNumFiles; i++) {
+        char path[32];
+        snprintf(path, sizeof(path), "::batch/%s", names[i]);
+        ASSERT_EQ(unlink(path), 0);
+    }
+    ASSERT_EQ(unlink("::batch/subdir/inner"), 0);
+    ASSERT_EQ(unlink("::batch/subdir"), 0);
+    ASSERT_EQ(unlink("::batch"), 0);
+    END_HELPER;
+}
+
+bool test_stat_batch(void) {
+    BEGIN_TEST;
+
+    char names[kNumFiles][16];
+    ASSERT_TRUE(make_tree(names));
+
+    constexpr size_t kCount = kNumFiles + fbl::count_of(kOddNames);
+    const char* list[kCount];
+    for (size_t i = 0; i < kNumFiles; i++) {
+        list[i] = names[i];
+    }
+    for (size_t i = 0; i < fbl::count_of(kOddNames); i++) {
+        list[kNumFiles + i] = kOddNames[i];
+    }
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<struct stat[]> st(new (&ac) struct stat[kCount]);
+    ASSERT_TRUE(ac.check());
+    int results[kCount];
+
+    int dirfd = open("::batch", O_RDONLY | O_DIRECTORY);
+    ASSERT_GT(dirfd, 0);
+    ASSERT_EQ(fdio_stat_batch(dirfd, list, kCount, st.get(), results), 0);
+
+    for (size_t i = 0; i < kCount; i++) {
+        struct stat expected;
+        int r = fstatat(dirfd, list[i], &expected, 0);
+        if (r < 0) {
+            ASSERT_EQ(results[i], -errno);
+            continue;
+        }
+        ASSERT_EQ(results[i], 0);
+        ASSERT_EQ(st[i].st_mode, expected.st_mode);
+        ASSERT_EQ(st[i].st_ino, expected.st_ino);
+        ASSERT_EQ(st[i].st_size, expected.st_size);
+    }
+    ASSERT_EQ(results[kNumFiles], -ENOENT);
+    ASSERT_EQ(st[1].st_size, 1);
+    ASSERT_TRUE(S_ISDIR(st[kCount - 1].st_mode));
+
+    ASSERT_EQ(close(dirfd), 0);
+    ASSERT_TRUE(remove_tree(names));
+    END_TEST;
+}
+
+bool test_open_batch(void) {
+    BEGIN_TEST;
+
+    char names[kNumFiles][16];
+    ASSERT_TRUE(make_tree(names));
+
+    constexpr size_t kCount = 20 + fbl::count_of(kOddNames);
+    const char* list[kCount];
+    for (size_t i = 0; i < 20; i++) {
+        list[i] = names[i];
+    }
+    for (size_t i = 0; i < fbl::count_of(kOddNames); i++) {
+        list[20 + i] = kOddNames[i];
+    }
+    int fds[kCount];
+
+    int dirfd = open("::batch", O_RDONLY | O_DIRECTORY);
+    ASSERT_GT(dirfd, 0);
+    ASSERT_EQ(fdio_open_batch(dirfd, list, kCount, O_RDONLY, fds), 0);
+
+    for (size_t i = 0; i < 20; i++) {
+        ASSERT_GE(fds[i], 0);
+        struct stat st;
+        ASSERT_EQ(fstat(fds[i], &st), 0);
+        ASSERT_EQ(st.st_size, (off_t)(i % 16));
+        ASSERT_EQ(close(fds[i]), 0);
+    }
+    ASSERT_EQ(fds[20], -ENOENT);
+    for (size_t i = 21; i < kCount; i++) {
+        ASSERT_GE(fds[i], 0);
+        ASSERT_EQ(close(fds[i]), 0);
+    }
+
+    // O_CREAT is refused outright.
+    ASSERT_EQ(fdio_open_batch(dirfd, list, kCount, O_RDWR | O_CREAT, fds), -1);
+    ASSERT_EQ(errno, EINVAL);
+
+    ASSERT_EQ(close(dirfd), 0);
+    ASSERT_TRUE(remove_tree(names));
+    END_TEST;
+}
+
+} // namespace
+
+RUN_FOR_ALL_FILESYSTEMS(batch_tests,
+    RUN_TEST_MEDIUM(test_stat_batch)
+    RUN_TEST_MEDIUM(test_open_batch)
+)
@@ -0,0 +1,134 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fbl/alloc_checker.h>
+#include <fbl/unique_ptr.h>
+#include <fdio/limits.h>
+#include <unittest/unittest.h>
+#include <zircon/syscalls.h>
+
+#include "filesystems.h"
+
+namespace {
+
+// Large enough to need several transfer vmo round trips, and not a multiple
+// of either the transfer or the chunk size.
+constexpr size_t kLargeSize = 3 * FDIO_XFER_SIZE + FDIO_CHUNK_SIZE / 2 + 1;
+
+bool fill_random(uint8_t* buf, size_t len) {
+    BEGIN_HELPER;
+    unsigned int seed = static_cast<unsigned int>(zx_ticks_get());
+    unittest_printf("Large io test using seed: %u\n", seed);
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = static_cast<uint8_t>(rand_r(&seed));
+    }
+    END_HELPER;
+}
+
+// read() and write() larger than a single message, keeping the seek offset.
+bool test_large_read_write(void) {
+    BEGIN_TEST;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<uint8_t[]> wbuf(new (&ac) uint8_t[kLargeSize]);
+    ASSERT_TRUE(ac.check());
+    fbl::unique_ptr<uint8_t[]> rbuf(new (&ac) uint8_t[kLargeSize]);
+    ASSERT_TRUE(ac.check());
+    ASSERT_TRUE(fill_random(wbuf.get(), kLargeSize));
+
+    int fd = open("::large", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(write(fd, wbuf.get(), kLargeSize), (ssize_t)kLargeSize);
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), (off_t)kLargeSize);
+
+    // Small and large reads interleave on the same seek offset.
+    ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(read(fd, rbuf.get(), 1), 1);
+    ASSERT_EQ(read(fd, rbuf.get() + 1, kLargeSize - 2), (ssize_t)(kLargeSize - 2));
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), (off_t)(kLargeSize - 1));
+    ASSERT_EQ(read(fd, rbuf.get() + kLargeSize - 1, 1), 1);
+    ASSERT_EQ(memcmp(rbuf.get(), wbuf.get(), kLargeSize), 0);
+
+    // A large read stops short at the end of the file.
+    ASSERT_EQ(lseek(fd, FDIO_XFER_SIZE, SEEK_SET), FDIO_XFER_SIZE);
+    ASSERT_EQ(read(fd, rbuf.get(), kLargeSize), (ssize_t)(kLargeSize - FDIO_XFER_SIZE));
+    ASSERT_EQ(memcmp(rbuf.get(), wbuf.get() + FDIO_XFER_SIZE, kLargeSize - FDIO_XFER_SIZE), 0);
+    ASSERT_EQ(read(fd, rbuf.get(), kLargeSize), 0);
+
+    ASSERT_EQ(close(fd), 0);
+    ASSERT_EQ(unlink("::large"), 0);
+    END_TEST;
+}
+
+// pread() and pwrite() larger than a single message leave the seek offset alone.
+bool test_large_pread_pwrite(void) {
+    BEGIN_TEST;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<uint8_t[]> wbuf(new (&ac) uint8_t[kLargeSize]);
+    ASSERT_TRUE(ac.check());
+    fbl::unique_ptr<uint8_t[]> rbuf(new (&ac) uint8_t[kLargeSize]);
+    ASSERT_TRUE(ac.check());
+    ASSERT_TRUE(fill_random(wbuf.get(), kLargeSize));
+
+    int fd = open("::large", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GT(fd, 0);
+    constexpr off_t kOffset = FDIO_CHUNK_SIZE + 3;
+    ASSERT_EQ(pwrite(fd, wbuf.get(), kLargeSize, kOffset), (ssize_t)kLargeSize);
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+
+    ASSERT_EQ(pread(fd, rbuf.get(), kLargeSize, kOffset), (ssize_t)kLargeSize);
+    ASSERT_EQ(memcmp(rbuf.get(), wbuf.get(), kLargeSize), 0);
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), 0);
+
+    ASSERT_EQ(close(fd), 0);
+    ASSERT_EQ(unlink("::large"), 0);
+    END_TEST;
+}
+
+// write() larger than a single message to a file opened with O_APPEND.
+bool test_large_append(void) {
+    BEGIN_TEST;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<uint8_t[]> wbuf(new (&ac) uint8_t[kLargeSize]);
+    ASSERT_TRUE(ac.check());
+    fbl::unique_ptr<uint8_t[]> rbuf(new (&ac) uint8_t[kLargeSize]);
+    ASSERT_TRUE(ac.check());
+    ASSERT_TRUE(fill_random(wbuf.get(), kLargeSize));
+
+    int fd = open("::large", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(write(fd, wbuf.get(), 1), 1);
+    ASSERT_EQ(close(fd), 0);
+
+    fd = open("::large", O_RDWR | O_APPEND);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(lseek(fd, 0, SEEK_SET), 0);
+    ASSERT_EQ(write(fd, wbuf.get() + 1, kLargeSize - 1), (ssize_t)(kLargeSize - 1));
+    ASSERT_EQ(lseek(fd, 0, SEEK_CUR), (off_t)kLargeSize);
+
+    ASSERT_EQ(pread(fd, rbuf.get(), kLargeSize, 0), (ssize_t)kLargeSize);
+    ASSERT_EQ(memcmp(rbuf.get(), wbuf.get(), kLargeSize), 0);
+
+    ASSERT_EQ(close(fd), 0);
+    ASSERT_EQ(unlink("::large"), 0);
+    END_TEST;
+}
+
+} // namespace
+
+RUN_FOR_ALL_FILESYSTEMS(large_io_tests,
+    RUN_TEST_MEDIUM(test_large_read_write)
+    RUN_TEST_MEDIUM(test_large_pread_pwrite)
+    RUN_TEST_MEDIUM(test_large_append)
+)
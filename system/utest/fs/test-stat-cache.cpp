@@ -0,0 +1,231 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fdio/io.h>
+#include <fdio/remoteio.h>
+#include <fdio/util.h>
+#include <unittest/unittest.h>
+#include <zircon/device/vfs.h>
+#include <zircon/syscalls.h>
+
+#include "filesystems.h"
+
+namespace {
+
+struct CacheCounts {
+    uint64_t hits;
+    uint64_t misses;
+};
+
+// Counts since the last call, which started at |counts|.
+CacheCounts delta(CacheCounts* counts) {
+    fdio_stat_cache_stats_t stats;
+    fdio_stat_cache_get_stats(&stats);
+    CacheCounts d = {stats.hits - counts->hits, stats.misses - counts->misses};
+    counts->hits = stats.hits;
+    counts->misses = stats.misses;
+    return d;
+}
+
+// Repeated lookups are answered from the cache, and changes made by this
+// process are seen straight away.
+bool test_stat_cache_hits(void) {
+    BEGIN_TEST;
+
+    fdio_stat_cache_enable(ZX_SEC(60));
+    CacheCounts counts = {};
+    delta(&counts);
+
+    struct stat st;
+    ASSERT_EQ(stat("::cached", &st), -1);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_EQ(delta(&counts).misses, 1u);
+    ASSERT_EQ(stat("::cached", &st), -1);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_EQ(open("::cached", O_RDONLY), -1);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_EQ(delta(&counts).hits, 2u);
+
+    int fd = open("::cached", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(stat("::cached", &st), 0);
+    ASSERT_EQ(st.st_size, 0);
+    ASSERT_EQ(stat("::cached", &st), 0);
+    ASSERT_EQ(st.st_size, 0);
+    CacheCounts d = delta(&counts);
+    ASSERT_EQ(d.misses, 1u);
+    ASSERT_EQ(d.hits, 1u);
+
+    ASSERT_EQ(write(fd, "hello", 5), 5);
+    ASSERT_EQ(stat("::cached", &st), 0);
+    ASSERT_EQ(st.st_size, 5);
+    ASSERT_EQ(ftruncate(fd, 2), 0);
+    ASSERT_EQ(stat("::cached", &st), 0);
+    ASSERT_EQ(st.st_size, 2);
+    ASSERT_EQ(close(fd), 0);
+
+    ASSERT_EQ(rename("::cached", "::renamed"), 0);
+    ASSERT_EQ(stat("::cached", &st), -1);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_EQ(stat("::renamed", &st), 0);
+    ASSERT_EQ(unlink("::renamed"), 0);
+    ASSERT_EQ(stat("::renamed", &st), -1);
+    ASSERT_EQ(errno, ENOENT);
+
+    fdio_stat_cache_enable(0);
+    END_TEST;
+}
+
+// Entries expire after the ttl, and nothing is cached once the cache is
+// turned off.
+bool test_stat_cache_expiry(void) {
+    BEGIN_TEST;
+
+    fdio_stat_cache_enable(ZX_MSEC(1));
+    CacheCounts counts = {};
+    delta(&counts);
+
+    struct stat st;
+    ASSERT_EQ(stat("::expiring", &st), -1);
+    zx_nanosleep(zx_deadline_after(ZX_MSEC(10)));
+    ASSERT_EQ(stat("::expiring", &st), -1);
+    CacheCounts d = delta(&counts);
+    ASSERT_EQ(d.misses, 2u);
+    ASSERT_EQ(d.hits, 0u);
+
+    fdio_stat_cache_enable(0);
+    ASSERT_EQ(stat("::expiring", &st), -1);
+    ASSERT_EQ(stat("::expiring", &st), -1);
+    d = delta(&counts);
+    ASSERT_EQ(d.misses, 0u);
+    ASSERT_EQ(d.hits, 0u);
+    END_TEST;
+}
+
+// The requests below go straight to the server over |dir|, a remoteio
+// channel, so that this process's fdio layer never hears of the changes
+// and only the stat cache's watchers can.
+zx_status_t raw_create(zx_handle_t dir, const char* name) {
+    zxrio_msg_t msg;
+    memset(&msg, 0, ZXRIO_HDR_SZ);
+    msg.op = ZXRIO_OPEN;
+    msg.datalen = static_cast<uint32_t>(strlen(name));
+    msg.arg = ZX_FS_RIGHT_READABLE | ZX_FS_FLAG_CREATE | ZX_FS_FLAG_EXCLUSIVE |
+              ZX_FS_FLAG_DESCRIBE;
+    msg.arg2.mode = 0644;
+    msg.hcount = 1;
+    memcpy(msg.data, name, msg.datalen);
+
+    zx_handle_t h, srv;
+    zx_status_t status = zx_channel_create(0, &h, &srv);
+    if (status != ZX_OK) {
+        return status;
+    }
+    if ((status = zx_channel_write(dir, 0, &msg, ZXRIO_HDR_SZ + msg.datalen,
+                                   &srv, 1)) != ZX_OK) {
+        zx_handle_close(h);
+        return status;
+    }
+    zxrio_describe_t info;
+    zx_handle_t extra;
+    uint32_t actual, hcount;
+    if (((status = zx_object_wait_one(h, ZX_CHANNEL_READABLE, ZX_TIME_INFINITE,
+                                      nullptr)) == ZX_OK) &&
+        ((status = zx_channel_read(h, 0, &info, &extra, sizeof(info), 1,
+                                   &actual, &hcount)) == ZX_OK)) {
+        status = (actual < sizeof(info)) ? ZX_ERR_IO : info.status;
+        if (hcount > 0) {
+            zx_handle_close(extra);
+        }
+    }
+    zx_handle_close(h);
+    return status;
+}
+
+zx_status_t raw_unlink(zx_handle_t dir, const char* name) {
+    zxrio_msg_t msg;
+    memset(&msg, 0, ZXRIO_HDR_SZ);
+    msg.op = ZXRIO_UNLINK;
+    msg.datalen = static_cast<uint32_t>(strlen(name));
+    memcpy(msg.data, name, msg.datalen);
+
+    zx_channel_call_args_t args = {};
+    args.wr_bytes = &msg;
+    args.wr_num_bytes = ZXRIO_HDR_SZ + msg.datalen;
+    args.rd_bytes = &msg;
+    args.rd_num_bytes = sizeof(msg);
+    uint32_t actual, hcount;
+    zx_status_t rs;
+    zx_status_t status = zx_channel_call(dir, 0, ZX_TIME_INFINITE, &args,
+                                         &actual, &hcount, &rs);
+    if (status == ZX_ERR_CALL_FAILED) {
+        return rs;
+    }
+    return (status != ZX_OK) ? status : msg.arg;
+}
+
+// Names added or removed behind this process's back are noticed through
+// the watcher on their directory, before the entries expire.
+bool test_stat_cache_watcher(void) {
+    BEGIN_TEST;
+
+    int fd = open("::present", O_RDWR | O_CREAT | O_EXCL, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(close(fd), 0);
+    int dirfd = open("::", O_RDONLY | O_DIRECTORY);
+    ASSERT_GT(dirfd, 0);
+    zx_handle_t handles[FDIO_MAX_HANDLES];
+    uint32_t types[FDIO_MAX_HANDLES];
+    zx_status_t count = fdio_clone_fd(dirfd, 0, handles, types);
+    ASSERT_GT(count, 0);
+    ASSERT_EQ(close(dirfd), 0);
+    zx_handle_t dir = handles[0];
+    for (zx_status_t i = 1; i < count; i++) {
+        zx_handle_close(handles[i]);
+    }
+
+    fdio_stat_cache_enable(ZX_SEC(60));
+    CacheCounts counts = {};
+    delta(&counts);
+
+    struct stat st;
+    ASSERT_EQ(stat("::present", &st), 0);
+    ASSERT_EQ(stat("::absent", &st), -1);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_EQ(stat("::present", &st), 0);
+    ASSERT_EQ(stat("::absent", &st), -1);
+    CacheCounts d = delta(&counts);
+    ASSERT_EQ(d.misses, 2u);
+    ASSERT_EQ(d.hits, 2u);
+
+    ASSERT_EQ(raw_unlink(dir, "present"), ZX_OK);
+    ASSERT_EQ(raw_create(dir, "absent"), ZX_OK);
+
+    ASSERT_EQ(stat("::present", &st), -1);
+    ASSERT_EQ(errno, ENOENT);
+    ASSERT_EQ(stat("::absent", &st), 0);
+    d = delta(&counts);
+    ASSERT_EQ(d.misses, 2u);
+    ASSERT_EQ(d.hits, 0u);
+
+    fdio_stat_cache_enable(0);
+    ASSERT_EQ(zx_handle_close(dir), ZX_OK);
+    ASSERT_EQ(unlink("::absent"), 0);
+    END_TEST;
+}
+
+} // namespace
+
+RUN_FOR_ALL_FILESYSTEMS(stat_cache_tests,
+    RUN_TEST_MEDIUM(test_stat_cache_hits)
+    RUN_TEST_MEDIUM(test_stat_cache_expiry)
+    RUN_TEST_MEDIUM(test_stat_cache_watcher)
+)
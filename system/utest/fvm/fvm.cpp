@@ -1584,6 +1584,99 @@ static bool TestSliceAccessNonContiguousPhysical(void) {
     END_TEST;
 }
 
+// Test that defragmenting a partition whose slices were interleaved with
+// another partition preserves the contents of both partitions.
+static bool TestVPartitionDefrag(void) {
+    BEGIN_TEST;
+    char ramdisk_path[PATH_MAX];
+    char fvm_driver[PATH_MAX];
+    constexpr uint64_t kBlkSize = 512;
+    constexpr uint64_t kBlkCount = 1 << 17;
+    constexpr uint64_t kSliceSize = 1 << 20;
+    ASSERT_EQ(StartFVMTest(kBlkSize, kBlkCount, kSliceSize, ramdisk_path,
+                           fvm_driver), 0, "error mounting FVM");
+
+    int fd = open(fvm_driver, O_RDWR);
+    ASSERT_GT(fd, 0);
+    fvm_info_t fvm_info;
+    ASSERT_GT(ioctl_block_fvm_query(fd, &fvm_info), 0);
+    size_t slice_size = fvm_info.slice_size;
+
+    alloc_req_t request;
+    memset(&request, 0, sizeof(request));
+    request.slice_count = 1;
+    memcpy(request.guid, kTestUniqueGUID, GUID_LEN);
+    strcpy(request.name, kTestPartName1);
+    memcpy(request.type, kTestPartGUIDData, GUID_LEN);
+    int data_fd = fvm_allocate_partition(fd, &request);
+    ASSERT_GT(data_fd, 0);
+
+    memcpy(request.guid, kTestUniqueGUID2, GUID_LEN);
+    strcpy(request.name, kTestPartName2);
+    memcpy(request.type, kTestPartGUIDBlob, GUID_LEN);
+    int blob_fd = fvm_allocate_partition(fd, &request);
+    ASSERT_GT(blob_fd, 0);
+
+    // Grow both partitions one slice at a time, so their physical slices
+    // are interleaved.
+    constexpr size_t kSliceCount = 8;
+    for (size_t i = 1; i < kSliceCount; i++) {
+        extend_request_t erequest;
+        erequest.offset = i;
+        erequest.length = 1;
+        ASSERT_EQ(ioctl_block_fvm_extend(data_fd, &erequest), 0);
+        ASSERT_EQ(ioctl_block_fvm_extend(blob_fd, &erequest), 0);
+    }
+
+    // Give every slice a distinct color.
+    for (size_t i = 0; i < kSliceCount; i++) {
+        ASSERT_TRUE(CheckWriteColor(data_fd, slice_size * i, slice_size,
+                                    static_cast<uint8_t>(i)));
+        ASSERT_TRUE(CheckWriteColor(blob_fd, slice_size * i, slice_size,
+                                    static_cast<uint8_t>(0x80 + i)));
+    }
+
+    ASSERT_EQ(ioctl_block_fvm_defrag(data_fd), 0);
+    // Defragmenting an already contiguous partition is a no-op.
+    ASSERT_EQ(ioctl_block_fvm_defrag(data_fd), 0);
+
+    for (size_t i = 0; i < kSliceCount; i++) {
+        ASSERT_TRUE(CheckReadColor(data_fd, slice_size * i, slice_size,
+                                   static_cast<uint8_t>(i)));
+        ASSERT_TRUE(CheckReadColor(blob_fd, slice_size * i, slice_size,
+                                   static_cast<uint8_t>(0x80 + i)));
+    }
+    // Reads spanning every slice of the partition still succeed.
+    ASSERT_TRUE(CheckWriteReadBlock(data_fd, 0, (slice_size / kBlkSize) * kSliceCount));
+    ASSERT_EQ(close(data_fd), 0);
+
+    // Check that the migration persists after rebinding the driver.
+    const partition_entry_t entries[] = {
+        {kTestPartName1, 1},
+        {kTestPartName2, 2},
+    };
+    ASSERT_EQ(close(blob_fd), 0);
+    fd = FVMRebind(fd, ramdisk_path, entries, 2);
+    ASSERT_GT(fd, 0, "Failed to rebind FVM driver");
+    blob_fd = open_partition(kTestUniqueGUID2, kTestPartGUIDBlob, 0, nullptr);
+    ASSERT_GT(blob_fd, 0, "Couldn't re-open Blob VPart");
+    for (size_t i = 0; i < kSliceCount; i++) {
+        ASSERT_TRUE(CheckReadColor(blob_fd, slice_size * i, slice_size,
+                                   static_cast<uint8_t>(0x80 + i)));
+    }
+    ASSERT_EQ(ioctl_block_fvm_defrag(blob_fd), 0);
+    for (size_t i = 0; i < kSliceCount; i++) {
+        ASSERT_TRUE(CheckReadColor(blob_fd, slice_size * i, slice_size,
+                                   static_cast<uint8_t>(0x80 + i)));
+    }
+    ASSERT_EQ(close(blob_fd), 0);
+
+    ASSERT_EQ(close(fd), 0);
+    ASSERT_EQ(FVMCheck(fvm_driver, slice_size), 0);
+    ASSERT_EQ(EndFVMTest(ramdisk_path), 0, "unmounting FVM");
+    END_TEST;
+}
+
 // Test allocating and accessing slices which are
 // allocated noncontiguously from the client's perspective.
 static bool TestSliceAccessNonContiguousVirtual(void) {
@@ -2777,6 +2870,7 @@ RUN_TEST_MEDIUM(TestSliceAccessContiguous)
 RUN_TEST_MEDIUM(TestSliceAccessMany)
 RUN_TEST_MEDIUM(TestSliceAccessNonContiguousPhysical)
 RUN_TEST_MEDIUM(TestSliceAccessNonContiguousVirtual)
+RUN_TEST_MEDIUM(TestVPartitionDefrag)
 RUN_TEST_MEDIUM(TestPersistenceSimple)
 RUN_TEST_LARGE(TestVPartitionUpgrade)
 RUN_TEST_LARGE(TestMounting)
@@ -125,9 +125,46 @@ static bool argument_size_test(void) {
     return ok;
 }
 
+static bool elf_cache_test(void) {
+    BEGIN_TEST;
+
+    launchpad_elf_cache_t* cache;
+    ASSERT_EQ(launchpad_elf_cache_create_from_file("/boot/bin/sh", &cache),
+              ZX_OK, "");
+
+    // Several processes from one ELF cache each get their own clones of
+    // the writable segments, so all of them must start and run normally.
+    for (int i = 0; i < 3; ++i) {
+        launchpad_t* lp;
+        ASSERT_EQ(launchpad_create(ZX_HANDLE_INVALID, "elf cache test", &lp),
+                  ZX_OK, "");
+        const char* const argv[] = { "/boot/bin/sh", "-c", "x=1; exit 0" };
+        EXPECT_EQ(launchpad_set_args(lp, countof(argv), argv), ZX_OK, "");
+        EXPECT_EQ(launchpad_load_from_elf_cache(lp, cache), ZX_OK, "");
+
+        zx_handle_t proc = ZX_HANDLE_INVALID;
+        const char* errmsg = "???";
+        ASSERT_EQ(launchpad_go(lp, &proc, &errmsg), ZX_OK, errmsg);
+
+        EXPECT_EQ(zx_object_wait_one(proc, ZX_PROCESS_TERMINATED,
+                                     ZX_TIME_INFINITE, NULL), ZX_OK, "");
+        zx_info_process_t info;
+        EXPECT_EQ(zx_object_get_info(proc, ZX_INFO_PROCESS,
+                                     &info, sizeof(info), NULL, NULL), ZX_OK, "");
+        EXPECT_EQ(zx_handle_close(proc), ZX_OK, "");
+
+        EXPECT_EQ(info.return_code, 0, "shell exit status");
+    }
+
+    launchpad_elf_cache_destroy(cache);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(launchpad_tests)
 RUN_TEST(launchpad_test);
 RUN_TEST(argument_size_test);
+RUN_TEST(elf_cache_test);
 END_TEST_CASE(launchpad_tests)
 
 int main(int argc, char **argv)
@@ -0,0 +1,22 @@
+# Copyright 2017 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := usertest
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/string.c
+
+MODULE_NAME := string-test
+
+# Keep the compiler from turning the reference loops back into calls to
+# the very functions they check.
+MODULE_CFLAGS += -fno-builtin
+
+MODULE_LIBS := system/ulib/unittest system/ulib/fdio system/ulib/c
+
+include make/module.mk
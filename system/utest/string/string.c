@@ -0,0 +1,197 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Checks libc's vectorized string routines against simple byte-at-a-time
+// versions on random inputs.  Every input is placed at a random alignment,
+// and often right up against an inaccessible page, so a routine that reads
+// past a page boundary it should not cross will fault.
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <unittest/unittest.h>
+#include <zircon/syscalls.h>
+
+#define ITERATIONS 100000
+#define MAX_LEN 1024
+
+static size_t ref_strlen(const char* s) {
+    size_t n = 0;
+    while (s[n])
+        ++n;
+    return n;
+}
+
+static char* ref_strchrnul(const char* s, int c) {
+    while (*s && *(const unsigned char*)s != (unsigned char)c)
+        ++s;
+    return (char*)s;
+}
+
+static char* ref_strchr(const char* s, int c) {
+    char* p = ref_strchrnul(s, c);
+    return *(unsigned char*)p == (unsigned char)c ? p : NULL;
+}
+
+static int ref_strcmp(const char* vl, const char* vr) {
+    const unsigned char* l = (const void*)vl;
+    const unsigned char* r = (const void*)vr;
+    while (*l && *l == *r) {
+        ++l;
+        ++r;
+    }
+    return *l - *r;
+}
+
+static void* ref_memchr(const void* src, int c, size_t n) {
+    const unsigned char* s = src;
+    for (size_t i = 0; i < n; ++i)
+        if (s[i] == (unsigned char)c)
+            return (void*)(s + i);
+    return NULL;
+}
+
+static void* ref_memrchr(const void* src, int c, size_t n) {
+    const unsigned char* s = src;
+    while (n--)
+        if (s[n] == (unsigned char)c)
+            return (void*)(s + n);
+    return NULL;
+}
+
+static int ref_memcmp(const void* vl, const void* vr, size_t n) {
+    const unsigned char* l = vl;
+    const unsigned char* r = vr;
+    for (size_t i = 0; i < n; ++i)
+        if (l[i] != r[i])
+            return l[i] - r[i];
+    return 0;
+}
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+// Two buffers of MAX_LEN + 1 usable bytes, each followed by a page
+// mapped with no access.
+typedef struct {
+    size_t page_size;
+    size_t size;
+    unsigned char* mapping;
+    unsigned char* left;
+    unsigned char* right;
+} guarded_buffers_t;
+
+static bool guarded_buffers_init(guarded_buffers_t* bufs) {
+    BEGIN_HELPER;
+    bufs->page_size = sysconf(_SC_PAGESIZE);
+    size_t span = (MAX_LEN + 1 + bufs->page_size - 1) & -bufs->page_size;
+    bufs->size = 2 * (span + bufs->page_size);
+    bufs->mapping = mmap(NULL, bufs->size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT_NE(bufs->mapping, MAP_FAILED, "mmap");
+    bufs->left = bufs->mapping;
+    bufs->right = bufs->mapping + span + bufs->page_size;
+    ASSERT_EQ(mprotect(bufs->left + span, bufs->page_size, PROT_NONE), 0,
+              "mprotect");
+    ASSERT_EQ(mprotect(bufs->right + span, bufs->page_size, PROT_NONE), 0,
+              "mprotect");
+    // From now on, the buffers are the last MAX_LEN + 1 bytes before each
+    // guard page.
+    bufs->left += span - (MAX_LEN + 1);
+    bufs->right += span - (MAX_LEN + 1);
+    END_HELPER;
+}
+
+// Returns where to put |len| bytes plus a terminator in |buf|: either
+// right against the guard page or at a random offset before it.
+static unsigned char* place(unsigned char* buf, size_t len, unsigned int* seed) {
+    size_t room = MAX_LEN - len;
+    if (rand_r(seed) % 2)
+        return buf + room;
+    return buf + rand_r(seed) % (room + 1);
+}
+
+// Fills |s| with |len| bytes from a small alphabet, so that searches and
+// comparisons both hit and miss often, and NUL-terminates it.
+static void fill(unsigned char* s, size_t len, unsigned int* seed) {
+    unsigned int alphabet = 1 + rand_r(seed) % 4;
+    for (size_t i = 0; i < len; ++i)
+        s[i] = 'a' + rand_r(seed) % alphabet;
+    s[len] = '\0';
+}
+
+static size_t random_length(unsigned int* seed) {
+    // Mostly short strings, where the alignment handling matters most.
+    if (rand_r(seed) % 8 == 0)
+        return rand_r(seed) % (MAX_LEN + 1);
+    return rand_r(seed) % 100;
+}
+
+static int random_char(unsigned int* seed) {
+    // Sometimes NUL, sometimes a value that only matches as unsigned char.
+    switch (rand_r(seed) % 16) {
+    case 0:
+        return '\0';
+    case 1:
+        return 0x100 + 'a';
+    default:
+        return 'a' + rand_r(seed) % 5;
+    }
+}
+
+static bool string_fuzz_test(void) {
+    BEGIN_TEST;
+
+    guarded_buffers_t bufs;
+    ASSERT_TRUE(guarded_buffers_init(&bufs), "");
+
+    unsigned int seed = (unsigned int)zx_ticks_get();
+    unittest_printf("random seed %u\n", seed);
+
+    for (int i = 0; i < ITERATIONS; ++i) {
+        size_t len = random_length(&seed);
+        char* l = (char*)place(bufs.left, len, &seed);
+        char* r = (char*)place(bufs.right, len, &seed);
+        fill((unsigned char*)l, len, &seed);
+        memmove(r, l, len + 1);
+        // Make the strings differ, or end early, some of the time.
+        if (len > 0 && rand_r(&seed) % 2)
+            r[rand_r(&seed) % len] = 'a' + rand_r(&seed) % 5;
+        if (rand_r(&seed) % 4 == 0)
+            r[rand_r(&seed) % (len + 1)] = '\0';
+        size_t n = rand_r(&seed) % (len + 2);
+        int c = random_char(&seed);
+
+        ASSERT_EQ(strlen(l), ref_strlen(l), "strlen");
+        ASSERT_EQ(strchr(l, c), ref_strchr(l, c), "strchr");
+        ASSERT_EQ(strchrnul(l, c), ref_strchrnul(l, c), "strchrnul");
+        ASSERT_EQ(sign(strcmp(l, r)), sign(ref_strcmp(l, r)), "strcmp");
+        ASSERT_EQ(memchr(l, c, n), ref_memchr(l, c, n), "memchr");
+        ASSERT_EQ(memrchr(l, c, n), ref_memrchr(l, c, n), "memrchr");
+        ASSERT_EQ(sign(memcmp(l, r, n)), sign(ref_memcmp(l, r, n)), "memcmp");
+
+        // A length far past the end is fine as long as there is a match.
+        void* found = ref_memchr(l, c, len + 1);
+        if (found != NULL)
+            ASSERT_EQ(memchr(l, c, SIZE_MAX), found, "memchr with huge length");
+    }
+
+    munmap(bufs.mapping, bufs.size);
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(string_tests)
+RUN_TEST(string_fuzz_test)
+END_TEST_CASE(string_tests)
+
+int main(int argc, char** argv) {
+    return unittest_run_all_tests(argc, argv) ? 0 : -1;
+}
@@ -3,7 +3,9 @@
 // found in the LICENSE file.
 
 #include <elfload/elfload.h>
+#include <inttypes.h>
 #include <limits.h>
+#include <stdio.h>
 #include <zircon/process.h>
 #include <zircon/processargs.h>
 #include <zircon/syscalls.h>
@@ -180,10 +182,72 @@ bool vdso_map_code_wrong_test() {
     END_TEST;
 }
 
+// zx_time_get() may compute the time in the vDSO; it must agree with the
+// kernel's idea of the time, as used for deadlines.
+bool vdso_time_get_test() {
+    BEGIN_TEST;
+
+    for (int i = 0; i < 100; ++i) {
+        zx_time_t deadline = zx_time_get(ZX_CLOCK_MONOTONIC) + ZX_USEC(100);
+        ASSERT_EQ(zx_nanosleep(deadline), ZX_OK, "zx_nanosleep");
+        EXPECT_GE(zx_time_get(ZX_CLOCK_MONOTONIC), deadline,
+                  "monotonic time before an expired deadline");
+    }
+
+    zx_time_t last = zx_time_get(ZX_CLOCK_MONOTONIC);
+    for (int i = 0; i < 100000; ++i) {
+        zx_time_t now = zx_time_get(ZX_CLOCK_MONOTONIC);
+        ASSERT_GE(now, last, "monotonic time went backwards");
+        last = now;
+    }
+
+    // Nothing adjusts the UTC clock while we run, so its offset from the
+    // monotonic clock only moves by the time between the two reads.
+    zx_time_t mono = zx_time_get(ZX_CLOCK_MONOTONIC);
+    zx_time_t utc = zx_time_get(ZX_CLOCK_UTC);
+    zx_time_t mono_after = zx_time_get(ZX_CLOCK_MONOTONIC);
+    zx_time_t utc_after = zx_time_get(ZX_CLOCK_UTC);
+    EXPECT_GE(utc_after - utc + ZX_MSEC(1), mono_after - mono, "UTC drifted");
+    EXPECT_LE(utc_after - utc, mono_after - mono + ZX_MSEC(1), "UTC drifted");
+
+    EXPECT_EQ(zx_time_get(UINT32_MAX), 0u, "invalid clock id");
+
+    END_TEST;
+}
+
+// Not a pass/fail test: reports the cost of reading each clock.
+bool vdso_time_get_benchmark() {
+    BEGIN_TEST;
+
+    static const int kIterations = 1000000;
+    static const struct {
+        uint32_t clock_id;
+        const char* name;
+    } clocks[] = {
+        {ZX_CLOCK_MONOTONIC, "ZX_CLOCK_MONOTONIC"},
+        {ZX_CLOCK_UTC, "ZX_CLOCK_UTC"},
+        {ZX_CLOCK_THREAD, "ZX_CLOCK_THREAD"},
+    };
+
+    for (const auto& clock : clocks) {
+        zx_time_t start = zx_time_get(ZX_CLOCK_MONOTONIC);
+        for (int i = 0; i < kIterations; ++i)
+            zx_time_get(clock.clock_id);
+        zx_time_t elapsed = zx_time_get(ZX_CLOCK_MONOTONIC) - start;
+        printf("\nzx_time_get(%s): %" PRIu64 " ns per call", clock.name,
+               elapsed / kIterations);
+    }
+    printf("\n");
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(vdso_tests)
 RUN_TEST(vdso_map_twice_test);
 RUN_TEST(vdso_map_code_wrong_test);
 RUN_TEST(vdso_map_change_test);
+RUN_TEST(vdso_time_get_test);
+RUN_TEST(vdso_time_get_benchmark);
 END_TEST_CASE(vdso_tests)
 
 int main(int argc, char** argv) {
@@ -0,0 +1,12 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "libc.h"
+#include <zircon/compiler.h>
+
+// Every AArch64 CPU has NEON, which is all the string routines use, so
+// there is nothing to detect yet.
+__NO_SAFESTACK NO_ASAN static inline void __init_hwcap(void) {}
@@ -0,0 +1,37 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "libc.h"
+#include <zircon/compiler.h>
+#include <cpuid.h>
+#include <stdint.h>
+
+// Bits in __hwcap.  Zircon passes no AT_HWCAP, so these are computed
+// with CPUID by __init_hwcap, below.
+#define HWCAP_X86_AVX2 (1 << 0)
+
+// This runs at the very start of the dynamic linker's startup, before
+// relocation, so it must only touch hidden data.  Until it has run,
+// __hwcap is zero and everything uses the baseline (SSE2) code.
+__NO_SAFESTACK NO_ASAN static inline void __init_hwcap(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return;
+
+    // AVX2 needs the OS to save the YMM state as well as the CPU to
+    // have it, which is what OSXSAVE and XCR0 tell us.
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX))
+        return;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (ebx & bit_AVX2)
+        __hwcap |= HWCAP_X86_AVX2;
+}
@@ -1,5 +1,6 @@
 #define _GNU_SOURCE
 #include "dynlink.h"
+#include "hwcap.h"
 #include "libc.h"
 #include "asan_impl.h"
 #include "zircon_impl.h"
@@ -40,7 +41,9 @@ static void early_init(void);
 static void error(const char*, ...);
 static void debugmsg(const char*, ...);
 static void log_write(const void* buf, size_t len);
-static zx_status_t get_library_vmo(const char* name, zx_handle_t* vmo);
+struct prelinked;
+static zx_status_t get_library_vmo(const char* name, zx_handle_t* vmo,
+                                   struct prelinked* prelinked);
 static void loader_svc_config(const char* config);
 
 #define MAXP2(a, b) (-(-(a) & -(b)))
@@ -75,6 +78,7 @@ struct dso {
     size_t map_len;
     signed char global;
     char relocated;
+    char prelinked;
     char constructed;
     struct dso **deps, *needed_by;
     struct tls_module tls;
@@ -97,6 +101,13 @@ struct symdef {
     struct dso* dso;
 };
 
+// A copy of a library with its relative relocations already applied
+// for the load bias |bias|, from LOADER_SVC_OP_LOAD_PRELINKED.
+struct prelinked {
+    zx_handle_t vmo;
+    uintptr_t bias;
+};
+
 union gnu_note_name {
     char name[sizeof("GNU")];
     uint32_t word;
@@ -133,6 +144,10 @@ static bool log_libs = false;
 static atomic_uintptr_t unlogged_tail;
 
 static zx_handle_t loader_svc = ZX_HANDLE_INVALID;
+// Set when the loader service does not support LOADER_SVC_OP_LOAD_OBJECTS.
+static bool loader_svc_no_batch;
+// Set when it does not support LOADER_SVC_OP_LOAD_PRELINKED.
+static bool loader_svc_no_prelink;
 static zx_handle_t logger = ZX_HANDLE_INVALID;
 
 // Various tools use this value to bootstrap their knowledge of the process.
@@ -432,6 +447,9 @@ __NO_SAFESTACK NO_ASAN static void do_relocs(struct dso* dso, size_t* rel,
             reuse_addends = 1;
         skip_relative = 1;
     }
+    // The loader service already applied these.
+    if (dso->prelinked)
+        skip_relative = 1;
 
     for (; rel_size; rel += stride, rel_size -= stride * sizeof(size_t)) {
         if (skip_relative && R_TYPE(rel[1]) == REL_RELATIVE)
@@ -674,8 +692,29 @@ __NO_SAFESTACK void _dl_log_unlogged(void) {
     }
 }
 
-__NO_SAFESTACK NO_ASAN static zx_status_t map_library(zx_handle_t vmo,
-                                                      struct dso* dso) {
+// Reserves |len| bytes at |addr| for a prelinked library.
+__NO_SAFESTACK static zx_status_t allocate_prelinked(uintptr_t addr,
+                                                    size_t len,
+                                                    uint32_t flags,
+                                                    zx_handle_t* vmar,
+                                                    uintptr_t* vmar_base) {
+    static zx_info_vmar_t root_info;
+    if (root_info.len == 0) {
+        zx_status_t status = _zx_object_get_info(
+            __zircon_vmar_root_self, ZX_INFO_VMAR,
+            &root_info, sizeof(root_info), NULL, NULL);
+        if (status != ZX_OK)
+            return status;
+    }
+    if (addr < root_info.base)
+        return ZX_ERR_NO_MEMORY;
+    return _zx_vmar_allocate(__zircon_vmar_root_self,
+                             addr - root_info.base, len,
+                             flags | ZX_VM_FLAG_SPECIFIC, vmar, vmar_base);
+}
+
+__NO_SAFESTACK NO_ASAN static zx_status_t map_library(
+    zx_handle_t vmo, const struct prelinked* prelinked, struct dso* dso) {
     struct {
         Ehdr ehdr;
         // A typical ELF file has 7 or 8 phdrs, so in practice
@@ -761,13 +800,24 @@ __NO_SAFESTACK NO_ASAN static zx_status_t map_library(zx_handle_t vmo,
     // Allocate a VMAR to reserve the whole address range.  Stash
     // the new VMAR's handle until relocation has finished, because
     // we need it to adjust page protections for RELRO.
+    // A prelinked library goes where the loader service relocated it,
+    // if that space is free; otherwise it is relocated as usual.
+    const uint32_t vmar_flags = ZX_VM_FLAG_CAN_MAP_READ |
+                                ZX_VM_FLAG_CAN_MAP_WRITE |
+                                ZX_VM_FLAG_CAN_MAP_EXECUTE |
+                                ZX_VM_FLAG_CAN_MAP_SPECIFIC;
     uintptr_t vmar_base;
-    status = _zx_vmar_allocate(__zircon_vmar_root_self, 0, map_len,
-                               ZX_VM_FLAG_CAN_MAP_READ |
-                                   ZX_VM_FLAG_CAN_MAP_WRITE |
-                                   ZX_VM_FLAG_CAN_MAP_EXECUTE |
-                                   ZX_VM_FLAG_CAN_MAP_SPECIFIC,
-                               &dso->vmar, &vmar_base);
+    zx_handle_t data_vmo = vmo;
+    if (prelinked != NULL && prelinked->vmo != ZX_HANDLE_INVALID &&
+        allocate_prelinked(prelinked->bias + addr_min, map_len, vmar_flags,
+                           &dso->vmar, &vmar_base) == ZX_OK) {
+        dso->prelinked = 1;
+        data_vmo = prelinked->vmo;
+        status = ZX_OK;
+    } else {
+        status = _zx_vmar_allocate(__zircon_vmar_root_self, 0, map_len,
+                                   vmar_flags, &dso->vmar, &vmar_base);
+    }
     if (status != ZX_OK) {
         error("failed to reserve %zu bytes of address space: %d\n",
               map_len, status);
@@ -828,7 +878,7 @@ __NO_SAFESTACK NO_ASAN static zx_status_t map_library(zx_handle_t vmo,
                 }
             } else {
                 // Get a writable (lazy) copy of the portion of the file VMO.
-                status = _zx_vmo_clone(vmo, ZX_VMO_CLONE_COPY_ON_WRITE,
+                status = _zx_vmo_clone(data_vmo, ZX_VMO_CLONE_COPY_ON_WRITE,
                                        off_start, data_size, &map_vmo);
                 if (status == ZX_OK && map_size > data_size) {
                     // Extend the writable VMO to cover the .bss pages too.
@@ -946,6 +996,25 @@ __NO_SAFESTACK static struct dso* find_library_in(struct dso* p,
     return p;
 }
 
+__NO_SAFESTACK static bool library_known_in(struct dso* p,
+                                            const char* name) {
+    for (; p != NULL; p = dso_next(p)) {
+        if (!strcmp(p->l_map.l_name, name) ||
+            (p->soname != NULL && !strcmp(p->soname, name)))
+            return true;
+    }
+    return false;
+}
+
+static void prefetch_library_vmos(struct dso* p);
+static void prefetch_discard(void);
+
+// Like find_library, but leaves the lists and reference counts alone.
+__NO_SAFESTACK static bool library_known(const char* name) {
+    return library_known_in(head, name) ||
+        library_known_in(detached_head, name);
+}
+
 __NO_SAFESTACK static struct dso* find_library(const char* name) {
     // First see if it's in the general list.
     struct dso* p = find_library_in(head, name);
@@ -1116,6 +1185,7 @@ __NO_SAFESTACK static void do_tls_layout(struct dso* p,
 }
 
 __NO_SAFESTACK static zx_status_t load_library_vmo(zx_handle_t vmo,
+                                                   const struct prelinked* prelinked,
                                                    const char* name,
                                                    int rtld_mode,
                                                    struct dso* needed_by,
@@ -1129,7 +1199,7 @@ __NO_SAFESTACK static zx_status_t load_library_vmo(zx_handle_t vmo,
         return ZX_OK;
     }
 
-    zx_status_t status = map_library(vmo, &temp_dso);
+    zx_status_t status = map_library(vmo, prelinked, &temp_dso);
     if (status != ZX_OK)
         return status;
 
@@ -1229,17 +1299,30 @@ __NO_SAFESTACK static zx_status_t load_library(const char* name, int rtld_mode,
         return ZX_OK;
 
     zx_handle_t vmo;
-    zx_status_t status = get_library_vmo(name, &vmo);
+    struct prelinked prelinked;
+    zx_status_t status = get_library_vmo(name, &vmo, &prelinked);
     if (status == ZX_OK) {
-        status = load_library_vmo(vmo, name, rtld_mode, needed_by, loaded);
+        status = load_library_vmo(vmo, &prelinked, name, rtld_mode,
+                                  needed_by, loaded);
         _zx_handle_close(vmo);
+        if (prelinked.vmo != ZX_HANDLE_INVALID)
+            _zx_handle_close(prelinked.vmo);
     }
 
     return status;
 }
 
 __NO_SAFESTACK static void load_deps(struct dso* p) {
+    // Anything left over from a load that failed.
+    prefetch_discard();
+    struct dso* prefetched = NULL;
     for (; p; p = dso_next(p)) {
+        // Ask for everything needed by this and the following
+        // modules at once, the first time we reach any of them.
+        if (prefetched == NULL || p == dso_next(prefetched)) {
+            prefetch_library_vmos(p);
+            prefetched = tail;
+        }
         struct dso** deps = NULL;
         // The two preallocated DSOs don't get space allocated for ->deps.
         if (runtime && p->deps == NULL && p != &ldso && p != &vdso)
@@ -1260,6 +1343,7 @@ __NO_SAFESTACK static void load_deps(struct dso* p) {
             }
         }
     }
+    prefetch_discard();
 }
 
 __NO_SAFESTACK static void load_preload(char* s) {
@@ -1497,6 +1581,8 @@ static dl_start_return_t __dls3(void* start_arg);
 __NO_SAFESTACK NO_ASAN __attribute__((__visibility__("hidden")))
 dl_start_return_t __dls2(
     void* start_arg, void* vdso_map) {
+    __init_hwcap();
+
     ldso.l_map.l_addr = (uintptr_t)__ehdr_start;
 
     Ehdr* ehdr = (void*)ldso.l_map.l_addr;
@@ -1603,7 +1689,7 @@ __NO_SAFESTACK static void* dls3(zx_handle_t exec_vmo, int argc, char** argv) {
             trace_maps = true;
     }
 
-    zx_status_t status = map_library(exec_vmo, &app);
+    zx_status_t status = map_library(exec_vmo, NULL, &app);
     _zx_handle_close(exec_vmo);
     if (status != ZX_OK) {
         debugmsg("%s: %s: Not a valid dynamic program (%s)\n",
@@ -1884,7 +1970,7 @@ static void* dlopen_internal(zx_handle_t vmo, const char* file, int mode) {
 
     struct dso* p;
     zx_status_t status = (vmo != ZX_HANDLE_INVALID ?
-                          load_library_vmo(vmo, file, mode, head, &p) :
+                          load_library_vmo(vmo, NULL, file, mode, head, &p) :
                           load_library(file, mode, head, &p));
 
     if (status != ZX_OK) {
@@ -1995,6 +2081,8 @@ zx_handle_t dl_set_loader_service(zx_handle_t new_svc) {
     pthread_rwlock_wrlock(&lock);
     old_svc = loader_svc;
     loader_svc = new_svc;
+    loader_svc_no_batch = false;
+    loader_svc_no_prelink = false;
     pthread_rwlock_unlock(&lock);
     return old_svc;
 }
@@ -2264,8 +2352,204 @@ __NO_SAFESTACK static void loader_svc_config(const char* config) {
                  config, _zx_status_get_string(status));
 }
 
+// Results of the last LOADER_SVC_OP_LOAD_PRELINKED or
+// LOADER_SVC_OP_LOAD_OBJECTS request, which get_library_vmo hands out
+// in place of separate requests.
+// The names point into the string tables of the modules needing them.
+static struct {
+    const char* name;
+    zx_handle_t vmo;
+    zx_status_t status;
+    struct prelinked prelinked;
+} prefetched_vmos[LOADER_SVC_BATCH_MAX];
+static size_t prefetched_count;
+
+__NO_SAFESTACK static void prefetch_discard(void) {
+    for (size_t i = 0; i < prefetched_count; ++i) {
+        if (prefetched_vmos[i].vmo != ZX_HANDLE_INVALID)
+            _zx_handle_close(prefetched_vmos[i].vmo);
+        if (prefetched_vmos[i].prelinked.vmo != ZX_HANDLE_INVALID)
+            _zx_handle_close(prefetched_vmos[i].prelinked.vmo);
+    }
+    prefetched_count = 0;
+}
+
+// Sends a LOADER_SVC_OP_LOAD_PRELINKED request if |prelink| is set,
+// or a LOADER_SVC_OP_LOAD_OBJECTS request otherwise, and fills in
+// prefetched_vmos from the reply.
+__NO_SAFESTACK static zx_status_t loader_svc_batch_rpc(
+    const char* const* names, size_t count, bool prelink) {
+    static struct {
+        zx_loader_svc_msg_t header;
+        uint8_t data[LOADER_SVC_MSG_MAX - sizeof(zx_loader_svc_msg_t)];
+    } msg;
+    static zx_handle_t handles[2 * LOADER_SVC_BATCH_MAX];
+
+    loader_svc_rpc_in_progress = true;
+
+    memset(&msg.header, 0, sizeof msg.header);
+    msg.header.txid = atomic_fetch_add(&loader_svc_txid, 1);
+    msg.header.opcode = prelink ? LOADER_SVC_OP_LOAD_PRELINKED :
+        LOADER_SVC_OP_LOAD_OBJECTS;
+    msg.header.arg = count;
+    size_t len = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t n = strlen(names[i]) + 1;
+        memcpy(&msg.data[len], names[i], n);
+        len += n;
+    }
+
+    zx_channel_call_args_t call = {
+        .wr_bytes = &msg,
+        .wr_num_bytes = sizeof(msg.header) + len,
+        .wr_handles = NULL,
+        .wr_num_handles = 0,
+        .rd_bytes = &msg,
+        .rd_num_bytes = sizeof(msg),
+        .rd_handles = handles,
+        .rd_num_handles = prelink ? 2 * count : count,
+    };
+
+    uint32_t reply_size;
+    uint32_t handle_count;
+    zx_status_t read_status = ZX_OK;
+    zx_status_t status = _zx_channel_call(loader_svc, 0, ZX_TIME_INFINITE,
+                                          &call, &reply_size, &handle_count,
+                                          &read_status);
+    if (status != ZX_OK) {
+        if (status == ZX_ERR_CALL_FAILED && read_status != ZX_OK)
+            status = read_status;
+        goto out;
+    }
+
+    const size_t record_size = prelink ? sizeof(zx_loader_svc_prelink_t) :
+        sizeof(int32_t);
+    if (msg.header.opcode != LOADER_SVC_OP_STATUS ||
+        (msg.header.arg == ZX_OK &&
+         reply_size != sizeof(msg.header) + count * record_size)) {
+        status = ZX_ERR_INVALID_ARGS;
+    } else {
+        status = msg.header.arg;
+    }
+
+    // There must be exactly one VMO for each name that was found,
+    // and a second one for each name with a prelink bias.
+    size_t used = 0;
+    for (size_t i = 0; status == ZX_OK && i < count; ++i) {
+        zx_loader_svc_prelink_t record = {};
+        memcpy(&record, &msg.data[i * record_size], record_size);
+        prefetched_vmos[i].name = names[i];
+        prefetched_vmos[i].status = record.status;
+        prefetched_vmos[i].vmo = ZX_HANDLE_INVALID;
+        prefetched_vmos[i].prelinked.vmo = ZX_HANDLE_INVALID;
+        prefetched_vmos[i].prelinked.bias = record.bias;
+        if (record.status != ZX_OK)
+            continue;
+        size_t needed = record.bias != 0 ? 2 : 1;
+        if (handle_count - used < needed) {
+            status = ZX_ERR_INVALID_ARGS;
+            break;
+        }
+        prefetched_vmos[i].vmo = handles[used++];
+        if (record.bias != 0)
+            prefetched_vmos[i].prelinked.vmo = handles[used++];
+    }
+    if (status == ZX_OK && used != handle_count)
+        status = ZX_ERR_INVALID_ARGS;
+    if (status == ZX_OK) {
+        prefetched_count = count;
+    } else {
+        for (size_t i = 0; i < handle_count; ++i)
+            _zx_handle_close(handles[i]);
+    }
+
+out:
+    loader_svc_rpc_in_progress = false;
+    return status;
+}
+
+// Sends the batch with the richest request the loader service supports.
+__NO_SAFESTACK static zx_status_t loader_svc_batch(const char* const* names,
+                                                   size_t count) {
+    zx_status_t status = ZX_ERR_NOT_SUPPORTED;
+    if (!loader_svc_no_prelink) {
+        status = loader_svc_batch_rpc(names, count, true);
+        if (status == ZX_ERR_INVALID_ARGS || status == ZX_ERR_NOT_SUPPORTED)
+            loader_svc_no_prelink = true;
+        else
+            return status;
+    }
+    // A single module is no better off batched without prelinking.
+    if (count < 2 || loader_svc_no_batch)
+        return status;
+    status = loader_svc_batch_rpc(names, count, false);
+    if (status == ZX_ERR_INVALID_ARGS || status == ZX_ERR_NOT_SUPPORTED)
+        loader_svc_no_batch = true;
+    return status;
+}
+
+// Fetches the VMOs for the DT_NEEDED entries of p and the modules after
+// it which are not loaded yet, with a single request to the loader
+// service. Failures are ignored: get_library_vmo falls back to asking
+// for each module on its own.
+__NO_SAFESTACK static void prefetch_library_vmos(struct dso* p) {
+    prefetch_discard();
+    if (loader_svc == ZX_HANDLE_INVALID ||
+        (loader_svc_no_prelink && loader_svc_no_batch))
+        return;
+
+    const char* names[LOADER_SVC_BATCH_MAX];
+    size_t count = 0;
+    size_t len = 0;
+    for (; p != NULL && count < LOADER_SVC_BATCH_MAX; p = dso_next(p)) {
+        for (size_t i = 0; p->l_map.l_ld[i].d_tag; i++) {
+            if (p->l_map.l_ld[i].d_tag != DT_NEEDED)
+                continue;
+            const char* name = p->strings + p->l_map.l_ld[i].d_un.d_val;
+            size_t n = strlen(name) + 1;
+            if (n == 1 || library_known(name) ||
+                len + n > LOADER_SVC_MSG_MAX - sizeof(zx_loader_svc_msg_t))
+                continue;
+            bool dup = false;
+            for (size_t j = 0; j < count && !dup; ++j)
+                dup = !strcmp(names[j], name);
+            if (dup)
+                continue;
+            names[count++] = name;
+            len += n;
+            if (count == LOADER_SVC_BATCH_MAX)
+                break;
+        }
+    }
+
+    if (count > 0)
+        loader_svc_batch(names, count);
+}
+
 __NO_SAFESTACK static zx_status_t get_library_vmo(const char* name,
-                                                  zx_handle_t* result) {
+                                                  zx_handle_t* result,
+                                                  struct prelinked* prelinked) {
+    prelinked->vmo = ZX_HANDLE_INVALID;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < prefetched_count; ++i) {
+            if (prefetched_vmos[i].name != NULL &&
+                !strcmp(prefetched_vmos[i].name, name)) {
+                *result = prefetched_vmos[i].vmo;
+                *prelinked = prefetched_vmos[i].prelinked;
+                prefetched_vmos[i].vmo = ZX_HANDLE_INVALID;
+                prefetched_vmos[i].prelinked.vmo = ZX_HANDLE_INVALID;
+                prefetched_vmos[i].name = NULL;
+                return prefetched_vmos[i].status;
+            }
+        }
+        // Something not prefetched, like the module named to dlopen,
+        // can still come prelinked as a batch of one.
+        if (pass > 0 || prefetched_count > 0 ||
+            loader_svc == ZX_HANDLE_INVALID || loader_svc_no_prelink)
+            break;
+        if (loader_svc_batch(&name, 1) != ZX_OK)
+            break;
+    }
     if (loader_svc == ZX_HANDLE_INVALID) {
         error("cannot look up \"%s\" with no loader service", name);
         return ZX_ERR_UNAVAILABLE;
@@ -0,0 +1,45 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "libc.h"
+#include <arm_neon.h>
+#include <stdint.h>
+#include <string.h>
+
+// cortex-strings has no memrchr, so this is a NEON version of the same
+// backwards scan the x86-64 one does.  NEON has no byte movemask, so each
+// comparison is narrowed to four bits per byte of a 64-bit mask.
+
+static inline uint64_t match16(uint8x16_t v, uint8x16_t c) {
+    uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(v, c)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+}
+
+static inline void* last_match(const unsigned char* block, uint64_t mask) {
+    return (void*)(block + (63 - __builtin_clzll(mask)) / 4);
+}
+
+void* __memrchr(const void* src, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+    const uint8x16_t cv = vdupq_n_u8((unsigned char)c);
+    const unsigned char* s = src;
+    const unsigned char* last = s + n - 1;
+    const unsigned char* block = (const void*)((uintptr_t)last & -16);
+    // For a full block 2 << 63 wraps to zero, keeping all 64 bits.
+    uint64_t mask = match16(vld1q_u8(block), cv) &
+                    ((UINT64_C(2) << ((last - block) * 4 + 3)) - 1);
+    for (;;) {
+        if (block <= s) {
+            mask &= ~UINT64_C(0) << ((s - block) * 4);
+            return mask ? last_match(block, mask) : NULL;
+        }
+        if (mask)
+            return last_match(block, mask);
+        block -= 16;
+        mask = match16(vld1q_u8(block), cv);
+    }
+}
+
+weak_alias(__memrchr, memrchr);
@@ -5,7 +5,6 @@ LOCAL_SRCS += \
     $(GET_LOCAL_DIR)/index.c \
     $(GET_LOCAL_DIR)/memccpy.c \
     $(GET_LOCAL_DIR)/memmem.c \
-    $(GET_LOCAL_DIR)/memrchr.c \
     $(GET_LOCAL_DIR)/rindex.c \
     $(GET_LOCAL_DIR)/stpcpy.c \
     $(GET_LOCAL_DIR)/stpncpy.c \
@@ -106,15 +105,42 @@ LOCAL_SRCS += \
 
 else
 
+LOCAL_SRCS += \
+    $(GET_LOCAL_DIR)/strchr.c \
+    $(GET_LOCAL_DIR)/strcpy.c \
+    $(GET_LOCAL_DIR)/strncmp.c \
+    $(GET_LOCAL_DIR)/strnlen.c \
+
+endif
+
+# The SSE2/AVX2 and NEON versions read whole aligned vectors past the end
+# of the string, which ASan would diagnose, so use the C versions there.
+ifeq ($(SUBARCH):$(call TOBOOL,$(USE_ASAN)),x86-64:false)
+
+LOCAL_SRCS += \
+    $(GET_LOCAL_DIR)/x86_64/memchr.c \
+    $(GET_LOCAL_DIR)/x86_64/memcmp.c \
+    $(GET_LOCAL_DIR)/x86_64/memrchr.c \
+    $(GET_LOCAL_DIR)/x86_64/strchrnul.c \
+    $(GET_LOCAL_DIR)/x86_64/strcmp.c \
+    $(GET_LOCAL_DIR)/x86_64/strlen.c \
+
+else ifeq ($(ARCH):$(call TOBOOL,$(USE_ASAN)),arm64:false)
+
+LOCAL_SRCS += $(GET_LOCAL_DIR)/aarch64/memrchr.c
+
+else ifeq ($(ARCH),arm64)
+
+LOCAL_SRCS += $(GET_LOCAL_DIR)/memrchr.c
+
+else
+
 LOCAL_SRCS += \
     $(GET_LOCAL_DIR)/memchr.c \
     $(GET_LOCAL_DIR)/memcmp.c \
-    $(GET_LOCAL_DIR)/strchr.c \
+    $(GET_LOCAL_DIR)/memrchr.c \
     $(GET_LOCAL_DIR)/strchrnul.c \
     $(GET_LOCAL_DIR)/strcmp.c \
-    $(GET_LOCAL_DIR)/strcpy.c \
     $(GET_LOCAL_DIR)/strlen.c \
-    $(GET_LOCAL_DIR)/strncmp.c \
-    $(GET_LOCAL_DIR)/strnlen.c \
 
 endif
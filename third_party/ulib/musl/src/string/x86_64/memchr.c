@@ -0,0 +1,65 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "simd.h"
+#include <string.h>
+
+static void* memchr_sse2(const void* src, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+    const __m128i cv = _mm_set1_epi8((char)c);
+    const unsigned char* s = src;
+    const __m128i* p = align_down(s, 16);
+    size_t skip = s - (const unsigned char*)p;
+    unsigned int mask = match16(_mm_load_si128(p), cv) >> skip;
+    if (mask) {
+        size_t i = __builtin_ctz(mask);
+        return i < n ? (void*)(s + i) : NULL;
+    }
+    if (n <= 16 - skip)
+        return NULL;
+    // From here on |n| counts the bytes left from the start of |p|.
+    n -= 16 - skip;
+    for (;;) {
+        mask = match16(_mm_load_si128(++p), cv);
+        if (mask) {
+            size_t i = __builtin_ctz(mask);
+            return i < n ? (void*)((const unsigned char*)p + i) : NULL;
+        }
+        if (n <= 16)
+            return NULL;
+        n -= 16;
+    }
+}
+
+AVX2 static void* memchr_avx2(const void* src, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+    const __m256i cv = _mm256_set1_epi8((char)c);
+    const unsigned char* s = src;
+    const __m256i* p = align_down(s, 32);
+    size_t skip = s - (const unsigned char*)p;
+    unsigned int mask = match32(_mm256_load_si256(p), cv) >> skip;
+    if (mask) {
+        size_t i = __builtin_ctz(mask);
+        return i < n ? (void*)(s + i) : NULL;
+    }
+    if (n <= 32 - skip)
+        return NULL;
+    n -= 32 - skip;
+    for (;;) {
+        mask = match32(_mm256_load_si256(++p), cv);
+        if (mask) {
+            size_t i = __builtin_ctz(mask);
+            return i < n ? (void*)((const unsigned char*)p + i) : NULL;
+        }
+        if (n <= 32)
+            return NULL;
+        n -= 32;
+    }
+}
+
+void* memchr(const void* src, int c, size_t n) {
+    return use_avx2() ? memchr_avx2(src, c, n) : memchr_sse2(src, c, n);
+}
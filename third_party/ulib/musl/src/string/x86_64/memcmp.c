@@ -0,0 +1,59 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "simd.h"
+#include <string.h>
+
+// The two buffers need not be aligned alike, so these use unaligned loads
+// and never read past the end of either.  The last block is loaded so it
+// ends exactly at the end of the buffers, overlapping bytes that are
+// already known to match.
+
+static int memcmp_bytes(const unsigned char* l, const unsigned char* r, size_t n) {
+    for (; n && *l == *r; n--, l++, r++)
+        ;
+    return n ? *l - *r : 0;
+}
+
+static int memcmp_sse2(const void* vl, const void* vr, size_t n) {
+    const unsigned char* l = vl;
+    const unsigned char* r = vr;
+    if (n < 16)
+        return memcmp_bytes(l, r, n);
+    for (size_t i = 0;; i += 16) {
+        if (i > n - 16)
+            i = n - 16;
+        unsigned int mask = match16(_mm_loadu_si128((const void*)(l + i)),
+                                    _mm_loadu_si128((const void*)(r + i))) ^ 0xffff;
+        if (mask) {
+            i += __builtin_ctz(mask);
+            return l[i] - r[i];
+        }
+        if (i == n - 16)
+            return 0;
+    }
+}
+
+AVX2 static int memcmp_avx2(const void* vl, const void* vr, size_t n) {
+    const unsigned char* l = vl;
+    const unsigned char* r = vr;
+    if (n < 32)
+        return memcmp_sse2(l, r, n);
+    for (size_t i = 0;; i += 32) {
+        if (i > n - 32)
+            i = n - 32;
+        unsigned int mask = ~match32(_mm256_loadu_si256((const void*)(l + i)),
+                                     _mm256_loadu_si256((const void*)(r + i)));
+        if (mask) {
+            i += __builtin_ctz(mask);
+            return l[i] - r[i];
+        }
+        if (i == n - 32)
+            return 0;
+    }
+}
+
+int memcmp(const void* vl, const void* vr, size_t n) {
+    return use_avx2() ? memcmp_avx2(vl, vr, n) : memcmp_sse2(vl, vr, n);
+}
@@ -0,0 +1,59 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "simd.h"
+#include <string.h>
+
+// Scans backwards one aligned block at a time from the block holding the
+// last byte.  The first mask drops the bytes past the end, and the block
+// holding |src| drops the bytes before it.
+
+static void* memrchr_sse2(const void* src, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+    const __m128i cv = _mm_set1_epi8((char)c);
+    const unsigned char* s = src;
+    const unsigned char* last = s + n - 1;
+    const __m128i* p = align_down(last, 16);
+    unsigned int mask = match16(_mm_load_si128(p), cv) &
+                        ((2u << (last - (const unsigned char*)p)) - 1);
+    for (;;) {
+        const unsigned char* block = (const unsigned char*)p;
+        if (block <= s) {
+            mask &= ~0u << (s - block);
+            return mask ? (void*)(block + 31 - __builtin_clz(mask)) : NULL;
+        }
+        if (mask)
+            return (void*)(block + 31 - __builtin_clz(mask));
+        mask = match16(_mm_load_si128(--p), cv);
+    }
+}
+
+AVX2 static void* memrchr_avx2(const void* src, int c, size_t n) {
+    if (n == 0)
+        return NULL;
+    const __m256i cv = _mm256_set1_epi8((char)c);
+    const unsigned char* s = src;
+    const unsigned char* last = s + n - 1;
+    const __m256i* p = align_down(last, 32);
+    // For a full block 2u << 31 wraps to zero, keeping all 32 bits.
+    unsigned int mask = match32(_mm256_load_si256(p), cv) &
+                        ((2u << (last - (const unsigned char*)p)) - 1);
+    for (;;) {
+        const unsigned char* block = (const unsigned char*)p;
+        if (block <= s) {
+            mask &= ~0u << (s - block);
+            return mask ? (void*)(block + 31 - __builtin_clz(mask)) : NULL;
+        }
+        if (mask)
+            return (void*)(block + 31 - __builtin_clz(mask));
+        mask = match32(_mm256_load_si256(--p), cv);
+    }
+}
+
+void* __memrchr(const void* src, int c, size_t n) {
+    return use_avx2() ? memrchr_avx2(src, c, n) : memrchr_sse2(src, c, n);
+}
+
+weak_alias(__memrchr, memrchr);
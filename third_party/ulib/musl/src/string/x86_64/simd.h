@@ -0,0 +1,39 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include "hwcap.h"
+#include "libc.h"
+#include <immintrin.h>
+#include <stdint.h>
+
+// The string routines here come in an SSE2 flavor, which every x86-64
+// CPU has, and an AVX2 flavor that doubles the width.  Each public entry
+// point picks one using __hwcap.
+//
+// Like the generic C versions, these read whole aligned vectors, and so
+// past the end of the string, which is safe because an aligned vector
+// never crosses a page boundary.  They are not used under ASan, which
+// would diagnose those reads.
+
+#define AVX2 __attribute__((target("avx2")))
+
+static inline int use_avx2(void) {
+    return __hwcap & HWCAP_X86_AVX2;
+}
+
+// Returns a bit per byte of |v| that equals the corresponding byte of |c|.
+static inline unsigned int match16(__m128i v, __m128i c) {
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, c));
+}
+
+AVX2 static inline unsigned int match32(__m256i v, __m256i c) {
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, c));
+}
+
+// Rounds |p| down to a multiple of |align|.
+static inline const void* align_down(const void* p, uintptr_t align) {
+    return (const void*)((uintptr_t)p & -align);
+}
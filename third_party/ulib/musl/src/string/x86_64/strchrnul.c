@@ -0,0 +1,50 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "simd.h"
+#include <string.h>
+
+// Returns a bit per byte of |v| that is either NUL or |c|.
+static inline unsigned int nul_or_c16(__m128i v, __m128i c) {
+    return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_setzero_si128()),
+                                          _mm_cmpeq_epi8(v, c)));
+}
+
+AVX2 static inline unsigned int nul_or_c32(__m256i v, __m256i c) {
+    return _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()),
+                        _mm256_cmpeq_epi8(v, c)));
+}
+
+static char* strchrnul_sse2(const char* s, int c) {
+    const __m128i cv = _mm_set1_epi8((char)c);
+    const __m128i* p = align_down(s, 16);
+    unsigned int mask = nul_or_c16(_mm_load_si128(p), cv) >> (s - (const char*)p);
+    if (mask)
+        return (char*)s + __builtin_ctz(mask);
+    for (;;) {
+        mask = nul_or_c16(_mm_load_si128(++p), cv);
+        if (mask)
+            return (char*)p + __builtin_ctz(mask);
+    }
+}
+
+AVX2 static char* strchrnul_avx2(const char* s, int c) {
+    const __m256i cv = _mm256_set1_epi8((char)c);
+    const __m256i* p = align_down(s, 32);
+    unsigned int mask = nul_or_c32(_mm256_load_si256(p), cv) >> (s - (const char*)p);
+    if (mask)
+        return (char*)s + __builtin_ctz(mask);
+    for (;;) {
+        mask = nul_or_c32(_mm256_load_si256(++p), cv);
+        if (mask)
+            return (char*)p + __builtin_ctz(mask);
+    }
+}
+
+char* __strchrnul(const char* s, int c) {
+    return use_avx2() ? strchrnul_avx2(s, c) : strchrnul_sse2(s, c);
+}
+
+weak_alias(__strchrnul, strchrnul);
@@ -0,0 +1,69 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "simd.h"
+#include <string.h>
+
+// The two strings need not be aligned alike, so these use unaligned loads.
+// A load is only done when neither string is close enough to the end of a
+// page for it to cross into the next one; otherwise they step one byte
+// until both are clear of the boundary.
+
+#define PAGE_SIZE 4096
+
+static inline int near_page_end(const unsigned char* p, size_t len) {
+    return ((uintptr_t)p & (PAGE_SIZE - 1)) > PAGE_SIZE - len;
+}
+
+static int strcmp_sse2(const char* vl, const char* vr) {
+    const unsigned char* l = (const void*)vl;
+    const unsigned char* r = (const void*)vr;
+    const __m128i zero = _mm_setzero_si128();
+    for (;;) {
+        if (near_page_end(l, 16) || near_page_end(r, 16)) {
+            if (*l != *r || *l == 0)
+                return *l - *r;
+            ++l;
+            ++r;
+            continue;
+        }
+        __m128i a = _mm_loadu_si128((const void*)l);
+        __m128i b = _mm_loadu_si128((const void*)r);
+        unsigned int mask = (match16(a, b) ^ 0xffff) | match16(a, zero);
+        if (mask) {
+            size_t i = __builtin_ctz(mask);
+            return l[i] - r[i];
+        }
+        l += 16;
+        r += 16;
+    }
+}
+
+AVX2 static int strcmp_avx2(const char* vl, const char* vr) {
+    const unsigned char* l = (const void*)vl;
+    const unsigned char* r = (const void*)vr;
+    const __m256i zero = _mm256_setzero_si256();
+    for (;;) {
+        if (near_page_end(l, 32) || near_page_end(r, 32)) {
+            if (*l != *r || *l == 0)
+                return *l - *r;
+            ++l;
+            ++r;
+            continue;
+        }
+        __m256i a = _mm256_loadu_si256((const void*)l);
+        __m256i b = _mm256_loadu_si256((const void*)r);
+        unsigned int mask = ~match32(a, b) | match32(a, zero);
+        if (mask) {
+            size_t i = __builtin_ctz(mask);
+            return l[i] - r[i];
+        }
+        l += 32;
+        r += 32;
+    }
+}
+
+int strcmp(const char* l, const char* r) {
+    return use_avx2() ? strcmp_avx2(l, r) : strcmp_sse2(l, r);
+}
@@ -0,0 +1,36 @@
+// Copyright 2017 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "simd.h"
+#include <string.h>
+
+static size_t strlen_sse2(const char* s) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i* p = align_down(s, 16);
+    unsigned int mask = match16(_mm_load_si128(p), zero) >> (s - (const char*)p);
+    if (mask)
+        return __builtin_ctz(mask);
+    for (;;) {
+        mask = match16(_mm_load_si128(++p), zero);
+        if (mask)
+            return (const char*)p + __builtin_ctz(mask) - s;
+    }
+}
+
+AVX2 static size_t strlen_avx2(const char* s) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i* p = align_down(s, 32);
+    unsigned int mask = match32(_mm256_load_si256(p), zero) >> (s - (const char*)p);
+    if (mask)
+        return __builtin_ctz(mask);
+    for (;;) {
+        mask = match32(_mm256_load_si256(++p), zero);
+        if (mask)
+            return (const char*)p + __builtin_ctz(mask) - s;
+    }
+}
+
+size_t strlen(const char* s) {
+    return use_avx2() ? strlen_avx2(s) : strlen_sse2(s);
+}